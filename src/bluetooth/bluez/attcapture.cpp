@@ -0,0 +1,325 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtBluetooth module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#include "attcapture_p.h"
+#include "../qlowenergycontroller.h"
+#include "../qlowenergycontroller_bluez_p.h"
+
+#include <QtCore/QLoggingCategory>
+#include <QtCore/QMutexLocker>
+#include <QtCore/QSocketNotifier>
+#include <QtCore/QtEndian>
+#include <QtCore/private/qcore_unix_p.h>
+
+#include <chrono>
+#include <errno.h>
+#include <sys/socket.h>
+
+QT_BEGIN_NAMESPACE
+
+Q_DECLARE_LOGGING_CATEGORY(QT_BT_BLUEZ)
+
+namespace {
+
+// btsnoop format as described in RFC 1761 and used by the BlueZ tools
+constexpr char btsnoopMagic[8] = { 'b', 't', 's', 'n', 'o', 'o', 'p', '\0' };
+constexpr quint32 btsnoopVersion = 1;
+constexpr quint32 btsnoopDatalinkH4 = 1002;
+constexpr quint32 btsnoopFlagReceived = 0x01;
+// microseconds between 0000-01-01 and 1970-01-01
+constexpr qint64 btsnoopEpochDelta = 0x00dcddb30f2f8000LL;
+
+constexpr quint8 h4AclPacket = 0x02;
+constexpr quint16 aclStartFlag = 0x2000;
+constexpr quint16 attCid = 0x0004;
+constexpr int aclHeaderSize = 1 + 4;  // H4 indicator, handle and length
+constexpr int l2capHeaderSize = 4;    // length and CID
+
+constexpr int maxReplayPacketSize = 1024;
+
+} // namespace
+
+AttCapture::AttCapture(const QString &fileName)
+    : file(fileName)
+{
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qCWarning(QT_BT_BLUEZ) << "Cannot open ATT capture file" << fileName
+                               << file.errorString();
+        return;
+    }
+
+    char header[16];
+    memcpy(header, btsnoopMagic, sizeof btsnoopMagic);
+    qToBigEndian<quint32>(btsnoopVersion, header + 8);
+    qToBigEndian<quint32>(btsnoopDatalinkH4, header + 12);
+    file.write(header, sizeof header);
+    file.flush();
+}
+
+AttCapture::~AttCapture()
+{
+}
+
+quint16 AttCapture::openChannel()
+{
+    QMutexLocker locker(&mutex);
+    // ACL handles are 12 bit wide
+    lastChannel = (lastChannel + 1) & 0x0fff;
+    if (lastChannel == 0)
+        lastChannel = 1;
+    return lastChannel;
+}
+
+void AttCapture::record(quint16 channel, AttCaptureRecord::Direction direction,
+                        QByteArrayView pdu)
+{
+    using namespace std::chrono;
+    const qint64 now = duration_cast<microseconds>(
+                system_clock::now().time_since_epoch()).count();
+
+    const quint32 length = quint32(aclHeaderSize + l2capHeaderSize + pdu.size());
+    char header[24 + aclHeaderSize + l2capHeaderSize];
+    qToBigEndian<quint32>(length, header);       // original length
+    qToBigEndian<quint32>(length, header + 4);   // included length
+    qToBigEndian<quint32>(direction == AttCaptureRecord::Received ? btsnoopFlagReceived : 0,
+                          header + 8);
+    qToBigEndian<quint32>(0, header + 12);       // cumulative drops
+    qToBigEndian<qint64>(now + btsnoopEpochDelta, header + 16);
+
+    char *acl = header + 24;
+    acl[0] = char(h4AclPacket);
+    qToLittleEndian<quint16>(aclStartFlag | (channel & 0x0fff), acl + 1);
+    qToLittleEndian<quint16>(quint16(l2capHeaderSize + pdu.size()), acl + 3);
+    qToLittleEndian<quint16>(quint16(pdu.size()), acl + 5);
+    qToLittleEndian<quint16>(attCid, acl + 7);
+
+    QMutexLocker locker(&mutex);
+    if (!file.isOpen())
+        return;
+    file.write(header, sizeof header);
+    file.write(pdu.data(), pdu.size());
+    // The process-wide capture is never closed, keep the file usable after a crash
+    file.flush();
+}
+
+AttCapture *AttCapture::fromEnvironment()
+{
+    // Intentionally leaked, controllers may still record during static destruction
+    static AttCapture *const capture = []() -> AttCapture * {
+        const QString fileName = qEnvironmentVariable("QT_BLUETOOTH_ATT_CAPTURE");
+        if (fileName.isEmpty())
+            return nullptr;
+        auto *capture = new AttCapture(fileName);
+        if (!capture->isOpen()) {
+            delete capture;
+            return nullptr;
+        }
+        qCDebug(QT_BT_BLUEZ) << "Capturing ATT traffic to" << fileName;
+        return capture;
+    }();
+    return capture;
+}
+
+QList<AttCaptureRecord> AttCapture::readFile(const QString &fileName, bool *ok)
+{
+    QList<AttCaptureRecord> records;
+    if (ok)
+        *ok = false;
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qCWarning(QT_BT_BLUEZ) << "Cannot open ATT capture file" << fileName
+                               << file.errorString();
+        return records;
+    }
+
+    const QByteArray header = file.read(16);
+    if (header.size() != 16 || memcmp(header.constData(), btsnoopMagic, sizeof btsnoopMagic) != 0
+            || qFromBigEndian<quint32>(header.constData() + 8) != btsnoopVersion
+            || qFromBigEndian<quint32>(header.constData() + 12) != btsnoopDatalinkH4) {
+        qCWarning(QT_BT_BLUEZ) << "Not a btsnoop H4 capture:" << fileName;
+        return records;
+    }
+
+    while (!file.atEnd()) {
+        const QByteArray recordHeader = file.read(24);
+        if (recordHeader.size() != 24) {
+            qCWarning(QT_BT_BLUEZ) << "Truncated record header in" << fileName;
+            return records;
+        }
+        const quint32 includedLength = qFromBigEndian<quint32>(recordHeader.constData() + 4);
+        const QByteArray data = file.read(includedLength);
+        if (quint32(data.size()) != includedLength) {
+            qCWarning(QT_BT_BLUEZ) << "Truncated record in" << fileName;
+            return records;
+        }
+
+        // Only complete ATT PDUs on the fixed channel are of interest
+        if (data.size() < aclHeaderSize + l2capHeaderSize || quint8(data.at(0)) != h4AclPacket)
+            continue;
+        const char *acl = data.constData();
+        const quint16 l2capLength = qFromLittleEndian<quint16>(acl + 5);
+        if (qFromLittleEndian<quint16>(acl + 7) != attCid
+                || l2capLength > data.size() - aclHeaderSize - l2capHeaderSize) {
+            continue;
+        }
+
+        AttCaptureRecord record;
+        const quint32 flags = qFromBigEndian<quint32>(recordHeader.constData() + 8);
+        record.direction = (flags & btsnoopFlagReceived) ? AttCaptureRecord::Received
+                                                         : AttCaptureRecord::Sent;
+        record.channel = qFromLittleEndian<quint16>(acl + 1) & 0x0fff;
+        record.timestamp = qFromBigEndian<qint64>(recordHeader.constData() + 16)
+                - btsnoopEpochDelta;
+        record.pdu = data.mid(aclHeaderSize + l2capHeaderSize, l2capLength);
+        records.append(record);
+    }
+
+    if (ok)
+        *ok = true;
+    return records;
+}
+
+#ifdef QT_BUILD_INTERNAL
+
+AttReplayDriver::AttReplayDriver(const QList<AttCaptureRecord> &records, QObject *parent)
+    : QObject(parent), records(records)
+{
+}
+
+AttReplayDriver::~AttReplayDriver()
+{
+    if (socket != -1)
+        qt_safe_close(socket);
+}
+
+bool AttReplayDriver::attach(QLowEnergyController *controller)
+{
+    Q_ASSERT(controller);
+    auto *d = qobject_cast<QLowEnergyControllerPrivateBluez *>(
+            QLowEnergyControllerPrivate::get(controller));
+    if (!d) {
+        qCWarning(QT_BT_BLUEZ) << "ATT replay requires the kernel based controller backend";
+        return false;
+    }
+    if (socket != -1) {
+        qCWarning(QT_BT_BLUEZ) << "ATT replay driver is already attached";
+        return false;
+    }
+
+    int sockets[2];
+    if (::socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, sockets) != 0) {
+        qCWarning(QT_BT_BLUEZ) << "Cannot create ATT replay socket pair:" << qt_error_string(errno);
+        return false;
+    }
+
+    socket = sockets[0];
+    readNotifier = new QSocketNotifier(socket, QSocketNotifier::Read, this);
+    readNotifier->setEnabled(false);
+    connect(readNotifier, &QSocketNotifier::activated, this, &AttReplayDriver::readPacket);
+
+    d->attachAttSocket(sockets[1]);
+    return true;
+}
+
+void AttReplayDriver::start()
+{
+    if (socket == -1) {
+        qCWarning(QT_BT_BLUEZ) << "ATT replay driver is not attached";
+        return;
+    }
+    advance();
+}
+
+void AttReplayDriver::advance()
+{
+    while (position < records.size()) {
+        const AttCaptureRecord &record = records.at(position);
+        if (record.direction == AttCaptureRecord::Sent) {
+            // Wait for the controller to produce the captured packet
+            readNotifier->setEnabled(true);
+            return;
+        }
+
+        if (qt_safe_write(socket, record.pdu.constData(), record.pdu.size()) < 0) {
+            qCWarning(QT_BT_BLUEZ) << "Cannot replay ATT packet:" << qt_error_string(errno);
+            return;
+        }
+        ++position;
+    }
+
+    readNotifier->setEnabled(false);
+    emit finished();
+}
+
+void AttReplayDriver::readPacket()
+{
+    char buffer[maxReplayPacketSize];
+    const qint64 size = qt_safe_read(socket, buffer, sizeof buffer);
+    if (size < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            qCWarning(QT_BT_BLUEZ) << "Cannot read replayed ATT packet:" << qt_error_string(errno);
+            readNotifier->setEnabled(false);
+        }
+        return;
+    }
+    if (size == 0) {
+        // the controller closed its end, the replay cannot continue
+        readNotifier->setEnabled(false);
+        return;
+    }
+    if (position >= records.size())
+        return;
+
+    const QByteArray actual(buffer, size);
+    const QByteArray &expected = records.at(position).pdu;
+    if (actual != expected) {
+        ++mismatchCount;
+        qCDebug(QT_BT_BLUEZ) << "ATT replay mismatch at record" << position << "expected"
+                             << expected.toHex() << "got" << actual.toHex();
+        emit mismatch(int(position), expected, actual);
+    }
+    ++position;
+    advance();
+}
+
+#endif // QT_BUILD_INTERNAL
+
+QT_END_NAMESPACE
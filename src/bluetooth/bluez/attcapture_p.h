@@ -0,0 +1,155 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtBluetooth module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#ifndef ATTCAPTURE_P_H
+#define ATTCAPTURE_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtCore/QByteArray>
+#include <QtCore/QByteArrayView>
+#include <QtCore/QFile>
+#include <QtCore/QList>
+#include <QtCore/QMutex>
+#include <QtCore/QObject>
+#include <QtBluetooth/qtbluetoothglobal.h>
+
+QT_BEGIN_NAMESPACE
+
+class QLowEnergyController;
+class QSocketNotifier;
+
+struct AttCaptureRecord
+{
+    enum Direction { Sent, Received };
+
+    Direction direction = Sent;
+    quint16 channel = 0;
+    qint64 timestamp = 0; // microseconds since the Unix epoch
+    QByteArray pdu;
+};
+
+/*
+ * Writes ATT PDUs to a btsnoop file (datalink type H4) so that they can be
+ * inspected with Wireshark or btmon and replayed by AttReplayDriver.
+ *
+ * Every PDU is wrapped into an ACL and L2CAP header for the ATT fixed channel.
+ * The ACL handle carries a capture channel rather than the HCI connection
+ * handle, since the latter is not known to every controller. Writes are
+ * serialized, one capture file can be shared by all controllers of a process.
+ */
+class Q_AUTOTEST_EXPORT AttCapture
+{
+public:
+    explicit AttCapture(const QString &fileName);
+    ~AttCapture();
+
+    bool isOpen() const { return file.isOpen(); }
+    QString fileName() const { return file.fileName(); }
+
+    quint16 openChannel();
+    void record(quint16 channel, AttCaptureRecord::Direction direction, QByteArrayView pdu);
+
+    // Capture selected by QT_BLUETOOTH_ATT_CAPTURE, nullptr if capturing is disabled
+    static AttCapture *fromEnvironment();
+
+    static QList<AttCaptureRecord> readFile(const QString &fileName, bool *ok = nullptr);
+
+private:
+    Q_DISABLE_COPY(AttCapture)
+
+    QMutex mutex;
+    QFile file;
+    quint16 lastChannel = 0;
+};
+
+#ifdef QT_BUILD_INTERNAL
+/*
+ * Plays the records of one capture channel back to a controller. Only built
+ * for developer builds, it exists for autotests.
+ *
+ * The controller is attached to one end of a socket pair instead of an L2CAP
+ * socket. Received records are written to the controller, for every sent record
+ * the driver waits for the next packet of the controller and compares it to the
+ * captured PDU. Timestamps are ignored, records are replayed as fast as the
+ * controller answers.
+ */
+class Q_AUTOTEST_EXPORT AttReplayDriver : public QObject
+{
+    Q_OBJECT
+public:
+    explicit AttReplayDriver(const QList<AttCaptureRecord> &records, QObject *parent = nullptr);
+    ~AttReplayDriver();
+
+    bool attach(QLowEnergyController *controller);
+    void start();
+
+    bool isFinished() const { return position == records.size(); }
+    int replayedRecords() const { return int(position); }
+    int mismatches() const { return mismatchCount; }
+
+signals:
+    void mismatch(int record, const QByteArray &expected, const QByteArray &actual);
+    void finished();
+
+private:
+    void advance();
+    void readPacket();
+
+    QList<AttCaptureRecord> records;
+    qsizetype position = 0;
+    int mismatchCount = 0;
+    int socket = -1;
+    QSocketNotifier *readNotifier = nullptr;
+};
+#endif // QT_BUILD_INTERNAL
+
+QT_END_NAMESPACE
+
+#endif // ATTCAPTURE_P_H
@@ -0,0 +1,238 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtBluetooth module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#include "attloopback_p.h"
+#include "../qlowenergycontroller.h"
+#include "../qlowenergycontroller_bluez_p.h"
+
+#include <QtCore/QLoggingCategory>
+#include <QtCore/QSocketNotifier>
+#include <QtCore/QThread>
+#include <QtCore/QTimer>
+#include <QtCore/private/qcore_unix_p.h>
+
+#include <errno.h>
+#include <sys/socket.h>
+
+QT_BEGIN_NAMESPACE
+
+Q_DECLARE_LOGGING_CATEGORY(QT_BT_BLUEZ)
+
+namespace {
+
+// larger than the biggest ATT MTU of 517 bytes
+constexpr int maxRelayPacketSize = 1024;
+
+bool createSocketPair(int sockets[2])
+{
+    if (::socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, sockets) == 0)
+        return true;
+    qCWarning(QT_BT_BLUEZ) << "Cannot create ATT loopback socket pair:" << qt_error_string(errno);
+    return false;
+}
+
+// A controller on an engine thread takes over the socket on that thread
+void attachSocket(QLowEnergyControllerPrivateBluez *controller, int socketDescriptor)
+{
+    if (controller->thread() == QThread::currentThread()) {
+        controller->attachAttSocket(socketDescriptor);
+        return;
+    }
+    QMetaObject::invokeMethod(controller, [controller, socketDescriptor]() {
+        controller->attachAttSocket(socketDescriptor);
+    }, Qt::BlockingQueuedConnection);
+}
+
+} // namespace
+
+AttLoopback::AttLoopback(QObject *parent)
+    : QObject(parent)
+{
+}
+
+AttLoopback::~AttLoopback()
+{
+    closeSockets();
+}
+
+void AttLoopback::setLatency(int msecs)
+{
+    if (connected) {
+        qCWarning(QT_BT_BLUEZ) << "Cannot change the latency of a connected ATT loopback";
+        return;
+    }
+    latencyMsecs = qMax(0, msecs);
+}
+
+void AttLoopback::setCentralPacketFilter(const PacketFilter &filter)
+{
+    if (connected) {
+        qCWarning(QT_BT_BLUEZ) << "Cannot change the packet filter of a connected ATT loopback";
+        return;
+    }
+    centralFilter = filter;
+}
+
+bool AttLoopback::connectControllers(QLowEnergyController *central,
+                                     QLowEnergyController *peripheral)
+{
+    Q_ASSERT(central && peripheral);
+    auto *centralPrivate = qobject_cast<QLowEnergyControllerPrivateBluez *>(
+            QLowEnergyControllerPrivate::get(central));
+    auto *peripheralPrivate = qobject_cast<QLowEnergyControllerPrivateBluez *>(
+            QLowEnergyControllerPrivate::get(peripheral));
+    if (!centralPrivate || !peripheralPrivate) {
+        qCWarning(QT_BT_BLUEZ) << "ATT loopback requires the kernel based controller backend";
+        return false;
+    }
+    if (central->role() != QLowEnergyController::CentralRole
+            || peripheral->role() != QLowEnergyController::PeripheralRole) {
+        qCWarning(QT_BT_BLUEZ) << "ATT loopback requires a central and a peripheral controller";
+        return false;
+    }
+    // Without a relay the loopback keeps no sockets, remember the connection itself
+    if (connected) {
+        qCWarning(QT_BT_BLUEZ) << "ATT loopback is already connected";
+        return false;
+    }
+
+    int centralPair[2];
+    if (!createSocketPair(centralPair))
+        return false;
+
+    if (latencyMsecs == 0 && !centralFilter) {
+        // The controllers own the descriptors from here on
+        attachSocket(peripheralPrivate, centralPair[1]);
+        attachSocket(centralPrivate, centralPair[0]);
+        connected = true;
+        return true;
+    }
+
+    int peripheralPair[2];
+    if (!createSocketPair(peripheralPair)) {
+        qt_safe_close(centralPair[0]);
+        qt_safe_close(centralPair[1]);
+        return false;
+    }
+
+    sockets = { centralPair[1], peripheralPair[1] };
+    setupDirection(toPeripheral, centralPair[1], peripheralPair[1]);
+    setupDirection(toCentral, peripheralPair[1], centralPair[1]);
+
+    attachSocket(peripheralPrivate, peripheralPair[0]);
+    attachSocket(centralPrivate, centralPair[0]);
+    connected = true;
+    return true;
+}
+
+void AttLoopback::setupDirection(Direction &direction, int from, int to)
+{
+    direction.from = from;
+    direction.to = to;
+    direction.notifier = new QSocketNotifier(from, QSocketNotifier::Read, this);
+    connect(direction.notifier, &QSocketNotifier::activated, this, [this, &direction]() {
+        readPacket(direction);
+    });
+    direction.timer = new QTimer(this);
+    direction.timer->setSingleShot(true);
+    direction.timer->setTimerType(Qt::PreciseTimer);
+    connect(direction.timer, &QTimer::timeout, this, [this, &direction]() {
+        deliverPackets(direction);
+    });
+}
+
+void AttLoopback::readPacket(Direction &direction)
+{
+    char buffer[maxRelayPacketSize];
+    const qint64 size = qt_safe_read(direction.from, buffer, sizeof buffer);
+    if (size < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            qCWarning(QT_BT_BLUEZ) << "Cannot read ATT loopback packet:" << qt_error_string(errno);
+            direction.notifier->setEnabled(false);
+        }
+        return;
+    }
+    if (size == 0) {
+        // the controller closed its end
+        direction.notifier->setEnabled(false);
+        return;
+    }
+
+    direction.pending.append({ QDeadlineTimer(latencyMsecs, Qt::PreciseTimer),
+                               QByteArray(buffer, size) });
+    if (!direction.timer->isActive())
+        direction.timer->start(int(direction.pending.constFirst().first.remainingTime()));
+}
+
+void AttLoopback::deliverPackets(Direction &direction)
+{
+    // All packets are delayed by the same amount, the queue is ordered by deadline
+    while (!direction.pending.isEmpty() && direction.pending.constFirst().first.hasExpired()) {
+        QByteArray packet = direction.pending.takeFirst().second;
+        if (&direction == &toCentral && centralFilter) {
+            packet = centralFilter(packet);
+            if (packet.isEmpty())
+                continue;
+        }
+        if (qt_safe_write(direction.to, packet.constData(), packet.size()) < 0)
+            qCWarning(QT_BT_BLUEZ) << "Cannot relay ATT loopback packet:" << qt_error_string(errno);
+        else
+            ++relayed;
+    }
+    if (!direction.pending.isEmpty())
+        direction.timer->start(int(direction.pending.constFirst().first.remainingTime()));
+}
+
+void AttLoopback::closeSockets()
+{
+    for (Direction *direction : { &toPeripheral, &toCentral }) {
+        delete direction->notifier;
+        direction->notifier = nullptr;
+        delete direction->timer;
+        direction->timer = nullptr;
+        direction->pending.clear();
+    }
+    for (int socket : qAsConst(sockets))
+        qt_safe_close(socket);
+    sockets.clear();
+    connected = false;
+}
+
+QT_END_NAMESPACE
@@ -0,0 +1,125 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtBluetooth module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#ifndef ATTLOOPBACK_P_H
+#define ATTLOOPBACK_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtCore/QByteArray>
+#include <QtCore/QDeadlineTimer>
+#include <QtCore/QList>
+#include <QtCore/QObject>
+#include <QtBluetooth/qtbluetoothglobal.h>
+
+#include <functional>
+
+QT_BEGIN_NAMESPACE
+
+class QLowEnergyController;
+class QSocketNotifier;
+class QTimer;
+
+/*
+ * Connects a central and a peripheral controller of the same process through a
+ * socket pair instead of a radio, so that the GATT client and server engines can
+ * be exercised and benchmarked without hardware.
+ *
+ * Both controllers must use the kernel based backend. With a latency of zero and
+ * no packet filter the controllers share one socket pair, otherwise every packet
+ * is relayed with the given one way delay. Controllers on engine threads take over their socket on
+ * their own thread, the relay runs on the thread of the loopback.
+ */
+class Q_AUTOTEST_EXPORT AttLoopback : public QObject
+{
+    Q_OBJECT
+public:
+    explicit AttLoopback(QObject *parent = nullptr);
+    ~AttLoopback();
+
+    void setLatency(int msecs);
+    int latency() const { return latencyMsecs; }
+
+    bool connectControllers(QLowEnergyController *central, QLowEnergyController *peripheral);
+
+    // Rewrites packets relayed towards the central, an empty result drops the
+    // packet. Setting a filter enables the relay even with a latency of zero.
+    using PacketFilter = std::function<QByteArray(const QByteArray &packet)>;
+    void setCentralPacketFilter(const PacketFilter &filter);
+
+    // packets passed through the relay, only counted when relaying
+    quint64 relayedPackets() const { return relayed; }
+
+private:
+    struct Direction
+    {
+        int from = -1;
+        int to = -1;
+        QSocketNotifier *notifier = nullptr;
+        QTimer *timer = nullptr;
+        QList<QPair<QDeadlineTimer, QByteArray>> pending;
+    };
+
+    void setupDirection(Direction &direction, int from, int to);
+    void readPacket(Direction &direction);
+    void deliverPackets(Direction &direction);
+    void closeSockets();
+
+    int latencyMsecs = 0;
+    quint64 relayed = 0;
+    PacketFilter centralFilter;
+    Direction toPeripheral;
+    Direction toCentral;
+    QList<int> sockets;
+    bool connected = false;
+};
+
+QT_END_NAMESPACE
+
+#endif // ATTLOOPBACK_P_H
@@ -0,0 +1,240 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtBluetooth module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#include "atttransmitqueue_p.h"
+#include "attcapture_p.h"
+
+#include <qtbluetooth_tracepoints_p.h>
+
+#include <QtCore/QLoggingCategory>
+#include <QtCore/QSocketNotifier>
+#include <QtCore/private/qcore_unix_p.h>
+
+#include <algorithm>
+#include <cstring>
+#include <errno.h>
+
+QT_BEGIN_NAMESPACE
+
+Q_DECLARE_LOGGING_CATEGORY(QT_BT_BLUEZ)
+
+AttTransmitQueue::AttTransmitQueue(QObject *parent)
+    : QObject(parent)
+{
+}
+
+AttTransmitQueue::~AttTransmitQueue()
+{
+}
+
+void AttTransmitQueue::setSocketDescriptor(int socketDescriptor)
+{
+    if (socket == socketDescriptor)
+        return;
+
+    clear();
+    resetStatistics();
+    delete writeNotifier;
+    writeNotifier = nullptr;
+
+    socket = socketDescriptor;
+    if (socket < 0)
+        return;
+
+    writeNotifier = new QSocketNotifier(socket, QSocketNotifier::Write, this);
+    writeNotifier->setEnabled(false);
+    connect(writeNotifier, &QSocketNotifier::activated, this, &AttTransmitQueue::flush);
+}
+
+void AttTransmitQueue::resetStatistics()
+{
+    writtenBytes = 0;
+    writtenPackets = 0;
+}
+
+void AttTransmitQueue::setMaximumNotifications(int maximum)
+{
+    maxNotifications = qMax(1, maximum);
+}
+
+/*
+ * Sends a packet which must not get lost, such as a request or response.
+ * Returns false if the socket failed, in which case writeFailed() has been emitted.
+ */
+bool AttTransmitQueue::sendPacket(QByteArrayView packet)
+{
+    if (socket < 0)
+        return false;
+
+    if (queue.isEmpty()) {
+        switch (write(packet)) {
+        case WriteResult::Written:
+            return true;
+        case WriteResult::Failed:
+            fail(errno);
+            return false;
+        case WriteResult::WouldBlock:
+            break;
+        }
+    }
+
+    enqueue(packet, 0, false);
+    return true;
+}
+
+/*
+ * Sends a notification for \a handle. Unlike other packets, a notification may be
+ * coalesced with a queued one for the same handle or dropped when the queue is full.
+ */
+bool AttTransmitQueue::sendNotification(quint16 handle, QByteArrayView packet)
+{
+    if (socket < 0)
+        return false;
+
+    if (queue.isEmpty()) {
+        switch (write(packet)) {
+        case WriteResult::Written:
+            return true;
+        case WriteResult::Failed:
+            fail(errno);
+            return false;
+        case WriteResult::WouldBlock:
+            break;
+        }
+    }
+
+    enqueue(packet, handle, true);
+    return true;
+}
+
+void AttTransmitQueue::clear()
+{
+    queue.clear();
+    notificationCount = 0;
+    if (writeNotifier)
+        writeNotifier->setEnabled(false);
+}
+
+void AttTransmitQueue::setCapture(AttCapture *capture, quint16 channel)
+{
+    this->capture = capture;
+    captureChannel = channel;
+}
+
+AttTransmitQueue::WriteResult AttTransmitQueue::write(QByteArrayView packet)
+{
+    // L2CAP ATT sockets are SOCK_SEQPACKET, a packet is either sent in full or not at all
+    const qint64 result = qt_safe_write(socket, packet.data(), packet.size());
+    if (result < 0)
+        return (errno == EAGAIN || errno == EWOULDBLOCK) ? WriteResult::WouldBlock
+                                                         : WriteResult::Failed;
+    if (result < packet.size()) {
+        qCWarning(QT_BT_BLUEZ) << "L2CP write request incomplete:"
+                               << result << "of" << packet.size();
+    }
+    Q_TRACE(AttTransmitQueue_write, socket, int(result));
+    writtenBytes += quint64(result);
+    ++writtenPackets;
+    if (capture)
+        capture->record(captureChannel, AttCaptureRecord::Sent, packet);
+    return WriteResult::Written;
+}
+
+void AttTransmitQueue::enqueue(QByteArrayView packet, quint16 handle, bool notification)
+{
+    if (notification) {
+        // only the latest value of a characteristic is of interest to the client
+        for (Packet &queued : queue) {
+            if (queued.notification && queued.handle == handle) {
+                queued.data.resize(packet.size());
+                memcpy(queued.data.data(), packet.data(), packet.size());
+                ++coalesced;
+                return;
+            }
+        }
+
+        if (notificationCount >= maxNotifications) {
+            ++dropped;
+            if (dropPolicy_ == DropPolicy::DropNewest)
+                return;
+
+            const auto oldest = std::find_if(queue.begin(), queue.end(),
+                                             [](const Packet &p) { return p.notification; });
+            Q_ASSERT(oldest != queue.end());
+            queue.erase(oldest);
+            --notificationCount;
+        }
+        ++notificationCount;
+    }
+
+    queue.append({ packet.toByteArray(), handle, notification });
+    Q_TRACE(AttTransmitQueue_enqueue, socket, int(queue.size()));
+    writeNotifier->setEnabled(true);
+}
+
+void AttTransmitQueue::flush()
+{
+    while (!queue.isEmpty()) {
+        switch (write(queue.constFirst().data)) {
+        case WriteResult::WouldBlock:
+            return;
+        case WriteResult::Failed:
+            fail(errno);
+            return;
+        case WriteResult::Written:
+            break;
+        }
+
+        if (queue.constFirst().notification)
+            --notificationCount;
+        queue.removeFirst();
+    }
+
+    writeNotifier->setEnabled(false);
+}
+
+void AttTransmitQueue::fail(int error)
+{
+    qCWarning(QT_BT_BLUEZ) << "Cannot write L2CP packet:" << qt_error_string(error);
+    clear();
+    emit writeFailed(error);
+}
+
+QT_END_NAMESPACE
@@ -0,0 +1,148 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtBluetooth module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#ifndef ATTTRANSMITQUEUE_P_H
+#define ATTTRANSMITQUEUE_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtCore/QByteArray>
+#include <QtCore/QByteArrayView>
+#include <QtCore/QList>
+#include <QtCore/QObject>
+#include <QtBluetooth/qtbluetoothglobal.h>
+
+QT_BEGIN_NAMESPACE
+
+class AttCapture;
+class QSocketNotifier;
+
+/*
+ * Transmit path of one ATT bearer.
+ *
+ * Packets are written straight to the non-blocking L2CAP socket. Once the socket
+ * reports EAGAIN, further packets are queued in order and flushed whenever the
+ * socket becomes writable again. Requests, responses and indications are never
+ * dropped. Notifications are bounded: a queued notification is replaced by a
+ * newer value for the same handle and the drop policy applies once the limit of
+ * queued notifications is reached.
+ */
+class Q_AUTOTEST_EXPORT AttTransmitQueue : public QObject
+{
+    Q_OBJECT
+public:
+    enum class DropPolicy {
+        DropOldest,
+        DropNewest
+    };
+
+    explicit AttTransmitQueue(QObject *parent = nullptr);
+    ~AttTransmitQueue();
+
+    // Queued packets are discarded when the descriptor changes, -1 detaches the queue
+    void setSocketDescriptor(int socketDescriptor);
+    int socketDescriptor() const { return socket; }
+
+    void setMaximumNotifications(int maximum);
+    int maximumNotifications() const { return maxNotifications; }
+    void setDropPolicy(DropPolicy policy) { dropPolicy_ = policy; }
+    DropPolicy dropPolicy() const { return dropPolicy_; }
+
+    bool sendPacket(QByteArrayView packet);
+    bool sendNotification(quint16 handle, QByteArrayView packet);
+    void clear();
+
+    // Every packet written to the socket is recorded on the given capture channel
+    void setCapture(AttCapture *capture, quint16 channel);
+
+    int queueDepth() const { return int(queue.size()); }
+    int queuedNotificationCount() const { return notificationCount; }
+    quint64 droppedNotifications() const { return dropped; }
+    quint64 coalescedNotifications() const { return coalesced; }
+
+    // traffic written since the descriptor was set or the last reset
+    quint64 bytesWritten() const { return writtenBytes; }
+    quint64 packetsWritten() const { return writtenPackets; }
+    void resetStatistics();
+
+signals:
+    void writeFailed(int error);
+
+private:
+    struct Packet
+    {
+        QByteArray data;
+        quint16 handle = 0;
+        bool notification = false;
+    };
+
+    enum class WriteResult { Written, WouldBlock, Failed };
+
+    WriteResult write(QByteArrayView packet);
+    void enqueue(QByteArrayView packet, quint16 handle, bool notification);
+    void flush();
+    void fail(int error);
+
+    int socket = -1;
+    QSocketNotifier *writeNotifier = nullptr;
+    QList<Packet> queue;
+    int notificationCount = 0;
+    int maxNotifications = 64;
+    DropPolicy dropPolicy_ = DropPolicy::DropOldest;
+    quint64 dropped = 0;
+    quint64 coalesced = 0;
+    quint64 writtenBytes = 0;
+    quint64 writtenPackets = 0;
+    AttCapture *capture = nullptr;
+    quint16 captureChannel = 0;
+};
+
+QT_END_NAMESPACE
+
+#endif // ATTTRANSMITQUEUE_P_H
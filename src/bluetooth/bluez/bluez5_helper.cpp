@@ -45,7 +45,7 @@
 #include "bluez5_helper_p.h"
 #include "bluez_data_p.h"
 #include "objectmanager_p.h"
-#include "properties_p.h"
+#include "propertiesrouter_p.h"
 #include "adapter1_bluez5_p.h"
 
 QT_BEGIN_NAMESPACE
@@ -284,7 +284,7 @@ public:
 
     int reference;
     bool wasListeningAlready;
-    OrgFreedesktopDBusPropertiesInterface *propteryListener = nullptr;
+    QtBluezPropertiesSubscription *propteryListener = nullptr;
 };
 
 class QtBluezDiscoveryManagerPrivate
@@ -365,11 +365,14 @@ bool QtBluezDiscoveryManager::registerDiscoveryInterest(const QString &adapterPa
 
     AdapterData *data = new AdapterData();
 
-    OrgFreedesktopDBusPropertiesInterface *propIface = new OrgFreedesktopDBusPropertiesInterface(
-                QStringLiteral("org.bluez"), adapterPath, QDBusConnection::systemBus());
-    connect(propIface, &OrgFreedesktopDBusPropertiesInterface::PropertiesChanged,
-            this, &QtBluezDiscoveryManager::PropertiesChanged);
-    data->propteryListener = propIface;
+    data->propteryListener = QtBluezPropertiesRouter::instance()->subscribe(
+                adapterPath, QStringLiteral("org.bluez.Adapter1"),
+                QtBluezPropertiesRouter::PathMatch::Exact, this,
+                [this](const QString &path, const QString &interface,
+                       const QVariantMap &changedProperties,
+                       const QStringList &invalidatedProperties) {
+        PropertiesChanged(interface, path, changedProperties, invalidatedProperties);
+    });
 
     OrgBluezAdapter1Interface iface(QStringLiteral("org.bluez"), adapterPath,
                                     QDBusConnection::systemBus());
@@ -430,20 +433,14 @@ void QtBluezDiscoveryManager::InterfacesRemoved(const QDBusObjectPath &object_pa
 }
 
 void QtBluezDiscoveryManager::PropertiesChanged(const QString &interface,
+                                                const QString &path,
                                                 const QVariantMap &changed_properties,
-                                                const QStringList &invalidated_properties,
-                                                const QDBusMessage &)
+                                                const QStringList &invalidated_properties)
 {
     Q_UNUSED(invalidated_properties);
 
-    OrgFreedesktopDBusPropertiesInterface *propIface =
-            qobject_cast<OrgFreedesktopDBusPropertiesInterface *>(sender());
-
-    if (!propIface)
-        return;
-
     if (interface == QStringLiteral("org.bluez.Adapter1")
-            && d->references.contains(propIface->path())
+            && d->references.contains(path)
             && changed_properties.contains(QStringLiteral("Discovering"))) {
         bool isDiscovering = changed_properties.value(QStringLiteral("Discovering")).toBool();
         if (!isDiscovering) {
@@ -455,11 +452,11 @@ void QtBluezDiscoveryManager::PropertiesChanged(const QString &interface,
               To compensate we check whether there was renewed interest.
              */
 
-            AdapterData *data = d->references[propIface->path()];
+            AdapterData *data = d->references[path];
             if (!data) {
-                removeAdapterFromMonitoring(propIface->path());
+                removeAdapterFromMonitoring(path);
             } else {
-                OrgBluezAdapter1Interface iface(QStringLiteral("org.bluez"), propIface->path(),
+                OrgBluezAdapter1Interface iface(QStringLiteral("org.bluez"), path,
                                                 QDBusConnection::systemBus());
                 iface.StartDiscovery();
             }
@@ -99,12 +99,12 @@ signals:
 private slots:
     void InterfacesRemoved(const QDBusObjectPath &object_path,
                            const QStringList &interfaces);
-    void PropertiesChanged(const QString &interface,
-                           const QVariantMap &changed_properties,
-                           const QStringList &invalidated_properties,
-                           const QDBusMessage &msg);
 
 private:
+    void PropertiesChanged(const QString &interface,
+                           const QString &path,
+                           const QVariantMap &changed_properties,
+                           const QStringList &invalidated_properties);
     void removeAdapterFromMonitoring(const QString &dbusPath);
 
     QtBluezDiscoveryManagerPrivate *d;
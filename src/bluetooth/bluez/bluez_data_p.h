@@ -390,6 +390,17 @@ namespace QBluezConst {
         OcfLeClearWhiteList = 0x10,
         OcfLeAddToWhiteList = 0x11,
         OcfLeConnectionUpdate = 0x13,
+        OcfLeSetDataLength = 0x22,
+        OcfLeSetPhy = 0x32,
+        OcfLeSetExtAdvParams = 0x36,
+        OcfLeSetExtAdvData = 0x37,
+        OcfLeSetExtScanResponseData = 0x38,
+        OcfLeSetExtAdvEnable = 0x39,
+        OcfLeReadMaxAdvDataLength = 0x3a,
+        OcfLeRemoveAdvSet = 0x3c,
+        OcfLeSetPeriodicAdvParams = 0x3e,
+        OcfLeSetPeriodicAdvData = 0x3f,
+        OcfLeSetPeriodicAdvEnable = 0x40,
     };
     Q_ENUM_NS(OpCodeCommandField)
 
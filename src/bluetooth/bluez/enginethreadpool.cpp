@@ -0,0 +1,110 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtBluetooth module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#include "enginethreadpool_p.h"
+
+#include <QtCore/QLoggingCategory>
+#include <QtCore/QThread>
+
+QT_BEGIN_NAMESPACE
+
+Q_DECLARE_LOGGING_CATEGORY(QT_BT_BLUEZ)
+
+// a few threads already take the load off the application thread,
+// beyond that the threads mostly wait for the radio
+const int maxDefaultEngineThreads = 4;
+
+Q_GLOBAL_STATIC(EngineThreadPool, engineThreadPool)
+
+EngineThreadPool *EngineThreadPool::instance()
+{
+    return engineThreadPool();
+}
+
+EngineThreadPool::~EngineThreadPool()
+{
+    // Controllers still living on the threads are leaked, as after any
+    // thread which is stopped with objects left on it
+    for (QThread *thread : qAsConst(threads)) {
+        thread->quit();
+        thread->wait();
+        delete thread;
+    }
+}
+
+bool EngineThreadPool::setThreadCount(int count)
+{
+    QMutexLocker locker(&mutex);
+    if (!threads.isEmpty())
+        return false;
+    this->count = qMax(0, count);
+    return true;
+}
+
+int EngineThreadPool::threadCount() const
+{
+    QMutexLocker locker(&mutex);
+    if (count > 0)
+        return count;
+    return qBound(1, QThread::idealThreadCount(), maxDefaultEngineThreads);
+}
+
+QThread *EngineThreadPool::threadFor(const QBluetoothAddress &address)
+{
+    const int size = threadCount();
+
+    QMutexLocker locker(&mutex);
+    if (threads.isEmpty()) {
+        threads.reserve(size);
+        for (int i = 0; i < size; ++i) {
+            auto *thread = new QThread;
+            thread->setObjectName(QStringLiteral("QtBluetooth engine %1").arg(i));
+            thread->start();
+            threads.append(thread);
+        }
+        qCDebug(QT_BT_BLUEZ) << "Started" << size << "controller engine threads";
+    }
+
+    // peripherals have no remote address, they are spread evenly
+    const quint64 key = address.isNull() ? nextUnaddressed++ : address.toUInt64();
+    return threads.at(int(key % quint64(threads.size())));
+}
+
+QT_END_NAMESPACE
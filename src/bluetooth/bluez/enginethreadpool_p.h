@@ -0,0 +1,93 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtBluetooth module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#ifndef ENGINETHREADPOOL_P_H
+#define ENGINETHREADPOOL_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtCore/QList>
+#include <QtCore/QMutex>
+#include <QtBluetooth/qbluetoothaddress.h>
+#include <QtBluetooth/qtbluetoothglobal.h>
+
+QT_BEGIN_NAMESPACE
+
+class QThread;
+
+/*
+ * Worker threads running QLowEnergyController instances away from the thread
+ * that created them, see QLowEnergyController::moveToEngineThread().
+ *
+ * Controllers are sharded by remote address, so the same peer always ends up on
+ * the same thread. The threads are started on first use and run until the
+ * application exits.
+ */
+class Q_AUTOTEST_EXPORT EngineThreadPool
+{
+public:
+    static EngineThreadPool *instance();
+    ~EngineThreadPool();
+
+    // has no effect once the first thread has been started
+    bool setThreadCount(int count);
+    int threadCount() const;
+
+    QThread *threadFor(const QBluetoothAddress &address);
+
+private:
+    mutable QMutex mutex;
+    int count = 0;
+    quint64 nextUnaddressed = 0;
+    QList<QThread *> threads;
+};
+
+QT_END_NAMESPACE
+
+#endif // ENGINETHREADPOOL_P_H
@@ -43,6 +43,8 @@
 #include "qbluetoothsocketbase_p.h"
 #include "qlowenergyconnectionparameters.h"
 
+#include <qtbluetooth_tracepoints_p.h>
+
 #include <QtCore/qloggingcategory.h>
 
 #include <cstring>
@@ -92,6 +94,16 @@ HciManager::HciManager(const QBluetoothAddress& deviceAdapter, QObject *parent)
 
 }
 
+HciManager::HciManager(int socketDescriptor, int deviceId, QObject *parent) :
+    QObject(parent), hciSocket(socketDescriptor), hciDev(deviceId), injectedSocket(true)
+{
+    if (hciSocket < 0)
+        return;
+
+    notifier = new QSocketNotifier(hciSocket, QSocketNotifier::Read, this);
+    connect(notifier, SIGNAL(activated(QSocketDescriptor)), this, SLOT(_q_readNotify()));
+}
+
 HciManager::~HciManager()
 {
     if (hciSocket >= 0)
@@ -160,6 +172,10 @@ bool HciManager::monitorEvent(HciManager::HciEvent event)
     if (runningEvents.contains(event))
         return true;
 
+    // injected sockets are not filtered by the kernel, every event arrives anyway
+    if (injectedSocket)
+        return true;
+
     hci_filter filter;
     socklen_t length = sizeof(hci_filter);
     if (getsockopt(hciSocket, SOL_HCI, HCI_FILTER, &filter, &length) < 0) {
@@ -184,6 +200,9 @@ bool HciManager::monitorAclPackets()
     if (!isValid())
         return false;
 
+    if (injectedSocket)
+        return true;
+
     hci_filter filter;
     socklen_t length = sizeof(hci_filter);
     if (getsockopt(hciSocket, SOL_HCI, HCI_FILTER, &filter, &length) < 0) {
@@ -422,6 +441,45 @@ bool HciManager::sendConnectionParameterUpdateRequest(quint16 handle,
     return true;
 }
 
+bool HciManager::sendLeSetDataLength(quint16 handle, quint16 txOctets, quint16 txTime)
+{
+    // Spec v5.0, Vol 2, Part E, 7.8.33
+    struct CommandParams {
+        quint16 handle;
+        quint16 txOctets;
+        quint16 txTime;
+    } commandParams;
+    static_assert(sizeof commandParams == 6, "unexpected struct size");
+    commandParams.handle = qToLittleEndian(handle);
+    commandParams.txOctets = qToLittleEndian(qBound<quint16>(0x1b, txOctets, 0xfb));
+    commandParams.txTime = qToLittleEndian(qBound<quint16>(0x148, txTime, 0x4290));
+    const QByteArray data = QByteArray::fromRawData(reinterpret_cast<char *>(&commandParams),
+                                                    sizeof commandParams);
+    return sendCommand(QBluezConst::OgfLinkControl, QBluezConst::OcfLeSetDataLength, data);
+}
+
+bool HciManager::sendLeSetPhy(quint16 handle, quint8 txPhys, quint8 rxPhys)
+{
+    // Spec v5.0, Vol 2, Part E, 7.8.49
+    struct CommandParams {
+        quint16 handle;
+        quint8 allPhys;
+        quint8 txPhys;
+        quint8 rxPhys;
+        quint16 phyOptions;
+    } __attribute((packed)) commandParams;
+    static_assert(sizeof commandParams == 7, "unexpected struct size");
+    commandParams.handle = qToLittleEndian(handle);
+    // bit 0/1: host has no preference for TX/RX if the respective mask is empty
+    commandParams.allPhys = (txPhys ? 0 : 0x1) | (rxPhys ? 0 : 0x2);
+    commandParams.txPhys = txPhys;
+    commandParams.rxPhys = rxPhys;
+    commandParams.phyOptions = 0;
+    const QByteArray data = QByteArray::fromRawData(reinterpret_cast<char *>(&commandParams),
+                                                    sizeof commandParams);
+    return sendCommand(QBluezConst::OgfLinkControl, QBluezConst::OcfLeSetPhy, data);
+}
+
 /*!
  * Process all incoming HCI events. Function cannot process anything else but events.
  */
@@ -469,6 +527,7 @@ void HciManager::handleHciEventPacket(const quint8 *data, int size)
 
     qCDebug(QT_BT_BLUEZ) << "HCI event triggered, type:" << (HciManager::HciEvent)header->evt
                          << "type code:" << Qt::hex << header->evt;
+    Q_TRACE_SCOPE(HciManager_handleHciEventPacket, int(header->evt), size);
 
     switch ((HciManager::HciEvent)header->evt) {
     case HciEvent::EVT_ENCRYPT_CHANGE: {
@@ -563,7 +622,8 @@ void HciManager::handleLeMetaEvent(const quint8 *data)
 {
     // Spec v4.2, Vol 2, part E, 7.7.65ff
     switch (*data) {
-    case 0x1: {
+    case 0x1:   // LE Connection Complete
+    case 0xa: { // LE Enhanced Connection Complete
         const quint16 handle = bt_get_le16(data + 2);
         emit connectionComplete(handle);
         break;
@@ -589,6 +649,22 @@ void HciManager::handleLeMetaEvent(const quint8 *data)
         }
         break;
     }
+    case 0x7: { // LE Data Length Change
+        const quint16 handle = bt_get_le16(data + 1);
+        const quint16 maxTxOctets = bt_get_le16(data + 3);
+        const quint16 maxRxOctets = bt_get_le16(data + 7);
+        emit dataLengthChanged(handle, maxTxOctets, maxRxOctets);
+        break;
+    }
+    case 0xc: { // LE PHY Update Complete
+        const quint8 status = data[1];
+        if (status != 0) {
+            qCDebug(QT_BT_BLUEZ) << "PHY update failed, status:" << Qt::hex << status;
+            break;
+        }
+        emit phyUpdateComplete(bt_get_le16(data + 2), data[4], data[5]);
+        break;
+    }
     default:
         break;
     }
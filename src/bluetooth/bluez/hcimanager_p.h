@@ -56,13 +56,13 @@
 #include <QtCore/QSet>
 #include <QtCore/QSocketNotifier>
 #include <QtBluetooth/QBluetoothAddress>
-#include "bluez/bluez_data_p.h"
+#include "bluez_data_p.h"
 
 QT_BEGIN_NAMESPACE
 
 class QLowEnergyConnectionParameters;
 
-class HciManager : public QObject
+class Q_AUTOTEST_EXPORT HciManager : public QObject
 {
     Q_OBJECT
 public:
@@ -193,6 +193,8 @@ public:
     Q_ENUM(HciError);
 
     explicit HciManager(const QBluetoothAddress &deviceAdapter, QObject *parent = nullptr);
+    // Takes ownership of an already bound socket; used by autotests to inject a fake HCI socket.
+    explicit HciManager(int socketDescriptor, int deviceId, QObject *parent = nullptr);
     ~HciManager();
 
     bool isValid() const;
@@ -209,6 +211,8 @@ public:
     bool sendConnectionUpdateCommand(quint16 handle, const QLowEnergyConnectionParameters &params);
     bool sendConnectionParameterUpdateRequest(quint16 handle,
                                               const QLowEnergyConnectionParameters &params);
+    bool sendLeSetDataLength(quint16 handle, quint16 txOctets, quint16 txTime);
+    bool sendLeSetPhy(quint16 handle, quint8 txPhys, quint8 rxPhys);
 
 signals:
     void encryptionChangedEvent(const QBluetoothAddress &address, bool wasSuccess);
@@ -216,6 +220,8 @@ signals:
     void connectionComplete(quint16 handle);
     void connectionUpdate(quint16 handle, const QLowEnergyConnectionParameters &parameters);
     void signatureResolvingKeyReceived(quint16 connHandle, bool remoteKey, const quint128 &csrk);
+    void dataLengthChanged(quint16 handle, quint16 maxTxOctets, quint16 maxRxOctets);
+    void phyUpdateComplete(quint16 handle, quint8 txPhy, quint8 rxPhy);
 
 private slots:
     void _q_readNotify();
@@ -228,6 +234,7 @@ private:
 
     int hciSocket;
     int hciDev;
+    bool injectedSocket = false;
     quint8 sigPacketIdentifier = 0;
     QSocketNotifier *notifier = nullptr;
     QSet<HciManager::HciEvent> runningEvents;
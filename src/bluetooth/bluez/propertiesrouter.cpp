@@ -0,0 +1,278 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtBluetooth module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#include "propertiesrouter_p.h"
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QLoggingCategory>
+#include <QtCore/QThread>
+#include <QtDBus/QDBusArgument>
+#include <QtDBus/QDBusConnection>
+#include <QtDBus/QDBusMessage>
+
+#include <algorithm>
+
+QT_BEGIN_NAMESPACE
+
+Q_DECLARE_LOGGING_CATEGORY(QT_BT_BLUEZ)
+
+Q_GLOBAL_STATIC(QtBluezPropertiesRouter, propertiesRouter)
+
+static const QLatin1String bluezService("org.bluez");
+static const QLatin1String propertiesInterface("org.freedesktop.DBus.Properties");
+static const QLatin1String propertiesChanged("PropertiesChanged");
+
+/*!
+    \internal
+    \class QtBluezPropertiesRouter
+
+    Distributes org.freedesktop.DBus.Properties::PropertiesChanged signals from BlueZ.
+
+    Every Qt class interested in property changes used to create its own
+    OrgFreedesktopDBusPropertiesInterface. Each of those installed a match rule
+    and unmarshalled every matching signal again; the discovery agent even listened
+    to all property changes of org.bluez, including GATT value notifications of
+    unrelated connections.
+
+    The router installs a single match rule per object path and interface
+    (\c path and \c arg0) or, for subscriptions covering a subtree, per
+    interface (\c arg0 only, the path namespace is checked here as QtDBus
+    cannot express \c path_namespace). Each signal is unmarshalled once and
+    handed to the subscribers found via the object path.
+
+    Subscriptions may be made on any thread. The router itself lives in the
+    application thread, each handler is called on the thread of the context
+    object given to subscribe(), queued if that is a different thread.
+*/
+
+QtBluezPropertiesSubscription::~QtBluezPropertiesSubscription()
+{
+    if (QtBluezPropertiesRouter *router = QtBluezPropertiesRouter::instance())
+        router->unsubscribe(m_id);
+}
+
+QtBluezPropertiesRouter::QtBluezPropertiesRouter(QObject *parent)
+    : QObject(parent)
+{
+    // the first subscriber may be on a short lived thread
+    if (!parent && QCoreApplication::instance())
+        moveToThread(QCoreApplication::instance()->thread());
+}
+
+QtBluezPropertiesRouter::~QtBluezPropertiesRouter()
+{
+}
+
+QtBluezPropertiesRouter *QtBluezPropertiesRouter::instance()
+{
+    return propertiesRouter();
+}
+
+QtBluezPropertiesSubscription *QtBluezPropertiesRouter::subscribe(const QString &path,
+                                                                  const QString &interface,
+                                                                  PathMatch match,
+                                                                  QObject *context,
+                                                                  Handler handler)
+{
+    Q_ASSERT(context);
+    QMutexLocker locker(&mutex);
+    QDBusConnection bus = QDBusConnection::systemBus();
+    const quint64 id = nextId++;
+
+    if (match == PathMatch::Exact) {
+        QList<quint64> &ids = exactPathSubscribers[path];
+        const bool hasRule = std::any_of(ids.cbegin(), ids.cend(), [&](quint64 other) {
+            return subscribers.value(other).interface == interface;
+        });
+        if (!hasRule) {
+            bus.connect(bluezService, path, propertiesInterface, propertiesChanged,
+                        QStringList{ interface }, QString(),
+                        this, SLOT(exactPathSignal(QDBusMessage)));
+        }
+        ids.append(id);
+    } else {
+        QList<quint64> &ids = namespaceSubscribers[interface];
+        if (ids.isEmpty()) {
+            bus.connect(bluezService, QString(), propertiesInterface, propertiesChanged,
+                        QStringList{ interface }, QString(),
+                        this, SLOT(pathNamespaceSignal(QDBusMessage)));
+        }
+        ids.append(id);
+    }
+
+    subscribers.insert(id, { path, interface, match, context, std::move(handler) });
+    return new QtBluezPropertiesSubscription(id, path, interface);
+}
+
+void QtBluezPropertiesRouter::unsubscribe(quint64 id)
+{
+    QMutexLocker locker(&mutex);
+    const auto it = subscribers.constFind(id);
+    if (it == subscribers.cend())
+        return;
+
+    const Subscriber subscriber = *it;
+    subscribers.erase(it);
+
+    QDBusConnection bus = QDBusConnection::systemBus();
+    if (subscriber.match == PathMatch::Exact) {
+        auto ids = exactPathSubscribers.find(subscriber.path);
+        if (ids == exactPathSubscribers.end())
+            return;
+
+        ids->removeOne(id);
+        const bool ruleInUse = std::any_of(ids->cbegin(), ids->cend(), [&](quint64 other) {
+            return subscribers.value(other).interface == subscriber.interface;
+        });
+        if (!ruleInUse) {
+            bus.disconnect(bluezService, subscriber.path, propertiesInterface, propertiesChanged,
+                           QStringList{ subscriber.interface }, QString(),
+                           this, SLOT(exactPathSignal(QDBusMessage)));
+        }
+        if (ids->isEmpty())
+            exactPathSubscribers.erase(ids);
+    } else {
+        auto ids = namespaceSubscribers.find(subscriber.interface);
+        if (ids == namespaceSubscribers.end())
+            return;
+
+        ids->removeOne(id);
+        if (ids->isEmpty()) {
+            bus.disconnect(bluezService, QString(), propertiesInterface, propertiesChanged,
+                           QStringList{ subscriber.interface }, QString(),
+                           this, SLOT(pathNamespaceSignal(QDBusMessage)));
+            namespaceSubscribers.erase(ids);
+        }
+    }
+}
+
+static bool unmarshal(const QDBusMessage &message, QString *interface,
+                      QVariantMap *changed, QStringList *invalidated)
+{
+    const QList<QVariant> arguments = message.arguments();
+    if (arguments.size() < 3)
+        return false;
+
+    *interface = arguments.at(0).toString();
+    *changed = qdbus_cast<QVariantMap>(arguments.at(1));
+    *invalidated = qdbus_cast<QStringList>(arguments.at(2));
+    return true;
+}
+
+void QtBluezPropertiesRouter::exactPathSignal(const QDBusMessage &message)
+{
+    QMutexLocker locker(&mutex);
+    const QList<quint64> ids = exactPathSubscribers.value(message.path());
+    locker.unlock();
+    if (ids.isEmpty())
+        return;
+
+    QString interface;
+    QVariantMap changed;
+    QStringList invalidated;
+    if (!unmarshal(message, &interface, &changed, &invalidated))
+        return;
+
+    dispatch(ids, message.path(), interface, changed, invalidated);
+}
+
+void QtBluezPropertiesRouter::pathNamespaceSignal(const QDBusMessage &message)
+{
+    QString interface;
+    QVariantMap changed;
+    QStringList invalidated;
+    if (!unmarshal(message, &interface, &changed, &invalidated))
+        return;
+
+    const QString path = message.path();
+    QMutexLocker locker(&mutex);
+    QList<quint64> ids = namespaceSubscribers.value(interface);
+    ids.removeIf([this, &path](quint64 id) {
+        const QString &root = subscribers.value(id).path;
+        return !(path == root || (path.startsWith(root) && path.at(root.size()) == QLatin1Char('/')));
+    });
+    locker.unlock();
+
+    dispatch(ids, path, interface, changed, invalidated);
+}
+
+void QtBluezPropertiesRouter::dispatch(const QList<quint64> &ids, const QString &path,
+                                       const QString &interface, const QVariantMap &changed,
+                                       const QStringList &invalidated)
+{
+    for (quint64 id : ids) {
+        QMutexLocker locker(&mutex);
+        // a handler may have removed other subscriptions
+        const auto it = subscribers.constFind(id);
+        if (it == subscribers.cend() || it->interface != interface)
+            continue;
+
+        if (it->context->thread() != QThread::currentThread()) {
+            // Posted while locked: the subscription is removed before its
+            // context is destroyed, which also discards the queued call.
+            QMetaObject::invokeMethod(it->context,
+                                      [this, id, path, interface, changed, invalidated]() {
+                deliver(id, path, interface, changed, invalidated);
+            }, Qt::QueuedConnection);
+            continue;
+        }
+
+        // copy, the handler may delete its own subscription
+        const Handler handler = it->handler;
+        locker.unlock();
+        handler(path, interface, changed, invalidated);
+    }
+}
+
+void QtBluezPropertiesRouter::deliver(quint64 id, const QString &path, const QString &interface,
+                                      const QVariantMap &changed, const QStringList &invalidated)
+{
+    QMutexLocker locker(&mutex);
+    // the subscription may have been deleted while the call was queued
+    const auto it = subscribers.constFind(id);
+    if (it == subscribers.cend())
+        return;
+
+    const Handler handler = it->handler;
+    locker.unlock();
+    handler(path, interface, changed, invalidated);
+}
+
+QT_END_NAMESPACE
@@ -0,0 +1,143 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtBluetooth module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#ifndef PROPERTIESROUTER_P_H
+#define PROPERTIESROUTER_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtCore/QHash>
+#include <QtCore/QMutex>
+#include <QtCore/QObject>
+#include <QtCore/QStringList>
+#include <QtCore/QVariantMap>
+
+#include <functional>
+
+QT_BEGIN_NAMESPACE
+
+class QDBusMessage;
+
+class QtBluezPropertiesSubscription
+{
+public:
+    ~QtBluezPropertiesSubscription();
+
+    QString path() const { return m_path; }
+    QString interface() const { return m_interface; }
+
+private:
+    friend class QtBluezPropertiesRouter;
+    QtBluezPropertiesSubscription(quint64 id, const QString &path, const QString &interface)
+        : m_id(id), m_path(path), m_interface(interface) {}
+
+    quint64 m_id;
+    QString m_path;
+    QString m_interface;
+
+    Q_DISABLE_COPY(QtBluezPropertiesSubscription)
+};
+
+class Q_AUTOTEST_EXPORT QtBluezPropertiesRouter : public QObject
+{
+    Q_OBJECT
+public:
+    enum class PathMatch {
+        Exact,      // only the object at the given path
+        Namespace   // the object at the given path and all objects below it
+    };
+
+    using Handler = std::function<void(const QString &path, const QString &interface,
+                                       const QVariantMap &changedProperties,
+                                       const QStringList &invalidatedProperties)>;
+
+    QtBluezPropertiesRouter(QObject *parent = nullptr);
+    ~QtBluezPropertiesRouter();
+    static QtBluezPropertiesRouter *instance();
+
+    // The caller owns the returned subscription, deleting it stops the notifications.
+    // The handler is called on the thread of context, which must outlive the subscription.
+    QtBluezPropertiesSubscription *subscribe(const QString &path, const QString &interface,
+                                             PathMatch match, QObject *context,
+                                             Handler handler);
+
+private slots:
+    void exactPathSignal(const QDBusMessage &message);
+    void pathNamespaceSignal(const QDBusMessage &message);
+
+private:
+    friend class QtBluezPropertiesSubscription;
+    void unsubscribe(quint64 id);
+    void dispatch(const QList<quint64> &ids, const QString &path, const QString &interface,
+                  const QVariantMap &changed, const QStringList &invalidated);
+    void deliver(quint64 id, const QString &path, const QString &interface,
+                 const QVariantMap &changed, const QStringList &invalidated);
+
+    struct Subscriber {
+        QString path;
+        QString interface;
+        PathMatch match = PathMatch::Exact;
+        QObject *context = nullptr;
+        Handler handler;
+    };
+
+    // subscriptions are made and removed on the subscribers' threads
+    QMutex mutex;
+
+    QHash<quint64, Subscriber> subscribers;
+    // object path -> subscribers using PathMatch::Exact
+    QHash<QString, QList<quint64>> exactPathSubscribers;
+    // interface -> subscribers using PathMatch::Namespace
+    QHash<QString, QList<quint64>> namespaceSubscribers;
+    quint64 nextId = 1;
+};
+
+QT_END_NAMESPACE
+
+#endif // PROPERTIESROUTER_P_H
@@ -0,0 +1,150 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtBluetooth module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#ifndef SDPSCANNERPROTOCOL_P_H
+#define SDPSCANNERPROTOCOL_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtCore/qbytearray.h>
+#include <QtCore/qendian.h>
+
+QT_BEGIN_NAMESPACE
+
+/*
+ * Worker mode of src/tools/sdpscanner, shared by the scanner and
+ * QBluetoothServiceDiscoveryAgent. Only QtCore may be used here.
+ *
+ * Started with -w, sdpscanner reads one request per line from stdin:
+ *     <remote bdaddr> <local bdaddr> [-u ({uuids})]
+ * and answers each with a frame on stdout:
+ *     quint32 length of the remaining frame
+ *     quint8  status, one of the RETURN_* values of sdpscanner
+ *     quint16 number of records
+ *     records: quint16 number of attributes, followed by that many
+ *              pairs of quint16 attribute id and data element
+ * A data element is a quint8 ElementType followed by its value. Integers are
+ * big-endian, UUIDs are stored in their shortest form, strings and URLs are
+ * prefixed by their quint32 length and sequences and alternatives by their
+ * quint16 number of elements.
+ */
+namespace SdpScannerProtocol {
+
+enum ElementType : quint8 {
+    ElementNil = 0,
+    ElementUInt8,
+    ElementUInt16,
+    ElementUInt32,
+    ElementUInt64,
+    ElementUInt128,
+    ElementInt8,
+    ElementInt16,
+    ElementInt32,
+    ElementInt64,
+    ElementInt128,
+    ElementBool,
+    ElementUuid16,
+    ElementUuid32,
+    ElementUuid128,
+    ElementText,
+    ElementUrl,
+    ElementSequence,
+    ElementAlternative
+};
+
+template<typename T> inline void appendBigEndian(QByteArray &output, T value)
+{
+    char buffer[sizeof(T)];
+    qToBigEndian(value, buffer);
+    output.append(buffer, sizeof(T));
+}
+
+// integers, booleans and the 16 and 32 bit UUIDs
+template<typename T> inline void appendElement(QByteArray &output, ElementType type, T value)
+{
+    output.append(char(type));
+    appendBigEndian<T>(output, value);
+}
+
+// the 128 bit integers and UUIDs, already in network byte order
+inline void appendElement128(QByteArray &output, ElementType type, const void *data)
+{
+    output.append(char(type));
+    output.append(static_cast<const char *>(data), 16);
+}
+
+inline void appendString(QByteArray &output, ElementType type, const char *data, quint32 length)
+{
+    output.append(char(type));
+    appendBigEndian<quint32>(output, length);
+    output.append(data, int(length));
+}
+
+// the elements of the sequence or alternative follow
+inline void appendListHeader(QByteArray &output, ElementType type, quint16 count)
+{
+    output.append(char(type));
+    appendBigEndian<quint16>(output, count);
+}
+
+inline QByteArray frame(quint8 status, quint16 recordCount, const QByteArray &records)
+{
+    QByteArray frame;
+    appendBigEndian<quint32>(frame, quint32(1 + 2 + records.size()));
+    frame.append(char(status));
+    appendBigEndian<quint16>(frame, recordCount);
+    frame.append(records);
+    return frame;
+}
+
+} // namespace SdpScannerProtocol
+
+QT_END_NAMESPACE
+
+#endif // SDPSCANNERPROTOCOL_P_H
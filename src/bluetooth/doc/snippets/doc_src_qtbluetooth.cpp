@@ -54,6 +54,7 @@
 #include <QtCore/QCoreApplication>
 #include <QtCore/QDebug>
 #include <QtCore/QFile>
+#include <QtCore/QFuture>
 #include <QtCore/QObject>
 #include <QtBluetooth/QBluetoothDeviceDiscoveryAgent>
 #include <QtBluetooth/QBluetoothServiceDiscoveryAgent>
@@ -77,6 +78,7 @@ public:
     void objectPush();
     void btleSharedData();
     void enableCharNotifications();
+    void asyncRead(QLowEnergyService *service);
 
 public slots:
     void deviceDiscovered(const QBluetoothDeviceInfo &device);
@@ -225,6 +227,25 @@ void MyClass::enableCharNotifications()
 //! [enable_btle_notifications]
 }
 
+void MyClass::asyncRead(QLowEnergyService *service)
+{
+//! [asyncRead]
+    const QLowEnergyCharacteristic level =
+            service->characteristic(QBluetoothUuid::CharacteristicType::BatteryLevel);
+    const QLowEnergyCharacteristic name =
+            service->characteristic(QBluetoothUuid::CharacteristicType::DeviceName);
+
+    // both requests are queued at once, each future receives its own value
+    service->readCharacteristicAsync(level).then(this, [](const QByteArray &value) {
+        qDebug() << "Battery level:" << int(quint8(value.at(0)));
+    });
+    service->readCharacteristicAsync(name).then(this, [](const QByteArray &value) {
+        qDebug() << "Device name:" << QString::fromUtf8(value);
+    }).onCanceled(this, [service]() {
+        qDebug() << "Reading the device name failed:" << service->error();
+    });
+//! [asyncRead]
+}
 
 
 int main(int argc, char** argv)
@@ -298,6 +298,42 @@ int QBluetoothDeviceDiscoveryAgent::lowEnergyDiscoveryTimeout() const
     return d->lowEnergySearchTimeout;
 }
 
+/*!
+    Sets the \a filter which remote devices must match to be reported by this agent.
+    The filter takes effect the next time the discovery is started; it does not
+    affect a discovery which is already running.
+
+    Where possible the filter is pushed down to the Bluetooth stack so that
+    non-matching advertisements are dropped before they reach the application.
+    This significantly reduces the load in environments with many advertising
+    devices.
+
+    \note Currently the filter is only applied by the BlueZ backend. Other
+    platforms ignore it and report every discovered device.
+
+    \sa discoveryFilter()
+    \since 6.3
+ */
+void QBluetoothDeviceDiscoveryAgent::setDiscoveryFilter(
+        const QBluetoothDeviceDiscoveryFilter &filter)
+{
+    Q_D(QBluetoothDeviceDiscoveryAgent);
+    d->discoveryFilter = filter;
+}
+
+/*!
+    Returns the filter applied to the device discovery. The default filter
+    matches every device.
+
+    \sa setDiscoveryFilter()
+    \since 6.3
+ */
+QBluetoothDeviceDiscoveryFilter QBluetoothDeviceDiscoveryAgent::discoveryFilter() const
+{
+    Q_D(const QBluetoothDeviceDiscoveryAgent);
+    return d->discoveryFilter;
+}
+
 /*!
     \fn QBluetoothDeviceDiscoveryAgent::DiscoveryMethods QBluetoothDeviceDiscoveryAgent::supportedDiscoveryMethods()
 
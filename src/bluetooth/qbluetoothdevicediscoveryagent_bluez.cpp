@@ -38,6 +38,7 @@
 ****************************************************************************/
 
 #include <QtCore/QLoggingCategory>
+#include <QtCore/QVersionNumber>
 #include "qbluetoothdevicediscoveryagent.h"
 #include "qbluetoothdevicediscoveryagent_p.h"
 #include "qbluetoothaddress.h"
@@ -48,8 +49,11 @@
 #include "bluez/adapter1_bluez5_p.h"
 #include "bluez/device1_bluez5_p.h"
 #include "bluez/properties_p.h"
+#include "bluez/propertiesrouter_p.h"
 #include "bluez/bluetoothmanagement_p.h"
 
+#include <qtbluetooth_tracepoints_p.h>
+
 QT_BEGIN_NAMESPACE
 
 Q_DECLARE_LOGGING_CATEGORY(QT_BT_BLUEZ)
@@ -78,6 +82,7 @@ QBluetoothDeviceDiscoveryAgentPrivate::QBluetoothDeviceDiscoveryAgentPrivate(
 QBluetoothDeviceDiscoveryAgentPrivate::~QBluetoothDeviceDiscoveryAgentPrivate()
 {
     delete adapter;
+    delete deviceMonitor;
 }
 
 //TODO: Qt6 remove the pendingCancel/pendingStart logic as it is cumbersome.
@@ -110,7 +115,8 @@ void QBluetoothDeviceDiscoveryAgentPrivate::start(QBluetoothDeviceDiscoveryAgent
     }
 
     discoveredDevices.clear();
-    devicesProperties.clear();
+    devicePathIndex.clear();
+    compileDiscoveryFilter();
 
     Q_Q(QBluetoothDeviceDiscoveryAgent);
 
@@ -147,7 +153,7 @@ void QBluetoothDeviceDiscoveryAgentPrivate::start(QBluetoothDeviceDiscoveryAgent
 
     // older BlueZ 5.x versions don't have this function
     // filterReply returns UnknownMethod which we ignore
-    QDBusPendingReply<> filterReply = adapter->SetDiscoveryFilter(map);
+    QDBusPendingReply<> filterReply = adapter->SetDiscoveryFilter(discoveryFilterPushdown(map));
     filterReply.waitForFinished();
     if (filterReply.isError()) {
         if (filterReply.error().type() == QDBusError::Other
@@ -170,18 +176,17 @@ void QBluetoothDeviceDiscoveryAgentPrivate::start(QBluetoothDeviceDiscoveryAgent
                      q, [this](const QString &path){
         this->_q_discoveryInterrupted(path);
     });
-    OrgFreedesktopDBusPropertiesInterface *prop = new OrgFreedesktopDBusPropertiesInterface(
-                QStringLiteral("org.bluez"), QStringLiteral(""), QDBusConnection::systemBus());
-    QObject::connect(prop, &OrgFreedesktopDBusPropertiesInterface::PropertiesChanged,
-                     q, [this](const QString &interface, const QVariantMap &changedProperties,
-                     const QStringList &invalidatedProperties,
-                     const QDBusMessage &signal) {
-        this->_q_PropertiesChanged(interface, signal.path(), changedProperties, invalidatedProperties);
+    // only devices of this adapter are of interest
+    delete deviceMonitor;
+    deviceMonitor = QtBluezPropertiesRouter::instance()->subscribe(
+                adapter->path(), QStringLiteral("org.bluez.Device1"),
+                QtBluezPropertiesRouter::PathMatch::Namespace, this,
+                [this](const QString &path, const QString &interface,
+                       const QVariantMap &changedProperties,
+                       const QStringList &invalidatedProperties) {
+        this->_q_PropertiesChanged(interface, path, changedProperties, invalidatedProperties);
     });
 
-    // remember what we have to cleanup
-    propertyMonitors.append(prop);
-
     // collect initial set of information
     QDBusPendingReply<ManagedObjectList> reply = manager->GetManagedObjects();
     reply.waitForFinished();
@@ -234,6 +239,266 @@ void QBluetoothDeviceDiscoveryAgentPrivate::stop()
     _q_discoveryFinished();
 }
 
+/*
+    Prepares the parts of discoveryFilter which are checked on the host before a
+    device is reported. BlueZ applies its own discovery filter only to
+    advertisements received while scanning; devices which are already known
+    to bluetoothd, as well as criteria which SetDiscoveryFilter does not support,
+    are covered here.
+ */
+void QBluetoothDeviceDiscoveryAgentPrivate::compileDiscoveryFilter()
+{
+    filteredDevicePaths.clear();
+    filterUuids.clear();
+    filterManufacturerIds.clear();
+
+    const QList<QBluetoothUuid> uuids = discoveryFilter.serviceUuids();
+    filterUuids.reserve(uuids.size());
+    for (const QBluetoothUuid &uuid : uuids)
+        filterUuids.insert(uuid.toString(QUuid::WithoutBraces).toLower());
+
+    const QList<quint16> ids = discoveryFilter.manufacturerIds();
+    filterManufacturerIds = QSet<quint16>(ids.cbegin(), ids.cend());
+    filterNamePrefix = discoveryFilter.namePrefix();
+    filterRssi = discoveryFilter.rssiThreshold();
+    filterPathloss = discoveryFilter.pathlossThreshold();
+}
+
+/*
+    Adds the criteria of discoveryFilter, which bluetoothd can evaluate itself,
+    to the \a transport filter passed to SetDiscoveryFilter.
+ */
+QVariantMap QBluetoothDeviceDiscoveryAgentPrivate::discoveryFilterPushdown(
+        const QVariantMap &transport) const
+{
+    QVariantMap map = transport;
+
+    if (!filterUuids.isEmpty())
+        map.insert(QStringLiteral("UUIDs"), QStringList(filterUuids.cbegin(), filterUuids.cend()));
+
+    // RSSI and Pathloss are mutually exclusive
+    if (filterRssi != 0)
+        map.insert(QStringLiteral("RSSI"), QVariant::fromValue(filterRssi));
+    else if (filterPathloss >= 0)
+        map.insert(QStringLiteral("Pathloss"), QVariant::fromValue(quint16(qMin(filterPathloss, 0xffff))));
+
+    // unknown keys cause SetDiscoveryFilter to fail with InvalidArguments
+    const QVersionNumber version = bluetoothdVersion();
+    if (!discoveryFilter.reportDuplicates() && version >= QVersionNumber(5, 45))
+        map.insert(QStringLiteral("DuplicateData"), false);
+    if (!filterNamePrefix.isEmpty() && version >= QVersionNumber(5, 54))
+        map.insert(QStringLiteral("Pattern"), filterNamePrefix);
+
+    return map;
+}
+
+/*
+    Returns the subset of \a criteria which \a properties of a org.bluez.Device1
+    object do not meet. A return value of 0 means the device matches.
+ */
+int QBluetoothDeviceDiscoveryAgentPrivate::failedFilterCriteria(const QVariantMap &properties,
+                                                                int criteria) const
+{
+    int failed = 0;
+
+    if ((criteria & RssiCriterion) && filterRssi != 0) {
+        const auto it = properties.constFind(QStringLiteral("RSSI"));
+        if (it == properties.cend() || qvariant_cast<short>(*it) < filterRssi)
+            failed |= RssiCriterion;
+    }
+
+    // Like bluetoothd, reject devices which do not advertise their TX power
+    if ((criteria & PathlossCriterion) && filterPathloss >= 0) {
+        const auto rssi = properties.constFind(QStringLiteral("RSSI"));
+        const auto txPower = properties.constFind(QStringLiteral("TxPower"));
+        if (rssi == properties.cend() || txPower == properties.cend()
+                || qvariant_cast<short>(*txPower) - qvariant_cast<short>(*rssi) > filterPathloss) {
+            failed |= PathlossCriterion;
+        }
+    }
+
+    if ((criteria & ServiceCriterion) && !filterUuids.isEmpty()) {
+        bool found = false;
+        const QStringList uuids = qvariant_cast<QStringList>(properties.value(QStringLiteral("UUIDs")));
+        for (const QString &uuid : uuids) {
+            if (filterUuids.contains(uuid.toLower())) {
+                found = true;
+                break;
+            }
+        }
+        if (!found) {
+            const ServiceDataList serviceData =
+                    qdbus_cast<ServiceDataList>(properties.value(QStringLiteral("ServiceData")));
+            for (auto it = serviceData.cbegin(); it != serviceData.cend(); ++it) {
+                if (filterUuids.contains(it.key().toLower())) {
+                    found = true;
+                    break;
+                }
+            }
+        }
+        if (!found)
+            failed |= ServiceCriterion;
+    }
+
+    if ((criteria & NameCriterion) && !filterNamePrefix.isEmpty()) {
+        if (!properties.value(QStringLiteral("Alias")).toString().startsWith(filterNamePrefix))
+            failed |= NameCriterion;
+    }
+
+    if ((criteria & ManufacturerCriterion) && !filterManufacturerIds.isEmpty()) {
+        bool found = false;
+        const ManufacturerDataList manufacturerData =
+                qdbus_cast<ManufacturerDataList>(properties.value(QStringLiteral("ManufacturerData")));
+        for (auto it = manufacturerData.cbegin(); it != manufacturerData.cend(); ++it) {
+            if (filterManufacturerIds.contains(it.key())) {
+                found = true;
+                break;
+            }
+        }
+        if (!found)
+            failed |= ManufacturerCriterion;
+    }
+
+    return failed;
+}
+
+/*
+    A device which was rejected by the filter is only reconsidered if
+    \a changedProperties touch every criterion it failed and it now meets them.
+    As PropertiesChanged carries a subset of the properties only, the full set
+    is fetched before the device is reported.
+ */
+void QBluetoothDeviceDiscoveryAgentPrivate::recheckFilteredDevice(
+        const QString &devicePath, const QVariantMap &changedProperties)
+{
+    Q_Q(QBluetoothDeviceDiscoveryAgent);
+
+    const auto entry = filteredDevicePaths.find(devicePath);
+    if (entry == filteredDevicePaths.end())
+        return;
+
+    FilteredDevice &device = entry.value();
+    QVariantMap checkedProperties = changedProperties;
+
+    int touched = 0;
+    const auto rssi = changedProperties.constFind(QStringLiteral("RSSI"));
+    if (rssi != changedProperties.cend()) {
+        device.rssi = *rssi;
+        touched |= RssiCriterion | PathlossCriterion;
+    }
+    const auto txPower = changedProperties.constFind(QStringLiteral("TxPower"));
+    if (txPower != changedProperties.cend()) {
+        device.txPower = *txPower;
+        touched |= PathlossCriterion;
+    }
+    if (changedProperties.contains(QStringLiteral("UUIDs"))
+            || changedProperties.contains(QStringLiteral("ServiceData")))
+        touched |= ServiceCriterion;
+    if (changedProperties.contains(QStringLiteral("Alias")))
+        touched |= NameCriterion;
+    if (changedProperties.contains(QStringLiteral("ManufacturerData")))
+        touched |= ManufacturerCriterion;
+
+    const int failed = device.failedCriteria;
+    if (!(failed & touched))
+        return;
+
+    // The pathloss is checked with the last known value of the property which did not change
+    if (failed & touched & PathlossCriterion) {
+        if (device.rssi.isValid())
+            checkedProperties.insert(QStringLiteral("RSSI"), device.rssi);
+        if (device.txPower.isValid())
+            checkedProperties.insert(QStringLiteral("TxPower"), device.txPower);
+    }
+
+    // The other criteria depend on a single property, except for the service criterion.
+    // As neither UUIDs nor ServiceData matched before, checking the changed one suffices.
+    device.failedCriteria = (failed & ~touched)
+            | failedFilterCriteria(checkedProperties, failed & touched);
+    if (device.failedCriteria != 0)
+        return;
+
+    qCDebug(QT_BT_BLUEZ) << "Filtered device now matches discovery filter:" << devicePath;
+    OrgFreedesktopDBusPropertiesInterface properties(QStringLiteral("org.bluez"), devicePath,
+                                                     QDBusConnection::systemBus());
+    auto watcher = new QDBusPendingCallWatcher(
+                properties.GetAll(QStringLiteral("org.bluez.Device1")), q);
+    QObject::connect(watcher, &QDBusPendingCallWatcher::finished,
+                     q, [this, devicePath](QDBusPendingCallWatcher *watcher) {
+        watcher->deleteLater();
+        QDBusPendingReply<QVariantMap> reply = *watcher;
+        if (reply.isError()) {
+            qCDebug(QT_BT_BLUEZ) << "Cannot read properties of" << devicePath << reply.error();
+            return;
+        }
+        // discovery may have been stopped or restarted in the meantime
+        if (!adapter || !filteredDevicePaths.contains(devicePath))
+            return;
+        deviceFound(devicePath, reply.value());
+    });
+}
+
+static bool isLikelyLowEnergyUuid(const QBluetoothUuid &id)
+{
+    bool ok = false;
+    quint16 shortId = id.toUInt16(&ok);
+    quint16 genericAccessInt = static_cast<quint16>(QBluetoothUuid::ServiceClassUuid::GenericAccess);
+    return ok && ((shortId & genericAccessInt) == genericAccessInt);
+}
+
+static QList<QBluetoothUuid> parseServiceUuids(const QVariant &value, bool *foundLikelyLowEnergyUuid)
+{
+    QList<QBluetoothUuid> uuids;
+    *foundLikelyLowEnergyUuid = false;
+    const QStringList foundUuids = qvariant_cast<QStringList>(value);
+    uuids.reserve(foundUuids.size());
+    for (const auto &u: foundUuids) {
+        const QBluetoothUuid id(u);
+        if (id.isNull())
+            continue;
+
+        //once we found one BTLE service we are done
+        if (!*foundLikelyLowEnergyUuid && isLikelyLowEnergyUuid(id))
+            *foundLikelyLowEnergyUuid = true;
+        uuids.append(id);
+    }
+    return uuids;
+}
+
+static QBluetoothDeviceInfo::CoreConfigurations coreConfigurations(bool hasDeviceClass,
+                                                                   bool foundLikelyLowEnergyUuid)
+{
+    if (!hasDeviceClass)
+        return QBluetoothDeviceInfo::LowEnergyCoreConfiguration;
+    if (foundLikelyLowEnergyUuid)
+        return QBluetoothDeviceInfo::BaseRateAndLowEnergyCoreConfiguration;
+    return QBluetoothDeviceInfo::BaseRateCoreConfiguration;
+}
+
+// Returns true if at least one entry was not known before
+static bool mergeManufacturerData(QBluetoothDeviceInfo &deviceInfo, const QVariant &value)
+{
+    const ManufacturerDataList manufacturerData = qdbus_cast<ManufacturerDataList>(value);
+    bool wasNewValue = false;
+    for (auto it = manufacturerData.cbegin(); it != manufacturerData.cend(); ++it) {
+        if (deviceInfo.setManufacturerData(it.key(), it.value().variant().toByteArray()))
+            wasNewValue = true;
+    }
+    return wasNewValue;
+}
+
+// Returns true if at least one entry was not known before
+static bool mergeServiceData(QBluetoothDeviceInfo &deviceInfo, const QVariant &value)
+{
+    const ServiceDataList serviceData = qdbus_cast<ServiceDataList>(value);
+    bool wasNewValue = false;
+    for (auto it = serviceData.cbegin(); it != serviceData.cend(); ++it) {
+        if (deviceInfo.setServiceData(QBluetoothUuid(it.key()), it.value().variant().toByteArray()))
+            wasNewValue = true;
+    }
+    return wasNewValue;
+}
+
 // Returns invalid QBluetoothDeviceInfo in case of error
 static QBluetoothDeviceInfo createDeviceInfoFromBluez5Device(const QVariantMap& properties)
 {
@@ -247,45 +512,40 @@ static QBluetoothDeviceInfo createDeviceInfoFromBluez5Device(const QVariantMap&
     QBluetoothDeviceInfo deviceInfo(btAddress, btName, btClass);
     deviceInfo.setRssi(qvariant_cast<short>(properties[QStringLiteral("RSSI")]));
 
-    QList<QBluetoothUuid> uuids;
     bool foundLikelyLowEnergyUuid = false;
-    const QStringList foundUuids = qvariant_cast<QStringList>(properties[QStringLiteral("UUIDs")]);
-    for (const auto &u: foundUuids) {
-        const QBluetoothUuid id(u);
-        if (id.isNull())
-            continue;
+    deviceInfo.setServiceUuids(parseServiceUuids(properties[QStringLiteral("UUIDs")],
+                                                 &foundLikelyLowEnergyUuid));
+    deviceInfo.setCoreConfigurations(coreConfigurations(btClass != 0, foundLikelyLowEnergyUuid));
 
-        if (!foundLikelyLowEnergyUuid) {
-            //once we found one BTLE service we are done
-            bool ok = false;
-            quint16 shortId = id.toUInt16(&ok);
-            quint16 genericAccessInt = static_cast<quint16>(QBluetoothUuid::ServiceClassUuid::GenericAccess);
-            if (ok && ((shortId & genericAccessInt) == genericAccessInt))
-                foundLikelyLowEnergyUuid = true;
-        }
-        uuids.append(id);
-    }
-    deviceInfo.setServiceUuids(uuids);
+    mergeManufacturerData(deviceInfo, properties[QStringLiteral("ManufacturerData")]);
+    mergeServiceData(deviceInfo, properties[QStringLiteral("ServiceData")]);
 
-    if (!btClass) {
-        deviceInfo.setCoreConfigurations(QBluetoothDeviceInfo::LowEnergyCoreConfiguration);
-    } else {
-        deviceInfo.setCoreConfigurations(QBluetoothDeviceInfo::BaseRateCoreConfiguration);
-        if (foundLikelyLowEnergyUuid)
-            deviceInfo.setCoreConfigurations(QBluetoothDeviceInfo::BaseRateAndLowEnergyCoreConfiguration);
-    }
+    return deviceInfo;
+}
+
+// QBluetoothDeviceInfo has no setter for the class of device, copy everything else over
+static QBluetoothDeviceInfo withDeviceClass(const QBluetoothDeviceInfo &info, quint32 btClass)
+{
+    QBluetoothDeviceInfo deviceInfo(info.address(), info.name(), btClass);
+    deviceInfo.setRssi(info.rssi());
+    deviceInfo.setServiceUuids(info.serviceUuids());
 
-    const ManufacturerDataList deviceManufacturerData = qdbus_cast<ManufacturerDataList>(properties[QStringLiteral("ManufacturerData")]);
-    const QList<quint16> keys_manufacturer = deviceManufacturerData.keys();
-    for (quint16 key : keys_manufacturer)
-        deviceInfo.setManufacturerData(
-                    key, deviceManufacturerData.value(key).variant().toByteArray());
+    bool foundLikelyLowEnergyUuid = false;
+    for (const QBluetoothUuid &id : deviceInfo.serviceUuids()) {
+        if (isLikelyLowEnergyUuid(id)) {
+            foundLikelyLowEnergyUuid = true;
+            break;
+        }
+    }
+    deviceInfo.setCoreConfigurations(coreConfigurations(btClass != 0, foundLikelyLowEnergyUuid));
 
-    const ServiceDataList deviceServiceData = qdbus_cast<ServiceDataList>(properties[QStringLiteral("ServiceData")]);
-    const QList<QString> keys_service = deviceServiceData.keys();
-    for (QString key : keys_service)
-        deviceInfo.setServiceData(
-                    QBluetoothUuid(key), deviceServiceData.value(key).variant().toByteArray());
+    const QMultiHash<quint16, QByteArray> manufacturerData = info.manufacturerData();
+    for (auto it = manufacturerData.cbegin(); it != manufacturerData.cend(); ++it)
+        deviceInfo.setManufacturerData(it.key(), it.value());
+    const QMultiHash<QBluetoothUuid, QByteArray> serviceData = info.serviceData();
+    for (auto it = serviceData.cbegin(); it != serviceData.cend(); ++it)
+        deviceInfo.setServiceData(it.key(), it.value());
+    deviceInfo.setCached(info.isCached());
 
     return deviceInfo;
 }
@@ -302,6 +562,13 @@ void QBluetoothDeviceDiscoveryAgentPrivate::deviceFound(const QString &devicePat
     if (deviceAdapter.path() != adapter->path())
         return;
 
+    if (const int failed = failedFilterCriteria(properties, AllCriteria)) {
+        filteredDevicePaths.insert(devicePath, { failed, properties.value(QStringLiteral("RSSI")),
+                                                 properties.value(QStringLiteral("TxPower")) });
+        return;
+    }
+    filteredDevicePaths.remove(devicePath);
+
     // read information
     QBluetoothDeviceInfo deviceInfo = createDeviceInfoFromBluez5Device(properties);
     if (!deviceInfo.isValid()) // no point reporting an empty address
@@ -314,23 +581,26 @@ void QBluetoothDeviceDiscoveryAgentPrivate::deviceFound(const QString &devicePat
                          << "Num ManufacturerData" << deviceInfo.manufacturerData().size()
                          << "Num ServiceData" << deviceInfo.serviceData().size();
 
-    // Cache the properties so we do not have to access dbus every time to get a value
-    devicesProperties[devicePath] = properties;
-
     for (int i = 0; i < discoveredDevices.size(); i++) {
         if (discoveredDevices[i].address() == deviceInfo.address()) {
+            // Later property changes are applied to this entry directly
+            devicePathIndex.insert(devicePath, i);
             if (lowEnergySearchTimeout > 0 && discoveredDevices[i] == deviceInfo) {
                 qCDebug(QT_BT_BLUEZ) << "Duplicate: " << deviceInfo.address();
                 return;
             }
             discoveredDevices.replace(i, deviceInfo);
 
+            Q_TRACE(QBluetoothDeviceDiscoveryAgentPrivate_deviceDiscovered,
+                    int(deviceInfo.rssi()), 1);
             emit q->deviceDiscovered(deviceInfo);
             return; // this works if the list doesn't contain duplicates. Don't let it.
         }
     }
 
+    devicePathIndex.insert(devicePath, discoveredDevices.size());
     discoveredDevices.append(deviceInfo);
+    Q_TRACE(QBluetoothDeviceDiscoveryAgentPrivate_deviceDiscovered, int(deviceInfo.rssi()), 0);
     emit q->deviceDiscovered(deviceInfo);
 }
 
@@ -360,8 +630,8 @@ void QBluetoothDeviceDiscoveryAgentPrivate::_q_discoveryFinished()
     QtBluezDiscoveryManager::instance()->disconnect(q);
     QtBluezDiscoveryManager::instance()->unregisterDiscoveryInterest(adapter->path());
 
-    qDeleteAll(propertyMonitors);
-    propertyMonitors.clear();
+    delete deviceMonitor;
+    deviceMonitor = nullptr;
 
     delete adapter;
     adapter = nullptr;
@@ -405,6 +675,12 @@ void QBluetoothDeviceDiscoveryAgentPrivate::_q_discoveryInterrupted(const QStrin
     }
 }
 
+/*
+    Applies the changed properties to the cached QBluetoothDeviceInfo. Only the
+    properties that actually changed are parsed. During LE scans BlueZ emits a
+    PropertiesChanged signal for nearly every advertisement, mostly for RSSI or
+    ManufacturerData only.
+ */
 void QBluetoothDeviceDiscoveryAgentPrivate::_q_PropertiesChanged(const QString &interface,
                                                                  const QString &path,
                                                                  const QVariantMap &changed_properties,
@@ -414,77 +690,83 @@ void QBluetoothDeviceDiscoveryAgentPrivate::_q_PropertiesChanged(const QString &
     if (interface != QStringLiteral("org.bluez.Device1"))
         return;
 
-    if (!devicesProperties.contains(path))
+    const qsizetype index = devicePathIndex.value(path, -1);
+    if (index < 0) {
+        recheckFilteredDevice(path, changed_properties);
         return;
-
-    // Update the cached properties before checking changed_properties for RSSI and ManufacturerData
-    // so the cached properties are always up to date.
-    QVariantMap & properties = devicesProperties[path];
-    for (QVariantMap::const_iterator it = changed_properties.constBegin();
-         it != changed_properties.constEnd(); ++it) {
-        properties[it.key()] = it.value();
     }
 
-    for (const QString & property : invalidated_properties)
-        properties.remove(property);
+    QBluetoothDeviceInfo &info = discoveredDevices[index];
+    QBluetoothDeviceInfo::Fields updatedFields = QBluetoothDeviceInfo::Field::None;
+    // set when a property that is not covered by QBluetoothDeviceInfo::Fields changed
+    bool otherFieldChanged = false;
+
+    for (auto it = changed_properties.cbegin(); it != changed_properties.cend(); ++it) {
+        const QString &property = it.key();
+        if (property == QLatin1String("RSSI")) {
+            qCDebug(QT_BT_BLUEZ) << "Updating RSSI for" << info.address() << it.value();
+            info.setRssi(it.value().toInt());
+            updatedFields.setFlag(QBluetoothDeviceInfo::Field::RSSI);
+        } else if (property == QLatin1String("ManufacturerData")) {
+            qCDebug(QT_BT_BLUEZ) << "Updating ManufacturerData for" << info.address();
+            if (mergeManufacturerData(info, it.value()))
+                updatedFields.setFlag(QBluetoothDeviceInfo::Field::ManufacturerData);
+        } else if (property == QLatin1String("ServiceData")) {
+            qCDebug(QT_BT_BLUEZ) << "Updating ServiceData for" << info.address();
+            if (mergeServiceData(info, it.value()))
+                updatedFields.setFlag(QBluetoothDeviceInfo::Field::ServiceData);
+        } else if (property == QLatin1String("Alias")) {
+            const QString name = it.value().toString();
+            if (name != info.name()) {
+                info.setName(name);
+                otherFieldChanged = true;
+            }
+        } else if (property == QLatin1String("UUIDs")) {
+            bool foundLikelyLowEnergyUuid = false;
+            const QList<QBluetoothUuid> uuids = parseServiceUuids(it.value(),
+                                                                  &foundLikelyLowEnergyUuid);
+            if (uuids != info.serviceUuids()) {
+                info.setServiceUuids(uuids);
+                const bool hasDeviceClass = info.coreConfigurations()
+                        != QBluetoothDeviceInfo::LowEnergyCoreConfiguration;
+                info.setCoreConfigurations(coreConfigurations(hasDeviceClass,
+                                                              foundLikelyLowEnergyUuid));
+                otherFieldChanged = true;
+            }
+        } else if (property == QLatin1String("Class")) {
+            info = withDeviceClass(info, it.value().toUInt());
+            otherFieldChanged = true;
+        }
+    }
 
-    const auto info = createDeviceInfoFromBluez5Device(properties);
-    if (!info.isValid())
-        return;
+    for (const QString &property : invalidated_properties) {
+        if (property == QLatin1String("RSSI")) {
+            info.setRssi(0);
+        } else if (property == QLatin1String("Alias") && !info.name().isEmpty()) {
+            info.setName(QString());
+            otherFieldChanged = true;
+        } else if (property == QLatin1String("UUIDs") && !info.serviceUuids().isEmpty()) {
+            info.setServiceUuids({});
+            otherFieldChanged = true;
+        }
+    }
 
-    if (changed_properties.contains(QStringLiteral("RSSI"))
-        || changed_properties.contains(QStringLiteral("ManufacturerData"))) {
-
-        for (int i = 0; i < discoveredDevices.size(); i++) {
-            if (discoveredDevices[i].address() == info.address()) {
-                QBluetoothDeviceInfo::Fields updatedFields = QBluetoothDeviceInfo::Field::None;
-                if (changed_properties.contains(QStringLiteral("RSSI"))) {
-                    qCDebug(QT_BT_BLUEZ) << "Updating RSSI for" << info.address()
-                                         << changed_properties.value(QStringLiteral("RSSI"));
-                    discoveredDevices[i].setRssi(
-                                changed_properties.value(QStringLiteral("RSSI")).toInt());
-                    updatedFields.setFlag(QBluetoothDeviceInfo::Field::RSSI);
-                }
-                if (changed_properties.contains(QStringLiteral("ManufacturerData"))) {
-                    qCDebug(QT_BT_BLUEZ) << "Updating ManufacturerData for" << info.address();
-                    ManufacturerDataList changedManufacturerData =
-                            qdbus_cast< ManufacturerDataList >(changed_properties.value(QStringLiteral("ManufacturerData")));
-
-                    const QList<quint16> keys = changedManufacturerData.keys();
-                    bool wasNewValue = false;
-                    for (quint16 key : keys) {
-                        bool added = discoveredDevices[i].setManufacturerData(key, changedManufacturerData.value(key).variant().toByteArray());
-                        wasNewValue = (wasNewValue || added);
-                    }
-
-                    if (wasNewValue)
-                        updatedFields.setFlag(QBluetoothDeviceInfo::Field::ManufacturerData);
-                }
+    if (otherFieldChanged || lowEnergySearchTimeout <= 0) {
+        if (!otherFieldChanged && updatedFields == QBluetoothDeviceInfo::Field::None)
+            return;
 
-                if (lowEnergySearchTimeout > 0) {
-                    if (discoveredDevices[i] != info) { // field other than manufacturer or rssi changed
-                        if (discoveredDevices.at(i).name() == info.name()) {
-                            qCDebug(QT_BT_BLUEZ) << "Almost Duplicate " << info.address()
-                                                   << info.name() << "- replacing in place";
-                            discoveredDevices.replace(i, info);
-                            emit q->deviceDiscovered(info);
-                        }
-                    } else {
-                        if (!updatedFields.testFlag(QBluetoothDeviceInfo::Field::None))
-                            emit q->deviceUpdated(discoveredDevices[i], updatedFields);
-                    }
-
-                    return;
-                }
+        qCDebug(QT_BT_BLUEZ) << "Updating device in place" << info.address() << info.name();
+        Q_TRACE(QBluetoothDeviceDiscoveryAgentPrivate_deviceDiscovered, int(info.rssi()), 1);
+        emit q->deviceDiscovered(info);
 
-                discoveredDevices.replace(i, info);
-                emit q_ptr->deviceDiscovered(discoveredDevices[i]);
+        // user code may have restarted the discovery from the slot
+        if (index >= discoveredDevices.size())
+            return;
+    }
 
-                if (!updatedFields.testFlag(QBluetoothDeviceInfo::Field::None))
-                    emit q->deviceUpdated(discoveredDevices[i], updatedFields);
-                return;
-            }
-        }
+    if (updatedFields != QBluetoothDeviceInfo::Field::None) {
+        Q_TRACE(QBluetoothDeviceDiscoveryAgentPrivate_deviceUpdated, int(updatedFields.toInt()));
+        emit q->deviceUpdated(discoveredDevices.at(index), updatedFields);
     }
 }
 QT_END_NAMESPACE
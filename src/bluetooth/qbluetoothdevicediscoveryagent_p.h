@@ -64,6 +64,7 @@
 #include "darwin/btraii_p.h"
 #endif // Q_OS_DARWIN
 
+#include <QtCore/QSet>
 #include <QtCore/QVariantMap>
 
 #include <QtBluetooth/QBluetoothAddress>
@@ -75,12 +76,12 @@
 class OrgBluezManagerInterface;
 class OrgBluezAdapterInterface;
 class OrgFreedesktopDBusObjectManagerInterface;
-class OrgFreedesktopDBusPropertiesInterface;
 class OrgBluezAdapter1Interface;
 class OrgBluezDevice1Interface;
 
 QT_BEGIN_NAMESPACE
 class QDBusVariant;
+class QtBluezPropertiesSubscription;
 QT_END_NAMESPACE
 #endif
 
@@ -100,7 +101,7 @@ QT_BEGIN_NAMESPACE
 class QWinRTBluetoothDeviceDiscoveryWorker;
 #endif
 
-class QBluetoothDeviceDiscoveryAgentPrivate
+class Q_AUTOTEST_EXPORT QBluetoothDeviceDiscoveryAgentPrivate
 #if defined(QT_ANDROID_BLUETOOTH) || defined(QT_WINRT_BLUETOOTH) \
             || defined(Q_OS_DARWIN)
     : public QObject
@@ -132,8 +133,46 @@ public:
                               const QString &path,
                               const QVariantMap &changed_properties,
                               const QStringList &invalidated_properties);
+
+    // Host side part of discoveryFilter, evaluated on the raw D-Bus properties
+    // before a QBluetoothDeviceInfo is created
+    enum FilterCriterion {
+        RssiCriterion = 0x01,
+        ServiceCriterion = 0x02,
+        NameCriterion = 0x04,
+        ManufacturerCriterion = 0x08,
+        PathlossCriterion = 0x10,
+        AllCriteria = 0x1f
+    };
+    void compileDiscoveryFilter();
+    QVariantMap discoveryFilterPushdown(const QVariantMap &transport) const;
+    int failedFilterCriteria(const QVariantMap &properties, int criteria) const;
+    void recheckFilteredDevice(const QString &devicePath, const QVariantMap &changedProperties);
+
+    QSet<QString> filterUuids; // lower case 128-bit UUID strings as used by BlueZ
+    QSet<quint16> filterManufacturerIds;
+    QString filterNamePrefix;
+    qint16 filterRssi = 0;
+    int filterPathloss = -1;
+
+    struct FilteredDevice
+    {
+        // FilterCriterion flags the device failed
+        int failedCriteria = 0;
+        // The pathloss depends on both values, but PropertiesChanged
+        // usually carries only one of them
+        QVariant rssi;
+        QVariant txPower;
+    };
+    // D-Bus object path -> device rejected by the filter
+    QHash<QString, FilteredDevice> filteredDevicePaths;
 #endif
 
+    static QBluetoothDeviceDiscoveryAgentPrivate *get(QBluetoothDeviceDiscoveryAgent *q)
+    {
+        return q->d_func();
+    }
+
 private:
     QList<QBluetoothDeviceInfo> discoveredDevices;
 
@@ -166,11 +205,12 @@ private:
     OrgFreedesktopDBusObjectManagerInterface *manager = nullptr;
     OrgBluezAdapter1Interface *adapter = nullptr;
     QTimer *discoveryTimer = nullptr;
-    QList<OrgFreedesktopDBusPropertiesInterface *> propertyMonitors;
+    QtBluezPropertiesSubscription *deviceMonitor = nullptr;
 
     void deviceFound(const QString &devicePath, const QVariantMap &properties);
 
-    QMap<QString, QVariantMap> devicesProperties;
+    // D-Bus object path -> index of the device in discoveredDevices
+    QHash<QString, qsizetype> devicePathIndex;
 #endif
 
 #ifdef QT_WINRT_BLUETOOTH
@@ -239,6 +279,7 @@ private:
 #endif // Q_OS_DARWIN
 
     int lowEnergySearchTimeout = 40000;
+    QBluetoothDeviceDiscoveryFilter discoveryFilter;
     QBluetoothDeviceDiscoveryAgent::DiscoveryMethods requestedMethods;
     QBluetoothDeviceDiscoveryAgent *q_ptr;
 };
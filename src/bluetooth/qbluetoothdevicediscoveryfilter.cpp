@@ -0,0 +1,283 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtBluetooth module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#include "qbluetoothdevicediscoveryfilter.h"
+
+QT_BEGIN_NAMESPACE
+
+class QBluetoothDeviceDiscoveryFilterPrivate : public QSharedData
+{
+public:
+    QList<QBluetoothUuid> serviceUuids;
+    QList<quint16> manufacturerIds;
+    QString namePrefix;
+    int pathlossThreshold = -1;
+    qint16 rssiThreshold = 0;
+    bool reportDuplicates = true;
+};
+
+/*!
+    \since 6.3
+    \class QBluetoothDeviceDiscoveryFilter
+    \inmodule QtBluetooth
+    \brief The QBluetoothDeviceDiscoveryFilter class describes the criteria a remote
+    device must meet to be reported by \l QBluetoothDeviceDiscoveryAgent.
+
+    A filter is applied via \l QBluetoothDeviceDiscoveryAgent::setDiscoveryFilter()
+    before discovery is started. Where the platform supports it, the criteria are
+    handed to the Bluetooth stack so that the controller itself discards
+    uninteresting advertisements; any criteria the stack cannot evaluate are
+    checked by the agent before a \l QBluetoothDeviceInfo is created.
+
+    All criteria that have been set must be met for a device to be reported.
+    A default constructed filter matches every device.
+
+    \note Currently only the BlueZ backend applies the filter. Other platforms
+    ignore it.
+
+    \sa QBluetoothDeviceDiscoveryAgent::setDiscoveryFilter()
+*/
+
+/*!
+   Constructs a new filter which matches every device.
+ */
+QBluetoothDeviceDiscoveryFilter::QBluetoothDeviceDiscoveryFilter()
+    : d(new QBluetoothDeviceDiscoveryFilterPrivate)
+{
+}
+
+/*! Constructs a new object of this class that is a copy of \a other. */
+QBluetoothDeviceDiscoveryFilter::QBluetoothDeviceDiscoveryFilter(
+        const QBluetoothDeviceDiscoveryFilter &other)
+    : d(other.d)
+{
+}
+
+/*! Destroys this object. */
+QBluetoothDeviceDiscoveryFilter::~QBluetoothDeviceDiscoveryFilter()
+{
+}
+
+/*! Makes this object a copy of \a other and returns the new value of this object. */
+QBluetoothDeviceDiscoveryFilter &QBluetoothDeviceDiscoveryFilter::operator=(
+        const QBluetoothDeviceDiscoveryFilter &other)
+{
+    d = other.d;
+    return *this;
+}
+
+/*!
+   Returns \c true if this filter has no criteria set and therefore matches
+   every device; otherwise returns \c false.
+ */
+bool QBluetoothDeviceDiscoveryFilter::isEmpty() const
+{
+    return d->serviceUuids.isEmpty() && d->manufacturerIds.isEmpty()
+            && d->namePrefix.isEmpty() && d->pathlossThreshold < 0
+            && d->rssiThreshold == 0 && d->reportDuplicates;
+}
+
+/*!
+   Restricts discovery to devices which advertise at least one of the service
+   \a uuids, either in their list of service UUIDs or as service data key.
+   An empty list, the default, disables this criterion.
+ */
+void QBluetoothDeviceDiscoveryFilter::setServiceUuids(const QList<QBluetoothUuid> &uuids)
+{
+    d->serviceUuids = uuids;
+}
+
+/*!
+   Returns the list of service UUIDs a device must advertise.
+ */
+QList<QBluetoothUuid> QBluetoothDeviceDiscoveryFilter::serviceUuids() const
+{
+    return d->serviceUuids;
+}
+
+/*!
+   Restricts discovery to devices whose received signal strength is at least
+   \a threshold dBm. A value of \c 0, the default, disables this criterion.
+
+   Setting an RSSI threshold resets the pathloss threshold, as the two are
+   mutually exclusive.
+
+   \sa setPathlossThreshold()
+ */
+void QBluetoothDeviceDiscoveryFilter::setRssiThreshold(qint16 threshold)
+{
+    d->rssiThreshold = threshold;
+    if (threshold != 0)
+        d->pathlossThreshold = -1;
+}
+
+/*!
+   Returns the minimum signal strength in dBm a device must be received with.
+ */
+qint16 QBluetoothDeviceDiscoveryFilter::rssiThreshold() const
+{
+    return d->rssiThreshold;
+}
+
+/*!
+   Restricts discovery to devices whose pathloss, the difference between the
+   advertised transmit power and the received signal strength, is at most
+   \a threshold dB. A negative value, the default, disables this criterion.
+
+   Setting a pathloss threshold resets the RSSI threshold, as the two are
+   mutually exclusive.
+
+   \sa setRssiThreshold()
+ */
+void QBluetoothDeviceDiscoveryFilter::setPathlossThreshold(int threshold)
+{
+    d->pathlossThreshold = threshold < 0 ? -1 : threshold;
+    if (threshold >= 0)
+        d->rssiThreshold = 0;
+}
+
+/*!
+   Returns the maximum pathloss in dB a device may have. A value of \c -1 means
+   the criterion is disabled.
+ */
+int QBluetoothDeviceDiscoveryFilter::pathlossThreshold() const
+{
+    return d->pathlossThreshold;
+}
+
+/*!
+   Determines whether every received advertisement of an already known device
+   is reported to the agent (\a report is \c true, the default), or whether the
+   controller should suppress duplicates.
+
+   Suppressing duplicates considerably reduces the traffic between controller
+   and host in crowded environments, at the cost of fewer RSSI and
+   manufacturer data updates.
+ */
+void QBluetoothDeviceDiscoveryFilter::setReportDuplicates(bool report)
+{
+    d->reportDuplicates = report;
+}
+
+/*!
+   Returns whether duplicate advertisements are reported.
+ */
+bool QBluetoothDeviceDiscoveryFilter::reportDuplicates() const
+{
+    return d->reportDuplicates;
+}
+
+/*!
+   Restricts discovery to devices whose name starts with \a prefix. The
+   comparison is case sensitive. An empty string, the default, disables this
+   criterion.
+ */
+void QBluetoothDeviceDiscoveryFilter::setNamePrefix(const QString &prefix)
+{
+    d->namePrefix = prefix;
+}
+
+/*!
+   Returns the prefix a device name must start with.
+ */
+QString QBluetoothDeviceDiscoveryFilter::namePrefix() const
+{
+    return d->namePrefix;
+}
+
+/*!
+   Restricts discovery to devices which advertise manufacturer specific data
+   for at least one of the company identifiers in \a ids. An empty list, the
+   default, disables this criterion.
+
+   \sa QBluetoothDeviceInfo::manufacturerIds()
+ */
+void QBluetoothDeviceDiscoveryFilter::setManufacturerIds(const QList<quint16> &ids)
+{
+    d->manufacturerIds = ids;
+}
+
+/*!
+   Returns the list of company identifiers of which at least one must be
+   present in the manufacturer data of a device.
+ */
+QList<quint16> QBluetoothDeviceDiscoveryFilter::manufacturerIds() const
+{
+    return d->manufacturerIds;
+}
+
+/*!
+   \fn void QBluetoothDeviceDiscoveryFilter::swap(QBluetoothDeviceDiscoveryFilter &other)
+   Swaps this object with \a other.
+ */
+
+/*!
+    \brief Returns \c true if \a a and \a b are equal with respect to their public state,
+    otherwise returns \c false.
+    \internal
+ */
+bool QBluetoothDeviceDiscoveryFilter::equals(const QBluetoothDeviceDiscoveryFilter &a,
+                                             const QBluetoothDeviceDiscoveryFilter &b)
+{
+    if (a.d == b.d)
+        return true;
+    return a.serviceUuids() == b.serviceUuids() && a.rssiThreshold() == b.rssiThreshold()
+            && a.pathlossThreshold() == b.pathlossThreshold()
+            && a.reportDuplicates() == b.reportDuplicates()
+            && a.namePrefix() == b.namePrefix() && a.manufacturerIds() == b.manufacturerIds();
+}
+
+/*!
+    \fn bool QBluetoothDeviceDiscoveryFilter::operator==(
+                                        const QBluetoothDeviceDiscoveryFilter &a,
+                                        const QBluetoothDeviceDiscoveryFilter &b)
+    \brief Returns \c true if \a a and \a b are equal with respect to their public state,
+    otherwise returns \c false.
+ */
+
+/*!
+    \fn bool QBluetoothDeviceDiscoveryFilter::operator!=(
+                                        const QBluetoothDeviceDiscoveryFilter &a,
+                                        const QBluetoothDeviceDiscoveryFilter &b)
+    \brief Returns \c true if \a a and \a b are not equal with respect to their public state,
+    otherwise returns \c false.
+ */
+
+QT_END_NAMESPACE
@@ -40,8 +40,31 @@
 #include "qbluetoothdeviceinfo.h"
 #include "qbluetoothdeviceinfo_p.h"
 
+#include <QtCore/QMutex>
+#include <QtCore/QSet>
+
+#include <algorithm>
+
 QT_BEGIN_NAMESPACE
 
+namespace {
+
+// Advertised names repeat a lot (many devices of the same product), those
+// devices share the storage of the name. The pool is bounded so that random
+// names, e.g. from privacy enabled devices, cannot grow it indefinitely.
+struct NamePool
+{
+    QMutex mutex;
+    QSet<QString> names;
+};
+
+constexpr qsizetype maxInternedNameLength = 64;
+constexpr qsizetype maxInternedNames = 4096;
+
+}
+
+Q_GLOBAL_STATIC(NamePool, namePool)
+
 /*!
     \class QBluetoothDeviceInfo
     \inmodule QtBluetooth
@@ -266,6 +289,74 @@ QBluetoothDeviceInfoPrivate::QBluetoothDeviceInfoPrivate()
 {
 }
 
+QString QBluetoothDeviceInfoPrivate::internName(const QString &name)
+{
+    if (name.isEmpty() || name.size() > maxInternedNameLength)
+        return name;
+
+    NamePool *pool = namePool();
+    if (!pool)
+        return name;
+
+    QMutexLocker locker(&pool->mutex);
+    const auto it = pool->names.constFind(name);
+    if (it != pool->names.cend())
+        return *it;
+
+    if (pool->names.size() >= maxInternedNames)
+        pool->names.clear();
+    pool->names.insert(name);
+    return name;
+}
+
+// Returns the most recently added data for key, nullptr if there is none
+template <typename Key>
+const QByteArray *QBluetoothDeviceInfoPrivate::findData(const DataEntries<Key> &entries,
+                                                        const Key &key)
+{
+    for (auto it = entries.crbegin(); it != entries.crend(); ++it) {
+        if (it->first == key)
+            return &it->second;
+    }
+    return nullptr;
+}
+
+// Returns false if the pair of key and data is already known
+template <typename Key>
+bool QBluetoothDeviceInfoPrivate::insertData(DataEntries<Key> &entries, const Key &key,
+                                             const QByteArray &data)
+{
+    for (const auto &entry : entries) {
+        if (entry.first == key && entry.second == data)
+            return false;
+    }
+    entries.append(std::make_pair(key, data));
+    return true;
+}
+
+template <typename Key>
+QMultiHash<Key, QByteArray> QBluetoothDeviceInfoPrivate::toHash(const DataEntries<Key> &entries)
+{
+    QMultiHash<Key, QByteArray> hash;
+    hash.reserve(entries.size());
+    for (const auto &entry : entries)
+        hash.insert(entry.first, entry.second);
+    return hash;
+}
+
+// Entries are unique, compare them as sets
+template <typename Key>
+bool QBluetoothDeviceInfoPrivate::sameData(const DataEntries<Key> &a, const DataEntries<Key> &b)
+{
+    if (a.size() != b.size())
+        return false;
+    for (const auto &entry : a) {
+        if (std::find(b.cbegin(), b.cend(), entry) == b.cend())
+            return false;
+    }
+    return true;
+}
+
 /*!
     Constructs an invalid QBluetoothDeviceInfo object.
 */
@@ -295,11 +386,11 @@ QBluetoothDeviceInfo::QBluetoothDeviceInfo(const QBluetoothAddress &address, con
     Q_D(QBluetoothDeviceInfo);
 
     d->address = address;
-    d->name = name;
+    d->name = QBluetoothDeviceInfoPrivate::internName(name);
 
     d->minorDeviceClass = static_cast<quint8>((classOfDevice >> 2) & 0x3f);
-    d->majorDeviceClass = static_cast<MajorDeviceClass>((classOfDevice >> 8) & 0x1f);
-    d->serviceClasses = static_cast<ServiceClasses>((classOfDevice >> 13) & 0x7ff);
+    d->majorDeviceClass = static_cast<quint8>((classOfDevice >> 8) & 0x1f);
+    d->serviceClasses = static_cast<quint16>((classOfDevice >> 13) & 0x7ff);
 
     d->valid = true;
     d->cached = false;
@@ -323,12 +414,12 @@ QBluetoothDeviceInfo::QBluetoothDeviceInfo(const QBluetoothUuid &uuid, const QSt
 {
     Q_D(QBluetoothDeviceInfo);
 
-    d->name = name;
+    d->name = QBluetoothDeviceInfoPrivate::internName(name);
     d->deviceUuid = uuid;
 
     d->minorDeviceClass = static_cast<quint8>((classOfDevice >> 2) & 0x3f);
-    d->majorDeviceClass = static_cast<MajorDeviceClass>((classOfDevice >> 8) & 0x1f);
-    d->serviceClasses = static_cast<ServiceClasses>((classOfDevice >> 13) & 0x7ff);
+    d->majorDeviceClass = static_cast<quint8>((classOfDevice >> 8) & 0x1f);
+    d->serviceClasses = static_cast<quint16>((classOfDevice >> 13) & 0x7ff);
 
     d->valid = true;
     d->cached = false;
@@ -339,9 +430,8 @@ QBluetoothDeviceInfo::QBluetoothDeviceInfo(const QBluetoothUuid &uuid, const QSt
     Constructs a QBluetoothDeviceInfo that is a copy of \a other.
 */
 QBluetoothDeviceInfo::QBluetoothDeviceInfo(const QBluetoothDeviceInfo &other) :
-    d_ptr(new QBluetoothDeviceInfoPrivate)
+    d_ptr(new QBluetoothDeviceInfoPrivate(*other.d_ptr))
 {
-    *this = other;
 }
 
 /*!
@@ -388,19 +478,8 @@ QBluetoothDeviceInfo &QBluetoothDeviceInfo::operator=(const QBluetoothDeviceInfo
 {
     Q_D(QBluetoothDeviceInfo);
 
-    d->address = other.d_func()->address;
-    d->name = other.d_func()->name;
-    d->minorDeviceClass = other.d_func()->minorDeviceClass;
-    d->majorDeviceClass = other.d_func()->majorDeviceClass;
-    d->serviceClasses = other.d_func()->serviceClasses;
-    d->valid = other.d_func()->valid;
-    d->cached = other.d_func()->cached;
-    d->serviceUuids = other.d_func()->serviceUuids;
-    d->manufacturerData = other.d_func()->manufacturerData;
-    d->serviceData = other.d_func()->serviceData;
-    d->rssi = other.d_func()->rssi;
-    d->deviceCoreConfiguration = other.d_func()->deviceCoreConfiguration;
-    d->deviceUuid = other.d_func()->deviceUuid;
+    if (this != &other)
+        *d = *other.d_func();
 
     return *this;
 }
@@ -437,13 +516,13 @@ bool QBluetoothDeviceInfo::equals(const QBluetoothDeviceInfo &a, const QBluetoot
         return false;
     if (a.d_func()->address != b.d_func()->address)
         return false;
-    if (a.d_func()->serviceUuids.count() != b.d_func()->serviceUuids.count())
-        return false;
     if (a.d_func()->serviceUuids != b.d_func()->serviceUuids)
         return false;
-    if (a.d_func()->manufacturerData != b.d_func()->manufacturerData)
+    if (!QBluetoothDeviceInfoPrivate::sameData(a.d_func()->manufacturerData,
+                                               b.d_func()->manufacturerData))
         return false;
-    if (a.d_func()->serviceData != b.d_func()->serviceData)
+    if (!QBluetoothDeviceInfoPrivate::sameData(a.d_func()->serviceData,
+                                               b.d_func()->serviceData))
         return false;
     if (a.d_func()->deviceCoreConfiguration != b.d_func()->deviceCoreConfiguration)
         return false;
@@ -488,7 +567,7 @@ void QBluetoothDeviceInfo::setName(const QString &name)
 {
     Q_D(QBluetoothDeviceInfo);
 
-    d->name = name;
+    d->name = QBluetoothDeviceInfoPrivate::internName(name);
 }
 
 /*!
@@ -498,7 +577,7 @@ QBluetoothDeviceInfo::ServiceClasses QBluetoothDeviceInfo::serviceClasses() cons
 {
     Q_D(const QBluetoothDeviceInfo);
 
-    return d->serviceClasses;
+    return static_cast<ServiceClasses>(d->serviceClasses);
 }
 
 /*!
@@ -508,7 +587,7 @@ QBluetoothDeviceInfo::MajorDeviceClass QBluetoothDeviceInfo::majorDeviceClass()
 {
     Q_D(const QBluetoothDeviceInfo);
 
-    return d->majorDeviceClass;
+    return static_cast<MajorDeviceClass>(d->majorDeviceClass);
 }
 
 /*!
@@ -533,7 +612,8 @@ quint8 QBluetoothDeviceInfo::minorDeviceClass() const
 void QBluetoothDeviceInfo::setServiceUuids(const QList<QBluetoothUuid> &uuids)
 {
     Q_D(QBluetoothDeviceInfo);
-    d->serviceUuids = uuids;
+    d->serviceUuids.clear();
+    d->serviceUuids.append(uuids.constData(), uuids.size());
 }
 
 /*!
@@ -547,7 +627,7 @@ void QBluetoothDeviceInfo::setServiceUuids(const QList<QBluetoothUuid> &uuids)
 QList<QBluetoothUuid> QBluetoothDeviceInfo::serviceUuids() const
 {
     Q_D(const QBluetoothDeviceInfo);
-    return d->serviceUuids;
+    return QList<QBluetoothUuid>(d->serviceUuids.cbegin(), d->serviceUuids.cend());
 }
 
 /*!
@@ -560,7 +640,11 @@ QList<QBluetoothUuid> QBluetoothDeviceInfo::serviceUuids() const
 QList<quint16> QBluetoothDeviceInfo::manufacturerIds() const
 {
     Q_D(const QBluetoothDeviceInfo);
-    return d->manufacturerData.keys().toList();
+    QList<quint16> ids;
+    ids.reserve(d->manufacturerData.size());
+    for (const auto &entry : d->manufacturerData)
+        ids.append(entry.first);
+    return ids;
 }
 
 /*!
@@ -589,7 +673,9 @@ QList<quint16> QBluetoothDeviceInfo::manufacturerIds() const
 QByteArray QBluetoothDeviceInfo::manufacturerData(quint16 manufacturerId) const
 {
     Q_D(const QBluetoothDeviceInfo);
-    return d->manufacturerData.value(manufacturerId);
+    const QByteArray *data = QBluetoothDeviceInfoPrivate::findData(d->manufacturerData,
+                                                                   manufacturerId);
+    return data ? *data : QByteArray();
 }
 
 /*!
@@ -605,15 +691,7 @@ QByteArray QBluetoothDeviceInfo::manufacturerData(quint16 manufacturerId) const
 bool QBluetoothDeviceInfo::setManufacturerData(quint16 manufacturerId, const QByteArray &data)
 {
     Q_D(QBluetoothDeviceInfo);
-    auto it = d->manufacturerData.constFind(manufacturerId);
-    while (it != d->manufacturerData.cend() && it.key() == manufacturerId) {
-        if (*it == data)
-            return false;
-        it++;
-    }
-
-    d->manufacturerData.insert(manufacturerId, data);
-    return true;
+    return QBluetoothDeviceInfoPrivate::insertData(d->manufacturerData, manufacturerId, data);
 }
 
 /*!
@@ -630,7 +708,7 @@ bool QBluetoothDeviceInfo::setManufacturerData(quint16 manufacturerId, const QBy
 QMultiHash<quint16, QByteArray> QBluetoothDeviceInfo::manufacturerData() const
 {
     Q_D(const QBluetoothDeviceInfo);
-    return d->manufacturerData;
+    return QBluetoothDeviceInfoPrivate::toHash(d->manufacturerData);
 }
 
 /*!
@@ -642,7 +720,11 @@ QMultiHash<quint16, QByteArray> QBluetoothDeviceInfo::manufacturerData() const
 QList<QBluetoothUuid> QBluetoothDeviceInfo::serviceIds() const
 {
     Q_D(const QBluetoothDeviceInfo);
-    return d->serviceData.keys().toList();
+    QList<QBluetoothUuid> ids;
+    ids.reserve(d->serviceData.size());
+    for (const auto &entry : d->serviceData)
+        ids.append(entry.first);
+    return ids;
 }
 
 /*!
@@ -666,7 +748,8 @@ QList<QBluetoothUuid> QBluetoothDeviceInfo::serviceIds() const
 QByteArray QBluetoothDeviceInfo::serviceData(const QBluetoothUuid &serviceId) const
 {
     Q_D(const QBluetoothDeviceInfo);
-    return d->serviceData.value(serviceId);
+    const QByteArray *data = QBluetoothDeviceInfoPrivate::findData(d->serviceData, serviceId);
+    return data ? *data : QByteArray();
 }
 
 /*!
@@ -679,15 +762,7 @@ QByteArray QBluetoothDeviceInfo::serviceData(const QBluetoothUuid &serviceId) co
 bool QBluetoothDeviceInfo::setServiceData(const QBluetoothUuid &serviceId, const QByteArray &data)
 {
     Q_D(QBluetoothDeviceInfo);
-    auto it = d->serviceData.constFind(serviceId);
-    while (it != d->serviceData.cend() && it.key() == serviceId) {
-        if (*it == data)
-            return false;
-        it++;
-    }
-
-    d->serviceData.insert(serviceId, data);
-    return true;
+    return QBluetoothDeviceInfoPrivate::insertData(d->serviceData, serviceId, data);
 }
 
 /*!
@@ -704,7 +779,7 @@ bool QBluetoothDeviceInfo::setServiceData(const QBluetoothUuid &serviceId, const
 QMultiHash<QBluetoothUuid, QByteArray> QBluetoothDeviceInfo::serviceData() const
 {
     Q_D(const QBluetoothDeviceInfo);
-    return d->serviceData;
+    return QBluetoothDeviceInfoPrivate::toHash(d->serviceData);
 }
 
 /*!
@@ -718,7 +793,7 @@ void QBluetoothDeviceInfo::setCoreConfigurations(QBluetoothDeviceInfo::CoreConfi
 {
     Q_D(QBluetoothDeviceInfo);
 
-    d->deviceCoreConfiguration = coreConfigs;
+    d->deviceCoreConfiguration = static_cast<quint8>(coreConfigs.toInt());
 }
 
 /*!
@@ -733,7 +808,7 @@ QBluetoothDeviceInfo::CoreConfigurations QBluetoothDeviceInfo::coreConfiguration
 {
     Q_D(const QBluetoothDeviceInfo);
 
-    return d->deviceCoreConfiguration;
+    return CoreConfigurations::fromInt(d->deviceCoreConfiguration);
 }
 
 /*!
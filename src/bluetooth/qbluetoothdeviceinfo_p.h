@@ -55,33 +55,55 @@
 #include "qbluetoothaddress.h"
 #include "qbluetoothuuid.h"
 
-#include <QString>
+#include <QtCore/QString>
+#include <QtCore/QVarLengthArray>
 #include <QtCore/qhash.h>
 
+#include <utility>
+
 QT_BEGIN_NAMESPACE
 
+/*
+    The layout is tuned for applications which keep a large number of
+    discovered devices in memory. The common case, a device with at most one
+    service UUID and one manufacturer or service data entry, does not need any
+    heap allocation apart from the QByteArray payload and the shared name.
+ */
 class QBluetoothDeviceInfoPrivate
 {
 public:
     QBluetoothDeviceInfoPrivate();
 
-    bool valid = false;
-    bool cached = false;
-    qint16 rssi = 1;
-    quint8 minorDeviceClass = 0;
+    static QString internName(const QString &name);
+
+    template <typename Key>
+    using DataEntries = QVarLengthArray<std::pair<Key, QByteArray>, 1>;
+
+    template <typename Key>
+    static const QByteArray *findData(const DataEntries<Key> &entries, const Key &key);
+    template <typename Key>
+    static bool insertData(DataEntries<Key> &entries, const Key &key, const QByteArray &data);
+    template <typename Key>
+    static QMultiHash<Key, QByteArray> toHash(const DataEntries<Key> &entries);
+    template <typename Key>
+    static bool sameData(const DataEntries<Key> &a, const DataEntries<Key> &b);
 
     QBluetoothAddress address;
     QString name;
-    QBluetoothDeviceInfo::MajorDeviceClass majorDeviceClass = QBluetoothDeviceInfo::MiscellaneousDevice;
-
-    QBluetoothDeviceInfo::ServiceClasses serviceClasses = QBluetoothDeviceInfo::NoService;
+    QBluetoothUuid deviceUuid;
 
-    QList<QBluetoothUuid> serviceUuids;
-    QMultiHash<quint16, QByteArray> manufacturerData;
-    QMultiHash<QBluetoothUuid, QByteArray> serviceData;
-    QBluetoothDeviceInfo::CoreConfigurations deviceCoreConfiguration = QBluetoothDeviceInfo::UnknownCoreConfiguration;
+    QVarLengthArray<QBluetoothUuid, 1> serviceUuids;
+    // entries in insertion order, keys may repeat
+    DataEntries<quint16> manufacturerData;
+    DataEntries<QBluetoothUuid> serviceData;
 
-    QBluetoothUuid deviceUuid;
+    qint16 rssi = 1;
+    quint16 serviceClasses = QBluetoothDeviceInfo::NoService;
+    quint8 minorDeviceClass = 0;
+    quint8 majorDeviceClass = QBluetoothDeviceInfo::MiscellaneousDevice;
+    quint8 deviceCoreConfiguration = QBluetoothDeviceInfo::UnknownCoreConfiguration;
+    bool valid = false;
+    bool cached = false;
 };
 
 QT_END_NAMESPACE
@@ -47,7 +47,7 @@
 
 #include "bluez/bluez5_helper_p.h"
 #include "bluez/objectmanager_p.h"
-#include "bluez/properties_p.h"
+#include "bluez/propertiesrouter_p.h"
 #include "bluez/adapter1_bluez5_p.h"
 #include "bluez/device1_bluez5_p.h"
 
@@ -447,7 +447,15 @@ void QBluetoothLocalDevicePrivate::connectDeviceChanges()
         if (reply.isError())
             return;
 
-        OrgFreedesktopDBusPropertiesInterface *monitor = nullptr;
+        // a single subscription covers all devices of this adapter
+        deviceProperties = QtBluezPropertiesRouter::instance()->subscribe(
+                    deviceAdapterPath, QStringLiteral("org.bluez.Device1"),
+                    QtBluezPropertiesRouter::PathMatch::Namespace, this,
+                    [this](const QString &path, const QString &interface,
+                           const QVariantMap &changedProperties,
+                           const QStringList &invalidatedProperties) {
+            PropertiesChanged(interface, path, changedProperties, invalidatedProperties);
+        });
 
         ManagedObjectList managedObjectList = reply.value();
         for (ManagedObjectList::const_iterator it = managedObjectList.constBegin(); it != managedObjectList.constEnd(); ++it) {
@@ -463,12 +471,7 @@ void QBluetoothLocalDevicePrivate::connectDeviceChanges()
                 const QVariantMap &ifaceValues = jt.value();
 
                 if (iface == QStringLiteral("org.bluez.Device1")) {
-                    monitor = new OrgFreedesktopDBusPropertiesInterface(QStringLiteral("org.bluez"),
-                                                                        path.path(),
-                                                                        QDBusConnection::systemBus(), this);
-                    connect(monitor, &OrgFreedesktopDBusPropertiesInterface::PropertiesChanged,
-                            this, &QBluetoothLocalDevicePrivate::PropertiesChanged);
-                    deviceChangeMonitors.insert(path.path(), monitor);
+                    knownDevicePaths.insert(path.path());
 
                     if (ifaceValues.value(QStringLiteral("Connected"), false).toBool()) {
                         QBluetoothAddress address(ifaceValues.value(QStringLiteral("Address")).toString());
@@ -484,10 +487,9 @@ QBluetoothLocalDevicePrivate::~QBluetoothLocalDevicePrivate()
 {
     delete adapter;
     delete adapterProperties;
+    delete deviceProperties;
     delete manager;
     delete pairingTarget;
-
-    qDeleteAll(deviceChangeMonitors);
 }
 
 void QBluetoothLocalDevicePrivate::initializeAdapter()
@@ -518,18 +520,21 @@ void QBluetoothLocalDevicePrivate::initializeAdapter()
 
     if (adapter) {
         //hook up propertiesChanged for current adapter
-        adapterProperties = new OrgFreedesktopDBusPropertiesInterface(
-                QStringLiteral("org.bluez"), adapter->path(),
-                QDBusConnection::systemBus(), this);
-        connect(adapterProperties, &OrgFreedesktopDBusPropertiesInterface::PropertiesChanged,
-                this, &QBluetoothLocalDevicePrivate::PropertiesChanged);
+        adapterProperties = QtBluezPropertiesRouter::instance()->subscribe(
+                adapter->path(), QStringLiteral("org.bluez.Adapter1"),
+                QtBluezPropertiesRouter::PathMatch::Exact, this,
+                [this](const QString &path, const QString &interface,
+                       const QVariantMap &changedProperties,
+                       const QStringList &invalidatedProperties) {
+            PropertiesChanged(interface, path, changedProperties, invalidatedProperties);
+        });
     }
 }
 
 void QBluetoothLocalDevicePrivate::PropertiesChanged(const QString &interface,
+                                                     const QString &path,
                                                      const QVariantMap &changed_properties,
-                                                     const QStringList &/*invalidated_properties*/,
-                                                     const QDBusMessage &)
+                                                     const QStringList &/*invalidated_properties*/)
 {
     //qDebug() << "Change" << interface << changed_properties;
     if (interface == QStringLiteral("org.bluez.Adapter1")) {
@@ -568,12 +573,10 @@ void QBluetoothLocalDevicePrivate::PropertiesChanged(const QString &interface,
     } else if (interface == QStringLiteral("org.bluez.Device1")
                && changed_properties.contains(QStringLiteral("Connected"))) {
         // update list of connected devices
-        OrgFreedesktopDBusPropertiesInterface *senderIface =
-                qobject_cast<OrgFreedesktopDBusPropertiesInterface*>(sender());
-        if (!senderIface)
+        if (!knownDevicePaths.contains(path))
             return;
 
-        const QString currentPath = senderIface->path();
+        const QString &currentPath = path;
         bool isConnected = changed_properties.value(QStringLiteral("Connected"), false).toBool();
         OrgBluezDevice1Interface device(QStringLiteral("org.bluez"), currentPath,
                                         QDBusConnection::systemBus());
@@ -592,17 +595,11 @@ void QBluetoothLocalDevicePrivate::PropertiesChanged(const QString &interface,
 void QBluetoothLocalDevicePrivate::InterfacesAdded(const QDBusObjectPath &object_path, InterfaceList interfaces_and_properties)
 {
     if (interfaces_and_properties.contains(QStringLiteral("org.bluez.Device1"))
-        && !deviceChangeMonitors.contains(object_path.path())) {
+        && !knownDevicePaths.contains(object_path.path())) {
         // a new device was added which we need to add to list of known devices
 
         if (objectPathIsForThisDevice(deviceAdapterPath, object_path.path())) {
-            OrgFreedesktopDBusPropertiesInterface *monitor = new OrgFreedesktopDBusPropertiesInterface(
-                                               QStringLiteral("org.bluez"),
-                                               object_path.path(),
-                                               QDBusConnection::systemBus());
-            connect(monitor, &OrgFreedesktopDBusPropertiesInterface::PropertiesChanged,
-                    this, &QBluetoothLocalDevicePrivate::PropertiesChanged);
-            deviceChangeMonitors.insert(object_path.path(), monitor);
+            knownDevicePaths.insert(object_path.path());
 
             const QVariantMap ifaceValues = interfaces_and_properties.value(QStringLiteral("org.bluez.Device1"));
             if (ifaceValues.value(QStringLiteral("Connected"), false).toBool()) {
@@ -626,12 +623,12 @@ void QBluetoothLocalDevicePrivate::InterfacesAdded(const QDBusObjectPath &object
 void QBluetoothLocalDevicePrivate::InterfacesRemoved(const QDBusObjectPath &object_path,
                                                      const QStringList &interfaces)
 {
-    if (deviceChangeMonitors.contains(object_path.path())
+    if (knownDevicePaths.contains(object_path.path())
             && interfaces.contains(QLatin1String("org.bluez.Device1"))) {
 
         if (objectPathIsForThisDevice(deviceAdapterPath, object_path.path())) {
             //a device was removed
-            delete deviceChangeMonitors.take(object_path.path());
+            knownDevicePaths.remove(object_path.path());
 
             //the path contains the address (e.g.: /org/bluez/hci0/dev_XX_XX_XX_XX_XX_XX)
             //-> use it to update current list of connected devices
@@ -659,8 +656,9 @@ void QBluetoothLocalDevicePrivate::InterfacesRemoved(const QDBusObjectPath &obje
         pairingTarget = nullptr;
 
         // turn  off connectivity monitoring
-        qDeleteAll(deviceChangeMonitors);
-        deviceChangeMonitors.clear();
+        delete deviceProperties;
+        deviceProperties = nullptr;
+        knownDevicePaths.clear();
         connectedDevicesSet.clear();
     }
 }
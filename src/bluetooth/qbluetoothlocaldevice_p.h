@@ -64,12 +64,12 @@
 #include "bluez/bluez5_helper_p.h"
 
 class OrgBluezAdapter1Interface;
-class OrgFreedesktopDBusPropertiesInterface;
 class OrgFreedesktopDBusObjectManagerInterface;
 class OrgBluezDevice1Interface;
 
 QT_BEGIN_NAMESPACE
 class QDBusPendingCallWatcher;
+class QtBluezPropertiesSubscription;
 QT_END_NAMESPACE
 #endif
 
@@ -140,9 +140,10 @@ public:
 
     QSet<QBluetoothAddress> connectedDevicesSet;
     OrgBluezAdapter1Interface *adapter = nullptr;
-    OrgFreedesktopDBusPropertiesInterface *adapterProperties = nullptr;
+    QtBluezPropertiesSubscription *adapterProperties = nullptr;
+    QtBluezPropertiesSubscription *deviceProperties = nullptr;
     OrgFreedesktopDBusObjectManagerInterface *manager = nullptr;
-    QMap<QString, OrgFreedesktopDBusPropertiesInterface *> deviceChangeMonitors;
+    QSet<QString> knownDevicePaths;
 
     QList<QBluetoothAddress> connectedDevices() const;
 
@@ -164,9 +165,9 @@ public slots:
 
 private Q_SLOTS:
     void PropertiesChanged(const QString &interface,
+                           const QString &path,
                            const QVariantMap &changed_properties,
-                           const QStringList &invalidated_properties,
-                           const QDBusMessage &signal);
+                           const QStringList &invalidated_properties);
     void InterfacesAdded(const QDBusObjectPath &object_path,
                          InterfaceList interfaces_and_properties);
     void InterfacesRemoved(const QDBusObjectPath &object_path,
@@ -0,0 +1,229 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtBluetooth module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#include "qbluetoothservicecache_p.h"
+
+#if QT_CONFIG(bluez)
+#include "bluez/propertiesrouter_p.h"
+#endif
+
+#include <QtCore/qcoreapplication.h>
+#include <QtCore/qglobalstatic.h>
+
+#include <algorithm>
+
+QT_BEGIN_NAMESPACE
+
+Q_GLOBAL_STATIC(QBluetoothServiceCache, serviceCache)
+
+/*!
+    \internal
+    \class QBluetoothServiceCache
+
+    Process-wide store of the services found by full service discoveries.
+
+    Entries are keyed by the remote device and the UUID filter of the discovery
+    which produced them. Each lookup states how old an entry may be, so agents
+    with different freshness requirements share the same data. A device's
+    entries are dropped when the platform reports that its service records changed.
+
+    Service discovery agents on any thread use the cache, a mutex guards the
+    entries. The cache itself lives in the application thread, which receives
+    the platform's change notifications.
+*/
+
+QBluetoothServiceCache::QBluetoothServiceCache()
+{
+    // the first agent using the cache may run on a short lived thread
+    if (QCoreApplication::instance())
+        moveToThread(QCoreApplication::instance()->thread());
+}
+
+QBluetoothServiceCache::~QBluetoothServiceCache()
+{
+}
+
+QBluetoothServiceCache *QBluetoothServiceCache::instance()
+{
+    return serviceCache();
+}
+
+static QList<QBluetoothUuid> normalizedFilter(const QList<QBluetoothUuid> &uuidFilter)
+{
+    QList<QBluetoothUuid> result = uuidFilter;
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    return result;
+}
+
+/*!
+    Stores the \a services found on \a device by a discovery using \a uuidFilter,
+    replacing any previous entry for the same filter.
+*/
+void QBluetoothServiceCache::insert(const QBluetoothAddress &device,
+                                    const QList<QBluetoothUuid> &uuidFilter,
+                                    const QList<QBluetoothServiceInfo> &services)
+{
+    QMutexLocker locker(&mutex);
+    monitorDevices();
+
+    const QList<QBluetoothUuid> filter = normalizedFilter(uuidFilter);
+    QList<Entry> &deviceEntries = entries[device.toUInt64()];
+    auto it = std::find_if(deviceEntries.begin(), deviceEntries.end(),
+                           [&filter](const Entry &entry) { return entry.uuidFilter == filter; });
+    if (it == deviceEntries.end())
+        it = deviceEntries.insert(deviceEntries.end(), Entry{ filter, {}, {} });
+    it->services = services;
+    it->age.start();
+}
+
+/*!
+    Looks up the services of \a device for a discovery using \a uuidFilter and
+    writes them to \a services. Entries older than \a maximumAge milliseconds are
+    ignored. An entry of an unfiltered discovery answers filtered lookups too.
+
+    Returns \c true if a usable entry was found.
+*/
+bool QBluetoothServiceCache::lookup(const QBluetoothAddress &device,
+                                    const QList<QBluetoothUuid> &uuidFilter, int maximumAge,
+                                    QList<QBluetoothServiceInfo> *services) const
+{
+    Q_ASSERT(services);
+    QMutexLocker locker(&mutex);
+
+    const auto deviceEntries = entries.constFind(device.toUInt64());
+    if (deviceEntries == entries.cend())
+        return false;
+
+    const QList<QBluetoothUuid> filter = normalizedFilter(uuidFilter);
+    const Entry *unfiltered = nullptr;
+    for (const Entry &entry : *deviceEntries) {
+        if (entry.age.hasExpired(maximumAge))
+            continue;
+        if (entry.uuidFilter == filter) {
+            *services = entry.services;
+            return true;
+        }
+        if (entry.uuidFilter.isEmpty())
+            unfiltered = &entry;
+    }
+    if (!unfiltered)
+        return false;
+
+    services->clear();
+    for (const QBluetoothServiceInfo &service : unfiltered->services) {
+        if (matchesFilter(service, filter))
+            services->append(service);
+    }
+    return true;
+}
+
+/*!
+    Returns the devices for which entries exist, regardless of their age.
+*/
+QList<QBluetoothAddress> QBluetoothServiceCache::devices() const
+{
+    QMutexLocker locker(&mutex);
+    QList<QBluetoothAddress> result;
+    result.reserve(entries.size());
+    for (auto it = entries.cbegin(); it != entries.cend(); ++it)
+        result.append(QBluetoothAddress(it.key()));
+    return result;
+}
+
+void QBluetoothServiceCache::invalidate(const QBluetoothAddress &device)
+{
+    QMutexLocker locker(&mutex);
+    entries.remove(device.toUInt64());
+}
+
+void QBluetoothServiceCache::clear()
+{
+    QMutexLocker locker(&mutex);
+    entries.clear();
+}
+
+/*!
+    Returns \c true if \a service passes \a uuidFilter. The filter applies to the
+    service UUID and the service class UUIDs; an empty filter passes everything.
+*/
+bool QBluetoothServiceCache::matchesFilter(const QBluetoothServiceInfo &service,
+                                           const QList<QBluetoothUuid> &uuidFilter)
+{
+    if (uuidFilter.isEmpty() || uuidFilter.contains(service.serviceUuid()))
+        return true;
+    const QList<QBluetoothUuid> classUuids = service.serviceClassUuids();
+    return std::any_of(classUuids.cbegin(), classUuids.cend(),
+                       [&uuidFilter](const QBluetoothUuid &uuid) {
+                           return uuidFilter.contains(uuid);
+                       });
+}
+
+void QBluetoothServiceCache::monitorDevices()
+{
+#if QT_CONFIG(bluez)
+    if (deviceMonitor)
+        return;
+
+    // Changed UUIDs mean changed service records, a changed pairing may
+    // expose records that require authentication.
+    deviceMonitor.reset(QtBluezPropertiesRouter::instance()->subscribe(
+                QStringLiteral("/org/bluez"), QStringLiteral("org.bluez.Device1"),
+                QtBluezPropertiesRouter::PathMatch::Namespace, this,
+                [this](const QString &path, const QString &,
+                       const QVariantMap &changedProperties,
+                       const QStringList &invalidatedProperties) {
+        if (!changedProperties.contains(QStringLiteral("UUIDs"))
+                && !changedProperties.contains(QStringLiteral("Paired"))
+                && !invalidatedProperties.contains(QStringLiteral("UUIDs"))) {
+            return;
+        }
+        // object paths end in dev_XX_XX_XX_XX_XX_XX
+        const qsizetype index = path.lastIndexOf(QLatin1String("/dev_"));
+        if (index == -1)
+            return;
+        QString address = path.mid(index + 5);
+        address.replace(QLatin1Char('_'), QLatin1Char(':'));
+        invalidate(QBluetoothAddress(address));
+    }));
+#endif
+}
+
+QT_END_NAMESPACE
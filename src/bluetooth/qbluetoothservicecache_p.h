@@ -0,0 +1,113 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtBluetooth module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#ifndef QBLUETOOTHSERVICECACHE_P_H
+#define QBLUETOOTHSERVICECACHE_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include "qbluetoothaddress.h"
+#include "qbluetoothserviceinfo.h"
+#include "qbluetoothuuid.h"
+
+#include <QtCore/qelapsedtimer.h>
+#include <QtCore/qhash.h>
+#include <QtCore/qlist.h>
+#include <QtCore/qmutex.h>
+#include <QtCore/qobject.h>
+
+#include <memory>
+
+QT_BEGIN_NAMESPACE
+
+#if QT_CONFIG(bluez)
+class QtBluezPropertiesSubscription;
+#endif
+
+class Q_AUTOTEST_EXPORT QBluetoothServiceCache : public QObject
+{
+    Q_OBJECT
+public:
+    QBluetoothServiceCache();
+    ~QBluetoothServiceCache();
+
+    static QBluetoothServiceCache *instance();
+
+    void insert(const QBluetoothAddress &device, const QList<QBluetoothUuid> &uuidFilter,
+                const QList<QBluetoothServiceInfo> &services);
+    bool lookup(const QBluetoothAddress &device, const QList<QBluetoothUuid> &uuidFilter,
+                int maximumAge, QList<QBluetoothServiceInfo> *services) const;
+    QList<QBluetoothAddress> devices() const;
+
+    void invalidate(const QBluetoothAddress &device);
+    void clear();
+
+    static bool matchesFilter(const QBluetoothServiceInfo &service,
+                              const QList<QBluetoothUuid> &uuidFilter);
+
+private:
+    struct Entry {
+        QList<QBluetoothUuid> uuidFilter; // sorted, empty means public browse group
+        QList<QBluetoothServiceInfo> services;
+        QElapsedTimer age;
+    };
+
+    void monitorDevices();
+
+    // agents on any thread use the cache, property changes arrive on its own thread
+    mutable QMutex mutex;
+    QHash<quint64, QList<Entry>> entries;
+#if QT_CONFIG(bluez)
+    std::unique_ptr<QtBluezPropertiesSubscription> deviceMonitor;
+#endif
+};
+
+QT_END_NAMESPACE
+
+#endif // QBLUETOOTHSERVICECACHE_P_H
@@ -41,6 +41,7 @@
 #include "qbluetoothlocaldevice.h"
 #include "qbluetoothservicediscoveryagent.h"
 #include "qbluetoothservicediscoveryagent_p.h"
+#include "qbluetoothservicecache_p.h"
 
 #include "qbluetoothdevicediscoveryagent.h"
 
@@ -115,6 +116,21 @@ QT_BEGIN_NAMESPACE
     Since a minimal discovery relies on cached SDP data it may not find a physically existing
     device until a \c FullDiscovery is performed.
     \value FullDiscovery        Performs a full service discovery.
+    \value CachedOnlyDiscovery  Reports the results of earlier full service discoveries
+    which are not older than \l maximumCacheAge() and does not contact any device. Without
+    a \l remoteAddress() the cached results of all devices are reported. This value was
+    introduced by Qt 6.3.
+    \value CacheThenRefreshDiscovery Reports the cached results like \c CachedOnlyDiscovery
+    and then performs a full service discovery. Services already reported from the cache
+    are not reported again. This value was introduced by Qt 6.3.
+
+    The cache is shared by all QBluetoothServiceDiscoveryAgent instances of the process.
+    It is filled by full service discoveries and keyed by the remote device and the
+    \l uuidFilter(). The results of a discovery without filter also serve filtered lookups.
+    Cached results of a device are dropped when the platform reports changed service
+    records for it.
+
+    \note The cache is currently only filled on Linux (BlueZ).
 */
 
 /*!
@@ -311,6 +327,72 @@ QBluetoothAddress QBluetoothServiceDiscoveryAgent::remoteAddress() const
         return QBluetoothAddress();
 }
 
+/*!
+    Sets the maximum number of remote devices which are queried at the same time
+    during a \l FullDiscovery without a \l remoteAddress() to \a limit. Values
+    smaller than \c 1 are treated as \c 1, which queries one device after another.
+
+    Each query has its own timeout, so a single unresponsive device does not hold up
+    the others. Services are reported via \l serviceDiscovered() as soon as the query
+    of the device offering them completes. A changed limit takes effect for queries
+    started afterwards.
+
+    The default limit is \c 3. Larger values shorten the time needed to scan many
+    devices but put more load on the local Bluetooth adapter.
+
+    \note This setting is currently only used on Linux (BlueZ). Other platforms always
+    query one device at a time.
+
+    \sa concurrentScanLimit()
+    \since 6.3
+*/
+void QBluetoothServiceDiscoveryAgent::setConcurrentScanLimit(int limit)
+{
+    Q_D(QBluetoothServiceDiscoveryAgent);
+    d->concurrentScanLimit = qMax(1, limit);
+}
+
+/*!
+    Returns the maximum number of remote devices which are queried at the same time.
+
+    \sa setConcurrentScanLimit()
+    \since 6.3
+*/
+int QBluetoothServiceDiscoveryAgent::concurrentScanLimit() const
+{
+    Q_D(const QBluetoothServiceDiscoveryAgent);
+    return d->concurrentScanLimit;
+}
+
+/*!
+    Sets the maximum age of cached results used by \l CachedOnlyDiscovery and
+    \l CacheThenRefreshDiscovery to \a msecs milliseconds. Older results are
+    ignored. A value of \c 0 disables the use of cached results; negative values
+    are treated as \c 0.
+
+    The default is five minutes.
+
+    \sa maximumCacheAge(), DiscoveryMode
+    \since 6.3
+*/
+void QBluetoothServiceDiscoveryAgent::setMaximumCacheAge(int msecs)
+{
+    Q_D(QBluetoothServiceDiscoveryAgent);
+    d->maximumCacheAge = qMax(0, msecs);
+}
+
+/*!
+    Returns the maximum age of cached results in milliseconds.
+
+    \sa setMaximumCacheAge()
+    \since 6.3
+*/
+int QBluetoothServiceDiscoveryAgent::maximumCacheAge() const
+{
+    Q_D(const QBluetoothServiceDiscoveryAgent);
+    return d->maximumCacheAge;
+}
+
 namespace DarwinBluetooth {
 
 void qt_test_iobluetooth_runloop();
@@ -341,12 +423,10 @@ void QBluetoothServiceDiscoveryAgent::start(DiscoveryMode mode)
         d->foundHostAdapterPath.clear();
 #endif
         d->setDiscoveryMode(mode);
-        if (d->deviceAddress.isNull()) {
-            d->startDeviceDiscovery();
-        } else {
-            d->discoveredDevices << QBluetoothDeviceInfo(d->deviceAddress, QString(), 0);
-            d->startServiceDiscovery();
-        }
+        if (mode == CachedOnlyDiscovery || mode == CacheThenRefreshDiscovery)
+            d->startCacheLookup();
+        else
+            d->startDiscovery();
     }
 }
 
@@ -367,6 +447,11 @@ void QBluetoothServiceDiscoveryAgent::stop()
         break;
     case QBluetoothServiceDiscoveryAgentPrivate::ServiceDiscovery:
         d->stopServiceDiscovery();
+        break;
+    case QBluetoothServiceDiscoveryAgentPrivate::CacheLookup:
+        d->setDiscoveryState(QBluetoothServiceDiscoveryAgentPrivate::Inactive);
+        emit canceled();
+        break;
     default:
         ;
     }
@@ -440,6 +525,75 @@ QString QBluetoothServiceDiscoveryAgent::errorString() const
  */
 
 
+/*!
+    Starts the discovery of devices or, if a remote address is set, the
+    service discovery on that device.
+*/
+void QBluetoothServiceDiscoveryAgentPrivate::startDiscovery()
+{
+    if (deviceAddress.isNull()) {
+        startDeviceDiscovery();
+    } else {
+        discoveredDevices << QBluetoothDeviceInfo(deviceAddress, QString(), 0);
+        startServiceDiscovery();
+    }
+}
+
+/*!
+    Reports cached services from the event loop, like any other discovery result.
+*/
+void QBluetoothServiceDiscoveryAgentPrivate::startCacheLookup()
+{
+    Q_Q(QBluetoothServiceDiscoveryAgent);
+
+    setDiscoveryState(CacheLookup);
+    QMetaObject::invokeMethod(q, [this]() { this->_q_cacheLookupDone(); },
+                              Qt::QueuedConnection);
+}
+
+void QBluetoothServiceDiscoveryAgentPrivate::_q_cacheLookupDone()
+{
+    Q_Q(QBluetoothServiceDiscoveryAgent);
+
+    if (discoveryState() != CacheLookup)
+        return; // stopped in the meantime
+
+    reportCachedServices();
+    if (discoveryState() != CacheLookup)
+        return; // stopped by a receiver of serviceDiscovered()
+
+    if (DiscoveryMode() == QBluetoothServiceDiscoveryAgent::CachedOnlyDiscovery) {
+        setDiscoveryState(Inactive);
+        emit q->finished();
+        return;
+    }
+
+    setDiscoveryMode(QBluetoothServiceDiscoveryAgent::FullDiscovery);
+    startDiscovery();
+}
+
+void QBluetoothServiceDiscoveryAgentPrivate::reportCachedServices()
+{
+    Q_Q(QBluetoothServiceDiscoveryAgent);
+
+    QBluetoothServiceCache *cache = QBluetoothServiceCache::instance();
+    const QList<QBluetoothAddress> devices = deviceAddress.isNull()
+            ? cache->devices() : QList<QBluetoothAddress>{ deviceAddress };
+    for (const QBluetoothAddress &device : devices) {
+        QList<QBluetoothServiceInfo> services;
+        if (!cache->lookup(device, uuidFilter, maximumCacheAge, &services))
+            continue;
+        for (const QBluetoothServiceInfo &serviceInfo : qAsConst(services)) {
+            if (isDuplicatedService(serviceInfo))
+                continue;
+            discoveredServices.append(serviceInfo);
+            emit q->serviceDiscovered(serviceInfo);
+            if (discoveryState() != CacheLookup)
+                return;
+        }
+    }
+}
+
 /*!
     Starts device discovery.
 */
@@ -77,7 +77,9 @@ public:
 
     enum DiscoveryMode {
         MinimalDiscovery,
-        FullDiscovery
+        FullDiscovery,
+        CachedOnlyDiscovery,
+        CacheThenRefreshDiscovery
     };
     Q_ENUM(DiscoveryMode)
 
@@ -98,6 +100,12 @@ public:
     bool setRemoteAddress(const QBluetoothAddress &address);
     QBluetoothAddress remoteAddress() const;
 
+    void setConcurrentScanLimit(int limit);
+    int concurrentScanLimit() const;
+
+    void setMaximumCacheAge(int msecs);
+    int maximumCacheAge() const;
+
 public Q_SLOTS:
     void start(DiscoveryMode mode = MinimalDiscovery);
     void stop();
@@ -39,15 +39,20 @@
 
 #include "qbluetoothservicediscoveryagent.h"
 #include "qbluetoothservicediscoveryagent_p.h"
+#include "qbluetoothservicecache_p.h"
 
 #include "bluez/bluez5_helper_p.h"
 #include "bluez/objectmanager_p.h"
 #include "bluez/adapter1_bluez5_p.h"
+#include "bluez/sdpscannerprotocol_p.h"
 
+#include <QtCore/QDataStream>
 #include <QtCore/QFile>
 #include <QtCore/QLibraryInfo>
 #include <QtCore/QLoggingCategory>
 #include <QtCore/QProcess>
+#include <QtCore/QTimer>
+#include <QtCore/QtEndian>
 #include <QtDBus/QDBusPendingCallWatcher>
 
 QT_BEGIN_NAMESPACE
@@ -68,6 +73,22 @@ QBluetoothServiceDiscoveryAgentPrivate::QBluetoothServiceDiscoveryAgentPrivate(
 
 QBluetoothServiceDiscoveryAgentPrivate::~QBluetoothServiceDiscoveryAgentPrivate()
 {
+    abortSdpScans();
+    // closing stdin lets idle workers exit on their own, they get a moment to do so
+    const QList<QProcess *> workers = idleSdpWorkers;
+    idleSdpWorkers.clear();
+    for (QProcess *worker : workers) {
+        worker->disconnect();
+        sdpWorkerTimers.take(worker)->stop();
+        worker->closeWriteChannel();
+    }
+    for (QProcess *worker : workers) {
+        if (!worker->waitForFinished(100)) {
+            worker->kill();
+            worker->waitForFinished();
+        }
+        delete worker;
+    }
     delete manager;
 }
 
@@ -122,129 +143,239 @@ void QBluetoothServiceDiscoveryAgentPrivate::start(const QBluetoothAddress &addr
     if (DiscoveryMode() == QBluetoothServiceDiscoveryAgent::MinimalDiscovery) {
         performMinimalServiceDiscovery(address);
     } else {
-        runExternalSdpScan(address, QBluetoothAddress(adapter.address()));
+        // queries all remaining devices, not only the one passed in
+        localAdapterAddress = QBluetoothAddress(adapter.address());
+        scheduleSdpScans();
     }
 }
 
+/*
+ * Runs the SDP queries of several devices at once, bounded by concurrentScanLimit.
+ * discoveredDevices holds the devices which have not been queried yet.
+ */
+void QBluetoothServiceDiscoveryAgentPrivate::scheduleSdpScans()
+{
+    while (discoveryState() == ServiceDiscovery && !discoveredDevices.isEmpty()
+           && runningSdpScans.size() < concurrentScanLimit) {
+        runExternalSdpScan(discoveredDevices.takeFirst());
+    }
+
+    if (runningSdpScans.isEmpty() && discoveryState() == ServiceDiscovery)
+        startServiceDiscovery(); // nothing left, finishes the discovery
+}
+
 /* Bluez 5
  * src/tools/sdpscanner performs an SDP scan. This is
  * done out-of-process to avoid license issues. At this stage Bluez uses GPLv2.
+ *
+ * The scanner runs in its worker mode: it stays alive between scans, takes one
+ * request per line on stdin and answers with a binary frame per request, see
+ * bluez/sdpscannerprotocol_p.h for the format.
  */
 void QBluetoothServiceDiscoveryAgentPrivate::runExternalSdpScan(
-        const QBluetoothAddress &remoteAddress, const QBluetoothAddress &localAddress)
+        const QBluetoothDeviceInfo &remoteDevice)
 {
-    Q_Q(QBluetoothServiceDiscoveryAgent);
-
-    if (!sdpScannerProcess) {
+    if (sdpScannerPath.isEmpty()) {
         const QString binPath = QLibraryInfo::path(QLibraryInfo::LibraryExecutablesPath);
         QFileInfo fileInfo(binPath, QStringLiteral("sdpscanner"));
         if (!fileInfo.exists() || !fileInfo.isExecutable()) {
-            _q_finishSdpScan(QBluetoothServiceDiscoveryAgent::InputOutputError,
+            _q_finishSdpScan(remoteDevice, QBluetoothServiceDiscoveryAgent::InputOutputError,
                              QBluetoothServiceDiscoveryAgent::tr("Unable to find sdpscanner"),
-                             QStringList());
+                             QList<QBluetoothServiceInfo>());
             qCWarning(QT_BT_BLUEZ) << "Cannot find sdpscanner:"
                                    << fileInfo.canonicalFilePath();
             return;
         }
-
-        sdpScannerProcess = new QProcess(q);
-        sdpScannerProcess->setReadChannel(QProcess::StandardOutput);
-        if (QT_BT_BLUEZ().isDebugEnabled())
-            sdpScannerProcess->setProcessChannelMode(QProcess::ForwardedErrorChannel);
-        sdpScannerProcess->setProgram(fileInfo.canonicalFilePath());
-        q->connect(sdpScannerProcess,
-                   QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
-                   q, [this](int exitCode, QProcess::ExitStatus status){
-            this->_q_sdpScannerDone(exitCode, status);
-        });
+        sdpScannerPath = fileInfo.canonicalFilePath();
     }
 
-    QStringList arguments;
-    arguments << remoteAddress.toString() << localAddress.toString();
+    QProcess *worker = idleSdpWorkers.isEmpty() ? startSdpWorker() : idleSdpWorkers.takeLast();
+    if (!worker) {
+        sdpScanFailed(remoteDevice);
+        return;
+    }
 
+    QByteArray request = remoteDevice.address().toString().toLatin1() + ' '
+            + localAdapterAddress.toString().toLatin1();
     // No filter implies PUBLIC_BROWSE_GROUP based SDP scan
     if (!uuidFilter.isEmpty()) {
-        arguments << QLatin1String("-u"); // cmd line option for list of uuids
+        request += " -u"; // option for list of uuids
         for (const QBluetoothUuid& uuid : qAsConst(uuidFilter))
-            arguments << uuid.toString();
+            request += ' ' + uuid.toString().toLatin1();
     }
+    request += '\n';
 
-    sdpScannerProcess->setArguments(arguments);
-    sdpScannerProcess->start();
+    runningSdpScans.insert(worker, remoteDevice);
+    worker->write(request);
+    sdpWorkerTimers.value(worker)->start(sdpScanTimeout);
 }
 
-void QBluetoothServiceDiscoveryAgentPrivate::_q_sdpScannerDone(int exitCode, QProcess::ExitStatus status)
+QProcess *QBluetoothServiceDiscoveryAgentPrivate::startSdpWorker()
 {
-    if (status != QProcess::NormalExit || exitCode != 0) {
-        qCWarning(QT_BT_BLUEZ) << "SDP scan failure" << status << exitCode;
-        if (singleDevice) {
-            _q_finishSdpScan(QBluetoothServiceDiscoveryAgent::InputOutputError,
-                             QBluetoothServiceDiscoveryAgent::tr("Unable to perform SDP scan"),
-                             QStringList());
-        } else {
-            // go to next device
-            _q_finishSdpScan(QBluetoothServiceDiscoveryAgent::NoError, QString(), QStringList());
+    Q_Q(QBluetoothServiceDiscoveryAgent);
+
+    QProcess *worker = new QProcess(q);
+    worker->setReadChannel(QProcess::StandardOutput);
+    // the diagnostics of sdpscanner are only of interest when debugging
+    if (QT_BT_BLUEZ().isDebugEnabled())
+        worker->setProcessChannelMode(QProcess::ForwardedErrorChannel);
+    else
+        worker->setStandardErrorFile(QProcess::nullDevice());
+    worker->setProgram(sdpScannerPath);
+    worker->setArguments({ QStringLiteral("-w") });
+
+    q->connect(worker, &QProcess::readyReadStandardOutput, q, [this, worker]() {
+        this->_q_sdpWorkerReadyRead(worker);
+    });
+    q->connect(worker, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
+               q, [this, worker]() {
+        this->_q_sdpWorkerFinished(worker);
+    });
+    q->connect(worker, &QProcess::errorOccurred, q, [this, worker](QProcess::ProcessError error) {
+        // finished() is not emitted in this case
+        if (error == QProcess::FailedToStart)
+            this->_q_sdpWorkerFinished(worker);
+    });
+
+    // an unresponsive device must not hold up the other queries,
+    // an unused worker must not linger
+    QTimer *timer = new QTimer(worker);
+    timer->setSingleShot(true);
+    sdpWorkerTimers.insert(worker, timer);
+    q->connect(timer, &QTimer::timeout, worker, [this, worker]() {
+        if (!runningSdpScans.contains(worker)) {
+            retireSdpWorker(worker);
+            return;
         }
+        qCWarning(QT_BT_BLUEZ) << "SDP scan timed out for"
+                               << runningSdpScans.value(worker).address().toString();
+        worker->kill();
+    });
+
+    worker->start();
+    if (worker->state() == QProcess::NotRunning) {
+        qCWarning(QT_BT_BLUEZ) << "Cannot start sdpscanner:" << worker->errorString();
+        sdpWorkerTimers.remove(worker);
+        worker->disconnect();
+        worker->deleteLater();
+        return nullptr;
+    }
+    return worker;
+}
+
+void QBluetoothServiceDiscoveryAgentPrivate::_q_sdpWorkerReadyRead(QProcess *worker)
+{
+    // quint32 frame length, followed by the frame
+    if (worker->bytesAvailable() < qint64(sizeof(quint32)))
+        return;
+    const QByteArray header = worker->peek(sizeof(quint32));
+    const quint32 length = qFromBigEndian<quint32>(header.constData());
+    if (worker->bytesAvailable() < qint64(sizeof(quint32) + length))
+        return;
+    worker->skip(sizeof(quint32));
+    const QByteArray frame = worker->read(length);
+
+    if (!runningSdpScans.contains(worker))
+        return;
+
+    const QBluetoothDeviceInfo device = runningSdpScans.take(worker);
+    idleSdpWorkers.append(worker);
+    sdpWorkerTimers.value(worker)->start(sdpWorkerIdleTimeout);
+
+    QDataStream stream(frame);
+    quint8 status = 0;
+    quint16 recordCount = 0;
+    stream >> status >> recordCount;
+
+    QList<QBluetoothServiceInfo> records;
+    for (quint16 i = 0; i < recordCount && stream.status() == QDataStream::Ok; ++i)
+        records.append(parseServiceRecord(device, stream));
+
+    if (stream.status() != QDataStream::Ok || status != 0) {
+        qCWarning(QT_BT_BLUEZ) << "SDP scan failure for" << device.address().toString()
+                               << "status" << status << "stream" << stream.status();
+        sdpScanFailed(device);
         return;
     }
 
-    QStringList xmlRecords;
-    const QByteArray output = sdpScannerProcess->readAllStandardOutput();
-    const QString decodedData = QString::fromUtf8(QByteArray::fromBase64(output));
-
-    // split the various xml docs up
-    int next;
-    int start = decodedData.indexOf(QStringLiteral("<?xml"), 0);
-    if (start != -1) {
-        do {
-            next = decodedData.indexOf(QStringLiteral("<?xml"), start + 1);
-            if (next != -1)
-                xmlRecords.append(decodedData.mid(start, next-start));
-            else
-                xmlRecords.append(decodedData.mid(start, decodedData.size() - start));
-            start = next;
-        } while ( start != -1);
+    _q_finishSdpScan(device, QBluetoothServiceDiscoveryAgent::NoError, QString(), records);
+}
+
+void QBluetoothServiceDiscoveryAgentPrivate::_q_sdpWorkerFinished(QProcess *worker)
+{
+    idleSdpWorkers.removeOne(worker);
+    if (QTimer *timer = sdpWorkerTimers.take(worker))
+        timer->stop();
+    worker->deleteLater();
+    if (!runningSdpScans.contains(worker))
+        return;
+
+    const QBluetoothDeviceInfo device = runningSdpScans.take(worker);
+    qCWarning(QT_BT_BLUEZ) << "SDP scan failure" << worker->exitStatus() << worker->exitCode();
+    sdpScanFailed(device);
+}
+
+void QBluetoothServiceDiscoveryAgentPrivate::sdpScanFailed(const QBluetoothDeviceInfo &device)
+{
+    if (singleDevice) {
+        _q_finishSdpScan(device, QBluetoothServiceDiscoveryAgent::InputOutputError,
+                         QBluetoothServiceDiscoveryAgent::tr("Unable to perform SDP scan"),
+                         QList<QBluetoothServiceInfo>());
+    } else {
+        // go to next device
+        scheduleSdpScans();
     }
+}
 
-    _q_finishSdpScan(QBluetoothServiceDiscoveryAgent::NoError, QString(), xmlRecords);
+void QBluetoothServiceDiscoveryAgentPrivate::retireSdpWorker(QProcess *worker)
+{
+    // the worker exits once stdin is closed, _q_sdpWorkerFinished() cleans up
+    idleSdpWorkers.removeOne(worker);
+    worker->closeWriteChannel();
 }
 
-void QBluetoothServiceDiscoveryAgentPrivate::_q_finishSdpScan(QBluetoothServiceDiscoveryAgent::Error errorCode,
+void QBluetoothServiceDiscoveryAgentPrivate::abortSdpScans()
+{
+    // idle workers are kept, busy ones cannot be interrupted
+    const QList<QProcess *> workers = runningSdpScans.keys();
+    runningSdpScans.clear();
+    for (QProcess *worker : workers) {
+        // no results are wanted anymore
+        worker->disconnect();
+        sdpWorkerTimers.take(worker)->stop();
+        if (worker->state() != QProcess::NotRunning) {
+            worker->terminate();
+            if (!worker->waitForFinished(100)) {
+                worker->kill();
+                worker->waitForFinished();
+            }
+        }
+        worker->deleteLater();
+    }
+}
+
+void QBluetoothServiceDiscoveryAgentPrivate::_q_finishSdpScan(const QBluetoothDeviceInfo &device,
+                                                              QBluetoothServiceDiscoveryAgent::Error errorCode,
                                                               const QString &errorDescription,
-                                                              const QStringList &xmlRecords)
+                                                              const QList<QBluetoothServiceInfo> &records)
 {
     Q_Q(QBluetoothServiceDiscoveryAgent);
 
     if (errorCode != QBluetoothServiceDiscoveryAgent::NoError) {
-        qCWarning(QT_BT_BLUEZ) << "SDP search failed for"
-                              << (!discoveredDevices.isEmpty()
-                                     ? discoveredDevices.at(0).address().toString()
-                                     : QStringLiteral("<Unknown>"));
+        qCWarning(QT_BT_BLUEZ) << "SDP search failed for" << device.address().toString();
         // We have an error which we need to indicate and stop further processing
         discoveredDevices.clear();
+        abortSdpScans();
         error = errorCode;
         errorString = errorDescription;
         emit q->errorOccurred(error);
-    } else if (!xmlRecords.isEmpty() && discoveryState() != Inactive) {
-        for (const QString &record : xmlRecords) {
-            QBluetoothServiceInfo serviceInfo = parseServiceXml(record);
-
+    } else if (discoveryState() != Inactive) {
+        // everything the device offers for this filter, also services reported before
+        QList<QBluetoothServiceInfo> deviceServices;
+        for (QBluetoothServiceInfo serviceInfo : records) {
             //apply uuidFilter
-            if (!uuidFilter.isEmpty()) {
-                bool serviceNameMatched = uuidFilter.contains(serviceInfo.serviceUuid());
-                bool serviceClassMatched = false;
-                const QList<QBluetoothUuid> serviceClassUuids
-                        = serviceInfo.serviceClassUuids();
-                for (const QBluetoothUuid &id : serviceClassUuids) {
-                    if (uuidFilter.contains(id)) {
-                        serviceClassMatched = true;
-                        break;
-                    }
-                }
-
-                if (!serviceNameMatched && !serviceClassMatched)
-                    continue;
-            }
+            if (!QBluetoothServiceCache::matchesFilter(serviceInfo, uuidFilter))
+                continue;
 
             if (!serviceInfo.isValid())
                 continue;
@@ -265,18 +396,20 @@ void QBluetoothServiceDiscoveryAgentPrivate::_q_finishSdpScan(QBluetoothServiceD
                 }
             }
 
+            deviceServices.append(serviceInfo);
             if (!isDuplicatedService(serviceInfo)) {
                 discoveredServices.append(serviceInfo);
-                qCDebug(QT_BT_BLUEZ) << "Discovered services" << discoveredDevices.at(0).address().toString()
+                qCDebug(QT_BT_BLUEZ) << "Discovered services" << device.address().toString()
                                      << serviceInfo.serviceName() << serviceInfo.serviceUuid()
                                      << ">>>" << serviceInfo.serviceClassUuids();
 
                 emit q->serviceDiscovered(serviceInfo);
             }
         }
+        QBluetoothServiceCache::instance()->insert(device.address(), uuidFilter, deviceServices);
     }
 
-    _q_serviceDiscoveryFinished();
+    scheduleSdpScans();
 }
 
 void QBluetoothServiceDiscoveryAgentPrivate::stop()
@@ -287,39 +420,26 @@ void QBluetoothServiceDiscoveryAgentPrivate::stop()
     setDiscoveryState(Inactive);
 
     // must happen after discoveredDevices.clear() above to avoid retrigger of next scan
-    // while waitForFinished() is waiting
-    if (sdpScannerProcess) { // Bluez 5
-        if (sdpScannerProcess->state() != QProcess::NotRunning) {
-            sdpScannerProcess->kill();
-            sdpScannerProcess->waitForFinished();
-        }
-    }
+    abortSdpScans();
 
     Q_Q(QBluetoothServiceDiscoveryAgent);
     emit q->canceled();
 }
 
-QBluetoothServiceInfo QBluetoothServiceDiscoveryAgentPrivate::parseServiceXml(
-                            const QString& xmlRecord)
+QBluetoothServiceInfo QBluetoothServiceDiscoveryAgentPrivate::parseServiceRecord(
+                            const QBluetoothDeviceInfo &device, QDataStream &stream)
 {
-    QXmlStreamReader xml(xmlRecord);
-
     QBluetoothServiceInfo serviceInfo;
-    serviceInfo.setDevice(discoveredDevices.at(0));
-
-    while (!xml.atEnd()) {
-        xml.readNext();
-
-        if (xml.tokenType() == QXmlStreamReader::StartElement &&
-            xml.name() == QLatin1String("attribute")) {
-            quint16 attributeId =
-                xml.attributes().value(QLatin1String("id")).toString().toUShort(nullptr, 0);
-
-            if (xml.readNextStartElement()) {
-                const QVariant value = readAttributeValue(xml);
-                serviceInfo.setAttribute(attributeId, value);
-            }
-        }
+    serviceInfo.setDevice(device);
+
+    quint16 attributeCount = 0;
+    stream >> attributeCount;
+    for (quint16 i = 0; i < attributeCount && stream.status() == QDataStream::Ok; ++i) {
+        quint16 attributeId = 0;
+        stream >> attributeId;
+        const QVariant value = readDataElement(stream);
+        if (stream.status() == QDataStream::Ok)
+            serviceInfo.setAttribute(attributeId, value);
     }
 
     return serviceInfo;
@@ -428,64 +548,100 @@ void QBluetoothServiceDiscoveryAgentPrivate::performMinimalServiceDiscovery(cons
     _q_serviceDiscoveryFinished();
 }
 
-QVariant QBluetoothServiceDiscoveryAgentPrivate::readAttributeValue(QXmlStreamReader &xml)
+template<typename T> static QVariant readValue(QDataStream &stream)
 {
-    if (xml.name() == QLatin1String("boolean")) {
-        const QString value = xml.attributes().value(QStringLiteral("value")).toString();
-        xml.skipCurrentElement();
-        return value == QLatin1String("true");
-    } else if (xml.name() == QLatin1String("uint8")) {
-        quint8 value = xml.attributes().value(QStringLiteral("value")).toString().toUShort(nullptr, 0);
-        xml.skipCurrentElement();
-        return value;
-    } else if (xml.name() == QLatin1String("uint16")) {
-        quint16 value = xml.attributes().value(QStringLiteral("value")).toString().toUShort(nullptr, 0);
-        xml.skipCurrentElement();
-        return value;
-    } else if (xml.name() == QLatin1String("uint32")) {
-        quint32 value = xml.attributes().value(QStringLiteral("value")).toString().toUInt(nullptr, 0);
-        xml.skipCurrentElement();
-        return value;
-    } else if (xml.name() == QLatin1String("uint64")) {
-        quint64 value = xml.attributes().value(QStringLiteral("value")).toString().toULongLong(nullptr, 0);
-        xml.skipCurrentElement();
-        return value;
-    } else if (xml.name() == QLatin1String("uuid")) {
-        QBluetoothUuid uuid;
-        const QString value = xml.attributes().value(QStringLiteral("value")).toString();
-        if (value.startsWith(QStringLiteral("0x"))) {
-            if (value.length() == 6) {
-                quint16 v = value.toUShort(nullptr, 0);
-                uuid = QBluetoothUuid(v);
-            } else if (value.length() == 10) {
-                quint32 v = value.toUInt(nullptr, 0);
-                uuid = QBluetoothUuid(v);
-            }
-        } else {
-            uuid = QBluetoothUuid(value);
-        }
-        xml.skipCurrentElement();
-        return QVariant::fromValue(uuid);
-    } else if (xml.name() == QLatin1String("text") || xml.name() == QLatin1String("url")) {
-        QString value = xml.attributes().value(QStringLiteral("value")).toString();
-        if (xml.attributes().value(QStringLiteral("encoding")) == QLatin1String("hex"))
-            value = QString::fromUtf8(QByteArray::fromHex(value.toLatin1()));
-        xml.skipCurrentElement();
-        return value;
-    } else if (xml.name() == QLatin1String("sequence")) {
-        QBluetoothServiceInfo::Sequence sequence;
-
-        while (xml.readNextStartElement()) {
-            QVariant value = readAttributeValue(xml);
-            sequence.append(value);
-        }
+    T value = 0;
+    stream >> value;
+    return QVariant::fromValue(value);
+}
 
-        return QVariant::fromValue<QBluetoothServiceInfo::Sequence>(sequence);
-    } else {
-        qCWarning(QT_BT_BLUEZ) << "unknown attribute type"
-                               << xml.name().toString()
-                               << xml.attributes().value(QStringLiteral("value")).toString();
-        xml.skipCurrentElement();
+static QByteArray readBytes(QDataStream &stream, quint32 length)
+{
+    QByteArray bytes;
+    // guards against bogus lengths, the frame has been read completely
+    if (length > quint32(stream.device()->bytesAvailable())) {
+        stream.setStatus(QDataStream::ReadCorruptData);
+        return bytes;
+    }
+    bytes.resize(length);
+    if (stream.readRawData(bytes.data(), int(length)) != int(length))
+        stream.setStatus(QDataStream::ReadPastEnd);
+    return bytes;
+}
+
+QVariant QBluetoothServiceDiscoveryAgentPrivate::readDataElement(QDataStream &stream, int depth)
+{
+    using namespace SdpScannerProtocol;
+
+    quint8 type = ElementNil;
+    stream >> type;
+
+    switch (type) {
+    case ElementNil:
+        return QVariant();
+    case ElementUInt8:
+        return readValue<quint8>(stream);
+    case ElementUInt16:
+        return readValue<quint16>(stream);
+    case ElementUInt32:
+        return readValue<quint32>(stream);
+    case ElementUInt64:
+        return readValue<quint64>(stream);
+    case ElementInt8:
+        return readValue<qint8>(stream);
+    case ElementInt16:
+        return readValue<qint16>(stream);
+    case ElementInt32:
+        return readValue<qint32>(stream);
+    case ElementInt64:
+        return readValue<qint64>(stream);
+    case ElementUInt128:
+    case ElementInt128:
+        // not representable in QBluetoothServiceInfo
+        stream.skipRawData(16);
+        return QVariant();
+    case ElementBool: {
+        quint8 value = 0;
+        stream >> value;
+        return value != 0;
+    }
+    case ElementUuid16: {
+        quint16 value = 0;
+        stream >> value;
+        return QVariant::fromValue(QBluetoothUuid(value));
+    }
+    case ElementUuid32: {
+        quint32 value = 0;
+        stream >> value;
+        return QVariant::fromValue(QBluetoothUuid(value));
+    }
+    case ElementUuid128:
+        return QVariant::fromValue(QBluetoothUuid(QUuid::fromRfc4122(readBytes(stream, 16))));
+    case ElementText:
+    case ElementUrl: {
+        quint32 length = 0;
+        stream >> length;
+        return QString::fromUtf8(readBytes(stream, length));
+    }
+    case ElementSequence:
+    case ElementAlternative: {
+        // nesting is limited to keep a broken frame from exhausting the stack
+        quint16 count = 0;
+        stream >> count;
+        if (depth > 32) {
+            stream.setStatus(QDataStream::ReadCorruptData);
+            return QVariant();
+        }
+        QList<QVariant> elements;
+        for (quint16 i = 0; i < count && stream.status() == QDataStream::Ok; ++i)
+            elements.append(readDataElement(stream, depth + 1));
+        if (type == ElementSequence)
+            return QVariant::fromValue(QBluetoothServiceInfo::Sequence(elements));
+        return QVariant::fromValue(QBluetoothServiceInfo::Alternative(elements));
+    }
+    default:
+        qCWarning(QT_BT_BLUEZ) << "unknown SDP data element type" << type;
+        stream.setStatus(QDataStream::ReadCorruptData);
         return QVariant();
     }
 }
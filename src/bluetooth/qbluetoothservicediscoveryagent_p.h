@@ -56,6 +56,7 @@
 #include "qbluetoothserviceinfo.h"
 #include "qbluetoothservicediscoveryagent.h"
 
+#include <QHash>
 #include <QStack>
 #include <QStringList>
 
@@ -67,8 +68,9 @@ class OrgFreedesktopDBusObjectManagerInterface;
 #include <QtCore/qprocess.h>
 
 QT_BEGIN_NAMESPACE
+class QDataStream;
 class QDBusPendingCallWatcher;
-class QXmlStreamReader;
+class QTimer;
 QT_END_NAMESPACE
 #endif
 
@@ -95,7 +97,7 @@ class LocalDeviceBroadcastReceiver;
 class QWinRTBluetoothServiceDiscoveryWorker;
 #endif
 
-class QBluetoothServiceDiscoveryAgentPrivate
+class Q_AUTOTEST_EXPORT QBluetoothServiceDiscoveryAgentPrivate
 #if defined(QT_WINRT_BLUETOOTH)
         : public QObject
 {
@@ -113,12 +115,15 @@ public:
         Inactive,
         DeviceDiscovery,
         ServiceDiscovery,
+        CacheLookup,
     };
 
     QBluetoothServiceDiscoveryAgentPrivate(QBluetoothServiceDiscoveryAgent *qp,
                                            const QBluetoothAddress &deviceAdapter);
     ~QBluetoothServiceDiscoveryAgentPrivate();
 
+    void startDiscovery();
+    void startCacheLookup();
     void startDeviceDiscovery();
     void stopDeviceDiscovery();
     void startServiceDiscovery();
@@ -133,12 +138,19 @@ public:
     void _q_deviceDiscoveryFinished();
     void _q_deviceDiscovered(const QBluetoothDeviceInfo &info);
     void _q_serviceDiscoveryFinished();
+    void _q_cacheLookupDone();
     void _q_deviceDiscoveryError(QBluetoothDeviceDiscoveryAgent::Error);
 #if QT_CONFIG(bluez)
-    void _q_sdpScannerDone(int exitCode, QProcess::ExitStatus status);
-    void _q_finishSdpScan(QBluetoothServiceDiscoveryAgent::Error errorCode,
+    void _q_sdpWorkerReadyRead(QProcess *worker);
+    void _q_sdpWorkerFinished(QProcess *worker);
+    void _q_finishSdpScan(const QBluetoothDeviceInfo &device,
+                          QBluetoothServiceDiscoveryAgent::Error errorCode,
                           const QString &errorDescription,
-                          const QStringList &xmlRecords);
+                          const QList<QBluetoothServiceInfo> &records);
+    // queries the services of discoveredDevices through sdpscanner workers
+    void scheduleSdpScans();
+    QBluetoothServiceInfo parseServiceRecord(const QBluetoothDeviceInfo &device,
+                                             QDataStream &stream);
 #endif
 #ifdef QT_ANDROID_BLUETOOTH
     void _q_processFetchedUuids(const QBluetoothAddress &address, const QList<QBluetoothUuid> &uuids);
@@ -153,14 +165,16 @@ private:
     void start(const QBluetoothAddress &address);
     void stop();
     bool isDuplicatedService(const QBluetoothServiceInfo &serviceInfo) const;
+    void reportCachedServices();
 
 #if QT_CONFIG(bluez)
     void startBluez5(const QBluetoothAddress &address);
-    void runExternalSdpScan(const QBluetoothAddress &remoteAddress,
-                    const QBluetoothAddress &localAddress);
-    void sdpScannerDone(int exitCode, QProcess::ExitStatus exitStatus);
-    QVariant readAttributeValue(QXmlStreamReader &xml);
-    QBluetoothServiceInfo parseServiceXml(const QString& xml);
+    void runExternalSdpScan(const QBluetoothDeviceInfo &remoteDevice);
+    QProcess *startSdpWorker();
+    void sdpScanFailed(const QBluetoothDeviceInfo &device);
+    void retireSdpWorker(QProcess *worker);
+    void abortSdpScans();
+    QVariant readDataElement(QDataStream &stream, int depth = 0);
     void performMinimalServiceDiscovery(const QBluetoothAddress &deviceAddress);
 #endif
 
@@ -171,6 +185,24 @@ public:
     QList<QBluetoothServiceInfo> discoveredServices;
     QList<QBluetoothDeviceInfo> discoveredDevices;
     QBluetoothAddress m_deviceAdapterAddress;
+#if QT_CONFIG(bluez)
+    QString sdpScannerPath;
+    QBluetoothAddress localAdapterAddress;
+    // upper bound for the SDP query of a single device, including paging
+    int sdpScanTimeout = 30000;
+    // idle workers exit after this time
+    int sdpWorkerIdleTimeout = 10000;
+    // sdpscanner processes in worker mode, busy ones map to the device being scanned
+    QHash<QProcess *, QBluetoothDeviceInfo> runningSdpScans;
+    QList<QProcess *> idleSdpWorkers;
+    // times the scan of a busy worker and the idle time of the others
+    QHash<QProcess *, QTimer *> sdpWorkerTimers;
+#endif
+
+    static QBluetoothServiceDiscoveryAgentPrivate *get(QBluetoothServiceDiscoveryAgent *q)
+    {
+        return q->d_func();
+    }
 
 private:
     DiscoveryState state;
@@ -181,10 +213,11 @@ private:
     QBluetoothServiceDiscoveryAgent::DiscoveryMode mode;
 
     bool singleDevice;
+    int concurrentScanLimit = 3;
+    int maximumCacheAge = 300000;
 #if QT_CONFIG(bluez)
     QString foundHostAdapterPath;
     OrgFreedesktopDBusObjectManagerInterface *manager = nullptr;
-    QProcess *sdpScannerProcess = nullptr;
 #endif
 
 #ifdef QT_ANDROID_BLUETOOTH
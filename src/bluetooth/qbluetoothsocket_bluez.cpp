@@ -45,6 +45,8 @@
 #include <QtBluetooth/QBluetoothLocalDevice>
 #include "bluez/bluez_data_p.h"
 
+#include <qtbluetooth_tracepoints_p.h>
+
 #include <qplatformdefs.h>
 #include <QtCore/private/qcore_unix_p.h>
 
@@ -391,6 +393,7 @@ void QBluetoothSocketPrivateBluez::_q_readNotify()
         q->disconnectFromService();
     }
     else {
+        Q_TRACE(QBluetoothSocketPrivateBluez_readNotify, socket, readFromDevice);
         emit q->readyRead();
     }
 }
@@ -579,6 +582,7 @@ qint64 QBluetoothSocketPrivateBluez::writeData(const char *data, qint64 maxSize)
             }
         }
 
+        Q_TRACE(QBluetoothSocketPrivateBluez_writeData, socket, maxSize, qint64(sz));
         if (sz > 0)
             emit q->bytesWritten(sz);
 
@@ -43,6 +43,7 @@
 #include "bluez/hcimanager_p.h"
 #include "qbluetoothsocketbase_p.h"
 
+#include <QtCore/qendian.h>
 #include <QtCore/qloggingcategory.h>
 
 #include <cstring>
@@ -62,9 +63,59 @@ struct AdvParams {
     quint8 filterPolicy;
 } __attribute__ ((packed));
 
+// Spec v5.0, Vol 2, Part E, 7.8.53
+struct ExtAdvParams {
+    quint8 handle;
+    quint16 properties;
+    quint8 primMinInterval[3];
+    quint8 primMaxInterval[3];
+    quint8 primChannelMap;
+    quint8 ownAddrType;
+    quint8 peerAddrType;
+    bdaddr_t peerAddr;
+    quint8 filterPolicy;
+    qint8 txPower;
+    quint8 primPhy;
+    quint8 secMaxSkip;
+    quint8 secPhy;
+    quint8 sid;
+    quint8 scanReqNotifEnable;
+} __attribute__ ((packed));
+
+// Spec v5.0, Vol 2, Part E, 7.8.61
+struct PeriodicAdvParams {
+    quint8 handle;
+    quint16 minInterval;
+    quint16 maxInterval;
+    quint16 properties;
+} __attribute__ ((packed));
+
+// Sequence of AD structures, limited to the capacity of the advertising PDU
 struct AdvData {
-    quint8 length;
-    quint8 data[31];
+    explicit AdvData(int capacity) : capacity(capacity) { data.reserve(capacity); }
+    int spaceLeft() const { return capacity - int(data.size()); }
+    void append(quint8 byte) { data.append(char(byte)); }
+
+    int capacity;
+    QByteArray data;
+};
+
+// Legacy advertising PDUs carry 31 bytes, extended ones are split into fragments
+static const int legacyDataLength = 31;
+static const int maxExtDataFragmentLength = 251;
+static const int maxPeriodicDataFragmentLength = 252;
+
+// Spec v5.0, Vol 2, Part E, 7.8.54
+enum ExtDataOperation : quint8 {
+    ExtDataIntermediateFragment = 0x00,
+    ExtDataFirstFragment = 0x01,
+    ExtDataLastFragment = 0x02,
+    ExtDataComplete = 0x03,
+};
+
+enum ExtAdvProperty : quint16 {
+    ExtAdvConnectable = 0x01,
+    ExtAdvScannable = 0x02,
 };
 
 struct WhiteListParams {
@@ -104,16 +155,32 @@ void QLeAdvertiserBluez::doStartAdvertising()
 
     m_sendPowerLevel = advertisingData().includePowerLevel()
             || scanResponseData().includePowerLevel();
-    if (m_sendPowerLevel)
+    m_extended = parameters().isExtendedAdvertising();
+    if (m_extended) {
+        // Spec v5.0, Vol 2, Part E, 7.8.57
+        // Also tells whether the controller supports extended advertising at all.
+        queueCommand(QBluezConst::OcfLeReadMaxAdvDataLength, QByteArray());
+    } else if (m_sendPowerLevel) {
         queueReadTxPowerLevelCommand();
-    else
+    } else {
         queueAdvertisingCommands();
+    }
     sendNextCommand();
 }
 
 void QLeAdvertiserBluez::doStopAdvertising()
 {
-    toggleAdvertising(false);
+    m_updatePending = false;
+    if (m_extended) {
+        toggleExtendedAdvertising(false);
+        if (usesPeriodicAdvertising())
+            togglePeriodicAdvertising(false);
+        // Spec v5.0, Vol 2, Part E, 7.8.59
+        queueCommand(QBluezConst::OcfLeRemoveAdvSet,
+                     QByteArray(1, char(parameters().advertisingSetId())));
+    } else {
+        toggleAdvertising(false);
+    }
     sendNextCommand();
 }
 
@@ -124,6 +191,11 @@ void QLeAdvertiserBluez::queueCommand(QBluezConst::OpCodeCommandField ocf, const
 
 void QLeAdvertiserBluez::sendNextCommand()
 {
+    if (m_pendingCommands.isEmpty() && m_updatePending) {
+        // advertising has been set up in the meantime, apply the postponed update
+        m_updatePending = false;
+        startDataUpdate();
+    }
     if (m_pendingCommands.isEmpty()) {
         // TODO: Unmonitor event.
         return;
@@ -157,6 +229,26 @@ void QLeAdvertiserBluez::toggleAdvertising(bool enable)
     queueCommand(QBluezConst::OcfLeSetAdvEnable, QByteArray(1, enable));
 }
 
+static quint8 effectiveFilterPolicy(const QLowEnergyAdvertisingParameters &params,
+                                    const QLowEnergyAdvertisingData &advData)
+{
+    if (params.filterPolicy() != QLowEnergyAdvertisingParameters::IgnoreWhiteList
+            && advData.discoverability() == QLowEnergyAdvertisingData::DiscoverabilityLimited) {
+        qCWarning(QT_BT_BLUEZ) << "limited discoverability is incompatible with "
+                                  "using a white list; disabling filtering";
+        return QLowEnergyAdvertisingParameters::IgnoreWhiteList;
+    }
+    return params.filterPolicy();
+}
+
+// Legacy and extended advertising both use the public device address. Random addresses
+// would first need LE Set Random Address, which QLowEnergyAdvertisingParameters cannot
+// express yet.
+static quint8 ownAddressType()
+{
+    return QLowEnergyController::PublicAddress;
+}
+
 void QLeAdvertiserBluez::setAdvertisingParams()
 {
     // Spec v4.2, Vol 2, Part E, 7.8.5
@@ -166,14 +258,8 @@ void QLeAdvertiserBluez::setAdvertisingParams()
     memset(&params, 0, sizeof params);
     setAdvertisingInterval(params);
     params.type = parameters().mode();
-    params.filterPolicy = parameters().filterPolicy();
-    if (params.filterPolicy != QLowEnergyAdvertisingParameters::IgnoreWhiteList
-            && advertisingData().discoverability() == QLowEnergyAdvertisingData::DiscoverabilityLimited) {
-        qCWarning(QT_BT_BLUEZ) << "limited discoverability is incompatible with "
-                                  "using a white list; disabling filtering";
-        params.filterPolicy = QLowEnergyAdvertisingParameters::IgnoreWhiteList;
-    }
-    params.ownAddrType = QLowEnergyController::PublicAddress; // TODO: Make configurable.
+    params.filterPolicy = effectiveFilterPolicy(parameters(), advertisingData());
+    params.ownAddrType = ownAddressType();
 
     // TODO: For ADV_DIRECT_IND.
     // params.directAddrType = xxx;
@@ -208,10 +294,10 @@ void QLeAdvertiserBluez::setAdvertisingInterval(AdvParams &params)
 
 void QLeAdvertiserBluez::setPowerLevel(AdvData &advData)
 {
-    if (m_sendPowerLevel) {
-        advData.data[advData.length++] = 2;
-        advData.data[advData.length++]= 0xa;
-        advData.data[advData.length++] = m_powerLevel;
+    if (m_sendPowerLevel && advData.spaceLeft() >= 3) {
+        advData.append(2);
+        advData.append(0xa);
+        advData.append(m_powerLevel);
     }
 }
 
@@ -224,10 +310,10 @@ void QLeAdvertiserBluez::setFlags(AdvData &advData)
     else if (advertisingData().discoverability() == QLowEnergyAdvertisingData::DiscoverabilityGeneral)
         flags |= 0x2;
     flags |= 0x4; // "BR/EDR not supported". Otherwise clients might try to connect over Bluetooth classic.
-    if (flags) {
-        advData.data[advData.length++] = 2;
-        advData.data[advData.length++] = 0x1;
-        advData.data[advData.length++] = flags;
+    if (flags && advData.spaceLeft() >= 3) {
+        advData.append(2);
+        advData.append(0x1);
+        advData.append(flags);
     }
 }
 
@@ -250,7 +336,7 @@ static void addServicesData(AdvData &data, const QList<T> &services)
 {
     if (services.isEmpty())
         return;
-    const int spaceAvailable = sizeof data.data - data.length;
+    const int spaceAvailable = data.spaceLeft();
     const int maxServices = qMin<int>((spaceAvailable - 2) / sizeof(T), services.count());
     if (maxServices <= 0) {
         qCWarning(QT_BT_BLUEZ) << "services data does not fit into advertising data packet";
@@ -261,11 +347,12 @@ static void addServicesData(AdvData &data, const QList<T> &services)
         qCWarning(QT_BT_BLUEZ) << "only" << maxServices << "out of" << services.count()
                                << "services fit into the advertising data";
     }
-    data.data[data.length++] = 1 + maxServices * sizeof(T);
-    data.data[data.length++] = servicesType<T>(dataComplete);
+    data.append(1 + maxServices * sizeof(T));
+    data.append(servicesType<T>(dataComplete));
     for (int i = 0; i < maxServices; ++i) {
-        putBtData(services.at(i), data.data + data.length);
-        data.length += sizeof(T);
+        char buffer[sizeof(T)];
+        putBtData(services.at(i), buffer);
+        data.data.append(buffer, sizeof(T));
     }
 }
 
@@ -304,77 +391,84 @@ void QLeAdvertiserBluez::setManufacturerData(const QLowEnergyAdvertisingData &sr
 {
     if (src.manufacturerId() == QLowEnergyAdvertisingData::invalidManufacturerId())
         return;
-    if (dest.length >= sizeof dest.data - 1 - 1 - 2 - src.manufacturerData().count()) {
+    if (dest.spaceLeft() < 1 + 1 + 2 + src.manufacturerData().count()) {
         qCWarning(QT_BT_BLUEZ) << "manufacturer data does not fit into advertising data packet";
         return;
     }
 
-    dest.data[dest.length++] = src.manufacturerData().count() + 1 + 2;
-    dest.data[dest.length++] = 0xff;
-    putBtData(src.manufacturerId(), dest.data + dest.length);
-    dest.length += sizeof(quint16);
-    std::memcpy(dest.data + dest.length, src.manufacturerData(), src.manufacturerData().count());
-    dest.length += src.manufacturerData().count();
+    dest.append(src.manufacturerData().count() + 1 + 2);
+    dest.append(0xff);
+    char id[sizeof(quint16)];
+    putBtData(src.manufacturerId(), id);
+    dest.data.append(id, sizeof id);
+    dest.data.append(src.manufacturerData());
 }
 
 void QLeAdvertiserBluez::setLocalNameData(const QLowEnergyAdvertisingData &src, AdvData &dest)
 {
     if (src.localName().isEmpty())
         return;
-    if (dest.length >= sizeof dest.data - 3) {
+    if (dest.spaceLeft() <= 3) {
         qCWarning(QT_BT_BLUEZ) << "local name does not fit into advertising data";
         return;
     }
 
     const QByteArray localNameUtf8 = src.localName().toUtf8();
     const int fullSize = localNameUtf8.count() + 1 + 1;
-    const int size = qMin<int>(fullSize, sizeof dest.data - dest.length);
+    const int size = qMin<int>(fullSize, dest.spaceLeft());
     const bool isComplete = size == fullSize;
-    dest.data[dest.length++] = size - 1;
+    dest.append(size - 1);
     const int dataType = isComplete ? 0x9 : 0x8;
-    dest.data[dest.length++] = dataType;
-    std::memcpy(dest.data + dest.length, localNameUtf8, size - 2);
-    dest.length += size - 2;
+    dest.append(dataType);
+    dest.data.append(localNameUtf8.constData(), size - 2);
 }
 
-void QLeAdvertiserBluez::setData(bool isScanResponseData)
+QByteArray QLeAdvertiserBluez::encodeData(const QLowEnergyAdvertisingData &sourceData,
+                                          bool includeFlags, int maxLength)
 {
     // Spec v4.2, Vol 3, Part C, 11 and Supplement, Part 1
-    AdvData theData;
-    static_assert(sizeof theData == 32, "unexpected struct size");
-    theData.length = 0;
+    if (!sourceData.rawData().isEmpty())
+        return sourceData.rawData().left(maxLength);
 
-    const QLowEnergyAdvertisingData &sourceData = isScanResponseData
-            ? scanResponseData() : advertisingData();
+    AdvData theData(maxLength);
+    if (sourceData.includePowerLevel())
+        setPowerLevel(theData);
+    if (includeFlags)
+        setFlags(theData);
 
-    if (!sourceData.rawData().isEmpty()) {
-        theData.length = qMin<int>(sizeof theData.data, sourceData.rawData().count());
-        std::memcpy(theData.data, sourceData.rawData().constData(), theData.length);
-    } else {
-        if (sourceData.includePowerLevel())
-            setPowerLevel(theData);
-        if (!isScanResponseData)
-            setFlags(theData);
+    // Insert new constant-length data here.
 
-        // Insert new constant-length data here.
+    setLocalNameData(sourceData, theData);
+    setServicesData(sourceData, theData);
+    setManufacturerData(sourceData, theData);
+    return theData.data;
+}
 
-        setLocalNameData(sourceData, theData);
-        setServicesData(sourceData, theData);
-        setManufacturerData(sourceData, theData);
-    }
+void QLeAdvertiserBluez::setData(bool isScanResponseData)
+{
+    const QLowEnergyAdvertisingData &sourceData = isScanResponseData
+            ? scanResponseData() : advertisingData();
+    const QByteArray encoded = encodeData(sourceData, !isScanResponseData, legacyDataLength);
 
-    std::memset(theData.data + theData.length, 0, sizeof theData.data - theData.length);
-    const QByteArray dataToSend = byteArrayFromStruct(theData);
+    // length byte followed by the zero padded data
+    QByteArray dataToSend(1, char(encoded.size()));
+    dataToSend += encoded;
+    dataToSend.append(QByteArray(legacyDataLength - encoded.size(), '\0'));
 
     if (!isScanResponseData) {
         qCDebug(QT_BT_BLUEZ) << "advertising data:" << dataToSend.toHex();
         queueCommand(QBluezConst::OcfLeSetAdvData, dataToSend);
-    } else if ((parameters().mode() == QLowEnergyAdvertisingParameters::AdvScanInd
-               || parameters().mode() == QLowEnergyAdvertisingParameters::AdvInd)
-               && theData.length > 0) {
+        m_encodedAdvData = encoded;
+        return;
+    }
+    // An empty scan response only needs to be sent to clear a previous one
+    if ((parameters().mode() == QLowEnergyAdvertisingParameters::AdvScanInd
+         || parameters().mode() == QLowEnergyAdvertisingParameters::AdvInd)
+            && (!encoded.isEmpty() || !m_encodedResponseData.isEmpty())) {
         qCDebug(QT_BT_BLUEZ) << "scan response data:" << dataToSend.toHex();
         queueCommand(QBluezConst::OcfLeSetScanResponseData, dataToSend);
     }
+    m_encodedResponseData = encoded;
 }
 
 void QLeAdvertiserBluez::setAdvertisingData()
@@ -406,6 +500,284 @@ void QLeAdvertiserBluez::setWhiteList()
     }
 }
 
+void QLeAdvertiserBluez::queueExtendedAdvertisingCommands()
+{
+    // The set must be disabled before its parameters can be changed.
+    toggleExtendedAdvertising(false);
+    if (usesPeriodicAdvertising())
+        togglePeriodicAdvertising(false);
+    setWhiteList();
+    // The data is queued once the parameters are confirmed, see handleCommandCompleted()
+    setExtendedAdvertisingParams();
+}
+
+void QLeAdvertiserBluez::queueExtendedDataCommands()
+{
+    const bool scannable = parameters().mode() == QLowEnergyAdvertisingParameters::AdvScanInd;
+
+    // Spec v5.0, Vol 2, Part E, 7.8.54
+    const QByteArray advData = encodeData(advertisingData(), true, m_maxDataLength);
+    if (!scannable) {
+        qCDebug(QT_BT_BLUEZ) << "extended advertising data:" << advData.toHex();
+        setExtendedData(QBluezConst::OcfLeSetExtAdvData, advData, maxExtDataFragmentLength);
+    } else if (!advData.isEmpty()) {
+        qCWarning(QT_BT_BLUEZ) << "scannable extended advertising carries no advertising data, "
+                                  "use the scan response data instead";
+    }
+
+    // Spec v5.0, Vol 2, Part E, 7.8.55
+    const QByteArray responseData = encodeData(scanResponseData(), false, m_maxDataLength);
+    if (scannable) {
+        qCDebug(QT_BT_BLUEZ) << "extended scan response data:" << responseData.toHex();
+        setExtendedData(QBluezConst::OcfLeSetExtScanResponseData, responseData,
+                        maxExtDataFragmentLength);
+    } else if (!responseData.isEmpty()) {
+        qCWarning(QT_BT_BLUEZ) << "only scannable extended advertising has a scan response, "
+                                  "ignoring scan response data";
+    }
+    m_encodedAdvData = advData;
+    m_encodedResponseData = responseData;
+
+    setPeriodicAdvertising();
+    toggleExtendedAdvertising(true);
+}
+
+void QLeAdvertiserBluez::toggleExtendedAdvertising(bool enable)
+{
+    // Spec v5.0, Vol 2, Part E, 7.8.56
+    QByteArray data;
+    data.append(char(enable));
+    data.append(char(1)); // number of sets
+    data.append(char(parameters().advertisingSetId()));
+    data.append(QByteArray(3, '\0')); // no duration and no event limit
+    queueCommand(QBluezConst::OcfLeSetExtAdvEnable, data);
+}
+
+static void putInterval24(quint32 interval, quint8 *dest)
+{
+    dest[0] = interval & 0xff;
+    dest[1] = (interval >> 8) & 0xff;
+    dest[2] = (interval >> 16) & 0xff;
+}
+
+void QLeAdvertiserBluez::setExtendedAdvertisingParams()
+{
+    // Spec v5.0, Vol 2, Part E, 7.8.53
+    ExtAdvParams params;
+    static_assert(sizeof params == 25, "unexpected struct size");
+    using namespace std;
+    memset(&params, 0, sizeof params);
+    params.handle = parameters().advertisingSetId();
+
+    // connectable extended advertising cannot be scannable at the same time
+    quint16 properties = 0;
+    if (parameters().mode() == QLowEnergyAdvertisingParameters::AdvInd)
+        properties = ExtAdvConnectable;
+    else if (parameters().mode() == QLowEnergyAdvertisingParameters::AdvScanInd)
+        properties = ExtAdvScannable;
+    params.properties = qToLittleEndian(properties);
+
+    const double multiplier = 0.625;
+    const quint32 specMinimum = 0x20;
+    const quint32 specMaximum = 0xffffff;
+    const quint32 minVal = parameters().minimumInterval() / multiplier;
+    const quint32 maxVal = parameters().maximumInterval() / multiplier;
+    putInterval24(qBound(specMinimum, minVal, specMaximum), params.primMinInterval);
+    putInterval24(qBound(specMinimum, maxVal, specMaximum), params.primMaxInterval);
+
+    params.primChannelMap = 0x7; // All channels.
+    params.ownAddrType = ownAddressType();
+    params.filterPolicy = effectiveFilterPolicy(parameters(), advertisingData());
+    params.txPower = 0x7f; // no preference
+    params.primPhy = 0x1; // LE 1M
+    params.secPhy = 0x1; // LE 1M
+    params.sid = parameters().advertisingSetId();
+
+    const QByteArray paramsData = byteArrayFromStruct(params);
+    qCDebug(QT_BT_BLUEZ) << "extended advertising parameters:" << paramsData.toHex();
+    queueCommand(QBluezConst::OcfLeSetExtAdvParams, paramsData);
+}
+
+void QLeAdvertiserBluez::setExtendedData(QBluezConst::OpCodeCommandField ocf,
+                                         const QByteArray &data, int maxFragmentLength)
+{
+    // Periodic advertising data has no fragment preference field
+    const bool hasFragmentPreference = ocf != QBluezConst::OcfLeSetPeriodicAdvData;
+    qsizetype offset = 0;
+    do {
+        const qsizetype length = qMin<qsizetype>(maxFragmentLength, data.size() - offset);
+        const bool first = offset == 0;
+        const bool last = offset + length == data.size();
+        ExtDataOperation operation = ExtDataIntermediateFragment;
+        if (first && last)
+            operation = ExtDataComplete;
+        else if (first)
+            operation = ExtDataFirstFragment;
+        else if (last)
+            operation = ExtDataLastFragment;
+
+        QByteArray command;
+        command.reserve(4 + length);
+        command.append(char(parameters().advertisingSetId()));
+        command.append(char(operation));
+        if (hasFragmentPreference)
+            command.append(char(0x1)); // the controller should not fragment the data
+        command.append(char(length));
+        command.append(data.constData() + offset, length);
+        queueCommand(ocf, command);
+
+        offset += length;
+    } while (offset < data.size());
+}
+
+bool QLeAdvertiserBluez::usesPeriodicAdvertising() const
+{
+    return m_extended && parameters().periodicMinimumInterval() > 0
+            && parameters().mode() == QLowEnergyAdvertisingParameters::AdvNonConnInd;
+}
+
+void QLeAdvertiserBluez::setPeriodicAdvertising()
+{
+    if (parameters().periodicMinimumInterval() > 0 && !usesPeriodicAdvertising()) {
+        qCWarning(QT_BT_BLUEZ) << "periodic advertising requires non-connectable, "
+                                  "non-scannable advertising; not enabling it";
+        return;
+    }
+    if (!usesPeriodicAdvertising())
+        return;
+
+    // Spec v5.0, Vol 2, Part E, 7.8.61
+    PeriodicAdvParams params;
+    static_assert(sizeof params == 7, "unexpected struct size");
+    const double multiplier = 1.25;
+    const quint16 specMinimum = 0x6;
+    const quint16 specMaximum = 0xffff;
+    const quint16 minVal = qMin<double>(parameters().periodicMinimumInterval() / multiplier,
+                                        specMaximum);
+    const quint16 maxVal = qMin<double>(parameters().periodicMaximumInterval() / multiplier,
+                                        specMaximum);
+    params.handle = parameters().advertisingSetId();
+    params.minInterval = qToLittleEndian(forceIntoRange(minVal, specMinimum, specMaximum));
+    params.maxInterval = qToLittleEndian(forceIntoRange(maxVal, specMinimum, specMaximum));
+    params.properties = 0;
+    queueCommand(QBluezConst::OcfLeSetPeriodicAdvParams, byteArrayFromStruct(params));
+
+    // Spec v5.0, Vol 2, Part E, 7.8.62, flags are not allowed in periodic advertising data
+    const QByteArray periodicData = encodeData(advertisingData(), false, m_maxDataLength);
+    qCDebug(QT_BT_BLUEZ) << "periodic advertising data:" << periodicData.toHex();
+    setExtendedData(QBluezConst::OcfLeSetPeriodicAdvData, periodicData,
+                    maxPeriodicDataFragmentLength);
+
+    m_encodedPeriodicData = periodicData;
+    togglePeriodicAdvertising(true);
+}
+
+void QLeAdvertiserBluez::togglePeriodicAdvertising(bool enable)
+{
+    // Spec v5.0, Vol 2, Part E, 7.8.63
+    queueCommand(QBluezConst::OcfLeSetPeriodicAdvEnable,
+                 QByteArray(1, char(enable)) + char(parameters().advertisingSetId()));
+}
+
+void QLeAdvertiserBluez::doUpdateAdvertisingData()
+{
+    if (!m_pendingCommands.isEmpty()) {
+        // Advertising is still being set up, possibly with the old data.
+        // The new data is compared to whatever ends up in the controller afterwards.
+        m_updatePending = true;
+        return;
+    }
+    startDataUpdate();
+    sendNextCommand();
+}
+
+void QLeAdvertiserBluez::startDataUpdate()
+{
+    const bool powerLevelNeeded = advertisingData().includePowerLevel()
+            || scanResponseData().includePowerLevel();
+    if (powerLevelNeeded && !m_powerLevelKnown && !m_extended) {
+        // the TX power level was not needed so far
+        m_sendPowerLevel = true;
+        m_readingPowerLevelForUpdate = true;
+        queueReadTxPowerLevelCommand();
+        return;
+    }
+    m_sendPowerLevel = powerLevelNeeded && m_powerLevelKnown;
+    queueChangedDataCommands();
+}
+
+void QLeAdvertiserBluez::queueChangedDataCommands()
+{
+    const qsizetype queuedBefore = m_pendingCommands.size();
+
+    if (m_extended) {
+        const bool scannable = parameters().mode() == QLowEnergyAdvertisingParameters::AdvScanInd;
+        const QByteArray advData = encodeData(advertisingData(), true, m_maxDataLength);
+        if (!scannable && advData != m_encodedAdvData) {
+            qCDebug(QT_BT_BLUEZ) << "updating extended advertising data:" << advData.toHex();
+            updateExtendedData(QBluezConst::OcfLeSetExtAdvData, advData);
+        }
+        m_encodedAdvData = advData;
+
+        const QByteArray responseData = encodeData(scanResponseData(), false, m_maxDataLength);
+        if (scannable && responseData != m_encodedResponseData) {
+            qCDebug(QT_BT_BLUEZ) << "updating extended scan response data:"
+                                 << responseData.toHex();
+            updateExtendedData(QBluezConst::OcfLeSetExtScanResponseData, responseData);
+        }
+        m_encodedResponseData = responseData;
+
+        if (usesPeriodicAdvertising()) {
+            const QByteArray periodicData = encodeData(advertisingData(), false,
+                                                       m_maxDataLength);
+            if (periodicData != m_encodedPeriodicData) {
+                qCDebug(QT_BT_BLUEZ) << "updating periodic advertising data:"
+                                     << periodicData.toHex();
+                updateExtendedData(QBluezConst::OcfLeSetPeriodicAdvData, periodicData);
+            }
+            m_encodedPeriodicData = periodicData;
+        }
+    } else {
+        // Spec v4.2, Vol 2, Part E, 7.8.7-8, both may be issued while advertising is enabled
+        if (encodeData(advertisingData(), true, legacyDataLength) != m_encodedAdvData)
+            setAdvertisingData();
+        if (encodeData(scanResponseData(), false, legacyDataLength) != m_encodedResponseData)
+            setScanResponseData();
+    }
+
+    if (m_pendingCommands.size() == queuedBefore) {
+        qCDebug(QT_BT_BLUEZ) << "advertising data unchanged, nothing to send";
+        QMetaObject::invokeMethod(this, &QLeAdvertiser::advertisingDataUpdated,
+                                  Qt::QueuedConnection);
+        return;
+    }
+    m_pendingCommands.last().completesUpdate = true;
+}
+
+void QLeAdvertiserBluez::updateExtendedData(QBluezConst::OpCodeCommandField ocf,
+                                            const QByteArray &data)
+{
+    const bool periodic = ocf == QBluezConst::OcfLeSetPeriodicAdvData;
+    const int maxFragmentLength = periodic ? maxPeriodicDataFragmentLength
+                                           : maxExtDataFragmentLength;
+
+    // Spec v5.0, Vol 2, Part E, 7.8.54-55 and 7.8.62, only complete data may be
+    // replaced while the set is enabled. Fragmented data requires a short pause.
+    if (data.size() <= maxFragmentLength) {
+        setExtendedData(ocf, data, maxFragmentLength);
+        return;
+    }
+    if (periodic)
+        togglePeriodicAdvertising(false);
+    else
+        toggleExtendedAdvertising(false);
+    setExtendedData(ocf, data, maxFragmentLength);
+    if (periodic)
+        togglePeriodicAdvertising(true);
+    else
+        toggleExtendedAdvertising(true);
+}
+
 void QLeAdvertiserBluez::handleCommandCompleted(quint16 opCode, quint8 status,
                                                 const QByteArray &data)
 {
@@ -428,10 +800,32 @@ void QLeAdvertiserBluez::handleCommandCompleted(quint16 opCode, quint8 status,
             sendNextCommand();
             return;
         }
+        if (((ocf == QBluezConst::OcfLeSetExtAdvEnable
+              || ocf == QBluezConst::OcfLeSetPeriodicAdvEnable)
+             && currentCmd.data.startsWith('\0'))
+                || ocf == QBluezConst::OcfLeRemoveAdvSet) {
+            // the set may not exist yet or was never enabled
+            qCDebug(QT_BT_BLUEZ) << "Disabling the advertising set failed, ignoring";
+            sendNextCommand();
+            return;
+        }
+        if (ocf == QBluezConst::OcfLeReadMaxAdvDataLength) {
+            qCDebug(QT_BT_BLUEZ) << "extended advertising is not supported, "
+                                    "falling back to legacy advertising";
+            m_extended = false;
+            m_maxDataLength = legacyDataLength;
+            if (m_sendPowerLevel)
+                queueReadTxPowerLevelCommand();
+            else
+                queueAdvertisingCommands();
+            sendNextCommand();
+            return;
+        }
         if (ocf == QBluezConst::OcfLeReadTxPowerLevel) {
             qCDebug(QT_BT_BLUEZ) << "reading power level failed, leaving it out of the "
                                     "advertising data";
             m_sendPowerLevel = false;
+            m_powerLevelKnown = false;
         } else {
             handleError();
             return;
@@ -444,20 +838,45 @@ void QLeAdvertiserBluez::handleCommandCompleted(quint16 opCode, quint8 status,
     case QBluezConst::OcfLeReadTxPowerLevel:
         if (m_sendPowerLevel) {
             m_powerLevel = data.at(0);
+            m_powerLevelKnown = true;
             qCDebug(QT_BT_BLUEZ) << "TX power level is" << m_powerLevel;
         }
-        queueAdvertisingCommands();
+        if (m_readingPowerLevelForUpdate) {
+            m_readingPowerLevelForUpdate = false;
+            queueChangedDataCommands();
+        } else {
+            queueAdvertisingCommands();
+        }
+        break;
+    case QBluezConst::OcfLeReadMaxAdvDataLength:
+        if (data.size() >= 2)
+            m_maxDataLength = qFromLittleEndian<quint16>(data.constData());
+        qCDebug(QT_BT_BLUEZ) << "maximum advertising data length is" << m_maxDataLength;
+        queueExtendedAdvertisingCommands();
+        break;
+    case QBluezConst::OcfLeSetExtAdvParams:
+        // the response carries the selected TX power
+        if (!data.isEmpty()) {
+            m_powerLevel = data.at(0);
+            m_powerLevelKnown = true;
+            qCDebug(QT_BT_BLUEZ) << "TX power level is" << m_powerLevel;
+        }
+        queueExtendedDataCommands();
         break;
     default:
         break;
     }
 
+    if (currentCmd.completesUpdate)
+        emit advertisingDataUpdated();
     sendNextCommand();
 }
 
 void QLeAdvertiserBluez::handleError()
 {
     m_pendingCommands.clear();
+    m_updatePending = false;
+    m_readingPowerLevelForUpdate = false;
     // TODO: Unmonitor event
     emit errorOccurred();
 }
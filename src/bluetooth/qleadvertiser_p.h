@@ -63,15 +63,23 @@
 
 QT_BEGIN_NAMESPACE
 
-class QLeAdvertiser : public QObject
+class Q_AUTOTEST_EXPORT QLeAdvertiser : public QObject
 {
     Q_OBJECT
 public:
     void startAdvertising() { doStartAdvertising(); }
     void stopAdvertising() { doStopAdvertising(); }
+    void updateAdvertisingData(const QLowEnergyAdvertisingData &advData,
+                               const QLowEnergyAdvertisingData &responseData)
+    {
+        m_advData = advData;
+        m_responseData = responseData;
+        doUpdateAdvertisingData();
+    }
 
 signals:
     void errorOccurred();
+    void advertisingDataUpdated();
 
 public:
     QLeAdvertiser(const QLowEnergyAdvertisingParameters &params,
@@ -88,10 +96,11 @@ protected:
 private:
     virtual void doStartAdvertising() = 0;
     virtual void doStopAdvertising() = 0;
+    virtual void doUpdateAdvertisingData() = 0;
 
     const QLowEnergyAdvertisingParameters m_params;
-    const QLowEnergyAdvertisingData m_advData;
-    const QLowEnergyAdvertisingData m_responseData;
+    QLowEnergyAdvertisingData m_advData;
+    QLowEnergyAdvertisingData m_responseData;
 };
 
 
@@ -100,7 +109,7 @@ struct AdvData;
 struct AdvParams;
 class HciManager;
 
-class QLeAdvertiserBluez : public QLeAdvertiser
+class Q_AUTOTEST_EXPORT QLeAdvertiserBluez : public QLeAdvertiser
 {
 public:
     QLeAdvertiserBluez(const QLowEnergyAdvertisingParameters &params,
@@ -112,12 +121,15 @@ public:
 private:
     void doStartAdvertising() override;
     void doStopAdvertising() override;
+    void doUpdateAdvertisingData() override;
 
     void setPowerLevel(AdvData &advData);
     void setFlags(AdvData &advData);
     void setServicesData(const QLowEnergyAdvertisingData &src, AdvData &dest);
     void setManufacturerData(const QLowEnergyAdvertisingData &src, AdvData &dest);
     void setLocalNameData(const QLowEnergyAdvertisingData &src, AdvData &dest);
+    QByteArray encodeData(const QLowEnergyAdvertisingData &src, bool isScanResponseData,
+                          int maxLength);
 
     void queueCommand(QBluezConst::OpCodeCommandField ocf, const QByteArray &advertisingData);
     void sendNextCommand();
@@ -131,6 +143,22 @@ private:
     void setScanResponseData();
     void setWhiteList();
 
+    // LE Extended Advertising, Bluetooth 5.0
+    void queueExtendedAdvertisingCommands();
+    void queueExtendedDataCommands();
+    void toggleExtendedAdvertising(bool enable);
+    void setExtendedAdvertisingParams();
+    void setExtendedData(QBluezConst::OpCodeCommandField ocf, const QByteArray &data,
+                         int maxFragmentLength);
+    void setPeriodicAdvertising();
+    void togglePeriodicAdvertising(bool enable);
+    bool usesPeriodicAdvertising() const;
+
+    // Updates of the data while advertising is active
+    void startDataUpdate();
+    void queueChangedDataCommands();
+    void updateExtendedData(QBluezConst::OpCodeCommandField ocf, const QByteArray &data);
+
     void handleCommandCompleted(quint16 opCode, quint8 status, const QByteArray &advertisingData);
     void handleError();
 
@@ -141,11 +169,22 @@ private:
         Command(QBluezConst::OpCodeCommandField ocf, const QByteArray &data) : ocf(ocf), data(data) { }
         QBluezConst::OpCodeCommandField ocf;
         QByteArray data;
+        bool completesUpdate = false;
     };
     QList<Command> m_pendingCommands;
 
+    // The payloads last handed to the controller
+    QByteArray m_encodedAdvData;
+    QByteArray m_encodedResponseData;
+    QByteArray m_encodedPeriodicData;
+
+    quint16 m_maxDataLength = 31;
     quint8 m_powerLevel;
+    bool m_powerLevelKnown = false;
     bool m_sendPowerLevel;
+    bool m_extended = false;
+    bool m_updatePending = false;
+    bool m_readingPowerLevelForUpdate = false;
 };
 #endif // QT_CONFIG(bluez)
 
@@ -242,8 +242,10 @@ QList<QBluetoothUuid> QLowEnergyAdvertisingData::services() const
   Sets the data to be advertised to \a data. If the value is not an empty byte array, it will
   be sent as-is as the advertising data and all other data in this object will be ignored.
   This can be used to send non-standard data.
-  \note If \a data is longer than 31 bytes, it will be truncated. It is the caller's responsibility
-        to ensure that \a data is well-formed.
+  \note If \a data is longer than 31 bytes, it will be truncated, unless extended advertising
+        is used. In that case the limit is determined by the local Bluetooth controller.
+        It is the caller's responsibility to ensure that \a data is well-formed.
+  \sa QLowEnergyAdvertisingParameters::setExtendedAdvertising()
  */
 void QLowEnergyAdvertisingData::setRawData(const QByteArray &data)
 {
@@ -57,6 +57,10 @@ public:
     QLowEnergyAdvertisingParameters::Mode mode;
     int minInterval;
     int maxInterval;
+    int periodicMinInterval = 0;
+    int periodicMaxInterval = 0;
+    quint8 setId = 0;
+    bool extended = false;
 };
 
 /*!
@@ -263,6 +267,101 @@ int QLowEnergyAdvertisingParameters::maximumInterval() const
     return d->maxInterval;
 }
 
+/*!
+   Enables LE Extended Advertising if \a extended is \c true. Extended advertising
+   was introduced with Bluetooth 5.0. It allows advertising and scan response data of
+   more than 31 bytes, several concurrent advertising sets and periodic advertising.
+
+   If the local Bluetooth controller does not support extended advertising, legacy
+   advertising is used instead and the advertised data may be truncated.
+
+   With extended advertising, connectable advertising (\l AdvInd) is not scannable, and
+   scannable advertising (\l AdvScanInd) carries its data in the scan response only.
+
+   The default is \c false.
+
+   \note Currently only BlueZ supports extended advertising.
+   \sa setAdvertisingSetId(), setPeriodicInterval()
+   \since 6.3
+ */
+void QLowEnergyAdvertisingParameters::setExtendedAdvertising(bool extended)
+{
+    d->extended = extended;
+}
+
+/*!
+   Returns \c true if LE Extended Advertising is requested.
+   \since 6.3
+ */
+bool QLowEnergyAdvertisingParameters::isExtendedAdvertising() const
+{
+    return d->extended;
+}
+
+/*!
+   Sets the advertising set identifier to \a id. Several advertising sets with
+   distinct identifiers can be active at the same time, for example by starting
+   advertising on several peripheral \l QLowEnergyController instances of the same
+   local adapter. Valid identifiers range from \c 0 to \c 15; larger values are
+   clamped.
+
+   The identifier is only used with extended advertising. The default is \c 0.
+
+   \sa setExtendedAdvertising()
+   \since 6.3
+ */
+void QLowEnergyAdvertisingParameters::setAdvertisingSetId(quint8 id)
+{
+    d->setId = qMin<quint8>(id, 0xf);
+}
+
+/*!
+   Returns the advertising set identifier.
+   \since 6.3
+ */
+quint8 QLowEnergyAdvertisingParameters::advertisingSetId() const
+{
+    return d->setId;
+}
+
+/*!
+   Enables periodic advertising with an interval between \a minimum and \a maximum
+   milliseconds. The periodic advertising train carries the advertising data and
+   allows scanners to synchronize to it. Passing \c 0 as \a minimum, the default,
+   disables periodic advertising. Intervals longer than the controller supports,
+   about 81.9 seconds, are shortened when advertising starts.
+   If \a maximum is smaller than \a minimum, it will be set to the value of \a minimum.
+
+   Periodic advertising requires extended advertising in the \l AdvNonConnInd mode.
+
+   \sa setExtendedAdvertising()
+   \since 6.3
+ */
+void QLowEnergyAdvertisingParameters::setPeriodicInterval(int minimum, int maximum)
+{
+    d->periodicMinInterval = qMax(0, minimum);
+    d->periodicMaxInterval = d->periodicMinInterval ? qMax(d->periodicMinInterval, maximum) : 0;
+}
+
+/*!
+   Returns the minimum periodic advertising interval in milliseconds. The default is 0,
+   which means periodic advertising is disabled.
+   \since 6.3
+ */
+int QLowEnergyAdvertisingParameters::periodicMinimumInterval() const
+{
+    return d->periodicMinInterval;
+}
+
+/*!
+   Returns the maximum periodic advertising interval in milliseconds. The default is 0.
+   \since 6.3
+ */
+int QLowEnergyAdvertisingParameters::periodicMaximumInterval() const
+{
+    return d->periodicMaxInterval;
+}
+
 /*!
    \fn void QLowEnergyAdvertisingParameters::swap(QLowEnergyAdvertisingParameters &other)
    Swaps this object with \a other.
@@ -280,7 +379,11 @@ bool QLowEnergyAdvertisingParameters::equals(const QLowEnergyAdvertisingParamete
         return true;
     return a.filterPolicy() == b.filterPolicy() && a.minimumInterval() == b.minimumInterval()
             && a.maximumInterval() == b.maximumInterval() && a.mode() == b.mode()
-            && a.whiteList() == b.whiteList();
+            && a.whiteList() == b.whiteList()
+            && a.isExtendedAdvertising() == b.isExtendedAdvertising()
+            && a.advertisingSetId() == b.advertisingSetId()
+            && a.periodicMinimumInterval() == b.periodicMinimumInterval()
+            && a.periodicMaximumInterval() == b.periodicMaximumInterval();
 }
 
 bool QLowEnergyAdvertisingParameters::AddressInfo::equals(
@@ -104,6 +104,16 @@ public:
     int minimumInterval() const;
     int maximumInterval() const;
 
+    void setExtendedAdvertising(bool extended);
+    bool isExtendedAdvertising() const;
+
+    void setAdvertisingSetId(quint8 id);
+    quint8 advertisingSetId() const;
+
+    void setPeriodicInterval(int minimum, int maximum);
+    int periodicMinimumInterval() const;
+    int periodicMaximumInterval() const;
+
     // TODO: own address type
     // TODO: For ADV_DIRECT_IND: peer address + peer address type
 
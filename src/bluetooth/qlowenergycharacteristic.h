@@ -108,6 +108,7 @@ private:
     QSharedPointer<QLowEnergyServicePrivate> d_ptr;
 
     friend class QLowEnergyService;
+    friend class QLowEnergyServicePrivate;
     friend class QLowEnergyControllerPrivate;
     friend class QLowEnergyControllerPrivateAndroid;
     friend class QLowEnergyControllerPrivateBluez;
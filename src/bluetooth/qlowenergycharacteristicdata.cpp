@@ -67,6 +67,8 @@ struct QLowEnergyCharacteristicDataPrivate : public QSharedData
     QBluetooth::AttAccessConstraints writeConstraints;
     int minimumValueLength;
     int maximumValueLength;
+    QLowEnergyCharacteristicData::ValueProvider valueProvider;
+    int valueProviderCacheTime = 0;
 };
 
 /*!
@@ -243,6 +245,75 @@ int QLowEnergyCharacteristicData::maximumValueLength() const
     return d->maximumValueLength;
 }
 
+/*!
+    \typedef QLowEnergyCharacteristicData::ValueProvider
+
+    A function returning the current value of a characteristic, see \l setValueProvider().
+
+    \since 6.3
+ */
+
+/*!
+    Makes the value of this characteristic computed on demand by \a provider.
+
+    Instead of serving the stored \l value(), the GATT server calls \a provider
+    when a client reads the characteristic, and sends the returned value. This
+    suits values which are expensive to compute but rarely read. The result is
+    also stored as the characteristic's value, which is sent with notifications
+    and indications.
+
+    If \a cacheTime is greater than zero, a produced value is reused for
+    reads within \a cacheTime milliseconds. The parts of a long read always
+    use the value produced for its first part.
+
+    The provider is called in the thread of the QLowEnergyController. A returned
+    value which violates the \l {setValueLength()}{length constraints} is ignored
+    and the previous value is sent instead. An empty \a provider disables the
+    mechanism again.
+
+    A Read By Type request calls the providers of the matching characteristics
+    in handle order, and only until the response is full.
+
+    \note Comparing two QLowEnergyCharacteristicData objects with \c{operator==()}
+    only checks whether both have a provider, not whether it is the same function.
+
+    \note Value providers are currently only supported by the BlueZ peripheral backend.
+    Other backends serve the stored value.
+
+    \sa valueProvider(), valueProviderCacheTime()
+    \since 6.3
+ */
+void QLowEnergyCharacteristicData::setValueProvider(const ValueProvider &provider,
+                                                    int cacheTime)
+{
+    d->valueProvider = provider;
+    d->valueProviderCacheTime = qMax(0, cacheTime);
+}
+
+/*!
+    Returns the function computing the value of this characteristic on demand, if any.
+
+    \sa setValueProvider()
+    \since 6.3
+ */
+QLowEnergyCharacteristicData::ValueProvider QLowEnergyCharacteristicData::valueProvider() const
+{
+    return d->valueProvider;
+}
+
+/*!
+    Returns the time in milliseconds for which a value produced by the
+    \l valueProvider() is reused. The default is \c 0, which means that every
+    read produces a new value.
+
+    \sa setValueProvider()
+    \since 6.3
+ */
+int QLowEnergyCharacteristicData::valueProviderCacheTime() const
+{
+    return d->valueProviderCacheTime;
+}
+
 /*!
   Returns true if and only if this characteristic is valid, that is, it has a non-null UUID.
  */
@@ -259,6 +330,7 @@ bool QLowEnergyCharacteristicData::isValid() const
 /*!
     \brief Returns \c true if \a a and \a b are equal with respect to their public state,
     otherwise returns \c false.
+    Value providers only compare by whether they are set.
     \internal
  */
 bool QLowEnergyCharacteristicData::equals(const QLowEnergyCharacteristicData &a,
@@ -270,7 +342,9 @@ bool QLowEnergyCharacteristicData::equals(const QLowEnergyCharacteristicData &a,
                 && a.readConstraints() == b.readConstraints()
                 && a.writeConstraints() == b.writeConstraints()
                 && a.minimumValueLength() == b.maximumValueLength()
-                && a.maximumValueLength() == b.maximumValueLength());
+                && a.maximumValueLength() == b.maximumValueLength()
+                && bool(a.valueProvider()) == bool(b.valueProvider())
+                && a.valueProviderCacheTime() == b.valueProviderCacheTime());
 }
 
 /*!
@@ -278,6 +352,10 @@ bool QLowEnergyCharacteristicData::equals(const QLowEnergyCharacteristicData &a,
                                                       const QLowEnergyCharacteristicData &b)
     \brief Returns \c true if \a a and \a b are equal with respect to their public state,
     otherwise returns \c false.
+
+    Functions cannot be compared, so only the presence of a \l valueProvider() is
+    taken into account: two objects with different providers but the same cache
+    time compare equal.
  */
 
 /*!
@@ -42,6 +42,8 @@
 #include <QtBluetooth/qlowenergycharacteristic.h>
 #include <QtCore/qshareddata.h>
 
+#include <functional>
+
 QT_BEGIN_NAMESPACE
 
 class QLowEnergyDescriptorData;
@@ -88,6 +90,11 @@ public:
     int minimumValueLength() const;
     int maximumValueLength() const;
 
+    using ValueProvider = std::function<QByteArray()>;
+    void setValueProvider(const ValueProvider &provider, int cacheTime = 0);
+    ValueProvider valueProvider() const;
+    int valueProviderCacheTime() const;
+
     bool isValid() const;
 
     void swap(QLowEnergyCharacteristicData &other) Q_DECL_NOTHROW { qSwap(d, other.d); }
@@ -0,0 +1,407 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtBluetooth module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#include "qlowenergyconnectionpool.h"
+#include "qlowenergyconnectionpool_p.h"
+
+#include <QtBluetooth/QBluetoothLocalDevice>
+#include <QtCore/QLoggingCategory>
+
+#if QT_CONFIG(bluez) && !defined(QT_BLUEZ_NO_BTLE)
+#include "bluez/hcimanager_p.h"
+#endif
+
+QT_BEGIN_NAMESPACE
+
+Q_DECLARE_LOGGING_CATEGORY(QT_BT)
+
+/*!
+    \class QLowEnergyConnectionPool
+    \inmodule QtBluetooth
+    \brief The QLowEnergyConnectionPool class distributes Bluetooth Low Energy
+    connections across several local adapters.
+
+    \since 6.3
+
+    Every Bluetooth controller supports only a limited number of simultaneous
+    LE connections, typically between 7 and 10. A QLowEnergyController is bound
+    to a single local adapter when it is created, so an application that creates
+    all of its controllers for the same adapter leaves the other adapters of the
+    system idle.
+
+    QLowEnergyConnectionPool creates the controllers itself. For every call to
+    \l connectToDevice() it selects the adapter with the lowest \l adapterLoad()
+    and creates a central role controller for it. When every adapter has reached
+    \l maximumConnectionsPerAdapter(), the request is queued and is served as
+    soon as a connection of the pool is closed or fails. Links of other
+    applications do not notify the pool when they are closed, so the load of
+    the adapters is also rechecked once per second while requests are waiting.
+
+    The \l connected() signal hands over the controller once the connection is
+    established. The controller is a child of the pool; the application
+    should reparent or delete it once it is no longer needed. If the connection
+    attempt fails, \l connectionFailed() is emitted and the controller is
+    deleted by the pool.
+
+    On BlueZ, the load of an adapter includes the LE connections established
+    by other applications. On all other platforms only the connections of the
+    pool itself are taken into account.
+
+    \sa QLowEnergyController::createCentral()
+*/
+
+/*!
+    \fn void QLowEnergyConnectionPool::connected(QLowEnergyController *controller)
+
+    This signal is emitted when a connection requested via \l connectToDevice()
+    has been established. The \a controller is in the
+    \l {QLowEnergyController::ConnectedState}{ConnectedState} and its
+    \l {QLowEnergyController::localAddress()}{localAddress()} is the adapter
+    that was selected.
+*/
+
+/*!
+    \fn void QLowEnergyConnectionPool::connectionFailed(const QBluetoothDeviceInfo &remoteDevice,
+                                                        QLowEnergyController::Error error)
+
+    This signal is emitted when the connection to \a remoteDevice could not be
+    established. The \a error describes the reason.
+*/
+
+QLowEnergyConnectionPoolPrivate::QLowEnergyConnectionPoolPrivate(
+        const QList<QBluetoothAddress> &adapters, QLowEnergyConnectionPool *parent)
+    : adapters(adapters), q_ptr(parent)
+{
+    recheckTimer.setInterval(1000);
+    QObject::connect(&recheckTimer, &QTimer::timeout, parent, [this]() {
+        scheduleConnections();
+    });
+}
+
+int QLowEnergyConnectionPoolPrivate::externalConnectionCount(const QBluetoothAddress &adapter) const
+{
+    if (externalConnectionCounter)
+        return externalConnectionCounter(adapter);
+#if QT_CONFIG(bluez) && !defined(QT_BLUEZ_NO_BTLE)
+    HciManager *manager = hciManagers.value(adapter.toUInt64());
+    if (!manager) {
+        manager = new HciManager(adapter);
+        hciManagers.insert(adapter.toUInt64(), manager);
+    }
+    // also includes the links of this pool, an invalid manager reports none
+    return int(manager->activeLowEnergyConnections().size());
+#else
+    Q_UNUSED(adapter);
+    return 0;
+#endif
+}
+
+int QLowEnergyConnectionPoolPrivate::connectionCount(const QBluetoothAddress &adapter,
+                                                     bool established) const
+{
+    int count = 0;
+    for (const Connection &connection : connections) {
+        if (connection.adapter == adapter && connection.established == established)
+            ++count;
+    }
+    return count;
+}
+
+int QLowEnergyConnectionPoolPrivate::load(const QBluetoothAddress &adapter) const
+{
+    return qMax(externalConnectionCount(adapter), connectionCount(adapter, true))
+            + connectionCount(adapter, false);
+}
+
+QBluetoothAddress QLowEnergyConnectionPoolPrivate::selectAdapter() const
+{
+    QBluetoothAddress selected;
+    int lowestLoad = maximumConnections;
+    for (const QBluetoothAddress &adapter : adapters) {
+        const int adapterLoad = load(adapter);
+        if (adapterLoad < lowestLoad) {
+            lowestLoad = adapterLoad;
+            selected = adapter;
+        }
+    }
+    return selected;
+}
+
+void QLowEnergyConnectionPoolPrivate::scheduleConnections()
+{
+    Q_Q(QLowEnergyConnectionPool);
+
+    // a controller failing synchronously reenters via connectionDone()
+    if (scheduling)
+        return;
+    scheduling = true;
+
+    while (!queue.isEmpty()) {
+        if (adapters.isEmpty()) {
+            const QBluetoothDeviceInfo remoteDevice = queue.takeFirst();
+            emit q->connectionFailed(remoteDevice,
+                                     QLowEnergyController::InvalidBluetoothAdapterError);
+            continue;
+        }
+
+        const QBluetoothAddress adapter = selectAdapter();
+        if (adapter.isNull())
+            break;
+
+        const QBluetoothDeviceInfo remoteDevice = queue.takeFirst();
+        QLowEnergyController *controller =
+                QLowEnergyController::createCentral(remoteDevice, adapter, q);
+        connections.insert(controller, { remoteDevice, adapter, false });
+
+        QObject::connect(controller, &QLowEnergyController::connected, q, [this, controller]() {
+            auto it = connections.find(controller);
+            if (it == connections.end())
+                return;
+            it->established = true;
+            emit q_ptr->connected(controller);
+        });
+        QObject::connect(controller, &QLowEnergyController::errorOccurred, q, [this, controller]() {
+            if (!connections.value(controller).established)
+                connectionDone(controller);
+        });
+        QObject::connect(controller, &QLowEnergyController::stateChanged, q,
+                         [this, controller](QLowEnergyController::ControllerState state) {
+            if (state == QLowEnergyController::UnconnectedState)
+                connectionDone(controller);
+        });
+        QObject::connect(controller, &QObject::destroyed, q, [this, controller]() {
+            connectionLost(controller);
+        });
+
+        qCDebug(QT_BT) << "Connecting to" << remoteDevice.address().toString()
+                       << "via adapter" << adapter.toString();
+        controller->connectToDevice();
+    }
+
+    if (queue.isEmpty())
+        recheckTimer.stop();
+    else if (!recheckTimer.isActive())
+        recheckTimer.start();
+
+    scheduling = false;
+}
+
+void QLowEnergyConnectionPoolPrivate::connectionDone(QLowEnergyController *controller)
+{
+    Q_Q(QLowEnergyConnectionPool);
+
+    auto it = connections.find(controller);
+    if (it == connections.end())
+        return;
+
+    const Connection connection = it.value();
+    connections.erase(it);
+    // the pool no longer tracks the controller
+    QObject::disconnect(controller, nullptr, q, nullptr);
+
+    if (!connection.established) {
+        QLowEnergyController::Error error = controller->error();
+        if (error == QLowEnergyController::NoError)
+            error = QLowEnergyController::ConnectionError;
+        controller->deleteLater();
+        emit q->connectionFailed(connection.remoteDevice, error);
+    }
+
+    scheduleConnections();
+}
+
+void QLowEnergyConnectionPoolPrivate::connectionLost(QLowEnergyController *controller)
+{
+    if (connections.remove(controller))
+        scheduleConnections();
+}
+
+/*!
+    Constructs a new connection pool with \a parent that distributes connections
+    across all local Bluetooth adapters known at construction time.
+
+    \sa QBluetoothLocalDevice::allDevices()
+*/
+QLowEnergyConnectionPool::QLowEnergyConnectionPool(QObject *parent)
+    : QObject(parent)
+{
+    QList<QBluetoothAddress> adapters;
+    const QList<QBluetoothHostInfo> hosts = QBluetoothLocalDevice::allDevices();
+    for (const QBluetoothHostInfo &host : hosts)
+        adapters.append(host.address());
+    d_ptr = new QLowEnergyConnectionPoolPrivate(adapters, this);
+}
+
+/*!
+    Constructs a new connection pool with \a parent that distributes connections
+    across the local Bluetooth \a adapters.
+*/
+QLowEnergyConnectionPool::QLowEnergyConnectionPool(const QList<QBluetoothAddress> &adapters,
+                                                   QObject *parent)
+    : QObject(parent), d_ptr(new QLowEnergyConnectionPoolPrivate(adapters, this))
+{
+}
+
+/*!
+    Destroys the connection pool. Queued connection requests are discarded and
+    all controllers which are still children of the pool are deleted.
+*/
+QLowEnergyConnectionPool::~QLowEnergyConnectionPool()
+{
+    Q_D(QLowEnergyConnectionPool);
+    // the child controllers are deleted afterwards by ~QObject()
+    for (auto it = d->connections.keyBegin(); it != d->connections.keyEnd(); ++it)
+        QObject::disconnect(*it, nullptr, this, nullptr);
+#if QT_CONFIG(bluez) && !defined(QT_BLUEZ_NO_BTLE)
+    qDeleteAll(d->hciManagers);
+#endif
+    delete d_ptr;
+}
+
+/*!
+    Returns the addresses of the local adapters used by this pool.
+*/
+QList<QBluetoothAddress> QLowEnergyConnectionPool::adapters() const
+{
+    Q_D(const QLowEnergyConnectionPool);
+    return d->adapters;
+}
+
+/*!
+    Sets the number of simultaneous LE connections the pool places on a single
+    adapter to \a maximum. Values smaller than \c 1 are treated as \c 1.
+
+    Connection requests exceeding the capacity of all adapters are queued.
+    Raising the limit immediately serves queued requests.
+
+    \sa maximumConnectionsPerAdapter(), adapterLoad()
+*/
+void QLowEnergyConnectionPool::setMaximumConnectionsPerAdapter(int maximum)
+{
+    Q_D(QLowEnergyConnectionPool);
+    d->maximumConnections = qMax(1, maximum);
+    d->scheduleConnections();
+}
+
+/*!
+    Returns the number of simultaneous LE connections the pool places on a
+    single adapter. The default is \c 7, which most controllers support.
+
+    \sa setMaximumConnectionsPerAdapter()
+*/
+int QLowEnergyConnectionPool::maximumConnectionsPerAdapter() const
+{
+    Q_D(const QLowEnergyConnectionPool);
+    return d->maximumConnections;
+}
+
+/*!
+    Requests a connection to \a remoteDevice.
+
+    The connection is attempted right away via the least loaded adapter that has
+    capacity left. Otherwise the request is queued until an adapter has capacity
+    again. Requests are served in the order they were made.
+
+    If the pool has no adapters, \l connectionFailed() is emitted with
+    \l {QLowEnergyController::InvalidBluetoothAdapterError}{InvalidBluetoothAdapterError}.
+
+    \sa connected(), queuedConnectionCount()
+*/
+void QLowEnergyConnectionPool::connectToDevice(const QBluetoothDeviceInfo &remoteDevice)
+{
+    Q_D(QLowEnergyConnectionPool);
+    d->queue.append(remoteDevice);
+    d->scheduleConnections();
+}
+
+/*!
+    Discards all connection requests which are waiting for an adapter.
+    Connection attempts already in progress are not affected.
+*/
+void QLowEnergyConnectionPool::cancelQueuedConnections()
+{
+    Q_D(QLowEnergyConnectionPool);
+    d->queue.clear();
+    d->recheckTimer.stop();
+}
+
+/*!
+    Returns the number of connection requests waiting for an adapter.
+*/
+int QLowEnergyConnectionPool::queuedConnectionCount() const
+{
+    Q_D(const QLowEnergyConnectionPool);
+    return int(d->queue.size());
+}
+
+/*!
+    Returns the number of connections the pool has established via \a adapter
+    and which are still open.
+*/
+int QLowEnergyConnectionPool::connectionCount(const QBluetoothAddress &adapter) const
+{
+    Q_D(const QLowEnergyConnectionPool);
+    return d->connectionCount(adapter, true);
+}
+
+/*!
+    Returns the number of connection attempts in progress via \a adapter.
+*/
+int QLowEnergyConnectionPool::pendingConnectionCount(const QBluetoothAddress &adapter) const
+{
+    Q_D(const QLowEnergyConnectionPool);
+    return d->connectionCount(adapter, false);
+}
+
+/*!
+    Returns the number of LE connections occupying \a adapter. This is the sum
+    of the open and pending connections of the pool. On BlueZ, the open LE
+    connections of other applications are counted as well.
+
+    The pool compares this value against \l maximumConnectionsPerAdapter()
+    when selecting an adapter.
+*/
+int QLowEnergyConnectionPool::adapterLoad(const QBluetoothAddress &adapter) const
+{
+    Q_D(const QLowEnergyConnectionPool);
+    return d->load(adapter);
+}
+
+QT_END_NAMESPACE
@@ -0,0 +1,115 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtBluetooth module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#ifndef QLOWENERGYCONNECTIONPOOL_P_H
+#define QLOWENERGYCONNECTIONPOOL_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include "qlowenergyconnectionpool.h"
+
+#include <QtBluetooth/private/qtbluetoothglobal_p.h>
+#include <QtCore/QHash>
+#include <QtCore/QTimer>
+
+#include <functional>
+
+QT_BEGIN_NAMESPACE
+
+#if QT_CONFIG(bluez) && !defined(QT_BLUEZ_NO_BTLE)
+class HciManager;
+#endif
+
+class Q_AUTOTEST_EXPORT QLowEnergyConnectionPoolPrivate
+{
+    Q_DECLARE_PUBLIC(QLowEnergyConnectionPool)
+public:
+    struct Connection
+    {
+        QBluetoothDeviceInfo remoteDevice;
+        QBluetoothAddress adapter;
+        bool established = false;
+    };
+
+    QLowEnergyConnectionPoolPrivate(const QList<QBluetoothAddress> &adapters,
+                                    QLowEnergyConnectionPool *parent);
+
+    int externalConnectionCount(const QBluetoothAddress &adapter) const;
+    int connectionCount(const QBluetoothAddress &adapter, bool established) const;
+    int load(const QBluetoothAddress &adapter) const;
+    QBluetoothAddress selectAdapter() const;
+
+    void scheduleConnections();
+    void connectionDone(QLowEnergyController *controller);
+    void connectionLost(QLowEnergyController *controller);
+
+    static QLowEnergyConnectionPoolPrivate *get(QLowEnergyConnectionPool *q)
+    {
+        return q->d_func();
+    }
+
+    QList<QBluetoothAddress> adapters;
+    int maximumConnections = 7;
+    QList<QBluetoothDeviceInfo> queue;
+    QHash<QLowEnergyController *, Connection> connections;
+    bool scheduling = false;
+    // links outside of the pool do not notify it, queued requests poll for them
+    QTimer recheckTimer;
+    // replaces the adapter's own count of LE links, used by autotests
+    std::function<int(const QBluetoothAddress &)> externalConnectionCounter;
+#if QT_CONFIG(bluez) && !defined(QT_BLUEZ_NO_BTLE)
+    mutable QHash<quint64, HciManager *> hciManagers;
+#endif
+
+    QLowEnergyConnectionPool *q_ptr;
+};
+
+QT_END_NAMESPACE
+
+#endif // QLOWENERGYCONNECTIONPOOL_P_H
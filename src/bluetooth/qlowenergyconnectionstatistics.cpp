@@ -0,0 +1,264 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtBluetooth module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#include "qlowenergyconnectionstatistics.h"
+#include "qlowenergyconnectionstatistics_p.h"
+
+#include <iterator>
+
+QT_BEGIN_NAMESPACE
+
+/*!
+    \since 6.3
+    \class QLowEnergyConnectionStatistics
+    \brief The QLowEnergyConnectionStatistics class is a snapshot of the
+           traffic and request latencies of a Bluetooth LE connection.
+
+    \inmodule QtBluetooth
+    \ingroup shared
+
+    An instance is obtained from \l QLowEnergyController::connectionStatistics().
+    The counters start at zero whenever a connection is established and when
+    \l QLowEnergyController::resetConnectionStatistics() is called.
+
+    The time between sending an ATT request and receiving its response is
+    recorded per request opcode, as defined by the Bluetooth Core
+    Specification (Vol 3, Part F, 3.4.8), in a histogram with the bucket limits
+    returned by \l latencyBucketLimits().
+
+    The BlueZ kernel ATT backend reports every counter. The BlueZ D-Bus backend
+    has no access to the ATT bearer. It reports the payload of characteristic
+    and descriptor operations as bytes and packets, maps reads to
+    Read Request (\c 0x0a) and writes to Write Request (\c 0x12) or Write Command
+    (\c 0x52), and does not know the MTU. Other backends return empty
+    statistics.
+
+    \sa QLowEnergyController::connectionStatistics()
+*/
+
+/*!
+    \fn void QLowEnergyConnectionStatistics::swap(QLowEnergyConnectionStatistics &other)
+    Swaps this object with \a other.
+ */
+
+/*!
+    Constructs empty statistics.
+ */
+QLowEnergyConnectionStatistics::QLowEnergyConnectionStatistics()
+    : d(new QLowEnergyConnectionStatisticsPrivate)
+{
+}
+
+/*!
+    Constructs a copy of \a other.
+ */
+QLowEnergyConnectionStatistics::QLowEnergyConnectionStatistics(
+        const QLowEnergyConnectionStatistics &other)
+    : d(other.d)
+{
+}
+
+/*!
+    Destroys this object.
+ */
+QLowEnergyConnectionStatistics::~QLowEnergyConnectionStatistics()
+{
+}
+
+/*!
+    Makes this object a copy of \a other and returns the new value of this object.
+ */
+QLowEnergyConnectionStatistics &QLowEnergyConnectionStatistics::operator=(
+        const QLowEnergyConnectionStatistics &other)
+{
+    d = other.d;
+    return *this;
+}
+
+/*!
+    Returns the ATT MTU of the connection or \c -1 if it is not known.
+ */
+int QLowEnergyConnectionStatistics::mtu() const
+{
+    return d->mtu;
+}
+
+/*!
+    Returns the number of ATT bytes written to the connection.
+ */
+quint64 QLowEnergyConnectionStatistics::bytesSent() const
+{
+    return d->bytesSent;
+}
+
+/*!
+    Returns the number of ATT bytes received from the connection.
+ */
+quint64 QLowEnergyConnectionStatistics::bytesReceived() const
+{
+    return d->bytesReceived;
+}
+
+/*!
+    Returns the number of ATT PDUs written to the connection.
+ */
+quint64 QLowEnergyConnectionStatistics::packetsSent() const
+{
+    return d->packetsSent;
+}
+
+/*!
+    Returns the number of ATT PDUs received from the connection.
+ */
+quint64 QLowEnergyConnectionStatistics::packetsReceived() const
+{
+    return d->packetsReceived;
+}
+
+/*!
+    Returns the number of requests which received a response, including
+    error responses.
+
+    \sa errorResponseCount(), timeoutCount()
+ */
+quint64 QLowEnergyConnectionStatistics::requestCount() const
+{
+    return d->requests;
+}
+
+/*!
+    Returns the number of requests which received an error response.
+ */
+quint64 QLowEnergyConnectionStatistics::errorResponseCount() const
+{
+    return d->errorResponses;
+}
+
+/*!
+    Returns the number of requests which were abandoned because the remote
+    device did not respond in time.
+
+    \sa lateResponseCount()
+ */
+quint64 QLowEnergyConnectionStatistics::timeoutCount() const
+{
+    return d->timeouts;
+}
+
+/*!
+    Returns the number of responses which arrived after their request had
+    timed out. Such responses are discarded. A growing count suggests that the
+    request timeout is too short for the remote device.
+
+    \sa timeoutCount(), QLowEnergyController::setGattRequestTimeout()
+ */
+quint64 QLowEnergyConnectionStatistics::lateResponseCount() const
+{
+    return d->lateResponses;
+}
+
+/*!
+    Returns the number of requests which were waiting to be sent or for their
+    response when the snapshot was taken.
+ */
+int QLowEnergyConnectionStatistics::pendingRequestCount() const
+{
+    return d->pendingRequests;
+}
+
+/*!
+    Returns the number of packets which were waiting for the connection to
+    become writable when the snapshot was taken.
+ */
+int QLowEnergyConnectionStatistics::queuedPacketCount() const
+{
+    return d->queuedPackets;
+}
+
+/*!
+    Returns the sorted opcodes of the requests for which latencies were recorded.
+
+    \sa latencyHistogram()
+ */
+QList<quint8> QLowEnergyConnectionStatistics::requestOpcodes() const
+{
+    return d->latencies.keys();
+}
+
+/*!
+    Returns the latency histogram of the requests with \a opcode.
+
+    The list has one entry more than \l latencyBucketLimits(). The entry at
+    index \c i counts the responses which arrived within the limit at index
+    \c i but not within the previous one, the last entry counts the responses
+    which took longer than every limit. The list is empty if no request with
+    \a opcode received a response.
+ */
+QList<quint64> QLowEnergyConnectionStatistics::latencyHistogram(quint8 opcode) const
+{
+    const auto it = d->latencies.constFind(opcode);
+    if (it == d->latencies.cend())
+        return {};
+    const auto &buckets = it->buckets;
+    return QList<quint64>(std::begin(buckets), std::end(buckets));
+}
+
+/*!
+    Returns the sum of the latencies of all requests with \a opcode in
+    microseconds. Divided by the sum of \l latencyHistogram() it yields the
+    average latency.
+ */
+qint64 QLowEnergyConnectionStatistics::totalLatency(quint8 opcode) const
+{
+    return d->latencies.value(opcode).total;
+}
+
+/*!
+    Returns the upper limits of the latency histogram buckets in microseconds.
+
+    \sa latencyHistogram()
+ */
+QList<qint64> QLowEnergyConnectionStatistics::latencyBucketLimits()
+{
+    const auto &limits = QLowEnergyConnectionStatisticsPrivate::bucketLimits;
+    return QList<qint64>(std::begin(limits), std::end(limits));
+}
+
+QT_END_NAMESPACE
@@ -0,0 +1,95 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtBluetooth module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#ifndef QLOWENERGYCONNECTIONSTATISTICS_H
+#define QLOWENERGYCONNECTIONSTATISTICS_H
+
+#include <QtBluetooth/qtbluetoothglobal.h>
+#include <QtCore/qlist.h>
+#include <QtCore/qmetatype.h>
+#include <QtCore/qshareddata.h>
+
+QT_BEGIN_NAMESPACE
+
+class QLowEnergyConnectionStatisticsPrivate;
+
+class Q_BLUETOOTH_EXPORT QLowEnergyConnectionStatistics
+{
+public:
+    QLowEnergyConnectionStatistics();
+    QLowEnergyConnectionStatistics(const QLowEnergyConnectionStatistics &other);
+    ~QLowEnergyConnectionStatistics();
+
+    QLowEnergyConnectionStatistics &operator=(const QLowEnergyConnectionStatistics &other);
+
+    int mtu() const;
+
+    quint64 bytesSent() const;
+    quint64 bytesReceived() const;
+    quint64 packetsSent() const;
+    quint64 packetsReceived() const;
+
+    quint64 requestCount() const;
+    quint64 errorResponseCount() const;
+    quint64 timeoutCount() const;
+    quint64 lateResponseCount() const;
+    int pendingRequestCount() const;
+    int queuedPacketCount() const;
+
+    QList<quint8> requestOpcodes() const;
+    QList<quint64> latencyHistogram(quint8 opcode) const;
+    qint64 totalLatency(quint8 opcode) const;
+    static QList<qint64> latencyBucketLimits();
+
+    void swap(QLowEnergyConnectionStatistics &other) Q_DECL_NOTHROW { qSwap(d, other.d); }
+
+private:
+    friend class QLowEnergyControllerPrivateBluez;
+    friend class QLowEnergyControllerPrivateBluezDBus;
+    QSharedDataPointer<QLowEnergyConnectionStatisticsPrivate> d;
+};
+
+Q_DECLARE_SHARED(QLowEnergyConnectionStatistics)
+
+QT_END_NAMESPACE
+
+Q_DECLARE_METATYPE(QLowEnergyConnectionStatistics)
+
+#endif // Include guard
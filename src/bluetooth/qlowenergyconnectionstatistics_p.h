@@ -0,0 +1,106 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtBluetooth module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#ifndef QLOWENERGYCONNECTIONSTATISTICS_P_H
+#define QLOWENERGYCONNECTIONSTATISTICS_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include "qlowenergyconnectionstatistics.h"
+
+#include <QtCore/QMap>
+
+QT_BEGIN_NAMESPACE
+
+class QLowEnergyConnectionStatisticsPrivate : public QSharedData
+{
+public:
+    // upper bounds of the latency buckets in microseconds, the last bucket is open
+    static constexpr qint64 bucketLimits[] = { 1000, 2000, 5000, 10000, 20000, 50000,
+                                               100000, 200000, 500000, 1000000,
+                                               2000000, 5000000 };
+    static constexpr int bucketCount = int(sizeof bucketLimits / sizeof bucketLimits[0]) + 1;
+
+    struct Latency
+    {
+        quint64 buckets[bucketCount] = {};
+        qint64 total = 0;
+    };
+
+    void recordResponse(quint8 opcode, qint64 usecs, bool isError)
+    {
+        Latency &latency = latencies[opcode];
+        int bucket = 0;
+        while (bucket < bucketCount - 1 && usecs > bucketLimits[bucket])
+            ++bucket;
+        ++latency.buckets[bucket];
+        latency.total += usecs;
+        ++requests;
+        if (isError)
+            ++errorResponses;
+    }
+
+    int mtu = -1;
+    quint64 bytesSent = 0;
+    quint64 bytesReceived = 0;
+    quint64 packetsSent = 0;
+    quint64 packetsReceived = 0;
+    quint64 requests = 0;
+    quint64 errorResponses = 0;
+    quint64 timeouts = 0;
+    quint64 lateResponses = 0;
+    int pendingRequests = 0;
+    int queuedPackets = 0;
+    // keyed by request opcode, QMap keeps requestOpcodes() sorted
+    QMap<quint8, Latency> latencies;
+};
+
+QT_END_NAMESPACE
+
+#endif // QLOWENERGYCONNECTIONSTATISTICS_P_H
@@ -46,10 +46,12 @@
 
 #include <QtBluetooth/QBluetoothLocalDevice>
 #include <QtCore/QLoggingCategory>
+#include <QtCore/QThread>
 
 
 #if QT_CONFIG(bluez) && !defined(QT_BLUEZ_NO_BTLE)
 #include "bluez/bluez5_helper_p.h"
+#include "bluez/enginethreadpool_p.h"
 #include "qlowenergycontroller_bluezdbus_p.h"
 #include "qlowenergycontroller_bluez_p.h"
 #elif defined(QT_ANDROID_BLUETOOTH)
@@ -212,6 +214,33 @@ Q_DECLARE_LOGGING_CATEGORY(QT_BT_WINDOWS)
          or newer.
  */
 
+/*!
+    \enum QLowEnergyController::Phy
+
+    Indicates a Bluetooth LE physical layer (PHY).
+
+    \value Phy1M       The 1 Mbit/s PHY which is supported by every device.
+    \value Phy2M       The 2 Mbit/s PHY introduced with Bluetooth 5.
+    \value PhyCoded    The long range coded PHY introduced with Bluetooth 5.
+
+    \sa setPreferredPhys(), linkParametersChanged()
+    \since 6.3
+*/
+
+/*!
+    \enum QLowEnergyController::NotificationDropPolicy
+
+    Indicates which notification is discarded when the notification queue of a
+    peripheral is full.
+
+    \value DropOldestNotification  The notification which has been waiting the longest
+                                   is discarded in favor of the new one.
+    \value DropNewestNotification  The new notification is discarded.
+
+    \sa setNotificationDropPolicy(), setNotificationQueueLimit()
+    \since 6.3
+*/
+
 
 /*!
     \fn void QLowEnergyController::connected()
@@ -302,6 +331,30 @@ Q_DECLARE_LOGGING_CATEGORY(QT_BT_WINDOWS)
     \sa requestConnectionUpdate()
 */
 
+/*!
+    \fn void QLowEnergyController::linkParametersChanged(int txOctets, int rxOctets, QLowEnergyController::Phy txPhy, QLowEnergyController::Phy rxPhy)
+
+    This signal is emitted when the link layer reports new packet sizes or a
+    new PHY for the current connection. \a txOctets and \a rxOctets are the
+    maximum payload sizes of a single link layer packet in transmit and receive
+    direction. \a txPhy and \a rxPhy are the PHYs in use.
+
+    \note This signal is currently only emitted by the BlueZ kernel ATT backend.
+
+    \sa setPreferredDataLength(), setPreferredPhys()
+    \since 6.3
+*/
+
+/*!
+    \fn void QLowEnergyController::advertisingDataUpdated()
+
+    This signal is emitted when the data passed to \l updateAdvertisingData()
+    is being advertised.
+
+    \sa updateAdvertisingData()
+    \since 6.3
+*/
+
 
 void registerQLowEnergyControllerMetaType()
 {
@@ -312,6 +365,7 @@ void registerQLowEnergyControllerMetaType()
         qRegisterMetaType<QLowEnergyConnectionParameters>();
         qRegisterMetaType<QLowEnergyCharacteristic>();
         qRegisterMetaType<QLowEnergyDescriptor>();
+        qRegisterMetaType<QLowEnergyController::Phy>();
         initDone = true;
     }
 }
@@ -746,6 +800,8 @@ QLowEnergyService *QLowEnergyController::createServiceObject(
    to 31 byte user data. If, for example, several 128bit uuids are added to \a advertisingData,
    the advertised packets may not contain all uuids. The existing limit may have caused the truncation
    of uuids. In such cases \a scanResponseData may be used for additional information.
+   If \a parameters enables extended advertising and the local device supports it, the
+   limit is raised to what the Bluetooth controller supports, typically 251 bytes or more.
 
    If this object is currently not in the \l UnconnectedState, nothing happens.
    \note Advertising will stop automatically once a client connects to the local device.
@@ -766,6 +822,7 @@ void QLowEnergyController::startAdvertising(const QLowEnergyAdvertisingParameter
         qCWarning(QT_BT) << "Cannot start advertising in state" << state();
         return;
     }
+    d->advertisingParameters = parameters;
     d->startAdvertising(parameters, advertisingData, scanResponseData);
 }
 
@@ -788,6 +845,38 @@ void QLowEnergyController::stopAdvertising()
     d->stopAdvertising();
 }
 
+/*!
+   Replaces the advertising data and scan response data of the running advertisement
+   with \a advertisingData and \a scanResponseData. The parameters passed to
+   \l startAdvertising() stay in effect.
+
+   This is meant for data which changes regularly, such as sensor readings or
+   rotating identifiers. Where the platform supports it, only the parts that actually
+   differ from the current data are handed to the Bluetooth controller and advertising
+   continues without interruption. Otherwise advertising is briefly stopped and restarted.
+
+   The controller has to be in the \l PeripheralRole and in the \l AdvertisingState.
+   The \l advertisingDataUpdated() signal is emitted once the new data is in effect.
+   If the update fails, \l errorOccurred() is emitted with \l AdvertisingError.
+
+   \since 6.3
+   \sa startAdvertising(), advertisingDataUpdated()
+ */
+void QLowEnergyController::updateAdvertisingData(const QLowEnergyAdvertisingData &advertisingData,
+                                                 const QLowEnergyAdvertisingData &scanResponseData)
+{
+    Q_D(QLowEnergyController);
+    if (role() != PeripheralRole) {
+        qCWarning(QT_BT) << "Cannot update advertising data in central role";
+        return;
+    }
+    if (state() != AdvertisingState) {
+        qCWarning(QT_BT) << "Cannot update advertising data in state" << state();
+        return;
+    }
+    d->updateAdvertisingData(advertisingData, scanResponseData);
+}
+
 /*!
   Constructs and returns a \l QLowEnergyService object with \a parent from \a service.
   The controller must be in the \l PeripheralRole and in the \l UnconnectedState. The \a service
@@ -919,4 +1008,440 @@ int QLowEnergyController::mtu() const
     return d_ptr->mtu();
 }
 
+/*!
+    Sets the \a mtu the controller proposes during the ATT MTU exchange.
+
+    The value is clamped to the range permitted by the ATT protocol
+    (23 to 512 bytes). A value of \c 0 restores the default, which is the
+    largest MTU supported by the platform. The setting must be applied before
+    \l connectToDevice() is called and becomes effective with the next
+    MTU exchange.
+
+    \note This setting is currently only used by the BlueZ kernel ATT backend.
+
+    \sa preferredMtu(), mtu(), mtuChanged()
+    \since 6.3
+ */
+void QLowEnergyController::setPreferredMtu(int mtu)
+{
+    d_ptr->preferredMtu = qMax(0, mtu);
+}
+
+/*!
+    Returns the preferred MTU, or \c 0 if the platform default is used.
+
+    \sa setPreferredMtu()
+    \since 6.3
+ */
+int QLowEnergyController::preferredMtu() const
+{
+    return d_ptr->preferredMtu;
+}
+
+/*!
+    Sets the maximum number of payload octets, \a txOctets, the local controller
+    should send in a single link layer packet (LE Data Length Extension).
+
+    Pairing a large ATT MTU with the maximum data length of 251 octets avoids
+    fragmenting ATT packets on the link layer. The request is sent once the
+    connection has been established. The controller may pick smaller values.
+    The result is reported via \l linkParametersChanged(). A value of \c 0
+    leaves the data length at the platform default.
+
+    \note This setting is currently only used by the BlueZ kernel ATT backend and
+    requires access to the HCI socket.
+
+    \sa preferredDataLength(), linkParametersChanged()
+    \since 6.3
+ */
+void QLowEnergyController::setPreferredDataLength(int txOctets)
+{
+    d_ptr->preferredDataLength = qMax(0, txOctets);
+}
+
+/*!
+    Returns the preferred link layer data length, or \c 0 if the platform
+    default is used.
+
+    \sa setPreferredDataLength()
+    \since 6.3
+ */
+int QLowEnergyController::preferredDataLength() const
+{
+    return d_ptr->preferredDataLength;
+}
+
+/*!
+    Sets the \a phys which the local controller should prefer for the connection
+    in both directions. The request is sent once the connection has been established
+    and the outcome is reported via \l linkParametersChanged(). An empty set leaves
+    the choice to the controllers.
+
+    \note This setting is currently only used by the BlueZ kernel ATT backend and
+    requires access to the HCI socket.
+
+    \sa preferredPhys(), linkParametersChanged()
+    \since 6.3
+ */
+void QLowEnergyController::setPreferredPhys(Phys phys)
+{
+    d_ptr->preferredPhys = phys;
+}
+
+/*!
+    Returns the preferred PHYs.
+
+    \sa setPreferredPhys()
+    \since 6.3
+ */
+QLowEnergyController::Phys QLowEnergyController::preferredPhys() const
+{
+    return d_ptr->preferredPhys;
+}
+
+/*!
+    Sets the maximum number of notifications which may wait for transmission
+    to \a limit. Values smaller than \c 1 are treated as \c 1.
+
+    In the \l PeripheralRole, every change of a characteristic value with
+    notifications enabled produces a notification. When the values change faster
+    than the link can transmit them, notifications are queued. A queued
+    notification is replaced when the same characteristic changes again, so the
+    client always receives the latest value. Once \a limit notifications for
+    different characteristics are waiting, the \l notificationDropPolicy()
+    decides which one is discarded. Responses and indications are never discarded.
+
+    The default limit is \c 64.
+
+    \note This setting is currently only used by the BlueZ kernel ATT backend.
+
+    \sa notificationQueueLimit(), queuedNotificationCount(), droppedNotificationCount()
+    \since 6.3
+ */
+void QLowEnergyController::setNotificationQueueLimit(int limit)
+{
+    d_ptr->notificationQueueLimit = qMax(1, limit);
+}
+
+/*!
+    Returns the maximum number of notifications which may wait for transmission.
+
+    \sa setNotificationQueueLimit()
+    \since 6.3
+ */
+int QLowEnergyController::notificationQueueLimit() const
+{
+    return d_ptr->notificationQueueLimit;
+}
+
+/*!
+    Sets the \a policy which decides the notification to discard when the
+    notification queue is full. The default is \l DropOldestNotification.
+
+    \sa notificationDropPolicy(), setNotificationQueueLimit()
+    \since 6.3
+ */
+void QLowEnergyController::setNotificationDropPolicy(NotificationDropPolicy policy)
+{
+    d_ptr->notificationDropPolicy = policy;
+}
+
+/*!
+    Returns the policy deciding the notification to discard when the
+    notification queue is full.
+
+    \sa setNotificationDropPolicy()
+    \since 6.3
+ */
+QLowEnergyController::NotificationDropPolicy QLowEnergyController::notificationDropPolicy() const
+{
+    return d_ptr->notificationDropPolicy;
+}
+
+/*!
+    Returns the number of notifications currently waiting for transmission.
+
+    \sa setNotificationQueueLimit(), droppedNotificationCount()
+    \since 6.3
+ */
+int QLowEnergyController::queuedNotificationCount() const
+{
+    return d_ptr->queuedNotificationCount();
+}
+
+/*!
+    Returns the number of notifications this controller has discarded because
+    the notification queue was full. Notifications which were replaced by a
+    newer value of the same characteristic are not counted.
+
+    \sa setNotificationDropPolicy(), queuedNotificationCount()
+    \since 6.3
+ */
+quint64 QLowEnergyController::droppedNotificationCount() const
+{
+    return d_ptr->droppedNotificationCount();
+}
+
+/*!
+    Returns a snapshot of the traffic counters and request latencies of the
+    current connection.
+
+    The snapshot is cheap to take and may be polled, for example by monitoring
+    code. The statistics start from zero whenever a connection is established.
+
+    \sa resetConnectionStatistics()
+    \since 6.3
+ */
+QLowEnergyConnectionStatistics QLowEnergyController::connectionStatistics() const
+{
+    return d_ptr->connectionStatistics();
+}
+
+/*!
+    Sets the counters and latency histograms of the connection statistics back
+    to zero. The MTU and the queue depths are not affected.
+
+    \sa connectionStatistics()
+    \since 6.3
+ */
+void QLowEnergyController::resetConnectionStatistics()
+{
+    d_ptr->resetConnectionStatistics();
+}
+
+/*!
+    Sets the longest time in milliseconds the controller waits for the response
+    to a GATT request to \a msecs. A value of \c 0 disables the timeout.
+
+    Some devices never answer certain requests. Without a timeout such a
+    request would stall all requests queued behind it. Once the timeout expires,
+    the request fails with the same error the remote device would have reported
+    for a stalled request, and the next request is sent.
+
+    While \l isAdaptiveGattRequestTimeout() is \c true, \a msecs is only the
+    upper bound and the controller waits for a shorter time on connections with
+    a fast peer. The default is \c 20000 milliseconds. On Linux the
+    \c BLUETOOTH_GATT_TIMEOUT environment variable changes the default for
+    controllers in the \l CentralRole.
+
+    \note This setting is currently only used by the BlueZ kernel ATT backend.
+    The BlueZ D-Bus backend leaves timeouts to the Bluetooth daemon.
+
+    \sa gattRequestTimeout(), setGattRequestTimeoutOverride(),
+        effectiveGattRequestTimeout()
+    \since 6.3
+ */
+void QLowEnergyController::setGattRequestTimeout(int msecs)
+{
+    d_ptr->gattRequestTimeout = qMax(0, msecs);
+}
+
+/*!
+    Returns the longest time in milliseconds the controller waits for the
+    response to a GATT request. \c 0 means requests never time out.
+
+    \sa setGattRequestTimeout()
+    \since 6.3
+ */
+int QLowEnergyController::gattRequestTimeout() const
+{
+    return d_ptr->gattRequestTimeout;
+}
+
+/*!
+    Enables or disables the adaptive GATT request timeout depending on
+    \a enabled. It is enabled by default.
+
+    When enabled, the controller measures the round trip time of every answered
+    request and derives the timeout from its smoothed mean and variation, in the
+    same way TCP derives its retransmission timeout. The result never drops below
+    a floor derived from the connection interval and slave latency, which
+    accounts for peers that may answer only every few connection events, and
+    never exceeds \l gattRequestTimeout(). Until a few round trips have been
+    measured the upper bound applies.
+
+    A request to an unresponsive device then fails within a few round trip
+    times instead of after the fixed upper bound.
+
+    \sa isAdaptiveGattRequestTimeout(), effectiveGattRequestTimeout()
+    \since 6.3
+ */
+void QLowEnergyController::setAdaptiveGattRequestTimeout(bool enabled)
+{
+    d_ptr->adaptiveGattRequestTimeout = enabled;
+}
+
+/*!
+    Returns \c true if the GATT request timeout adapts to the measured round
+    trip times.
+
+    \sa setAdaptiveGattRequestTimeout()
+    \since 6.3
+ */
+bool QLowEnergyController::isAdaptiveGattRequestTimeout() const
+{
+    return d_ptr->adaptiveGattRequestTimeout;
+}
+
+/*!
+    Sets a fixed timeout of \a msecs milliseconds for requests with the ATT
+    \a opcode, for example \c 0x12 for write requests. The override takes
+    precedence over both \l gattRequestTimeout() and the adaptive timeout.
+    A value of \c 0 disables the timeout for these requests, a negative value
+    removes the override.
+
+    Use this for requests the peer is known to answer slowly, such as writes
+    which trigger a flash erase on the device.
+
+    \sa gattRequestTimeoutOverride(), effectiveGattRequestTimeout()
+    \since 6.3
+ */
+void QLowEnergyController::setGattRequestTimeoutOverride(quint8 opcode, int msecs)
+{
+    if (msecs < 0)
+        d_ptr->gattRequestTimeoutOverrides.remove(opcode);
+    else
+        d_ptr->gattRequestTimeoutOverrides.insert(opcode, msecs);
+}
+
+/*!
+    Returns the fixed timeout in milliseconds for requests with the ATT
+    \a opcode, or \c -1 if no override is set.
+
+    \sa setGattRequestTimeoutOverride()
+    \since 6.3
+ */
+int QLowEnergyController::gattRequestTimeoutOverride(quint8 opcode) const
+{
+    return d_ptr->gattRequestTimeoutOverrides.value(opcode, -1);
+}
+
+/*!
+    Returns the timeout in milliseconds the controller currently applies to a
+    request with the ATT \a opcode. \c 0 means the request does not time out.
+
+    \sa setGattRequestTimeout(), setAdaptiveGattRequestTimeout(),
+        setGattRequestTimeoutOverride()
+    \since 6.3
+ */
+int QLowEnergyController::effectiveGattRequestTimeout(quint8 opcode) const
+{
+    return d_ptr->effectiveGattRequestTimeout(opcode);
+}
+
+/*!
+    Moves this controller to one of the Bluetooth engine threads and returns
+    \c true on success.
+
+    By default, all work of a controller happens on the thread which created
+    it: reading and parsing the ATT packets, updating the cached attribute
+    values, monitoring the HCI events of the connection and emitting the
+    signals. With many connected devices this can keep the application's main
+    thread busy. After this call, all of that happens on an engine thread
+    instead. The engine threads are a small pool shared by all controllers,
+    connections are distributed among them by remote address.
+
+    The controller then behaves like any QObject living in another thread:
+    \list
+        \li Its functions, and those of the services and characteristics it
+            creates, must only be called on the engine thread, for example
+            by QMetaObject::invokeMethod() with the controller as context.
+        \li Signals reach receivers in other threads as queued events. Enabling
+            \l QLowEnergyService::setNotificationBatching() delivers high rate
+            notifications as one event per flush interval.
+        \li The controller must be destroyed on the engine thread, for example
+            by QObject::deleteLater().
+    \endlist
+
+    The controller must not have a parent, must be in the \l UnconnectedState
+    and the function must be called from the thread which currently owns the
+    controller. Call it right after creating the controller, before any
+    services are created.
+
+    \note Engine threads are currently only supported by the BlueZ kernel ATT
+    backend, which is used for the peripheral role and, with bluetoothd older
+    than 5.42, for the central role. Otherwise this function returns \c false.
+
+    \sa setEngineThreadCount(), QObject::moveToThread()
+    \since 6.3
+ */
+bool QLowEnergyController::moveToEngineThread()
+{
+#if QT_CONFIG(bluez) && !defined(QT_BLUEZ_NO_BTLE)
+    Q_D(QLowEnergyController);
+    if (thread() != QThread::currentThread()) {
+        qCWarning(QT_BT) << "A controller can only be moved by the thread owning it";
+        return false;
+    }
+    if (parent()) {
+        qCWarning(QT_BT) << "Cannot move a controller with a parent to an engine thread";
+        return false;
+    }
+    if (state() != UnconnectedState) {
+        qCWarning(QT_BT) << "A controller can only be moved in unconnected state";
+        return false;
+    }
+    // the D-Bus backend has not been adapted to engine threads
+    if (!qobject_cast<QLowEnergyControllerPrivateBluez *>(d)) {
+        qCWarning(QT_BT) << "Engine threads require the BlueZ kernel ATT backend";
+        return false;
+    }
+
+    QThread *engine = EngineThreadPool::instance()->threadFor(
+            d->role == CentralRole ? d->remoteDevice : QBluetoothAddress());
+    if (engine == thread())
+        return true;
+
+    // The private object and the service data are not children of this object,
+    // the sockets, notifiers and timers of the backend are children of d.
+    d->moveToThread(engine);
+    for (const auto &service : qAsConst(d->serviceList))
+        service->moveToThread(engine);
+    for (const auto &service : qAsConst(d->localServices))
+        service->moveToThread(engine);
+    moveToThread(engine);
+    return true;
+#else
+    qCWarning(QT_BT) << "Engine threads are not supported on this platform";
+    return false;
+#endif
+}
+
+/*!
+    Sets the number of engine threads to \a count and returns \c true on
+    success. A \a count of \c 0 restores the default, which depends on the
+    number of processor cores and is at most \c 4.
+
+    The number can only be changed before the first controller has been moved
+    to an engine thread.
+
+    \sa engineThreadCount(), moveToEngineThread()
+    \since 6.3
+ */
+bool QLowEnergyController::setEngineThreadCount(int count)
+{
+#if QT_CONFIG(bluez) && !defined(QT_BLUEZ_NO_BTLE)
+    return EngineThreadPool::instance()->setThreadCount(count);
+#else
+    Q_UNUSED(count);
+    return false;
+#endif
+}
+
+/*!
+    Returns the number of engine threads, or \c 0 if the platform does not
+    support engine threads.
+
+    \sa setEngineThreadCount(), moveToEngineThread()
+    \since 6.3
+ */
+int QLowEnergyController::engineThreadCount()
+{
+#if QT_CONFIG(bluez) && !defined(QT_BLUEZ_NO_BTLE)
+    return EngineThreadPool::instance()->threadCount();
+#else
+    return 0;
+#endif
+}
+
 QT_END_NAMESPACE
@@ -46,6 +46,7 @@
 #include <QtBluetooth/QBluetoothUuid>
 #include <QtBluetooth/QLowEnergyAdvertisingData>
 #include <QtBluetooth/QLowEnergyConnectionParameters>
+#include <QtBluetooth/QLowEnergyConnectionStatistics>
 #include <QtBluetooth/QLowEnergyService>
 
 QT_BEGIN_NAMESPACE
@@ -91,6 +92,20 @@ public:
     enum Role { CentralRole, PeripheralRole };
     Q_ENUM(Role)
 
+    enum Phy {
+        Phy1M = 0x1,
+        Phy2M = 0x2,
+        PhyCoded = 0x4
+    };
+    Q_ENUM(Phy)
+    Q_DECLARE_FLAGS(Phys, Phy)
+
+    enum NotificationDropPolicy {
+        DropOldestNotification,
+        DropNewestNotification
+    };
+    Q_ENUM(NotificationDropPolicy)
+
     static QLowEnergyController *createCentral(const QBluetoothDeviceInfo &remoteDevice,
                                                QObject *parent = nullptr);
     static QLowEnergyController *createCentral(const QBluetoothDeviceInfo &remoteDevice,
@@ -127,6 +142,8 @@ public:
                           const QLowEnergyAdvertisingData &advertisingData,
                           const QLowEnergyAdvertisingData &scanResponseData = QLowEnergyAdvertisingData());
     void stopAdvertising();
+    void updateAdvertisingData(const QLowEnergyAdvertisingData &advertisingData,
+                               const QLowEnergyAdvertisingData &scanResponseData = QLowEnergyAdvertisingData());
 
     QLowEnergyService *addService(const QLowEnergyServiceData &service, QObject *parent = nullptr);
 
@@ -139,6 +156,35 @@ public:
 
     int mtu() const;
 
+    void setPreferredMtu(int mtu);
+    int preferredMtu() const;
+    void setPreferredDataLength(int txOctets);
+    int preferredDataLength() const;
+    void setPreferredPhys(Phys phys);
+    Phys preferredPhys() const;
+
+    void setNotificationQueueLimit(int limit);
+    int notificationQueueLimit() const;
+    void setNotificationDropPolicy(NotificationDropPolicy policy);
+    NotificationDropPolicy notificationDropPolicy() const;
+    int queuedNotificationCount() const;
+    quint64 droppedNotificationCount() const;
+
+    QLowEnergyConnectionStatistics connectionStatistics() const;
+    void resetConnectionStatistics();
+
+    void setGattRequestTimeout(int msecs);
+    int gattRequestTimeout() const;
+    void setAdaptiveGattRequestTimeout(bool enabled);
+    bool isAdaptiveGattRequestTimeout() const;
+    void setGattRequestTimeoutOverride(quint8 opcode, int msecs);
+    int gattRequestTimeoutOverride(quint8 opcode) const;
+    int effectiveGattRequestTimeout(quint8 opcode) const;
+
+    bool moveToEngineThread();
+    static bool setEngineThreadCount(int count);
+    static int engineThreadCount();
+
 Q_SIGNALS:
     void connected();
     void disconnected();
@@ -149,6 +195,10 @@ Q_SIGNALS:
     void serviceDiscovered(const QBluetoothUuid &newService);
     void discoveryFinished();
     void connectionUpdated(const QLowEnergyConnectionParameters &parameters);
+    void linkParametersChanged(int txOctets, int rxOctets,
+                               QLowEnergyController::Phy txPhy,
+                               QLowEnergyController::Phy rxPhy);
+    void advertisingDataUpdated();
 
 private:
     // peripheral role ctor
@@ -164,11 +214,14 @@ private:
     QLowEnergyControllerPrivate *d_ptr;
 };
 
+Q_DECLARE_OPERATORS_FOR_FLAGS(QLowEnergyController::Phys)
+
 QT_END_NAMESPACE
 
 Q_DECLARE_METATYPE(QLowEnergyController::Error)
 Q_DECLARE_METATYPE(QLowEnergyController::ControllerState)
 Q_DECLARE_METATYPE(QLowEnergyController::RemoteAddressType)
 Q_DECLARE_METATYPE(QLowEnergyController::Role)
+Q_DECLARE_METATYPE(QLowEnergyController::Phy)
 
 #endif // QLOWENERGYCONTROLLER_H
@@ -43,6 +43,9 @@
 #include "qbluetoothsocketbase_p.h"
 #include "qbluetoothsocket_bluez_p.h"
 #include "qleadvertiser_p.h"
+#include "qlowenergyconnectionstatistics_p.h"
+#include "bluez/attcapture_p.h"
+#include "bluez/atttransmitqueue_p.h"
 #include "bluez/bluez_data_p.h"
 #include "bluez/hcimanager_p.h"
 #include "bluez/objectmanager_p.h"
@@ -50,10 +53,13 @@
 #include "bluez/bluez5_helper_p.h"
 #include "bluez/bluetoothmanagement_p.h"
 
+#include <qtbluetooth_tracepoints_p.h>
+
 #include <QtCore/QFileInfo>
 #include <QtCore/QLoggingCategory>
 #include <QtCore/QSettings>
 #include <QtCore/QTimer>
+#include <QtCore/QtMath>
 #include <QtBluetooth/QBluetoothLocalDevice>
 #include <QtBluetooth/QBluetoothSocket>
 #include <QtBluetooth/QLowEnergyCharacteristicData>
@@ -71,6 +77,9 @@
 
 #define ATT_DEFAULT_LE_MTU 23
 #define ATT_MAX_LE_MTU 0x200
+#define ATT_MAX_VALUE_LENGTH 512  // Spec v4.2, Vol 3, Part F, 3.2.9
+#define LL_DEFAULT_DATA_LENGTH 27
+#define LL_MAX_DATA_LENGTH 251
 
 #define GATT_PRIMARY_SERVICE    quint16(0x2800)
 #define GATT_SECONDARY_SERVICE  quint16(0x2801)
@@ -100,6 +109,23 @@ using namespace QBluetooth;
 
 const int maxPrepareQueueSize = 1024;
 
+// bounds of the adaptive GATT request timeout
+const int minimumGattRequestTimeout = 1000; // ms
+const int connectionEventsPerRequest = 6;
+const double defaultConnectionInterval = 50; // ms, assumed until the controller reports one
+const int minimumRoundTripSamples = 3;
+// longest time the next request is held back after a timeout
+const int maximumLateResponseGracePeriod = 2000; // ms
+
+static bool isResponseTo(QBluezConst::AttCommand request, const QByteArray &response)
+{
+    // every ATT response opcode follows its request opcode
+    const quint8 opcode = quint8(response.at(0));
+    if (opcode == static_cast<quint8>(QBluezConst::AttCommand::ATT_OP_ERROR_RESPONSE))
+        return response.size() > 1 && quint8(response.at(1)) == static_cast<quint8>(request);
+    return opcode == static_cast<quint8>(request) + 1;
+}
+
 static inline QBluetoothUuid convert_uuid128(const quint128 *p)
 {
     quint128 dst_hostOrder, dst_bigEndian;
@@ -223,29 +249,100 @@ QLowEnergyControllerPrivateBluez::QLowEnergyControllerPrivateBluez()
 
 void QLowEnergyControllerPrivateBluez::init()
 {
+    transmitQueue = new AttTransmitQueue(this);
+    capture = AttCapture::fromEnvironment();
+    connect(transmitQueue, &AttTransmitQueue::writeFailed, this, [this]() {
+        setError(QLowEnergyController::NetworkError);
+    });
+
+    if (role == QLowEnergyController::CentralRole) {
+        if (Q_UNLIKELY(!qEnvironmentVariableIsEmpty("BLUETOOTH_GATT_TIMEOUT"))) {
+            bool ok = false;
+            int value = qEnvironmentVariableIntValue("BLUETOOTH_GATT_TIMEOUT", &ok);
+            if (ok)
+                gattRequestTimeout = qMax(0, value);
+            qCDebug(QT_BT_BLUEZ) << "GATT request timeout set to" << gattRequestTimeout;
+        }
+
+        // the timeout may be enabled later on, see restartRequestTimer()
+        requestTimer = new QTimer(this);
+        requestTimer->setSingleShot(true);
+        connect(requestTimer, &QTimer::timeout,
+                this, &QLowEnergyControllerPrivateBluez::handleGattRequestTimeout);
+    }
+
     hciManager = new HciManager(localAdapter, this);
     if (!hciManager->isValid()){
         setError(QLowEnergyController::InvalidBluetoothAdapterError);
         return;
     }
-        return;
 
+    connectHciManager();
+}
+
+/*
+    Replaces the HCI manager created by init() with \a manager. Autotests use this
+    to feed HCI events through a socket pair; it must be called before connecting.
+ */
+void QLowEnergyControllerPrivateBluez::setHciManager(HciManager *manager)
+{
+    Q_ASSERT(manager);
+    Q_ASSERT(!advertiser);
+
+    delete hciManager;
+    hciManager = manager;
+    hciManager->setParent(this);
+    connectHciManager();
+}
+
+void QLowEnergyControllerPrivateBluez::connectHciManager()
+{
     hciManager->monitorEvent(HciManager::HciEvent::EVT_ENCRYPT_CHANGE);
     connect(hciManager, SIGNAL(encryptionChangedEvent(QBluetoothAddress,bool)),
             this, SLOT(encryptionChangedEvent(QBluetoothAddress,bool)));
     hciManager->monitorEvent(HciManager::HciEvent::EVT_LE_META_EVENT);
     hciManager->monitorAclPackets();
-    connect(hciManager, &HciManager::connectionComplete, [this](quint16 handle) {
+    connect(hciManager, &HciManager::connectionComplete, this, [this](quint16 handle) {
         connectionHandle = handle;
         qCDebug(QT_BT_BLUEZ) << "received connection complete event, handle:" << handle;
+        applyLinkPreferences();
     });
-    connect(hciManager, &HciManager::connectionUpdate,
+    connect(hciManager, &HciManager::dataLengthChanged, this,
+            [this](quint16 handle, quint16 maxTxOctets, quint16 maxRxOctets) {
+                if (handle != connectionHandle)
+                    return;
+                linkTxOctets = maxTxOctets;
+                linkRxOctets = maxRxOctets;
+                emit q_ptr->linkParametersChanged(linkTxOctets, linkRxOctets, linkTxPhy, linkRxPhy);
+            }
+    );
+    connect(hciManager, &HciManager::phyUpdateComplete, this,
+            [this](quint16 handle, quint8 txPhy, quint8 rxPhy) {
+                if (handle != connectionHandle)
+                    return;
+                // PHY Update Complete reports 1 (1M), 2 (2M) or 3 (Coded);
+                // the Phy enum is a bit mask
+                const auto isKnownPhy = [](quint8 phy) { return phy >= 1 && phy <= 3; };
+                if (!isKnownPhy(txPhy) || !isKnownPhy(rxPhy)) {
+                    qCWarning(QT_BT_BLUEZ) << "Ignoring PHY update with unknown PHYs"
+                                           << int(txPhy) << int(rxPhy);
+                    return;
+                }
+                linkTxPhy = static_cast<QLowEnergyController::Phy>(1 << (txPhy - 1));
+                linkRxPhy = static_cast<QLowEnergyController::Phy>(1 << (rxPhy - 1));
+                emit q_ptr->linkParametersChanged(linkTxOctets, linkRxOctets, linkTxPhy, linkRxPhy);
+            }
+    );
+    connect(hciManager, &HciManager::connectionUpdate, this,
             [this](quint16 handle, const QLowEnergyConnectionParameters &params) {
-                if (handle == connectionHandle)
-                    emit q_ptr->connectionUpdated(params);
+                if (handle != connectionHandle)
+                    return;
+                connectionInterval = params.minimumInterval();
+                connectionLatency = params.latency();
+                emit q_ptr->connectionUpdated(params);
             }
     );
-    connect(hciManager, &HciManager::signatureResolvingKeyReceived,
+    connect(hciManager, &HciManager::signatureResolvingKeyReceived, this,
             [this](quint16 handle, bool remoteKey, const quint128 &csrk) {
                 if (handle != connectionHandle)
                     return;
@@ -259,25 +356,6 @@ void QLowEnergyControllerPrivateBluez::init()
                 signingData.insert(remoteDevice.toUInt64(), SigningData(csrk));
         }
     );
-
-    if (role == QLowEnergyController::CentralRole) {
-        if (Q_UNLIKELY(!qEnvironmentVariableIsEmpty("BLUETOOTH_GATT_TIMEOUT"))) {
-            bool ok = false;
-            int value = qEnvironmentVariableIntValue("BLUETOOTH_GATT_TIMEOUT", &ok);
-            if (ok)
-                gattRequestTimeout = value;
-        }
-
-        // permit disabling of timeout behavior via environment variable
-        if (gattRequestTimeout > 0) {
-            qCWarning(QT_BT_BLUEZ) << "Enabling GATT request timeout behavior" << gattRequestTimeout;
-            requestTimer = new QTimer(this);
-            requestTimer->setSingleShot(true);
-            requestTimer->setInterval(gattRequestTimeout);
-            connect(requestTimer, &QTimer::timeout,
-                    this, &QLowEnergyControllerPrivateBluez::handleGattRequestTimeout);
-        }
-    }
 }
 
 void QLowEnergyControllerPrivateBluez::handleGattRequestTimeout()
@@ -289,9 +367,17 @@ void QLowEnergyControllerPrivateBluez::handleGattRequestTimeout()
         return;
     }
 
+    if (awaitingLateResponse) {
+        finishLateResponseGracePeriod();
+        return;
+    }
+
     if (!openRequests.isEmpty() && requestPending) {
         const Request currentRequest = openRequests.dequeue();
         requestPending = false; // reset pending flag
+        ++statistics.d->timeouts;
+        ++unansweredTimeouts;
+        Q_TRACE(QLowEnergyControllerPrivateBluez_requestTimeout, int(currentRequest.command));
 
         qCWarning(QT_BT_BLUEZ).nospace() << "****** Request type 0x" << currentRequest.command
                                          << " to server/peripheral timed out";
@@ -359,11 +445,30 @@ void QLowEnergyControllerPrivateBluez::handleGattRequestTimeout()
             break;
         }
 
+        // The response may still be on its way. ATT permits one outstanding request
+        // only, so the next request waits a moment to keep the late response from
+        // being taken for its own. The request itself has failed already.
+        const int gracePeriod = qMin(effectiveGattRequestTimeout(static_cast<quint8>(command)),
+                                     maximumLateResponseGracePeriod);
+        if (gracePeriod > 0) {
+            awaitingLateResponse = true;
+            requestPending = true;
+            requestTimer->start(gracePeriod);
+            return;
+        }
+
         // spin openRequest queue further
         sendNextPendingRequest();
     }
 }
 
+void QLowEnergyControllerPrivateBluez::finishLateResponseGracePeriod()
+{
+    awaitingLateResponse = false;
+    requestPending = false;
+    sendNextPendingRequest();
+}
+
 QLowEnergyControllerPrivateBluez::~QLowEnergyControllerPrivateBluez()
 {
     closeServerSocket();
@@ -430,6 +535,10 @@ void QLowEnergyControllerPrivateBluez::startAdvertising(const QLowEnergyAdvertis
                                             this);
         connect(advertiser, &QLeAdvertiser::errorOccurred, this,
                 &QLowEnergyControllerPrivateBluez::handleAdvertisingError);
+        connect(advertiser, &QLeAdvertiser::advertisingDataUpdated, this, [this]() {
+            Q_Q(QLowEnergyController);
+            emit q->advertisingDataUpdated();
+        });
     }
     setState(QLowEnergyController::AdvertisingState);
     advertiser->startAdvertising();
@@ -459,6 +568,14 @@ void QLowEnergyControllerPrivateBluez::stopAdvertising()
     advertiser->stopAdvertising();
 }
 
+void QLowEnergyControllerPrivateBluez::updateAdvertisingData(
+        const QLowEnergyAdvertisingData &advertisingData,
+        const QLowEnergyAdvertisingData &scanResponseData)
+{
+    qCDebug(QT_BT_BLUEZ) << "Updating advertising data";
+    advertiser->updateAdvertisingData(advertisingData, scanResponseData);
+}
+
 void QLowEnergyControllerPrivateBluez::requestConnectionUpdate(const QLowEnergyConnectionParameters &params)
 {
     // The spec says that the connection update command can be used by both slave and master
@@ -666,6 +783,7 @@ void QLowEnergyControllerPrivateBluez::l2cpConnected()
     Q_Q(QLowEnergyController);
 
     securityLevelValue = securityLevel();
+    attachTransmitQueue(l2cpSocket->socketDescriptor());
     exchangeMTU();
 
     setState(QLowEnergyController::ConnectedState);
@@ -741,12 +859,26 @@ void QLowEnergyControllerPrivateBluez::resetController()
     openPrepareWriteRequests.clear();
     scheduledIndications.clear();
     indicationInFlight = false;
+    // the descriptor is replaced on the next connection
+    if (transmitQueue)
+        transmitQueue->clear();
     requestPending = false;
+    awaitingLateResponse = false;
+    unansweredTimeouts = 0;
+    roundTrip = RoundTripEstimator();
+    connectionInterval = 0;
+    connectionLatency = 0;
+    if (requestTimer)
+        requestTimer->stop();
     encryptionChangePending = false;
     receivedMtuExchangeRequest = false;
     mtuSize = ATT_DEFAULT_LE_MTU;
     securityLevelValue = -1;
     connectionHandle = 0;
+    linkTxOctets = LL_DEFAULT_DATA_LENGTH;
+    linkRxOctets = LL_DEFAULT_DATA_LENGTH;
+    linkTxPhy = QLowEnergyController::Phy1M;
+    linkRxPhy = QLowEnergyController::Phy1M;
 
     if (role == QLowEnergyController::PeripheralRole) {
         // public API behavior requires stop of advertisement
@@ -756,16 +888,53 @@ void QLowEnergyControllerPrivateBluez::resetController()
             advertiser = nullptr;
         }
         localAttributes.clear();
+        valueProviders.clear();
     }
 }
 
 void QLowEnergyControllerPrivateBluez::restartRequestTimer()
 {
-    if (!requestTimer)
+    if (!requestTimer || openRequests.isEmpty())
         return;
 
-    if (gattRequestTimeout > 0)
-        requestTimer->start(gattRequestTimeout);
+    const int timeout =
+            effectiveGattRequestTimeout(static_cast<quint8>(openRequests.head().command));
+    if (timeout > 0)
+        requestTimer->start(timeout);
+    else
+        requestTimer->stop();
+}
+
+int QLowEnergyControllerPrivateBluez::effectiveGattRequestTimeout(quint8 opcode) const
+{
+    const auto override = gattRequestTimeoutOverrides.constFind(opcode);
+    if (override != gattRequestTimeoutOverrides.cend())
+        return *override;
+    if (gattRequestTimeout <= 0 || !adaptiveGattRequestTimeout
+            || roundTrip.samples < minimumRoundTripSamples) {
+        return gattRequestTimeout;
+    }
+
+    // a peripheral using slave latency may skip that many connection events
+    const double interval = connectionInterval > 0 ? connectionInterval
+                                                   : defaultConnectionInterval;
+    const int floor = qMax(minimumGattRequestTimeout,
+                           qCeil(connectionEventsPerRequest * interval * (1 + connectionLatency)));
+    const qint64 timeout = (roundTrip.smoothed + 4 * roundTrip.variation + 999) / 1000;
+    return int(qMin<qint64>(qMax<qint64>(timeout, floor), gattRequestTimeout));
+}
+
+void QLowEnergyControllerPrivateBluez::RoundTripEstimator::addSample(qint64 usecs)
+{
+    // RFC 6298, section 2: alpha = 1/8, beta = 1/4
+    if (samples++ == 0) {
+        smoothed = usecs;
+        variation = usecs / 2;
+        return;
+    }
+    const qint64 delta = usecs - smoothed;
+    variation += (qAbs(delta) - variation) / 4;
+    smoothed += delta / 8;
 }
 
 void QLowEnergyControllerPrivateBluez::l2cpReadyRead()
@@ -775,6 +944,12 @@ void QLowEnergyControllerPrivateBluez::l2cpReadyRead()
                          << incomingPacket.toHex();
     if (incomingPacket.isEmpty())
         return;
+    Q_TRACE(QLowEnergyControllerPrivateBluez_l2cpReadyRead, int(quint8(incomingPacket.at(0))),
+            int(incomingPacket.size()));
+    statistics.d->bytesReceived += quint64(incomingPacket.size());
+    ++statistics.d->packetsReceived;
+    if (capture)
+        capture->record(captureChannel, AttCaptureRecord::Received, incomingPacket);
 
     const QBluezConst::AttCommand command =
             static_cast<QBluezConst::AttCommand>(incomingPacket.constData()[0]);
@@ -839,11 +1014,32 @@ void QLowEnergyControllerPrivateBluez::l2cpReadyRead()
         return;
     //--------------------------------------------------
     default:
-        //only solicited replies finish pending requests
-        requestPending = false;
         break;
     }
 
+    if (awaitingLateResponse) {
+        // the response to the timed out request, the next request may go out now
+        qCDebug(QT_BT_BLUEZ) << "Discarding late response" << command;
+        ++statistics.d->lateResponses;
+        --unansweredTimeouts;
+        requestTimer->stop();
+        finishLateResponseGracePeriod();
+        return;
+    }
+
+    // after the grace period, only a response that cannot belong to the pending request
+    // is known to be late
+    if (unansweredTimeouts > 0 && (!requestPending || openRequests.isEmpty()
+            || !isResponseTo(openRequests.head().command, incomingPacket))) {
+        qCDebug(QT_BT_BLUEZ) << "Discarding late response" << command;
+        ++statistics.d->lateResponses;
+        --unansweredTimeouts;
+        return;
+    }
+
+    //only solicited replies finish pending requests
+    requestPending = false;
+
     if (openRequests.isEmpty()) {
         qCWarning(QT_BT_BLUEZ) << "Received unexpected packet from peer, disconnecting.";
         disconnectFromDevice();
@@ -851,6 +1047,12 @@ void QLowEnergyControllerPrivateBluez::l2cpReadyRead()
     }
 
     const Request request = openRequests.dequeue();
+    const qint64 latency = requestLatency.nsecsElapsed() / 1000;
+    Q_TRACE(QLowEnergyControllerPrivateBluez_requestComplete, int(request.command), int(command),
+            latency);
+    statistics.d->recordResponse(static_cast<quint8>(request.command), latency,
+                                 command == QBluezConst::AttCommand::ATT_OP_ERROR_RESPONSE);
+    roundTrip.addSample(latency);
     processReply(request, incomingPacket);
 
     sendNextPendingRequest();
@@ -906,6 +1108,7 @@ void QLowEnergyControllerPrivateBluez::encryptionChangedEvent(
             // Prepare command failed, cancel pending prepare queue on
             // the device. The appropriate (Descriptor|Characteristic)WriteError
             // is emitted too once the execute write request comes through
+            removePendingPrepareWriteRequests(failedRequest.longWriteId);
             sendExecuteWriteRequest(attrHandle, newValue, true);
         }
     }
@@ -916,21 +1119,10 @@ void QLowEnergyControllerPrivateBluez::encryptionChangedEvent(
 
 void QLowEnergyControllerPrivateBluez::sendPacket(const QByteArray &packet)
 {
-    qint64 result = l2cpSocket->write(packet.constData(),
-                                      packet.size());
-    // We ignore result == 0 which is likely to be caused by EAGAIN.
-    // This packet is effectively discarded but the controller can still recover
-
-    if (result == -1) {
-        qCDebug(QT_BT_BLUEZ) << "Cannot write L2CP packet:" << Qt::hex
-                             << packet.toHex()
-                             << l2cpSocket->errorString();
-        setError(QLowEnergyController::NetworkError);
-    } else if (result < packet.size()) {
-        qCWarning(QT_BT_BLUEZ) << "L2CP write request incomplete:"
-                               << result << "of" << packet.size();
-    }
-
+    // Packets the socket cannot take right away (EAGAIN) are queued and sent
+    // once it becomes writable. A failed write is reported via writeFailed().
+    if (!transmitQueue->sendPacket(packet))
+        qCDebug(QT_BT_BLUEZ) << "Cannot write L2CP packet:" << Qt::hex << packet.toHex();
 }
 
 void QLowEnergyControllerPrivateBluez::sendNextPendingRequest()
@@ -944,6 +1136,9 @@ void QLowEnergyControllerPrivateBluez::sendNextPendingRequest()
 
     requestPending = true;
     restartRequestTimer();
+    requestLatency.start();
+    Q_TRACE(QLowEnergyControllerPrivateBluez_sendRequest, int(request.command),
+            int(openRequests.size()));
     sendPacket(request.payload);
 }
 
@@ -1211,6 +1406,14 @@ void QLowEnergyControllerPrivateBluez::processReply(
                          << charHandle << descriptorHandle
                          << service->characteristicList[charHandle].uuid.toString();
                 // Potentially more data -> switch to blob reads
+                // Pre-size the cached value so that the blob responses
+                // are appended without reallocation.
+                QLowEnergyServicePrivate::CharData &charData =
+                        service->characteristicList[charHandle];
+                if (!descriptorHandle)
+                    charData.value.reserve(ATT_MAX_VALUE_LENGTH);
+                else
+                    charData.descriptorList[descriptorHandle].value.reserve(ATT_MAX_VALUE_LENGTH);
                 readServiceValuesByOffset(handleData, mtuSize-1,
                                           request.reference2.toBool());
                 break;
@@ -1473,13 +1676,24 @@ void QLowEnergyControllerPrivateBluez::processReply(
                 break;
             }
             //emits error on cancellation and aborts existing prepare reuqests
+            removePendingPrepareWriteRequests(request.longWriteId);
+            sendExecuteWriteRequest(attrHandle, newValue, true);
+        } else if (response.mid(PREPARE_WRITE_HEADER_SIZE)
+                   != request.payload.mid(PREPARE_WRITE_HEADER_SIZE)) {
+            // The server echoes the queued part value. A mismatch means
+            // the queued value got corrupted -> cancel the entire write.
+            qCWarning(QT_BT_BLUEZ) << "Prepare write response mismatch for handle"
+                                   << Qt::hex << attrHandle << "-> cancelling long write";
+            removePendingPrepareWriteRequests(request.longWriteId);
             sendExecuteWriteRequest(attrHandle, newValue, true);
         } else {
-            if (writtenPayload < newValue.size()) {
-                sendNextPrepareWriteRequest(attrHandle, newValue, writtenPayload);
-            } else {
+            const QLowEnergyCharacteristic ch = characteristicForHandle(attrHandle);
+            if (ch.isValid() && ch.attributeHandle() == attrHandle)
+                emit ch.d_ptr->characteristicWriteProgress(ch, writtenPayload, newValue.size());
+
+            // The remaining parts are already queued right behind this one
+            if (writtenPayload >= newValue.size())
                 sendExecuteWriteRequest(attrHandle, newValue, false);
-            }
         }
     } break;
     case QBluezConst::AttCommand::ATT_OP_EXECUTE_WRITE_REQUEST: // error case
@@ -1783,22 +1997,70 @@ void QLowEnergyControllerPrivateBluez::processUnsolicitedReply(const QByteArray
 
     const QLowEnergyCharacteristic ch = characteristicForHandle(changedHandle);
     if (ch.isValid() && ch.handle() == changedHandle) {
-        if (ch.properties() & QLowEnergyCharacteristic::Read)
-            updateValueOfCharacteristic(ch.attributeHandle(), payload.mid(3), NEW_VALUE);
-        emit ch.d_ptr->characteristicChanged(ch, payload.mid(3));
+        const QByteArray newValue = payload.mid(3);
+        if ((ch.properties() & QLowEnergyCharacteristic::Read)
+                && !ch.d_ptr->skipsValueCacheUpdate()) {
+            updateValueOfCharacteristic(ch.attributeHandle(), newValue, NEW_VALUE);
+        }
+        if (ch.d_ptr->isNotificationBatchingEnabled())
+            ch.d_ptr->enqueueNotification(ch.attributeHandle(), newValue);
+        else
+            emit ch.d_ptr->characteristicChanged(ch, newValue);
     } else {
         qCWarning(QT_BT_BLUEZ) << "Cannot find matching characteristic for "
                                   "notification/indication";
     }
 }
 
+/*!
+    \internal
+
+    Returns the MTU proposed to the remote device, taking
+    QLowEnergyController::preferredMtu() into account.
+ */
+quint16 QLowEnergyControllerPrivateBluez::localRxMtu() const
+{
+    if (preferredMtu <= 0)
+        return ATT_MAX_LE_MTU;
+    return qBound(ATT_DEFAULT_LE_MTU, preferredMtu, ATT_MAX_LE_MTU);
+}
+
+/*!
+    \internal
+
+    Requests the preferred link layer data length and PHYs for the
+    current connection. The outcome arrives asynchronously via HCI events.
+ */
+void QLowEnergyControllerPrivateBluez::applyLinkPreferences()
+{
+    if (!connectionHandle || !hciManager || !hciManager->isValid())
+        return;
+
+    if (preferredDataLength > 0) {
+        const quint16 txOctets = qBound(LL_DEFAULT_DATA_LENGTH, preferredDataLength,
+                                        LL_MAX_DATA_LENGTH);
+        // Spec v5.0, Vol 6, Part B, 4.5.10: worst case time on the 1M PHY,
+        // the coded PHY needs the maximum time the command accepts.
+        const quint16 txTime = preferredPhys.testFlag(QLowEnergyController::PhyCoded)
+                ? 0x4290 : (txOctets + 14) * 8;
+        if (!hciManager->sendLeSetDataLength(connectionHandle, txOctets, txTime))
+            qCWarning(QT_BT_BLUEZ) << "Cannot request LE data length" << txOctets;
+    }
+
+    if (preferredPhys.toInt() != 0) {
+        const quint8 phys = static_cast<quint8>(preferredPhys.toInt());
+        if (!hciManager->sendLeSetPhy(connectionHandle, phys, phys))
+            qCWarning(QT_BT_BLUEZ) << "Cannot request LE PHY" << preferredPhys;
+    }
+}
+
 void QLowEnergyControllerPrivateBluez::exchangeMTU()
 {
     qCDebug(QT_BT_BLUEZ) << "Exchanging MTU";
 
     quint8 packet[MTU_EXCHANGE_HEADER_SIZE];
     packet[0] = static_cast<quint8>(QBluezConst::AttCommand::ATT_OP_EXCHANGE_MTU_REQUEST);
-    putBtData(quint16(ATT_MAX_LE_MTU), &packet[1]);
+    putBtData(localRxMtu(), &packet[1]);
 
     QByteArray data(MTU_EXCHANGE_HEADER_SIZE, Qt::Uninitialized);
     memcpy(data.data(), packet, MTU_EXCHANGE_HEADER_SIZE);
@@ -1934,9 +2196,22 @@ void QLowEnergyControllerPrivateBluez::discoverNextDescriptor(
     sendNextPendingRequest();
 }
 
-void QLowEnergyControllerPrivateBluez::sendNextPrepareWriteRequest(
-        const QLowEnergyHandle handle, const QByteArray &newValue,
-        quint16 offset)
+/*!
+    \internal
+
+    Splits \a newValue into prepare write requests and queues all of them
+    at once. The parts are sent back-to-back, each one as soon as the
+    response for the previous part arrived, and are completed by a single
+    execute write request.
+
+    Each response echoes the part value which is verified before the next
+    part is sent. Any mismatch or error cancels the entire write.
+
+    Returns \c false if \a newValue exceeds the maximum attribute value length
+    or \a handle is invalid; nothing is queued in that case.
+ */
+bool QLowEnergyControllerPrivateBluez::sendPrepareWriteRequests(
+        const QLowEnergyHandle handle, const QByteArray &newValue)
 {
     // is it a descriptor or characteristic?
     QLowEnergyHandle targetHandle = 0;
@@ -1947,38 +2222,69 @@ void QLowEnergyControllerPrivateBluez::sendNextPrepareWriteRequest(
         targetHandle = characteristicForHandle(handle).handle();
 
     if (!targetHandle) {
-        qCWarning(QT_BT_BLUEZ) << "sendNextPrepareWriteRequest cancelled due to invalid handle"
+        qCWarning(QT_BT_BLUEZ) << "sendPrepareWriteRequests cancelled due to invalid handle"
                                << handle;
-        return;
+        return false;
     }
 
-    quint8 packet[PREPARE_WRITE_HEADER_SIZE];
-    packet[0] = static_cast<quint8>(QBluezConst::AttCommand::ATT_OP_PREPARE_WRITE_REQUEST);
-    putBtData(targetHandle, &packet[1]); // attribute handle
-    putBtData(offset, &packet[3]); // offset into newValue
+    if (newValue.size() > ATT_MAX_VALUE_LENGTH) {
+        qCWarning(QT_BT_BLUEZ) << "Cannot write" << newValue.size() << "bytes to handle"
+                               << Qt::hex << handle << Qt::dec
+                               << "- attribute values are limited to"
+                               << ATT_MAX_VALUE_LENGTH << "bytes";
+        return false;
+    }
 
     qCDebug(QT_BT_BLUEZ) << "Writing long characteristic (prepare):"
-                         << Qt::hex << handle;
+                         << Qt::hex << handle << "size:" << Qt::dec << newValue.size();
 
+    if (++lastLongWriteId == 0)
+        ++lastLongWriteId;
 
     const int maxAvailablePayload = mtuSize - PREPARE_WRITE_HEADER_SIZE;
-    const int requiredPayload = qMin(newValue.size() - offset, maxAvailablePayload);
-    const int dataSize = PREPARE_WRITE_HEADER_SIZE + requiredPayload;
+    qsizetype offset = 0;
+    do {
+        const int requiredPayload = int(qMin(newValue.size() - offset,
+                                             qsizetype(maxAvailablePayload)));
+        const int dataSize = PREPARE_WRITE_HEADER_SIZE + requiredPayload;
+
+        Q_ASSERT((offset + requiredPayload) <= newValue.size());
+        Q_ASSERT(dataSize <= mtuSize);
+
+        QByteArray data(dataSize, Qt::Uninitialized);
+        data[0] = static_cast<quint8>(QBluezConst::AttCommand::ATT_OP_PREPARE_WRITE_REQUEST);
+        putBtData(targetHandle, data.data() + 1); // attribute handle
+        putBtData(quint16(offset), data.data() + 3); // offset into newValue
+        memcpy(data.data() + PREPARE_WRITE_HEADER_SIZE, newValue.constData() + offset,
+               requiredPayload);
 
-    Q_ASSERT((offset + requiredPayload) <= newValue.size());
-    Q_ASSERT(dataSize <= mtuSize);
+        Request request;
+        request.payload = data;
+        request.command = QBluezConst::AttCommand::ATT_OP_PREPARE_WRITE_REQUEST;
+        request.reference = (uint(handle) | (uint(offset + requiredPayload) << 16));
+        request.reference2 = newValue;
+        request.longWriteId = lastLongWriteId;
+        openRequests.enqueue(request);
 
-    QByteArray data(dataSize, Qt::Uninitialized);
-    memcpy(data.data(), packet, PREPARE_WRITE_HEADER_SIZE);
-    memcpy(&(data.data()[PREPARE_WRITE_HEADER_SIZE]), &(newValue.constData()[offset]),
-                                               requiredPayload);
+        offset += requiredPayload;
+    } while (offset < newValue.size());
 
-    Request request;
-    request.payload = data;
-    request.command = QBluezConst::AttCommand::ATT_OP_PREPARE_WRITE_REQUEST;
-    request.reference = (handle | ((offset + requiredPayload) << 16));
-    request.reference2 = newValue;
-    openRequests.enqueue(request);
+    return true;
+}
+
+/*!
+    \internal
+
+    Drops the queued, not yet sent prepare write requests of the long write
+    identified by \a longWriteId. Other long writes, including those to the
+    same handle, stay queued.
+ */
+void QLowEnergyControllerPrivateBluez::removePendingPrepareWriteRequests(quint32 longWriteId)
+{
+    openRequests.removeIf([longWriteId](const Request &request) {
+        return request.command == QBluezConst::AttCommand::ATT_OP_PREPARE_WRITE_REQUEST
+                && request.longWriteId == longWriteId;
+    });
 }
 
 /*!
@@ -2039,6 +2345,64 @@ void QLowEnergyControllerPrivateBluez::writeCharacteristic(
         writeCharacteristicForCentral(service, charHandle, charData.valueHandle, newValue, mode);
 }
 
+/*!
+    Writes \a newValue using prepare write requests and a single execute
+    write request, regardless of the MTU. Progress is reported after each
+    acknowledged part.
+ */
+void QLowEnergyControllerPrivateBluez::writeCharacteristicLong(
+        const QSharedPointer<QLowEnergyServicePrivate> service,
+        const QLowEnergyHandle charHandle,
+        const QByteArray &newValue)
+{
+    Q_ASSERT(!service.isNull());
+
+    if (role == QLowEnergyController::PeripheralRole || newValue.isEmpty()) {
+        writeCharacteristic(service, charHandle, newValue,
+                            QLowEnergyService::WriteWithResponse);
+        return;
+    }
+
+    if (!service->characteristicList.contains(charHandle))
+        return;
+
+    if (!sendPrepareWriteRequests(charHandle, newValue)) {
+        service->setError(QLowEnergyService::CharacteristicWriteError);
+        return;
+    }
+    sendNextPendingRequest();
+}
+
+/*!
+    Applies the value changes of a committed update. All values are stored before
+    the first notification is sent, so that the burst of notifications and indications
+    reflects one consistent state of the database.
+ */
+void QLowEnergyControllerPrivateBluez::writeCharacteristics(
+        const QSharedPointer<QLowEnergyServicePrivate> service,
+        const QList<QPair<QLowEnergyHandle, QByteArray>> &updates)
+{
+    Q_ASSERT(!service.isNull());
+
+    if (role != QLowEnergyController::PeripheralRole) {
+        QLowEnergyControllerPrivate::writeCharacteristics(service, updates);
+        return;
+    }
+
+    QList<QLowEnergyHandle> changedCharacteristics;
+    changedCharacteristics.reserve(updates.size());
+    for (const auto &update : updates) {
+        auto it = service->characteristicList.find(update.first);
+        if (it == service->characteristicList.end())
+            continue;
+        if (setLocalCharacteristicValue(it.value(), update.second))
+            changedCharacteristics.append(update.first);
+    }
+
+    for (const QLowEnergyHandle charHandle : changedCharacteristics)
+        notifyClientsOfValueChange(*service->characteristicList.constFind(charHandle));
+}
+
 void QLowEnergyControllerPrivateBluez::writeDescriptor(
         const QSharedPointer<QLowEnergyServicePrivate> service,
         const QLowEnergyHandle charHandle,
@@ -2223,15 +2587,15 @@ void QLowEnergyControllerPrivateBluez::handleExchangeMtuRequest(const QByteArray
     // Send reply.
     QByteArray reply(MTU_EXCHANGE_HEADER_SIZE, Qt::Uninitialized);
     reply[0] = static_cast<quint8>(QBluezConst::AttCommand::ATT_OP_EXCHANGE_MTU_RESPONSE);
-    putBtData(static_cast<quint16>(ATT_MAX_LE_MTU), reply.data() + 1);
+    putBtData(localRxMtu(), reply.data() + 1);
     sendPacket(reply);
 
     // Apply requested MTU.
     const quint16 clientRxMtu = bt_get_le16(packet.constData() + 1);
-    mtuSize = qMax<quint16>(ATT_DEFAULT_LE_MTU, qMin<quint16>(clientRxMtu, ATT_MAX_LE_MTU));
+    mtuSize = qMax<quint16>(ATT_DEFAULT_LE_MTU, qMin<quint16>(clientRxMtu, localRxMtu()));
     qCDebug(QT_BT_BLUEZ) << "MTU request from client:" << clientRxMtu
                          << "effective client RX MTU:" << mtuSize;
-    qCDebug(QT_BT_BLUEZ) << "Sending server RX MTU" << ATT_MAX_LE_MTU;
+    qCDebug(QT_BT_BLUEZ) << "Sending server RX MTU" << localRxMtu();
 }
 
 void QLowEnergyControllerPrivateBluez::handleFindInformationRequest(const QByteArray &packet)
@@ -2336,11 +2700,35 @@ void QLowEnergyControllerPrivateBluez::handleReadByTypeRequest(const QByteArray
                          endingHandle))
         return;
 
-    // Get all attributes with matching type.
-    QList<Attribute> results =
-            getAttributes(startingHandle, endingHandle,
-                          [type](const Attribute &attr) { return attr.type == type; });
-    ensureUniformValueSizes(results);
+    // Collect the matching attributes in handle order. The response ends at the first
+    // unreadable attribute, at the first value of a different size or once it is full;
+    // values computed on demand are only produced up to that point.
+    QList<Attribute> results;
+    int elementSize = 0;
+    for (int handle = startingHandle; handle <= qMin<int>(endingHandle, lastLocalHandle);
+         ++handle) {
+        if (localAttributes.at(handle).type != type)
+            continue;
+        const QBluezConst::AttError error = checkReadPermissions(localAttributes.at(handle));
+        if (error != QBluezConst::AttError::ATT_ERROR_NO_ERROR) {
+            if (results.isEmpty()) {
+                sendErrorResponse(static_cast<QBluezConst::AttCommand>(packet.at(0)),
+                                  handle, error);
+                return;
+            }
+            break;
+        }
+        updateProvidedValue(handle);
+        const Attribute &attribute = localAttributes.at(handle);
+        const int size = int(sizeof(QLowEnergyHandle)) + attribute.value.count();
+        if (results.isEmpty())
+            elementSize = size;
+        else if (size != elementSize)
+            break;
+        results << attribute;
+        if (results.count() >= (mtuSize - 2) / elementSize)
+            break;
+    }
 
     if (results.isEmpty()) {
         sendErrorResponse(static_cast<QBluezConst::AttCommand>(packet.at(0)), startingHandle,
@@ -2348,14 +2736,6 @@ void QLowEnergyControllerPrivateBluez::handleReadByTypeRequest(const QByteArray
         return;
     }
 
-    const QBluezConst::AttError error = checkReadPermissions(results);
-    if (error != QBluezConst::AttError::ATT_ERROR_NO_ERROR) {
-        sendErrorResponse(static_cast<QBluezConst::AttCommand>(packet.at(0)),
-                          results.first().handle, error);
-        return;
-    }
-
-    const int elementSize = sizeof(QLowEnergyHandle) + results.first().value.count();
     QByteArray responsePrefix(2, Qt::Uninitialized);
     responsePrefix[0] = static_cast<quint8>(QBluezConst::AttCommand::ATT_OP_READ_BY_TYPE_RESPONSE);
     responsePrefix[1] = elementSize;
@@ -2377,13 +2757,14 @@ void QLowEnergyControllerPrivateBluez::handleReadRequest(const QByteArray &packe
 
     if (!checkHandle(packet, handle))
         return;
-    const Attribute &attribute = localAttributes.at(handle);
-    const QBluezConst::AttError permissionsError = checkReadPermissions(attribute);
+    const QBluezConst::AttError permissionsError = checkReadPermissions(localAttributes.at(handle));
     if (permissionsError != QBluezConst::AttError::ATT_ERROR_NO_ERROR) {
         sendErrorResponse(static_cast<QBluezConst::AttCommand>(packet.at(0)), handle,
                           permissionsError);
         return;
     }
+    updateProvidedValue(handle);
+    const Attribute &attribute = localAttributes.at(handle);
 
     const int sentValueLength = qMin(attribute.value.count(), mtuSize - 1);
     QByteArray response(1 + sentValueLength, Qt::Uninitialized);
@@ -2407,13 +2788,16 @@ void QLowEnergyControllerPrivateBluez::handleReadBlobRequest(const QByteArray &p
 
     if (!checkHandle(packet, handle))
         return;
-    const Attribute &attribute = localAttributes.at(handle);
-    const QBluezConst::AttError permissionsError = checkReadPermissions(attribute);
+    const QBluezConst::AttError permissionsError = checkReadPermissions(localAttributes.at(handle));
     if (permissionsError != QBluezConst::AttError::ATT_ERROR_NO_ERROR) {
         sendErrorResponse(static_cast<QBluezConst::AttCommand>(packet.at(0)), handle,
                           permissionsError);
         return;
     }
+    // Later parts of a long read must come from the value the first part was taken from
+    if (valueOffset == 0)
+        updateProvidedValue(handle);
+    const Attribute &attribute = localAttributes.at(handle);
     if (valueOffset > attribute.value.count()) {
         sendErrorResponse(static_cast<QBluezConst::AttCommand>(packet.at(0)), handle,
                           QBluezConst::AttError::ATT_ERROR_INVALID_OFFSET);
@@ -2455,6 +2839,13 @@ void QLowEnergyControllerPrivateBluez::handleReadMultipleRequest(const QByteArra
                           QBluezConst::AttError::ATT_ERROR_INVALID_HANDLE);
         return;
     }
+    for (const QLowEnergyHandle handle : qAsConst(handles)) {
+        if (valueProviders.contains(handle)
+                && checkReadPermissions(localAttributes.at(handle))
+                        == QBluezConst::AttError::ATT_ERROR_NO_ERROR) {
+            updateProvidedValue(handle);
+        }
+    }
     const QList<Attribute> results = getAttributes(handles.first(), handles.last());
     QByteArray response(
             1, static_cast<quint8>(QBluezConst::AttCommand::ATT_OP_READ_MULTIPLE_RESPONSE));
@@ -2571,12 +2962,53 @@ void QLowEnergyControllerPrivateBluez::updateLocalAttributeValue(
     qFatal("local services map inconsistent with local attribute map");
 }
 
+/*!
+    Asks the value provider of the characteristic at \a handle, if any, for the
+    current value unless a previously produced value may still be used.
+ */
+void QLowEnergyControllerPrivateBluez::updateProvidedValue(QLowEnergyHandle handle)
+{
+    auto it = valueProviders.find(handle);
+    if (it == valueProviders.end())
+        return;
+    if (it->cacheTime > 0 && it->age.isValid() && !it->age.hasExpired(it->cacheTime))
+        return;
+
+    // the provider may modify the attribute database, do not hold iterators across the call
+    const QLowEnergyCharacteristicData::ValueProvider provide = it->provide;
+    const QByteArray value = provide();
+
+    it = valueProviders.find(handle);
+    if (it == valueProviders.end())
+        return;
+    it->age.start();
+
+    const Attribute &attribute = localAttributes.at(handle);
+    if (value.count() < attribute.minLength || value.count() > attribute.maxLength) {
+        qCWarning(QT_BT_BLUEZ) << "ignoring provided value of invalid length" << value.count()
+                               << "for attribute" << handle;
+        return;
+    }
+
+    QLowEnergyCharacteristic characteristic;
+    QLowEnergyDescriptor descriptor;
+    updateLocalAttributeValue(handle, value, characteristic, descriptor);
+}
+
 static bool isNotificationEnabled(quint16 clientConfigValue) { return clientConfigValue & 0x1; }
 static bool isIndicationEnabled(quint16 clientConfigValue) { return clientConfigValue & 0x2; }
 
 void QLowEnergyControllerPrivateBluez::writeCharacteristicForPeripheral(
         QLowEnergyServicePrivate::CharData &charData,
         const QByteArray &newValue)
+{
+    if (setLocalCharacteristicValue(charData, newValue))
+        notifyClientsOfValueChange(charData);
+}
+
+bool QLowEnergyControllerPrivateBluez::setLocalCharacteristicValue(
+        QLowEnergyServicePrivate::CharData &charData,
+        const QByteArray &newValue)
 {
     const QLowEnergyHandle valueHandle = charData.valueHandle;
     Q_ASSERT(valueHandle <= lastLocalHandle);
@@ -2584,10 +3016,18 @@ void QLowEnergyControllerPrivateBluez::writeCharacteristicForPeripheral(
     if (newValue.count() < attribute.minLength || newValue.count() > attribute.maxLength) {
         qCWarning(QT_BT_BLUEZ) << "ignoring value of invalid length" << newValue.count()
                                << "for attribute" << valueHandle;
-        return;
+        return false;
     }
     attribute.value = newValue;
     charData.value = newValue;
+    return true;
+}
+
+void QLowEnergyControllerPrivateBluez::notifyClientsOfValueChange(
+        const QLowEnergyServicePrivate::CharData &charData)
+{
+    const QLowEnergyHandle valueHandle = charData.valueHandle;
+    const Attribute &attribute = localAttributes.at(valueHandle);
     const bool hasNotifyProperty = attribute.properties & QLowEnergyCharacteristic::Notify;
     const bool hasIndicateProperty
             = attribute.properties & QLowEnergyCharacteristic::Indicate;
@@ -2644,8 +3084,10 @@ void QLowEnergyControllerPrivateBluez::writeCharacteristicForCentral(const QShar
     switch (mode) {
     case QLowEnergyService::WriteWithResponse:
         if (newValue.size() > (mtuSize - WRITE_REQUEST_HEADER_SIZE)) {
-            sendNextPrepareWriteRequest(charHandle, newValue, 0);
-            sendNextPendingRequest();
+            if (sendPrepareWriteRequests(charHandle, newValue))
+                sendNextPendingRequest();
+            else
+                service->setError(QLowEnergyService::CharacteristicWriteError);
             return;
         }
         // write value fits into single package
@@ -2728,8 +3170,12 @@ void QLowEnergyControllerPrivateBluez::writeDescriptorForCentral(
         const QByteArray &newValue)
 {
     if (newValue.size() > (mtuSize - WRITE_REQUEST_HEADER_SIZE)) {
-        sendNextPrepareWriteRequest(descriptorHandle, newValue, 0);
-        sendNextPendingRequest();
+        if (sendPrepareWriteRequests(descriptorHandle, newValue)) {
+            sendNextPendingRequest();
+        } else if (QSharedPointer<QLowEnergyServicePrivate> service =
+                           serviceForHandle(charHandle)) {
+            service->setError(QLowEnergyService::DescriptorWriteError);
+        }
         return;
     }
 
@@ -2994,13 +3440,25 @@ void QLowEnergyControllerPrivateBluez::sendNotificationOrIndication(QBluezConst:
     Q_ASSERT(handle <= lastLocalHandle);
     const Attribute &attribute = localAttributes.at(handle);
     const int maxValueLength = qMin(attribute.value.count(), mtuSize - 3);
-    QByteArray packet(3 + maxValueLength, Qt::Uninitialized);
-    packet[0] = static_cast<quint8>(opCode);
-    putBtData(handle, packet.data() + 1);
+    notificationPacket.resize(3 + maxValueLength);
+    notificationPacket[0] = static_cast<quint8>(opCode);
+    putBtData(handle, notificationPacket.data() + 1);
     using namespace std;
-    memcpy(packet.data() + 3, attribute.value.constData(), maxValueLength);
-    qCDebug(QT_BT_BLUEZ) << "sending notification/indication:" << packet.toHex();
-    sendPacket(packet);
+    memcpy(notificationPacket.data() + 3, attribute.value.constData(), maxValueLength);
+    qCDebug(QT_BT_BLUEZ) << "sending notification/indication:" << notificationPacket.toHex();
+
+    if (opCode != QBluezConst::AttCommand::ATT_OP_HANDLE_VAL_NOTIFICATION) {
+        // the client confirms every indication, it must not get lost
+        sendPacket(notificationPacket);
+        return;
+    }
+
+    transmitQueue->setMaximumNotifications(notificationQueueLimit);
+    transmitQueue->setDropPolicy(notificationDropPolicy == QLowEnergyController::DropNewestNotification
+                                 ? AttTransmitQueue::DropPolicy::DropNewest
+                                 : AttTransmitQueue::DropPolicy::DropOldest);
+    if (!transmitQueue->sendNotification(handle, notificationPacket))
+        qCDebug(QT_BT_BLUEZ) << "Cannot send notification for handle" << handle;
 }
 
 void QLowEnergyControllerPrivateBluez::sendNextIndication()
@@ -3064,6 +3522,11 @@ void QLowEnergyControllerPrivateBluez::handleConnectionRequest()
     if (connectionHandle == 0)
         qCWarning(QT_BT_BLUEZ) << "Received client connection, but no connection complete event";
 
+    attachAttSocket(clientSocket);
+}
+
+void QLowEnergyControllerPrivateBluez::attachAttSocket(int socketDescriptor)
+{
     if (l2cpSocket) {
         disconnect(l2cpSocket);
         if (l2cpSocket->isOpen())
@@ -3084,8 +3547,14 @@ void QLowEnergyControllerPrivateBluez::handleConnectionRequest()
     connect(l2cpSocket, &QIODevice::readyRead, this, &QLowEnergyControllerPrivateBluez::l2cpReadyRead);
     l2cpSocket->d_ptr->lowEnergySocketType = addressType == QLowEnergyController::PublicAddress
             ? BDADDR_LE_PUBLIC : BDADDR_LE_RANDOM;
-    l2cpSocket->setSocketDescriptor(clientSocket, QBluetoothServiceInfo::L2capProtocol,
+    l2cpSocket->setSocketDescriptor(socketDescriptor, QBluetoothServiceInfo::L2capProtocol,
             QBluetoothSocket::SocketState::ConnectedState, QIODevice::ReadWrite | QIODevice::Unbuffered);
+    if (role == QLowEnergyController::CentralRole) {
+        l2cpConnected();
+        return;
+    }
+
+    attachTransmitQueue(socketDescriptor);
     restoreClientConfigurations();
     loadSigningDataIfNecessary(RemoteSigningKey);
 
@@ -3094,6 +3563,19 @@ void QLowEnergyControllerPrivateBluez::handleConnectionRequest()
     emit q->connected();
 }
 
+void QLowEnergyControllerPrivateBluez::attachTransmitQueue(int socketDescriptor)
+{
+    // a new connection starts with fresh statistics, the queue resets its own counters
+    statistics = QLowEnergyConnectionStatistics();
+    transmitQueue->setSocketDescriptor(socketDescriptor);
+    if (capture) {
+        captureChannel = capture->openChannel();
+        transmitQueue->setCapture(capture, captureChannel);
+        qCDebug(QT_BT_BLUEZ) << "Capturing ATT traffic with" << remoteDevice
+                             << "on channel" << captureChannel;
+    }
+}
+
 void QLowEnergyControllerPrivateBluez::closeServerSocket()
 {
     if (!serverSocketNotifier)
@@ -3324,6 +3806,11 @@ void QLowEnergyControllerPrivateBluez::addToGenericAttributeList(const QLowEnerg
         attribute.minLength = cd.minimumValueLength();
         attribute.maxLength = cd.maximumValueLength();
         localAttributes[attribute.handle] = attribute;
+        if (cd.valueProvider()) {
+            ValueProvider &provider = valueProviders[attribute.handle];
+            provider.provide = cd.valueProvider();
+            provider.cacheTime = cd.valueProviderCacheTime();
+        }
 
         const QList<QLowEnergyDescriptorData> descriptors = cd.descriptors();
         for (const QLowEnergyDescriptorData &dd : descriptors) {
@@ -3386,6 +3873,36 @@ int QLowEnergyControllerPrivateBluez::mtu() const
     return mtuSize;
 }
 
+int QLowEnergyControllerPrivateBluez::queuedNotificationCount() const
+{
+    return transmitQueue ? transmitQueue->queuedNotificationCount() : 0;
+}
+
+quint64 QLowEnergyControllerPrivateBluez::droppedNotificationCount() const
+{
+    return transmitQueue ? transmitQueue->droppedNotifications() : 0;
+}
+
+QLowEnergyConnectionStatistics QLowEnergyControllerPrivateBluez::connectionStatistics() const
+{
+    QLowEnergyConnectionStatistics snapshot = statistics;
+    snapshot.d->mtu = mtuSize;
+    snapshot.d->pendingRequests = int(openRequests.size());
+    if (transmitQueue) {
+        snapshot.d->bytesSent = transmitQueue->bytesWritten();
+        snapshot.d->packetsSent = transmitQueue->packetsWritten();
+        snapshot.d->queuedPackets = transmitQueue->queueDepth();
+    }
+    return snapshot;
+}
+
+void QLowEnergyControllerPrivateBluez::resetConnectionStatistics()
+{
+    statistics = QLowEnergyConnectionStatistics();
+    if (transmitQueue)
+        transmitQueue->resetStatistics();
+}
+
 void QLowEnergyControllerPrivateBluez::ensureUniformAttributes(
         QList<Attribute> &attributes, const std::function<int(const Attribute &)> &getSize)
 {
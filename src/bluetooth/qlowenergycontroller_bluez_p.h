@@ -52,10 +52,12 @@
 //
 
 #include <qglobal.h>
+#include <QtCore/QElapsedTimer>
 #include <QtCore/QList>
 #include <QtCore/QQueue>
 #include <QtBluetooth/qbluetooth.h>
 #include <QtBluetooth/qlowenergycharacteristic.h>
+#include <QtBluetooth/qlowenergycharacteristicdata.h>
 #include "qlowenergycontroller.h"
 #include "qlowenergycontrollerbase_p.h"
 #include "bluez/bluez_data_p.h"
@@ -68,6 +70,8 @@ QT_BEGIN_NAMESPACE
 class QLowEnergyServiceData;
 class QTimer;
 
+class AttCapture;
+class AttTransmitQueue;
 class HciManager;
 class LeCmacCalculator;
 class QSocketNotifier;
@@ -77,7 +81,7 @@ extern void registerQLowEnergyControllerMetaType();
 
 class QLeAdvertiser;
 
-class QLowEnergyControllerPrivateBluez final: public QLowEnergyControllerPrivate
+class Q_AUTOTEST_EXPORT QLowEnergyControllerPrivateBluez final: public QLowEnergyControllerPrivate
 {
     Q_OBJECT
 public:
@@ -97,6 +101,8 @@ public:
                           const QLowEnergyAdvertisingData &advertisingData,
                           const QLowEnergyAdvertisingData &scanResponseData) override;
     void stopAdvertising() override;
+    void updateAdvertisingData(const QLowEnergyAdvertisingData &advertisingData,
+                               const QLowEnergyAdvertisingData &scanResponseData) override;
 
     void requestConnectionUpdate(const QLowEnergyConnectionParameters &params) override;
 
@@ -111,6 +117,11 @@ public:
     void writeCharacteristic(const QSharedPointer<QLowEnergyServicePrivate> service,
                              const QLowEnergyHandle charHandle,
                              const QByteArray &newValue, QLowEnergyService::WriteMode mode) override;
+    void writeCharacteristicLong(const QSharedPointer<QLowEnergyServicePrivate> service,
+                                 const QLowEnergyHandle charHandle,
+                                 const QByteArray &newValue) override;
+    void writeCharacteristics(const QSharedPointer<QLowEnergyServicePrivate> service,
+                              const QList<QPair<QLowEnergyHandle, QByteArray>> &updates) override;
     void writeDescriptor(const QSharedPointer<QLowEnergyServicePrivate> service,
                          const QLowEnergyHandle charHandle,
                          const QLowEnergyHandle descriptorHandle,
@@ -121,6 +132,17 @@ public:
 
     int mtu() const override;
 
+    int queuedNotificationCount() const override;
+    quint64 droppedNotificationCount() const override;
+
+    QLowEnergyConnectionStatistics connectionStatistics() const override;
+    void resetConnectionStatistics() override;
+    int effectiveGattRequestTimeout(quint8 opcode) const override;
+
+    // Takes over a connected ATT socket, also used to replay captured traffic
+    void attachAttSocket(int socketDescriptor);
+    void setHciManager(HciManager *manager);
+
     struct Attribute {
         Attribute() : handle(0) {}
 
@@ -136,6 +158,14 @@ public:
     };
     QList<Attribute> localAttributes;
 
+    // characteristic values computed when a client reads them, keyed by value handle
+    struct ValueProvider {
+        QLowEnergyCharacteristicData::ValueProvider provide;
+        int cacheTime = 0;
+        QElapsedTimer age;
+    };
+    QHash<QLowEnergyHandle, ValueProvider> valueProviders;
+
 private:
     quint16 connectionHandle = 0;
     QBluetoothSocket *l2cpSocket = nullptr;
@@ -146,8 +176,11 @@ private:
         // requirements this is WIP
         QVariant reference;
         QVariant reference2;
+        // identifies the parts of one long write, 0 for all other requests
+        quint32 longWriteId = 0;
     };
     QQueue<Request> openRequests;
+    quint32 lastLongWriteId = 0;
 
     struct WriteRequest {
         WriteRequest() {}
@@ -202,30 +235,61 @@ private:
     bool encryptionChangePending;
     bool receivedMtuExchangeRequest = false;
 
+    // link layer parameters as reported by the controller
+    quint16 linkTxOctets = 27;
+    quint16 linkRxOctets = 27;
+    QLowEnergyController::Phy linkTxPhy = QLowEnergyController::Phy1M;
+    QLowEnergyController::Phy linkRxPhy = QLowEnergyController::Phy1M;
+
     HciManager *hciManager = nullptr;
+    AttTransmitQueue *transmitQueue = nullptr;
+    AttCapture *capture = nullptr;
+    quint16 captureChannel = 0;
+    // counters kept while connected, the queue depths are filled in on request
+    QLowEnergyConnectionStatistics statistics;
+    QElapsedTimer requestLatency;
+    // reused for every notification, avoids an allocation per packet
+    QByteArray notificationPacket;
     QLeAdvertiser *advertiser = nullptr;
     QSocketNotifier *serverSocketNotifier = nullptr;
     QTimer *requestTimer = nullptr;
     RemoteDeviceManager* device1Manager = nullptr;
 
     /*
-      Defines the maximum number of milliseconds the implementation will
-      wait for requests that require a response.
-
-      This addresses the problem that some non-conformant BTLE devices
+      The request timer addresses the problem that some non-conformant BTLE devices
       do not implement the request/response system properly. In such cases
       the queue system would hang forever.
 
       Once timeout has been triggered we gracefully continue with the next request.
       Depending on the type of the timed out ATT command we either ignore it
       or artifically trigger an error response to ensure the API gives the
-      appropriate response. Potentially this can cause problems when the
-      response for the dropped requests arrives very late. That's why a big warning
-      is printed about the compromised state when a timeout is triggered.
+      appropriate response. The response for the dropped request may still arrive
+      very late. Therefore the next request is held back for a short grace period
+      in which such a response is discarded, and afterwards responses that cannot
+      belong to the pending request are discarded as long as timed out requests
+      remain unanswered.
+
+      The timeout itself follows the measured round trips (RFC 6298), bounded
+      by gattRequestTimeout and by a floor derived from the connection interval.
      */
-    int gattRequestTimeout = 20000;
+    struct RoundTripEstimator
+    {
+        void addSample(qint64 usecs);
 
+        qint64 smoothed = 0; // microseconds
+        qint64 variation = 0;
+        int samples = 0;
+    };
+    RoundTripEstimator roundTrip;
+    // last reported connection parameters, used for the timeout floor
+    double connectionInterval = 0; // milliseconds
+    int connectionLatency = 0;
+    bool awaitingLateResponse = false;
+    int unansweredTimeouts = 0;
+
+    void connectHciManager();
     void handleConnectionRequest();
+    void attachTransmitQueue(int socketDescriptor);
     void closeServerSocket();
 
     bool isBonded() const;
@@ -259,13 +323,15 @@ private:
                                 QLowEnergyHandle startingHandle);
     void processUnsolicitedReply(const QByteArray &msg);
     void exchangeMTU();
+    quint16 localRxMtu() const;
+    void applyLinkPreferences();
     bool setSecurityLevel(int level);
     int securityLevel() const;
     void sendExecuteWriteRequest(const QLowEnergyHandle attrHandle,
                                  const QByteArray &newValue,
                                  bool isCancelation);
-    void sendNextPrepareWriteRequest(const QLowEnergyHandle handle,
-                                     const QByteArray &newValue, quint16 offset);
+    bool sendPrepareWriteRequests(const QLowEnergyHandle handle, const QByteArray &newValue);
+    void removePendingPrepareWriteRequests(quint32 longWriteId);
     bool increaseEncryptLevelfRequired(QBluezConst::AttError errorCode);
 
     void resetController();
@@ -314,6 +380,7 @@ private:
     QBluezConst::AttError checkPermissions(const Attribute &attr,
                                            QLowEnergyCharacteristic::PropertyType type);
     QBluezConst::AttError checkReadPermissions(const Attribute &attr);
+    void updateProvidedValue(QLowEnergyHandle handle);
     QBluezConst::AttError checkReadPermissions(QList<Attribute> &attributes);
 
     bool verifyMac(const QByteArray &message, const quint128 &csrk, quint32 signCounter,
@@ -328,6 +395,9 @@ private:
     void writeCharacteristicForPeripheral(
             QLowEnergyServicePrivate::CharData &charData,
             const QByteArray &newValue);
+    bool setLocalCharacteristicValue(QLowEnergyServicePrivate::CharData &charData,
+                                     const QByteArray &newValue);
+    void notifyClientsOfValueChange(const QLowEnergyServicePrivate::CharData &charData);
     void writeCharacteristicForCentral(const QSharedPointer<QLowEnergyServicePrivate> &service,
             QLowEnergyHandle charHandle,
             QLowEnergyHandle valueHandle,
@@ -345,6 +415,7 @@ private:
             const QByteArray &newValue);
 
     void restartRequestTimer();
+    void finishLateResponseGracePeriod();
     void establishL2cpClientSocket();
     void createServicesForCentralIfRequired();
 
@@ -38,15 +38,19 @@
 ****************************************************************************/
 
 #include "qlowenergycontroller_bluezdbus_p.h"
+#include "qlowenergyconnectionstatistics_p.h"
 #include "bluez/adapter1_bluez5_p.h"
 #include "bluez/bluez5_helper_p.h"
+#include "bluez/bluez_data_p.h"
 #include "bluez/device1_bluez5_p.h"
 #include "bluez/gattservice1_p.h"
 #include "bluez/gattchar1_p.h"
 #include "bluez/gattdesc1_p.h"
 #include "bluez/battery1_p.h"
 #include "bluez/objectmanager_p.h"
-#include "bluez/properties_p.h"
+#include "bluez/propertiesrouter_p.h"
+
+#include <qtbluetooth_tracepoints_p.h>
 
 
 QT_BEGIN_NAMESPACE
@@ -63,6 +67,8 @@ QLowEnergyControllerPrivateBluezDBus::~QLowEnergyControllerPrivateBluezDBus()
     if (state != QLowEnergyController::UnconnectedState) {
         qCWarning(QT_BT_BLUEZ) << "Low Energy Controller deleted while connected.";
     }
+
+    delete deviceMonitor;
 }
 
 void QLowEnergyControllerPrivateBluezDBus::init()
@@ -202,12 +208,21 @@ void QLowEnergyControllerPrivateBluezDBus::characteristicPropertiesChanged(
         return;
 
     const QByteArray newValue = changedProperties.value(QStringLiteral("Value")).toByteArray();
-    if (changedChar.properties() & QLowEnergyCharacteristic::Read)
+    statistics.d->bytesReceived += quint64(newValue.size());
+    ++statistics.d->packetsReceived;
+    auto service = serviceForHandle(charHandle);
+
+    if ((changedChar.properties() & QLowEnergyCharacteristic::Read)
+            && (service.isNull() || !service->skipsValueCacheUpdate())) {
         updateValueOfCharacteristic(charHandle, newValue, false); //TODO upgrade to NEW_VALUE/APPEND_VALUE
+    }
 
-    auto service = serviceForHandle(charHandle);
+    if (service.isNull())
+        return;
 
-    if (!service.isNull())
+    if (service->isNotificationBatchingEnabled())
+        service->enqueueNotification(charHandle, newValue);
+    else
         emit service->characteristicChanged(changedChar, newValue);
 }
 
@@ -324,17 +339,21 @@ void QLowEnergyControllerPrivateBluezDBus::connectToDeviceHelper()
     device = new OrgBluezDevice1Interface(
                                 QStringLiteral("org.bluez"), devicePath,
                                 QDBusConnection::systemBus(), this);
-    deviceMonitor = new OrgFreedesktopDBusPropertiesInterface(
-                                QStringLiteral("org.bluez"), devicePath,
-                                QDBusConnection::systemBus(), this);
-    connect(deviceMonitor, &OrgFreedesktopDBusPropertiesInterface::PropertiesChanged,
-            this, &QLowEnergyControllerPrivateBluezDBus::devicePropertiesChanged);
+    deviceMonitor = QtBluezPropertiesRouter::instance()->subscribe(
+                                devicePath, QStringLiteral("org.bluez.Device1"),
+                                QtBluezPropertiesRouter::PathMatch::Exact, this,
+                                [this](const QString &, const QString &interface,
+                                       const QVariantMap &changedProperties,
+                                       const QStringList &removedProperties) {
+        devicePropertiesChanged(interface, changedProperties, removedProperties);
+    });
 }
 
 void QLowEnergyControllerPrivateBluezDBus::connectToDevice()
 {
     qCDebug(QT_BT_BLUEZ) << "QLowEnergyControllerPrivateBluezDBus::connectToDevice()";
 
+    statistics = QLowEnergyConnectionStatistics();
     connectToDeviceHelper();
 
     if (!adapter || !device)
@@ -670,17 +689,17 @@ void QLowEnergyControllerPrivateBluezDBus::discoverServiceDetails(
             // every ClientCharacteristicConfiguration needs to track property changes
             if (descData.uuid
                         == QBluetoothUuid(QBluetoothUuid::DescriptorType::ClientCharacteristicConfiguration)) {
-                dbusChar.charMonitor = QSharedPointer<OrgFreedesktopDBusPropertiesInterface>::create(
-                                                QStringLiteral("org.bluez"),
+                dbusChar.charMonitor.reset(QtBluezPropertiesRouter::instance()->subscribe(
                                                 dbusChar.characteristic->path(),
-                                                QDBusConnection::systemBus(), this);
-                connect(dbusChar.charMonitor.data(), &OrgFreedesktopDBusPropertiesInterface::PropertiesChanged,
-                        this, [this, indexHandle](const QString &interface, const QVariantMap &changedProperties,
-                        const QStringList &removedProperties) {
+                                                QStringLiteral("org.bluez.GattCharacteristic1"),
+                                                QtBluezPropertiesRouter::PathMatch::Exact, this,
+                                                [this, indexHandle](const QString &, const QString &interface,
+                                                                    const QVariantMap &changedProperties,
+                                                                    const QStringList &removedProperties) {
 
                     characteristicPropertiesChanged(indexHandle, interface,
                                                     changedProperties, removedProperties);
-                });
+                }));
             }
 
             if (mode == QLowEnergyService::FullDiscovery) {
@@ -717,6 +736,29 @@ void QLowEnergyControllerPrivateBluezDBus::prepareNextJob()
     scheduleNextJob(); // continue with next job - if available
 }
 
+void QLowEnergyControllerPrivateBluezDBus::recordJobResponse(const GattJob &job,
+                                                             qsizetype receivedBytes, bool isError)
+{
+    Q_TRACE(QLowEnergyControllerPrivateBluezDBus_jobFinished, int(job.flags), int(job.handle),
+            int(isError));
+
+    // Without access to the ATT bearer, jobs are accounted as the requests BlueZ sends for them
+    QBluezConst::AttCommand command = QBluezConst::AttCommand::ATT_OP_READ_REQUEST;
+    if (job.flags & (GattJob::CharWrite | GattJob::DescWrite)) {
+        command = job.writeMode == QLowEnergyService::WriteWithoutResponse
+                ? QBluezConst::AttCommand::ATT_OP_WRITE_COMMAND
+                : QBluezConst::AttCommand::ATT_OP_WRITE_REQUEST;
+        statistics.d->bytesSent += quint64(job.value.size());
+    }
+    ++statistics.d->packetsSent;
+    if (command != QBluezConst::AttCommand::ATT_OP_WRITE_COMMAND) {
+        statistics.d->bytesReceived += quint64(receivedBytes);
+        ++statistics.d->packetsReceived;
+    }
+    statistics.d->recordResponse(static_cast<quint8>(command),
+                                 jobLatency.nsecsElapsed() / 1000, isError);
+}
+
 void QLowEnergyControllerPrivateBluezDBus::onCharReadFinished(QDBusPendingCallWatcher *call)
 {
     if (!jobPending || jobs.isEmpty()) {
@@ -741,6 +783,7 @@ void QLowEnergyControllerPrivateBluezDBus::onCharReadFinished(QDBusPendingCallWa
 
     bool isServiceDiscovery = nextJob.flags.testFlag(GattJob::ServiceDiscovery);
     QDBusPendingReply<QByteArray> reply = *call;
+    recordJobResponse(nextJob, reply.isError() ? 0 : reply.value().size(), reply.isError());
     if (reply.isError()) {
         qCWarning(QT_BT_BLUEZ) << "Cannot initiate reading of" << charData.uuid
                                << "of service" << service->uuid
@@ -807,6 +850,7 @@ void QLowEnergyControllerPrivateBluezDBus::onDescReadFinished(QDBusPendingCallWa
     const QBluetoothUuid descUuid = charData.descriptorList[nextJob.handle].uuid;
 
     QDBusPendingReply<QByteArray> reply = *call;
+    recordJobResponse(nextJob, reply.isError() ? 0 : reply.value().size(), reply.isError());
     if (reply.isError()) {
         qCWarning(QT_BT_BLUEZ) << "Cannot read descriptor (onDescReadFinished 3): "
                              << charData.descriptorList[nextJob.handle].uuid
@@ -855,6 +899,7 @@ void QLowEnergyControllerPrivateBluezDBus::onCharWriteFinished(QDBusPendingCallW
                         service->characteristicList.value(nextJob.handle);
 
     QDBusPendingReply<> reply = *call;
+    recordJobResponse(nextJob, 0, reply.isError());
     if (reply.isError()) {
         qCWarning(QT_BT_BLUEZ) << "Cannot initiate writing of" << charData.uuid
                                << "of service" << service->uuid
@@ -907,6 +952,7 @@ void QLowEnergyControllerPrivateBluezDBus::onDescWriteFinished(QDBusPendingCallW
     }
 
     QDBusPendingReply<> reply = *call;
+    recordJobResponse(nextJob, 0, reply.isError());
     if (reply.isError()) {
         qCWarning(QT_BT_BLUEZ) << "Cannot initiate writing of" << descriptor.uuid()
                                << "of char" << associatedChar.uuid()
@@ -930,8 +976,11 @@ void QLowEnergyControllerPrivateBluezDBus::scheduleNextJob()
         return;
 
     jobPending = true;
+    jobLatency.start();
 
     const GattJob nextJob = jobs.constFirst();
+    Q_TRACE(QLowEnergyControllerPrivateBluezDBus_scheduleJob, int(nextJob.flags),
+            int(nextJob.handle), int(jobs.size()));
     QSharedPointer<QLowEnergyServicePrivate> service = serviceForHandle(nextJob.handle);
     if (service.isNull() || !dbusServices.contains(service->uuid)) {
         qCWarning(QT_BT_BLUEZ) << "Invalid GATT job (scheduleNextJob). Skipping.";
@@ -1308,6 +1357,19 @@ int QLowEnergyControllerPrivateBluezDBus::mtu() const
     return -1;
 }
 
+QLowEnergyConnectionStatistics QLowEnergyControllerPrivateBluezDBus::connectionStatistics() const
+{
+    QLowEnergyConnectionStatistics snapshot = statistics;
+    snapshot.d->mtu = mtu();
+    snapshot.d->pendingRequests = int(jobs.size());
+    return snapshot;
+}
+
+void QLowEnergyControllerPrivateBluezDBus::resetConnectionStatistics()
+{
+    statistics = QLowEnergyConnectionStatistics();
+}
+
 QLowEnergyService *QLowEnergyControllerPrivateBluezDBus::addServiceHelper(
                     const QLowEnergyServiceData &/*service*/)
 {
@@ -55,6 +55,7 @@
 #include "qlowenergycontroller.h"
 #include "qlowenergycontrollerbase_p.h"
 
+#include <QtCore/QElapsedTimer>
 #include <QtDBus/QDBusObjectPath>
 
 class OrgBluezAdapter1Interface;
@@ -64,11 +65,11 @@ class OrgBluezGattCharacteristic1Interface;
 class OrgBluezGattDescriptor1Interface;
 class OrgBluezGattService1Interface;
 class OrgFreedesktopDBusObjectManagerInterface;
-class OrgFreedesktopDBusPropertiesInterface;
 
 QT_BEGIN_NAMESPACE
 
 class QDBusPendingCallWatcher;
+class QtBluezPropertiesSubscription;
 
 class QLowEnergyControllerPrivateBluezDBus final : public QLowEnergyControllerPrivate
 {
@@ -118,6 +119,9 @@ public:
 
     int mtu() const override;
 
+    QLowEnergyConnectionStatistics connectionStatistics() const override;
+    void resetConnectionStatistics() override;
+
     QLowEnergyService *addServiceHelper(const QLowEnergyServiceData &service) override;
 
 
@@ -143,7 +147,7 @@ private:
     OrgBluezAdapter1Interface* adapter{};
     OrgBluezDevice1Interface* device{};
     OrgFreedesktopDBusObjectManagerInterface* managerBluez{};
-    OrgFreedesktopDBusPropertiesInterface* deviceMonitor{};
+    QtBluezPropertiesSubscription* deviceMonitor{};
 
     bool pendingConnect = false;
     bool disconnectSignalRequired = false;
@@ -151,7 +155,7 @@ private:
     struct GattCharacteristic
     {
         QSharedPointer<OrgBluezGattCharacteristic1Interface> characteristic;
-        QSharedPointer<OrgFreedesktopDBusPropertiesInterface> charMonitor;
+        QSharedPointer<QtBluezPropertiesSubscription> charMonitor;
         QList<QSharedPointer<OrgBluezGattDescriptor1Interface>> descriptors;
     };
 
@@ -188,8 +192,11 @@ private:
 
     QList<GattJob> jobs;
     bool jobPending = false;
+    QElapsedTimer jobLatency;
+    QLowEnergyConnectionStatistics statistics;
 
     void prepareNextJob();
+    void recordJobResponse(const GattJob &job, qsizetype receivedBytes, bool isError);
     void discoverBatteryServiceDetails(GattService &dbusData,
                                        QSharedPointer<QLowEnergyServicePrivate> serviceData);
     void executeClose(QLowEnergyController::Error newError);
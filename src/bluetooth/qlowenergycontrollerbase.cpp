@@ -270,6 +270,80 @@ void QLowEnergyControllerPrivate::invalidateServices()
     lastLocalHandle = {};
 }
 
+/*!
+    Writes \a newValue as one long value. Backends without native support for
+    prepare/execute write sequences fall back to a regular write request.
+ */
+void QLowEnergyControllerPrivate::writeCharacteristicLong(
+        const QSharedPointer<QLowEnergyServicePrivate> service,
+        const QLowEnergyHandle charHandle,
+        const QByteArray &newValue)
+{
+    writeCharacteristic(service, charHandle, newValue, QLowEnergyService::WriteWithResponse);
+}
+
+/*!
+    Applies the value changes of a committed update on a local service. Backends
+    which cannot update several characteristics in one pass write them one by one.
+ */
+void QLowEnergyControllerPrivate::writeCharacteristics(
+        const QSharedPointer<QLowEnergyServicePrivate> service,
+        const QList<QPair<QLowEnergyHandle, QByteArray>> &updates)
+{
+    for (const auto &update : updates)
+        writeCharacteristic(service, update.first, update.second,
+                            QLowEnergyService::WriteWithResponse);
+}
+
+/*!
+    Replaces the data of the running advertisement. Backends which cannot change
+    the data of an active advertisement restart it with the new data.
+ */
+void QLowEnergyControllerPrivate::updateAdvertisingData(
+        const QLowEnergyAdvertisingData &advertisingData,
+        const QLowEnergyAdvertisingData &scanResponseData)
+{
+    stopAdvertising();
+    startAdvertising(advertisingParameters, advertisingData, scanResponseData);
+    if (state != QLowEnergyController::AdvertisingState)
+        return;
+
+    Q_Q(QLowEnergyController);
+    QMetaObject::invokeMethod(q, &QLowEnergyController::advertisingDataUpdated,
+                              Qt::QueuedConnection);
+}
+
+/*!
+    Backends which queue outgoing notifications report the state of their queue.
+ */
+int QLowEnergyControllerPrivate::queuedNotificationCount() const
+{
+    return 0;
+}
+
+quint64 QLowEnergyControllerPrivate::droppedNotificationCount() const
+{
+    return 0;
+}
+
+QLowEnergyConnectionStatistics QLowEnergyControllerPrivate::connectionStatistics() const
+{
+    return QLowEnergyConnectionStatistics();
+}
+
+void QLowEnergyControllerPrivate::resetConnectionStatistics()
+{
+}
+
+/*!
+    Backends which measure request round trips may shorten the timeout,
+    all others use the configured upper bound.
+ */
+int QLowEnergyControllerPrivate::effectiveGattRequestTimeout(quint8 opcode) const
+{
+    return gattRequestTimeoutOverrides.value(opcode, gattRequestTimeout);
+}
+
 QLowEnergyService *QLowEnergyControllerPrivate::addServiceHelper(
                             const QLowEnergyServiceData &service)
 {
@@ -53,8 +53,10 @@
 
 #include <qglobal.h>
 #include <QtCore/qobject.h>
+#include <QtCore/qhash.h>
 
 #include <QtBluetooth/qlowenergycontroller.h>
+#include <QtBluetooth/qlowenergyadvertisingparameters.h>
 
 #include "qlowenergyserviceprivate_p.h"
 
@@ -62,10 +64,12 @@ QT_BEGIN_NAMESPACE
 
 typedef QMap<QBluetoothUuid, QSharedPointer<QLowEnergyServicePrivate> > ServiceDataMap;
 
-class QLowEnergyControllerPrivate : public QObject
+class Q_AUTOTEST_EXPORT QLowEnergyControllerPrivate : public QObject
 {
     Q_OBJECT
 public:
+    static QLowEnergyControllerPrivate *get(QLowEnergyController *q) { return q->d_func(); }
+
     // This class is required to enable selection of multiple
     // alternative QLowEnergyControllerPrivate implementations on BlueZ.
     // Bluez has a low level ATT protocol stack implementation and a DBus
@@ -96,6 +100,13 @@ public:
                         const QLowEnergyHandle charHandle,
                         const QByteArray &newValue,
                         QLowEnergyService::WriteMode writeMode) = 0;
+    virtual void writeCharacteristicLong(
+                        const QSharedPointer<QLowEnergyServicePrivate> service,
+                        const QLowEnergyHandle charHandle,
+                        const QByteArray &newValue);
+    virtual void writeCharacteristics(
+                        const QSharedPointer<QLowEnergyServicePrivate> service,
+                        const QList<QPair<QLowEnergyHandle, QByteArray>> &updates);
     virtual void writeDescriptor(
                         const QSharedPointer<QLowEnergyServicePrivate> service,
                         const QLowEnergyHandle charHandle,
@@ -107,6 +118,9 @@ public:
                         const QLowEnergyAdvertisingData &advertisingData,
                         const QLowEnergyAdvertisingData &scanResponseData) = 0;
     virtual void stopAdvertising() = 0;
+    virtual void updateAdvertisingData(
+                        const QLowEnergyAdvertisingData &advertisingData,
+                        const QLowEnergyAdvertisingData &scanResponseData);
 
     virtual void requestConnectionUpdate(
                         const QLowEnergyConnectionParameters & params) = 0;
@@ -116,6 +130,14 @@ public:
 
     virtual int mtu() const = 0;
 
+    virtual int queuedNotificationCount() const;
+    virtual quint64 droppedNotificationCount() const;
+
+    virtual QLowEnergyConnectionStatistics connectionStatistics() const;
+    virtual void resetConnectionStatistics();
+
+    virtual int effectiveGattRequestTimeout(quint8 opcode) const;
+
     virtual QLowEnergyService *addServiceHelper(
                         const QLowEnergyServiceData &service);
 
@@ -128,6 +150,25 @@ public:
     QLowEnergyController::Role role;
     QLowEnergyController::RemoteAddressType addressType;
 
+    // link layer preferences, 0 or empty means platform default
+    int preferredMtu = 0;
+    int preferredDataLength = 0;
+    QLowEnergyController::Phys preferredPhys;
+
+    // bounds the notifications waiting for a congested link
+    int notificationQueueLimit = 64;
+    QLowEnergyController::NotificationDropPolicy notificationDropPolicy =
+            QLowEnergyController::DropOldestNotification;
+
+    // upper bound for the response to a GATT request, 0 disables the timeout;
+    // the overrides are keyed by request opcode
+    int gattRequestTimeout = 20000;
+    bool adaptiveGattRequestTimeout = true;
+    QHash<quint8, int> gattRequestTimeoutOverrides;
+
+    // parameters of the most recent startAdvertising() call
+    QLowEnergyAdvertisingParameters advertisingParameters;
+
     // list of all found service uuids on remote device
     ServiceDataMap serviceList;
     // list of all found service uuids on local peripheral device
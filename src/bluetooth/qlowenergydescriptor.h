@@ -84,6 +84,7 @@ private:
 
     friend class QLowEnergyCharacteristic;
     friend class QLowEnergyService;
+    friend class QLowEnergyServicePrivate;
     friend class QLowEnergyControllerPrivate;
     friend class QLowEnergyControllerPrivateAndroid;
     friend class QLowEnergyControllerPrivateBluez;
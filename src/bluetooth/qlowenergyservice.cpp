@@ -39,6 +39,7 @@
 ****************************************************************************/
 
 #include <QtCore/QCoreApplication>
+#include <QtCore/QLoggingCategory>
 #include <QtCore/QPointer>
 #include <QtBluetooth/QLowEnergyService>
 
@@ -47,12 +48,10 @@
 #include "qlowenergycontrollerbase_p.h"
 #include "qlowenergyserviceprivate_p.h"
 
-#ifdef Q_OS_DARWIN
-#include "qlowenergycontroller_darwin_p.h"
-#endif // Q_OS_DARWIN
-
 QT_BEGIN_NAMESPACE
 
+Q_DECLARE_LOGGING_CATEGORY(QT_BT)
+
 /*!
     \class QLowEnergyService
     \inmodule QtBluetooth
@@ -297,6 +296,23 @@ QT_BEGIN_NAMESPACE
                                 3.7 or newer.
  */
 
+/*!
+    \enum QLowEnergyService::NotificationBatchingOption
+
+    This enum describes the options that can be passed to
+    \l setNotificationBatching().
+
+    \value DefaultBatching         Batched values are still stored in the service's
+                                    value cache, so \l QLowEnergyCharacteristic::value()
+                                    returns the latest notified value.
+    \value SkipValueCacheUpdate    Batched values are only delivered via
+                                    \l characteristicChangedBatch(). The cached
+                                    characteristic value is left untouched, which avoids
+                                    a hash lookup and a copy per notification.
+
+    \since 6.3
+ */
+
 /*!
     \fn void QLowEnergyService::stateChanged(QLowEnergyService::ServiceState newState)
 
@@ -348,6 +364,24 @@ QT_BEGIN_NAMESPACE
     \sa writeCharacteristic()
  */
 
+/*!
+    \fn void QLowEnergyService::characteristicWriteProgress(const QLowEnergyCharacteristic &characteristic, qsizetype bytesWritten, qsizetype totalBytes)
+
+    This signal is emitted during a long write of \a characteristic each time
+    the remote device has acknowledged another part of the value.
+    \a bytesWritten is the number of bytes queued on the remote device so far
+    and \a totalBytes is the size of the entire value.
+
+    The value is only applied once all parts are queued; completion is
+    reported via \l characteristicWritten().
+
+    \note This signal is only emitted for Central Role related use cases
+    and currently only by the BlueZ backend.
+
+    \sa writeCharacteristicLong()
+    \since 6.3
+ */
+
 /*!
     \fn void QLowEnergyService::characteristicChanged(const QLowEnergyCharacteristic
    &characteristic, const QByteArray &newValue)
@@ -368,6 +402,20 @@ QT_BEGIN_NAMESPACE
 
  */
 
+/*!
+    \fn void QLowEnergyService::characteristicChangedBatch(const QLowEnergyCharacteristic &characteristic, const QList<QByteArray> &values, const QList<qint64> &timestamps)
+
+    This signal replaces \l characteristicChanged() for remote notifications and
+    indications while notification batching is enabled. It is emitted once per
+    flush for each \a characteristic that changed since the previous flush.
+
+    \a values contains the received values in arrival order and \a timestamps
+    the matching reception times in milliseconds since the epoch.
+
+    \sa setNotificationBatching()
+    \since 6.3
+ */
+
 /*!
     \fn void QLowEnergyService::descriptorRead(const QLowEnergyDescriptor &descriptor, const QByteArray &value)
 
@@ -419,12 +467,20 @@ QLowEnergyService::QLowEnergyService(QSharedPointer<QLowEnergyServicePrivate> p,
             this, &QLowEnergyService::characteristicChanged);
     connect(p.data(), &QLowEnergyServicePrivate::characteristicWritten,
             this, &QLowEnergyService::characteristicWritten);
+    connect(p.data(), &QLowEnergyServicePrivate::characteristicWriteProgress,
+            this, &QLowEnergyService::characteristicWriteProgress);
     connect(p.data(), &QLowEnergyServicePrivate::descriptorWritten,
             this, &QLowEnergyService::descriptorWritten);
     connect(p.data(), &QLowEnergyServicePrivate::characteristicRead,
             this, &QLowEnergyService::characteristicRead);
     connect(p.data(), &QLowEnergyServicePrivate::descriptorRead,
             this, &QLowEnergyService::descriptorRead);
+    connect(p.data(), &QLowEnergyServicePrivate::characteristicChangedBatch, this,
+            [this](QLowEnergyHandle charHandle, const QList<QByteArray> &values,
+                   const QList<qint64> &timestamps) {
+        emit characteristicChangedBatch(QLowEnergyCharacteristic(d_ptr, charHandle),
+                                        values, timestamps);
+    });
 }
 
 /*!
@@ -685,8 +741,9 @@ void QLowEnergyService::readCharacteristic(
         return;
     }
 
-    d->controller->readCharacteristic(characteristic.d_ptr,
-                                      characteristic.attributeHandle());
+    const QLowEnergyHandle charHandle = characteristic.attributeHandle();
+    if (d->dispatch([&]() { d->controller->readCharacteristic(characteristic.d_ptr, charHandle); }))
+        d->trackOperation(QLowEnergyServicePrivate::Operation::ReadCharacteristic, charHandle);
 }
 
 /*!
@@ -714,7 +771,8 @@ void QLowEnergyService::readCharacteristic(
     to B, the two write request are executed in the given order.
 
     \note Currently, it is not possible to use signed or reliable writes as defined by the
-    Bluetooth specification.
+    Bluetooth specification. Use \l writeCharacteristicLong() to force a
+    prepare/execute write sequence for a single characteristic.
 
     A characteristic can only be written if this service is in the \l ServiceDiscovered state
     and belongs to the service. If one of these conditions is
@@ -741,6 +799,9 @@ void QLowEnergyService::readCharacteristic(
 
     \note The \a mode argument is ignored in peripheral mode.
 
+    Between \l beginUpdate() and \l commitUpdate() the new value is only applied
+    when the update is committed.
+
     \sa QLowEnergyService::characteristicWritten(), QLowEnergyService::readCharacteristic()
 
  */
@@ -759,11 +820,212 @@ void QLowEnergyService::writeCharacteristic(
         return;
     }
 
+    if (d->updateDepth > 0 && d->controller->role == QLowEnergyController::PeripheralRole) {
+        // applied by commitUpdate(), only the latest value of a characteristic matters
+        const QLowEnergyHandle charHandle = characteristic.attributeHandle();
+        for (auto &update : d->pendingUpdates) {
+            if (update.first == charHandle) {
+                update.second = newValue;
+                return;
+            }
+        }
+        d->pendingUpdates.append({ charHandle, newValue });
+        return;
+    }
+
     // don't write if properties don't permit it
-    d->controller->writeCharacteristic(characteristic.d_ptr,
-                                       characteristic.attributeHandle(),
-                                       newValue,
-                                       mode);
+    const QLowEnergyHandle charHandle = characteristic.attributeHandle();
+    const bool dispatched = d->dispatch([&]() {
+        d->controller->writeCharacteristic(characteristic.d_ptr, charHandle, newValue, mode);
+    });
+    if (dispatched && d->controller->role == QLowEnergyController::CentralRole
+            && mode == WriteWithResponse) {
+        d->trackOperation(QLowEnergyServicePrivate::Operation::WriteCharacteristic, charHandle);
+    }
+}
+
+/*!
+    Writes \a newValue as value for the \a characteristic using a long write.
+
+    In the central role, the value is split into parts that fit into the
+    current MTU. The parts are sent back-to-back as prepare write requests and
+    committed with a single execute write request. The remote device echoes
+    every part, and the echo is verified. A mismatch or error cancels the
+    whole write and sets \l CharacteristicWriteError. Progress is reported via
+    \l characteristicWriteProgress() and completion via
+    \l characteristicWritten().
+
+    Values longer than 512 bytes, the maximum length of an attribute value,
+    are rejected with \l CharacteristicWriteError before anything is sent.
+
+    The same preconditions as for \l writeCharacteristic() apply. Backends without
+    support for prepare write requests, as well as the peripheral role, fall back
+    to \l writeCharacteristic() with \l WriteWithResponse.
+
+    \sa characteristicWriteProgress(), writeCharacteristic()
+    \since 6.3
+ */
+void QLowEnergyService::writeCharacteristicLong(const QLowEnergyCharacteristic &characteristic,
+                                                const QByteArray &newValue)
+{
+    Q_D(QLowEnergyService);
+
+    if (d->controller == nullptr
+            || (d->controller->role == QLowEnergyController::CentralRole
+                && state() != RemoteServiceDiscovered)
+            || !contains(characteristic)) {
+        d->setError(QLowEnergyService::OperationError);
+        return;
+    }
+
+    const QLowEnergyHandle charHandle = characteristic.attributeHandle();
+    const bool dispatched = d->dispatch([&]() {
+        d->controller->writeCharacteristicLong(characteristic.d_ptr, charHandle, newValue);
+    });
+    if (dispatched && d->controller->role == QLowEnergyController::CentralRole)
+        d->trackOperation(QLowEnergyServicePrivate::Operation::WriteCharacteristic, charHandle);
+}
+
+/*!
+    Reads the value of \a characteristic and returns a future which receives
+    the value.
+
+    This function works like \l readCharacteristic(), except that the result is
+    delivered to the returned future only. Any number of requests may be
+    outstanding at the same time, each future receives the result of its own
+    request. The requests are queued by the controller like all other requests
+    to the remote device. \l characteristicRead() is still emitted.
+
+    If the preconditions of \l readCharacteristic() are not met, or the read
+    fails, the future is canceled and \l error() reports the reason. Pending
+    futures are canceled when the service becomes invalid, for example because
+    the connection was lost.
+
+    \snippet doc_src_qtbluetooth.cpp asyncRead
+
+    \sa readCharacteristic(), writeCharacteristicAsync(), readDescriptorAsync()
+    \since 6.3
+ */
+QFuture<QByteArray> QLowEnergyService::readCharacteristicAsync(
+        const QLowEnergyCharacteristic &characteristic)
+{
+    Q_D(QLowEnergyService);
+
+    if (d->controller == nullptr || state() != RemoteServiceDiscovered || !contains(characteristic)) {
+        d->setError(QLowEnergyService::OperationError);
+        return QLowEnergyServicePrivate::failedOperation();
+    }
+
+    const QLowEnergyHandle charHandle = characteristic.attributeHandle();
+    if (!d->dispatch([&]() { d->controller->readCharacteristic(characteristic.d_ptr, charHandle); }))
+        return QLowEnergyServicePrivate::failedOperation();
+    return d->trackOperation(QLowEnergyServicePrivate::Operation::ReadCharacteristic, charHandle,
+                             true);
+}
+
+/*!
+    Writes \a newValue as value for the \a characteristic using the given
+    write \a mode and returns a future which finishes once the write is done.
+
+    In the central role with \l WriteWithResponse, the future finishes when the
+    remote device has confirmed the write. Writes which are not confirmed, as
+    well as writes in the peripheral role, finish the future as soon as the
+    value has been handed over. Values which do not fit into a single packet are
+    written as in \l writeCharacteristic().
+
+    If the preconditions of \l writeCharacteristic() are not met, or the write
+    fails, the future is canceled and \l error() reports the reason.
+
+    \sa writeCharacteristic(), readCharacteristicAsync(), writeDescriptorAsync()
+    \since 6.3
+ */
+QFuture<void> QLowEnergyService::writeCharacteristicAsync(
+        const QLowEnergyCharacteristic &characteristic, const QByteArray &newValue,
+        QLowEnergyService::WriteMode mode)
+{
+    Q_D(QLowEnergyService);
+
+    if (d->controller == nullptr
+            || (d->controller->role == QLowEnergyController::CentralRole
+                && state() != RemoteServiceDiscovered)
+            || !contains(characteristic)) {
+        d->setError(QLowEnergyService::OperationError);
+        return QLowEnergyServicePrivate::failedOperation();
+    }
+
+    if (d->controller->role == QLowEnergyController::PeripheralRole) {
+        writeCharacteristic(characteristic, newValue, mode);
+        return QtFuture::makeReadyFuture();
+    }
+
+    const QLowEnergyHandle charHandle = characteristic.attributeHandle();
+    if (!d->dispatch([&]() {
+            d->controller->writeCharacteristic(characteristic.d_ptr, charHandle, newValue, mode);
+        })) {
+        return QLowEnergyServicePrivate::failedOperation();
+    }
+    if (mode != WriteWithResponse)
+        return QtFuture::makeReadyFuture();
+    return d->trackOperation(QLowEnergyServicePrivate::Operation::WriteCharacteristic, charHandle,
+                             true);
+}
+
+/*!
+    Starts collecting value changes of this service's characteristics.
+
+    In the peripheral role, subsequent calls to \l writeCharacteristic() do not
+    update the local database right away. The new values are collected until the
+    matching \l commitUpdate() call, which applies all of them in one pass. If a
+    characteristic is written several times, only the last value is applied. The
+    resulting notifications and indications are sent afterwards as one burst,
+    in the order in which the characteristics were first written.
+
+    Calls may be nested; the changes are applied by the outermost \l commitUpdate().
+
+    \note This function has no effect on services in the central role.
+
+    \sa commitUpdate(), isUpdating()
+    \since 6.3
+ */
+void QLowEnergyService::beginUpdate()
+{
+    Q_D(QLowEnergyService);
+    ++d->updateDepth;
+}
+
+/*!
+    Applies the value changes collected since the matching \l beginUpdate() call.
+
+    \sa beginUpdate(), isUpdating()
+    \since 6.3
+ */
+void QLowEnergyService::commitUpdate()
+{
+    Q_D(QLowEnergyService);
+
+    if (d->updateDepth == 0) {
+        qCWarning(QT_BT) << "QLowEnergyService::commitUpdate() called without beginUpdate()";
+        return;
+    }
+
+    if (--d->updateDepth > 0)
+        return;
+
+    const QList<QPair<QLowEnergyHandle, QByteArray>> updates = qExchange(d->pendingUpdates, {});
+    if (!updates.isEmpty() && d->controller)
+        d->controller->writeCharacteristics(d_ptr, updates);
+}
+
+/*!
+    Returns \c true if value changes are being collected between \l beginUpdate()
+    and \l commitUpdate(); otherwise \c false.
+
+    \since 6.3
+ */
+bool QLowEnergyService::isUpdating() const
+{
+    Q_D(const QLowEnergyService);
+    return d->updateDepth > 0;
 }
 
 /*!
@@ -815,9 +1077,13 @@ void QLowEnergyService::readDescriptor(
         return;
     }
 
-    d->controller->readDescriptor(descriptor.d_ptr,
-                                  descriptor.characteristicHandle(),
-                                  descriptor.handle());
+    const QLowEnergyHandle descriptorHandle = descriptor.handle();
+    const bool dispatched = d->dispatch([&]() {
+        d->controller->readDescriptor(descriptor.d_ptr, descriptor.characteristicHandle(),
+                                      descriptorHandle);
+    });
+    if (dispatched)
+        d->trackOperation(QLowEnergyServicePrivate::Operation::ReadDescriptor, descriptorHandle);
 }
 
 /*!
@@ -859,26 +1125,141 @@ void QLowEnergyService::writeDescriptor(const QLowEnergyDescriptor &descriptor,
         d->setError(QLowEnergyService::OperationError);
         return;
     }
-#ifdef Q_OS_DARWIN
-    if (descriptor.uuid() == QBluetoothUuid::DescriptorType::ClientCharacteristicConfiguration) {
-        // We have to identify a special case - ClientCharacteristicConfiguration
-        // since with CoreBluetooth:
-        //
-        // "You cannot use this method to write the value of a client configuration descriptor
-        // (represented by the CBUUIDClientCharacteristicConfigurationString constant),
-        // which describes how notification or indications are configured for a
-        // characteristic’s value with respect to a client. If you want to manage
-        // notifications or indications for a characteristic’s value, you must
-        // use the setNotifyValue:forCharacteristic: method instead."
-        auto controller = static_cast<QLowEnergyControllerPrivateDarwin *>(d->controller.data());
-        return controller->setNotifyValue(descriptor.d_ptr, descriptor.characteristicHandle(), newValue);
+
+    const bool dispatched = d->dispatch([&]() { d->writeDescriptor(descriptor, newValue); });
+    if (dispatched && d->controller->role == QLowEnergyController::CentralRole) {
+        d->trackOperation(QLowEnergyServicePrivate::Operation::WriteDescriptor,
+                          descriptor.handle());
     }
-#endif // Q_OS_DARWIN
+}
+
+/*!
+    Reads the value of \a descriptor and returns a future which receives the
+    value.
 
-    d->controller->writeDescriptor(descriptor.d_ptr,
-                                   descriptor.characteristicHandle(),
-                                   descriptor.handle(),
-                                   newValue);
+    This function works like \l readDescriptor(), except that the result is
+    delivered to the returned future only. \l descriptorRead() is still emitted.
+    If the preconditions of \l readDescriptor() are not met, or the read fails,
+    the future is canceled and \l error() reports the reason.
+
+    \sa readDescriptor(), readCharacteristicAsync()
+    \since 6.3
+ */
+QFuture<QByteArray> QLowEnergyService::readDescriptorAsync(const QLowEnergyDescriptor &descriptor)
+{
+    Q_D(QLowEnergyService);
+
+    if (d->controller == nullptr || state() != RemoteServiceDiscovered || !contains(descriptor)) {
+        d->setError(QLowEnergyService::OperationError);
+        return QLowEnergyServicePrivate::failedOperation();
+    }
+
+    const QLowEnergyHandle descriptorHandle = descriptor.handle();
+    const bool dispatched = d->dispatch([&]() {
+        d->controller->readDescriptor(descriptor.d_ptr, descriptor.characteristicHandle(),
+                                      descriptorHandle);
+    });
+    if (!dispatched)
+        return QLowEnergyServicePrivate::failedOperation();
+    return d->trackOperation(QLowEnergyServicePrivate::Operation::ReadDescriptor,
+                             descriptorHandle, true);
+}
+
+/*!
+    Writes \a newValue as value for \a descriptor and returns a future which
+    finishes once the write is done.
+
+    In the central role, the future finishes when the remote device has
+    confirmed the write. In the peripheral role, it finishes as soon as the
+    local service database has been updated. If the preconditions of
+    \l writeDescriptor() are not met, or the write fails, the future is canceled
+    and \l error() reports the reason.
+
+    \sa writeDescriptor(), writeCharacteristicAsync()
+    \since 6.3
+ */
+QFuture<void> QLowEnergyService::writeDescriptorAsync(const QLowEnergyDescriptor &descriptor,
+                                                      const QByteArray &newValue)
+{
+    Q_D(QLowEnergyService);
+
+    if (d->controller == nullptr
+            || (d->controller->role == QLowEnergyController::CentralRole
+            && state() != RemoteServiceDiscovered)
+        || !contains(descriptor)) {
+        d->setError(QLowEnergyService::OperationError);
+        return QLowEnergyServicePrivate::failedOperation();
+    }
+
+    if (!d->dispatch([&]() { d->writeDescriptor(descriptor, newValue); }))
+        return QLowEnergyServicePrivate::failedOperation();
+    if (d->controller->role == QLowEnergyController::PeripheralRole)
+        return QtFuture::makeReadyFuture();
+    return d->trackOperation(QLowEnergyServicePrivate::Operation::WriteDescriptor,
+                             descriptor.handle(), true);
+}
+
+/*!
+    Enables batched delivery of remote characteristic notifications and indications
+    for this service.
+
+    Instead of emitting \l characteristicChanged() for every received value, the
+    values are timestamped and stored in a ring buffer with room for \a capacity
+    entries. The buffer is flushed via \l characteristicChangedBatch() at most
+    \a flushInterval milliseconds after the first buffered value arrived, or
+    immediately when the ring is full. No values are dropped.
+
+    The ring is allocated once by this call, so high-rate peripherals such as
+    inertial sensors do not cause per-notification signal emissions.
+    \a options controls whether the characteristic value cache is still updated.
+
+    Calling this function again flushes pending values and applies the new
+    settings. A \a flushInterval or \a capacity less than or equal to zero
+    disables batching.
+
+    \note Batching is currently only supported by the BlueZ backends.
+    \note This function has no effect on services in the peripheral role.
+
+    \sa disableNotificationBatching(), characteristicChangedBatch()
+    \since 6.3
+ */
+void QLowEnergyService::setNotificationBatching(int flushInterval, int capacity,
+                                                NotificationBatchingOptions options)
+{
+    Q_D(QLowEnergyService);
+
+    if (flushInterval <= 0 || capacity <= 0) {
+        d->disableNotificationBatching();
+        return;
+    }
+
+    d->setNotificationBatching(flushInterval, capacity, options);
+}
+
+/*!
+    Disables batched notification delivery. Values that are still buffered
+    are delivered via \l characteristicChangedBatch() before this function returns.
+    Afterwards, \l characteristicChanged() is emitted for each notification again.
+
+    \sa setNotificationBatching()
+    \since 6.3
+ */
+void QLowEnergyService::disableNotificationBatching()
+{
+    Q_D(QLowEnergyService);
+    d->disableNotificationBatching();
+}
+
+/*!
+    Returns \c true if notification batching is enabled; otherwise \c false.
+
+    \sa setNotificationBatching()
+    \since 6.3
+ */
+bool QLowEnergyService::isNotificationBatchingEnabled() const
+{
+    Q_D(const QLowEnergyService);
+    return d->isNotificationBatchingEnabled();
 }
 
 QT_END_NAMESPACE
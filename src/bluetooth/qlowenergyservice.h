@@ -43,6 +43,7 @@
 #include <QtBluetooth/QBluetoothAddress>
 #include <QtBluetooth/QBluetoothUuid>
 #include <QtBluetooth/QLowEnergyCharacteristic>
+#include <QtCore/QFuture>
 
 QT_BEGIN_NAMESPACE
 
@@ -107,6 +108,13 @@ public:
     };
     Q_ENUM(WriteMode)
 
+    enum NotificationBatchingOption {
+        DefaultBatching = 0x0000,
+        SkipValueCacheUpdate = 0x0001
+    };
+    Q_ENUM(NotificationBatchingOption)
+    Q_DECLARE_FLAGS(NotificationBatchingOptions, NotificationBatchingOption)
+
     ~QLowEnergyService();
 
     QList<QBluetoothUuid> includedServices() const;
@@ -128,20 +136,45 @@ public:
     void writeCharacteristic(const QLowEnergyCharacteristic &characteristic,
                              const QByteArray &newValue,
                              WriteMode mode = WriteWithResponse);
+    void writeCharacteristicLong(const QLowEnergyCharacteristic &characteristic,
+                                 const QByteArray &newValue);
+
+    QFuture<QByteArray> readCharacteristicAsync(const QLowEnergyCharacteristic &characteristic);
+    QFuture<void> writeCharacteristicAsync(const QLowEnergyCharacteristic &characteristic,
+                                           const QByteArray &newValue,
+                                           WriteMode mode = WriteWithResponse);
+
+    void beginUpdate();
+    void commitUpdate();
+    bool isUpdating() const;
 
     bool contains(const QLowEnergyDescriptor &descriptor) const;
     void readDescriptor(const QLowEnergyDescriptor &descriptor);
     void writeDescriptor(const QLowEnergyDescriptor &descriptor,
                          const QByteArray &newValue);
 
+    QFuture<QByteArray> readDescriptorAsync(const QLowEnergyDescriptor &descriptor);
+    QFuture<void> writeDescriptorAsync(const QLowEnergyDescriptor &descriptor,
+                                       const QByteArray &newValue);
+
+    void setNotificationBatching(int flushInterval, int capacity = 256,
+                                 NotificationBatchingOptions options = DefaultBatching);
+    void disableNotificationBatching();
+    bool isNotificationBatchingEnabled() const;
+
 Q_SIGNALS:
     void stateChanged(QLowEnergyService::ServiceState newState);
     void characteristicChanged(const QLowEnergyCharacteristic &info,
                                const QByteArray &value);
+    void characteristicChangedBatch(const QLowEnergyCharacteristic &info,
+                                    const QList<QByteArray> &values,
+                                    const QList<qint64> &timestamps);
     void characteristicRead(const QLowEnergyCharacteristic &info,
                             const QByteArray &value);
     void characteristicWritten(const QLowEnergyCharacteristic &info,
                                const QByteArray &value);
+    void characteristicWriteProgress(const QLowEnergyCharacteristic &info,
+                                     qsizetype bytesWritten, qsizetype totalBytes);
     void descriptorRead(const QLowEnergyDescriptor &info,
                         const QByteArray &value);
     void descriptorWritten(const QLowEnergyDescriptor &info,
@@ -163,6 +196,7 @@ private:
 };
 
 Q_DECLARE_OPERATORS_FOR_FLAGS(QLowEnergyService::ServiceTypes)
+Q_DECLARE_OPERATORS_FOR_FLAGS(QLowEnergyService::NotificationBatchingOptions)
 
 QT_END_NAMESPACE
 
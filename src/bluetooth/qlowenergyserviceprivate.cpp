@@ -41,12 +41,43 @@
 
 #include "qlowenergycontrollerbase_p.h"
 
+#ifdef Q_OS_DARWIN
+#include "qlowenergycontroller_darwin_p.h"
+#endif // Q_OS_DARWIN
+
+#include <QtCore/QDateTime>
+#include <QtCore/QVarLengthArray>
+
+#include <algorithm>
+#include <utility>
+
 QT_BEGIN_NAMESPACE
 
-QLowEnergyServicePrivate::QLowEnergyServicePrivate(QObject *parent) : QObject(parent) { }
+QLowEnergyServicePrivate::QLowEnergyServicePrivate(QObject *parent) : QObject(parent)
+{
+    // Completes the futures of the asynchronous API. Connected before any
+    // QLowEnergyService, so a future is finished when the signal arrives there.
+    connect(this, &QLowEnergyServicePrivate::characteristicRead,
+            this, [this](const QLowEnergyCharacteristic &characteristic, const QByteArray &value) {
+        completeOperation(Operation::ReadCharacteristic, characteristic.attributeHandle(), value);
+    });
+    connect(this, &QLowEnergyServicePrivate::characteristicWritten,
+            this, [this](const QLowEnergyCharacteristic &characteristic, const QByteArray &value) {
+        completeOperation(Operation::WriteCharacteristic, characteristic.attributeHandle(), value);
+    });
+    connect(this, &QLowEnergyServicePrivate::descriptorRead,
+            this, [this](const QLowEnergyDescriptor &descriptor, const QByteArray &value) {
+        completeOperation(Operation::ReadDescriptor, descriptor.handle(), value);
+    });
+    connect(this, &QLowEnergyServicePrivate::descriptorWritten,
+            this, [this](const QLowEnergyDescriptor &descriptor, const QByteArray &value) {
+        completeOperation(Operation::WriteDescriptor, descriptor.handle(), value);
+    });
+}
 
 QLowEnergyServicePrivate::~QLowEnergyServicePrivate()
 {
+    failAllOperations();
 }
 
 void QLowEnergyServicePrivate::setController(QLowEnergyControllerPrivate *control)
@@ -62,6 +93,28 @@ void QLowEnergyServicePrivate::setController(QLowEnergyControllerPrivate *contro
 void QLowEnergyServicePrivate::setError(QLowEnergyService::ServiceError newError)
 {
     lastError = newError;
+
+    if (dispatching) {
+        dispatchFailed = true;
+    } else {
+        switch (newError) {
+        case QLowEnergyService::CharacteristicReadError:
+            failOperation(Operation::ReadCharacteristic);
+            break;
+        case QLowEnergyService::CharacteristicWriteError:
+            failOperation(Operation::WriteCharacteristic);
+            break;
+        case QLowEnergyService::DescriptorReadError:
+            failOperation(Operation::ReadDescriptor);
+            break;
+        case QLowEnergyService::DescriptorWriteError:
+            failOperation(Operation::WriteDescriptor);
+            break;
+        default:
+            break;
+        }
+    }
+
     emit errorOccurred(newError);
 }
 
@@ -70,8 +123,232 @@ void QLowEnergyServicePrivate::setState(QLowEnergyService::ServiceState newState
     if (state == newState)
         return;
 
+    // deliver whatever is still buffered before the service goes away
+    if (newState == QLowEnergyService::InvalidService) {
+        flushNotifications();
+        failAllOperations();
+    }
+
     state = newState;
     emit stateChanged(newState);
 }
 
+void QLowEnergyServicePrivate::setNotificationBatching(
+        int flushInterval, int capacity, QLowEnergyService::NotificationBatchingOptions options)
+{
+    flushNotifications();
+
+    batchFlushInterval = flushInterval;
+    batchOptions = options;
+
+    notificationRing.clear();
+    notificationRing.resize(capacity);
+    ringHead = 0;
+    ringCount = 0;
+
+    if (!batchTimer) {
+        batchTimer = new QTimer(this);
+        batchTimer->setSingleShot(true);
+        batchTimer->setTimerType(Qt::PreciseTimer);
+        connect(batchTimer, &QTimer::timeout,
+                this, &QLowEnergyServicePrivate::flushNotifications);
+    }
+    batchTimer->setInterval(flushInterval);
+}
+
+void QLowEnergyServicePrivate::disableNotificationBatching()
+{
+    flushNotifications();
+
+    batchFlushInterval = 0;
+    batchOptions = QLowEnergyService::DefaultBatching;
+    notificationRing.clear();
+    notificationRing.squeeze();
+    ringHead = 0;
+    ringCount = 0;
+}
+
+/*
+    Stores \a value in the next free ring slot. The slots are preallocated by
+    setNotificationBatching(); a full ring is flushed synchronously rather than
+    dropping the oldest entries.
+ */
+void QLowEnergyServicePrivate::enqueueNotification(QLowEnergyHandle charHandle,
+                                                   const QByteArray &value)
+{
+    Q_ASSERT(isNotificationBatchingEnabled());
+
+    if (ringCount == notificationRing.size())
+        flushNotifications();
+
+    BatchedNotification &slot = notificationRing[(ringHead + ringCount) % notificationRing.size()];
+    slot.charHandle = charHandle;
+    slot.timestamp = QDateTime::currentMSecsSinceEpoch();
+    slot.value = value;
+    ++ringCount;
+
+    if (!batchTimer->isActive())
+        batchTimer->start();
+}
+
+/*
+    Emits one characteristicChangedBatch() per characteristic that received
+    notifications since the last flush. The order of values within a
+    characteristic is preserved.
+ */
+void QLowEnergyServicePrivate::flushNotifications()
+{
+    if (batchTimer)
+        batchTimer->stop();
+
+    if (ringCount == 0)
+        return;
+
+    QVarLengthArray<QLowEnergyHandle, 8> handles;
+    for (qsizetype i = 0; i < ringCount; ++i) {
+        const QLowEnergyHandle h =
+                notificationRing.at((ringHead + i) % notificationRing.size()).charHandle;
+        if (!handles.contains(h))
+            handles.append(h);
+    }
+
+    // copy out before emitting, a slot may re-enter enqueueNotification()
+    struct Batch {
+        QList<QByteArray> values;
+        QList<qint64> timestamps;
+    };
+    QVarLengthArray<Batch, 8> batches(handles.size());
+    for (qsizetype i = 0; i < ringCount; ++i) {
+        BatchedNotification &entry = notificationRing[(ringHead + i) % notificationRing.size()];
+        Batch &batch = batches[handles.indexOf(entry.charHandle)];
+        batch.values.append(std::move(entry.value));
+        batch.timestamps.append(entry.timestamp);
+    }
+    ringHead = 0;
+    ringCount = 0;
+
+    for (qsizetype i = 0; i < handles.size(); ++i) {
+        if (!characteristicList.contains(handles.at(i)))
+            continue;
+        emit characteristicChangedBatch(handles.at(i), batches.at(i).values,
+                                        batches.at(i).timestamps);
+    }
+}
+
+void QLowEnergyServicePrivate::writeDescriptor(const QLowEnergyDescriptor &descriptor,
+                                               const QByteArray &newValue)
+{
+#ifdef Q_OS_DARWIN
+    if (descriptor.uuid() == QBluetoothUuid::DescriptorType::ClientCharacteristicConfiguration) {
+        // We have to identify a special case - ClientCharacteristicConfiguration
+        // since with CoreBluetooth:
+        //
+        // "You cannot use this method to write the value of a client configuration descriptor
+        // (represented by the CBUUIDClientCharacteristicConfigurationString constant),
+        // which describes how notification or indications are configured for a
+        // characteristic’s value with respect to a client. If you want to manage
+        // notifications or indications for a characteristic’s value, you must
+        // use the setNotifyValue:forCharacteristic: method instead."
+        auto darwinController = static_cast<QLowEnergyControllerPrivateDarwin *>(controller.data());
+        return darwinController->setNotifyValue(descriptor.d_ptr, descriptor.characteristicHandle(),
+                                                newValue);
+    }
+#endif // Q_OS_DARWIN
+
+    controller->writeDescriptor(descriptor.d_ptr,
+                                descriptor.characteristicHandle(),
+                                descriptor.handle(),
+                                newValue);
+}
+
+/*
+    Appends a request which was handed to the controller. Only requests
+    created by the asynchronous API (\a withResult) get a future.
+ */
+QFuture<QByteArray> QLowEnergyServicePrivate::trackOperation(Operation operation,
+                                                             QLowEnergyHandle handle,
+                                                             bool withResult)
+{
+    PendingOperation pending;
+    pending.operation = operation;
+    pending.handle = handle;
+    QFuture<QByteArray> future;
+    if (withResult) {
+        pending.promise.emplace();
+        pending.promise->start();
+        future = pending.promise->future();
+    }
+    pendingOperations.push_back(std::move(pending));
+    return future;
+}
+
+/*
+    The controller finishes the requests to one device in the order they were
+    made. Results for attributes without tracked request, for example the write
+    of a client characteristic configuration descriptor by a remote client in
+    the peripheral role, are ignored.
+ */
+void QLowEnergyServicePrivate::completeOperation(Operation operation, QLowEnergyHandle handle,
+                                                 const QByteArray &value)
+{
+    if (pendingOperations.empty())
+        return;
+
+    const auto it = std::find_if(pendingOperations.begin(), pendingOperations.end(),
+                                 [operation, handle](const PendingOperation &pending) {
+        return pending.operation == operation && pending.handle == handle;
+    });
+    if (it == pendingOperations.end())
+        return;
+
+    // a continuation of the future may issue the next request right away
+    PendingOperation finished = std::move(*it);
+    pendingOperations.erase(it);
+    if (finished.promise) {
+        finished.promise->addResult(value);
+        finished.promise->finish();
+    }
+}
+
+/*
+    Error reports do not carry the attribute, the oldest request of the
+    same kind is the one which failed.
+ */
+void QLowEnergyServicePrivate::failOperation(Operation operation)
+{
+    const auto it = std::find_if(pendingOperations.begin(), pendingOperations.end(),
+                                 [operation](const PendingOperation &pending) {
+        return pending.operation == operation;
+    });
+    if (it == pendingOperations.end())
+        return;
+
+    PendingOperation failed = std::move(*it);
+    pendingOperations.erase(it);
+    if (failed.promise) {
+        failed.promise->future().cancel();
+        failed.promise->finish();
+    }
+}
+
+void QLowEnergyServicePrivate::failAllOperations()
+{
+    std::deque<PendingOperation> failed = std::exchange(pendingOperations, {});
+    for (PendingOperation &pending : failed) {
+        if (pending.promise) {
+            pending.promise->future().cancel();
+            pending.promise->finish();
+        }
+    }
+}
+
+QFuture<QByteArray> QLowEnergyServicePrivate::failedOperation()
+{
+    QPromise<QByteArray> promise;
+    promise.start();
+    promise.future().cancel();
+    promise.finish();
+    return promise.future();
+}
+
 QT_END_NAMESPACE
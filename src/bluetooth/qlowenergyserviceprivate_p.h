@@ -51,8 +51,11 @@
 // We mean it.
 //
 
+#include <QtCore/QFuture>
 #include <QtCore/QObject>
 #include <QtCore/QPointer>
+#include <QtCore/QPromise>
+#include <QtCore/QTimer>
 #include <QtBluetooth/qbluetooth.h>
 #include <QtBluetooth/QLowEnergyService>
 #include <QtBluetooth/QLowEnergyCharacteristic>
@@ -61,6 +64,9 @@
 #include <QtCore/QJniObject>
 #endif
 
+#include <deque>
+#include <optional>
+
 QT_BEGIN_NAMESPACE
 
 class QLowEnergyControllerPrivate;
@@ -96,15 +102,65 @@ public:
     void setError(QLowEnergyService::ServiceError newError);
     void setState(QLowEnergyService::ServiceState newState);
 
+    void setNotificationBatching(int flushInterval, int capacity,
+                                 QLowEnergyService::NotificationBatchingOptions options);
+    void disableNotificationBatching();
+    bool isNotificationBatchingEnabled() const { return batchFlushInterval > 0; }
+    bool skipsValueCacheUpdate() const
+    {
+        return isNotificationBatchingEnabled()
+                && batchOptions.testFlag(QLowEnergyService::SkipValueCacheUpdate);
+    }
+    void enqueueNotification(QLowEnergyHandle charHandle, const QByteArray &value);
+    void flushNotifications();
+
+    struct BatchedNotification {
+        QLowEnergyHandle charHandle = 0;
+        qint64 timestamp = 0;
+        QByteArray value;
+    };
+
+    enum class Operation {
+        ReadCharacteristic,
+        WriteCharacteristic,
+        ReadDescriptor,
+        WriteDescriptor
+    };
+
+    // Hands a request to the controller. Errors the controller reports while
+    // doing so belong to this request; returns false if there were any.
+    template <typename Dispatch>
+    bool dispatch(Dispatch &&dispatchRequest)
+    {
+        dispatchFailed = false;
+        dispatching = true;
+        dispatchRequest();
+        dispatching = false;
+        return !dispatchFailed;
+    }
+    QFuture<QByteArray> trackOperation(Operation operation, QLowEnergyHandle handle,
+                                       bool withResult = false);
+    void completeOperation(Operation operation, QLowEnergyHandle handle,
+                           const QByteArray &value);
+    void failOperation(Operation operation);
+    void failAllOperations();
+    void writeDescriptor(const QLowEnergyDescriptor &descriptor, const QByteArray &newValue);
+    static QFuture<QByteArray> failedOperation();
+
 signals:
     void stateChanged(QLowEnergyService::ServiceState newState);
     void errorOccurred(QLowEnergyService::ServiceError error);
     void characteristicChanged(const QLowEnergyCharacteristic &characteristic,
                                const QByteArray &newValue);
+    void characteristicChangedBatch(QLowEnergyHandle charHandle,
+                                    const QList<QByteArray> &values,
+                                    const QList<qint64> &timestamps);
     void characteristicRead(const QLowEnergyCharacteristic &info,
                             const QByteArray &value);
     void characteristicWritten(const QLowEnergyCharacteristic &characteristic,
                                const QByteArray &newValue);
+    void characteristicWriteProgress(const QLowEnergyCharacteristic &characteristic,
+                                     qsizetype bytesWritten, qsizetype totalBytes);
     void descriptorRead(const QLowEnergyDescriptor &info,
                         const QByteArray &value);
     void descriptorWritten(const QLowEnergyDescriptor &descriptor,
@@ -125,6 +181,30 @@ public:
 
     QPointer<QLowEnergyControllerPrivate> controller;
 
+    // peripheral role value changes collected between beginUpdate() and commitUpdate(),
+    // one entry per characteristic in the order of the first change
+    int updateDepth = 0;
+    QList<QPair<QLowEnergyHandle, QByteArray>> pendingUpdates;
+
+    // ring buffer for batched notification delivery, allocated once when batching is enabled
+    QList<BatchedNotification> notificationRing;
+    qsizetype ringHead = 0;
+    qsizetype ringCount = 0;
+    int batchFlushInterval = 0;
+    QLowEnergyService::NotificationBatchingOptions batchOptions;
+    QTimer *batchTimer = nullptr;
+
+    // Central role requests in the order the controller serialises them. The
+    // signal based API has no promise, its entries keep the order intact.
+    struct PendingOperation {
+        Operation operation;
+        QLowEnergyHandle handle = 0;
+        std::optional<QPromise<QByteArray>> promise;
+    };
+    std::deque<PendingOperation> pendingOperations;
+    bool dispatching = false;
+    bool dispatchFailed = false;
+
 #if defined(QT_ANDROID_BLUETOOTH)
     // reference to the BluetoothGattService object
     QJniObject androidService;
@@ -40,6 +40,8 @@
 #include "qndefmessage.h"
 #include "qndefrecord_p.h"
 
+#include <qtnfc_tracepoints_p.h>
+
 QT_BEGIN_NAMESPACE
 
 /*!
@@ -93,6 +95,8 @@ QT_BEGIN_NAMESPACE
 */
 QNdefMessage QNdefMessage::fromByteArray(const QByteArray &message)
 {
+    Q_TRACE_SCOPE(QNdefMessage_fromByteArray, qint64(message.size()));
+
     QNdefMessage result;
 
     bool seenMessageBegin = false;
@@ -307,6 +311,8 @@ QByteArray QNdefMessage::toByteArray() const
     if (isEmpty())
         return QNdefMessage(QNdefRecord()).toByteArray();
 
+    Q_TRACE_SCOPE(QNdefMessage_toByteArray, int(size()));
+
     QByteArray m;
 
     for (int i = 0; i < count(); ++i) {
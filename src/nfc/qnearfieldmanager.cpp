@@ -46,6 +46,8 @@
 #include "qnearfieldmanager_android_p.h"
 #elif defined(IOS_NFC)
 #include "qnearfieldmanager_ios_p.h"
+#elif defined(NEARD_NFC)
+#include "qnearfieldmanager_neard_p.h"
 #else
 #include "qnearfieldmanager_generic_p.h"
 #endif
@@ -0,0 +1,313 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtNfc module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#include "qnearfieldmanager_neard_p.h"
+
+#include <QtCore/QDebug>
+#include <QtDBus/QDBusArgument>
+#include <QtDBus/QDBusMessage>
+#include <QtDBus/QDBusPendingCallWatcher>
+#include <QtDBus/QDBusPendingReply>
+#include <QtDBus/QDBusReply>
+
+QT_BEGIN_NAMESPACE
+
+static const QLatin1String objectManagerInterface("org.freedesktop.DBus.ObjectManager");
+static const QLatin1String propertiesInterface("org.freedesktop.DBus.Properties");
+static const QLatin1String adapterInterface("org.neard.Adapter");
+static const QLatin1String tagInterface("org.neard.Tag");
+static const QLatin1String recordInterface("org.neard.Record");
+
+QNearFieldManagerPrivateImpl::QNearFieldManagerPrivateImpl()
+    : bus(QNeard::bus())
+{
+    QNeard::registerMetaTypes();
+    qRegisterMetaType<QNdefMessage>();
+
+    bus.connect(QNeard::service(), QStringLiteral("/"), objectManagerInterface,
+                QStringLiteral("InterfacesAdded"),
+                this, SLOT(handleInterfacesAdded(QDBusMessage)));
+    bus.connect(QNeard::service(), QStringLiteral("/"), objectManagerInterface,
+                QStringLiteral("InterfacesRemoved"),
+                this, SLOT(handleInterfacesRemoved(QDBusMessage)));
+
+    initAdapter();
+}
+
+QNearFieldManagerPrivateImpl::~QNearFieldManagerPrivateImpl()
+{
+    if (detecting)
+        stopPollLoop();
+
+    for (const auto &target : qAsConst(detectedTargets)) {
+        if (target)
+            target->invalidate();
+    }
+}
+
+bool QNearFieldManagerPrivateImpl::isEnabled() const
+{
+    return !adapterPath.isEmpty() && adapterPowered;
+}
+
+bool QNearFieldManagerPrivateImpl::isSupported(QNearFieldTarget::AccessMethod accessMethod) const
+{
+    if (adapterPath.isEmpty())
+        return false;
+
+    switch (accessMethod) {
+    case QNearFieldTarget::NdefAccess:
+    case QNearFieldTarget::TagTypeSpecificAccess:
+    case QNearFieldTarget::AnyAccess:
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool QNearFieldManagerPrivateImpl::startTargetDetection(QNearFieldTarget::AccessMethod accessMethod)
+{
+    if (detecting)
+        return false;   // Already detecting targets
+
+    if (!isEnabled() || !isSupported(accessMethod))
+        return false;
+
+    detecting = true;
+    requestedMethod = accessMethod;
+    startPollLoop();
+    return true;
+}
+
+void QNearFieldManagerPrivateImpl::stopTargetDetection(const QString &)
+{
+    if (!detecting)
+        return;
+
+    detecting = false;
+    stopPollLoop();
+    Q_EMIT targetDetectionStopped();
+}
+
+void QNearFieldManagerPrivateImpl::handleInterfacesAdded(const QDBusMessage &message)
+{
+    const QList<QVariant> arguments = message.arguments();
+    if (arguments.size() < 2)
+        return;
+
+    const QString path = qdbus_cast<QDBusObjectPath>(arguments.at(0)).path();
+    const NeardInterfaceList interfaces = qdbus_cast<NeardInterfaceList>(arguments.at(1));
+
+    if (interfaces.contains(adapterInterface) && adapterPath.isEmpty()) {
+        setAdapter(path, interfaces.value(adapterInterface));
+        return;
+    }
+
+    if (interfaces.contains(tagInterface)) {
+        addTarget(path, interfaces.value(tagInterface));
+        return;
+    }
+
+    if (interfaces.contains(recordInterface)) {
+        const QString tagPath = path.left(path.lastIndexOf(QLatin1Char('/')));
+        const auto target = detectedTargets.value(tagPath);
+        if (target)
+            target->addRecord(path, interfaces.value(recordInterface));
+    }
+}
+
+void QNearFieldManagerPrivateImpl::handleInterfacesRemoved(const QDBusMessage &message)
+{
+    const QList<QVariant> arguments = message.arguments();
+    if (arguments.size() < 2)
+        return;
+
+    const QString path = qdbus_cast<QDBusObjectPath>(arguments.at(0)).path();
+    const QStringList interfaces = arguments.at(1).toStringList();
+
+    if (interfaces.contains(tagInterface)) {
+        const QPointer<QNearFieldTargetPrivateImpl> target = detectedTargets.take(path);
+        if (target) {
+            target->invalidate();
+            if (target->q_ptr)
+                Q_EMIT targetLost(target->q_ptr);
+            else
+                target->deleteLater(); // lost before it was reported
+        }
+
+        // neard ends the poll loop when a tag is found, resume it to keep
+        // detecting targets until stopTargetDetection() is called
+        if (detecting)
+            startPollLoop();
+    } else if (interfaces.contains(recordInterface)) {
+        const QString tagPath = path.left(path.lastIndexOf(QLatin1Char('/')));
+        const auto target = detectedTargets.value(tagPath);
+        if (target)
+            target->removeRecord(path);
+    } else if (interfaces.contains(adapterInterface) && path == adapterPath) {
+        bus.disconnect(QNeard::service(), adapterPath, propertiesInterface,
+                       QStringLiteral("PropertiesChanged"),
+                       this, SLOT(handleAdapterPropertiesChanged(QDBusMessage)));
+        adapterPath.clear();
+        adapterPolling = false;
+        if (adapterPowered) {
+            adapterPowered = false;
+            Q_EMIT adapterStateChanged(QNearFieldManager::AdapterState::Offline);
+        }
+        if (detecting) {
+            detecting = false;
+            Q_EMIT targetDetectionStopped();
+        }
+    }
+}
+
+void QNearFieldManagerPrivateImpl::handleAdapterPropertiesChanged(const QDBusMessage &message)
+{
+    const QList<QVariant> arguments = message.arguments();
+    if (arguments.size() < 2 || arguments.at(0).toString() != adapterInterface)
+        return;
+
+    const QVariantMap changed = qdbus_cast<QVariantMap>(arguments.at(1));
+    const auto powered = changed.constFind(QStringLiteral("Powered"));
+    if (powered != changed.cend() && powered->toBool() != adapterPowered) {
+        adapterPowered = powered->toBool();
+        Q_EMIT adapterStateChanged(adapterPowered ? QNearFieldManager::AdapterState::Online
+                                                  : QNearFieldManager::AdapterState::Offline);
+        if (adapterPowered && detecting)
+            startPollLoop();
+    }
+
+    const auto polling = changed.constFind(QStringLiteral("Polling"));
+    if (polling != changed.cend())
+        adapterPolling = polling->toBool();
+}
+
+void QNearFieldManagerPrivateImpl::initAdapter()
+{
+    QDBusMessage call = QDBusMessage::createMethodCall(QNeard::service(), QStringLiteral("/"),
+                                                       objectManagerInterface,
+                                                       QStringLiteral("GetManagedObjects"));
+    const QDBusReply<NeardManagedObjectList> reply = bus.call(call);
+    if (!reply.isValid()) {
+        qWarning() << "Cannot find neard:" << reply.error().message();
+        return;
+    }
+
+    const NeardManagedObjectList objects = reply.value();
+    for (auto it = objects.cbegin(); it != objects.cend(); ++it) {
+        if (it.value().contains(adapterInterface)) {
+            setAdapter(it.key().path(), it.value().value(adapterInterface));
+            break;
+        }
+    }
+}
+
+void QNearFieldManagerPrivateImpl::setAdapter(const QString &path, const QVariantMap &properties)
+{
+    adapterPath = path;
+    adapterPolling = properties.value(QStringLiteral("Polling")).toBool();
+    const bool powered = properties.value(QStringLiteral("Powered")).toBool();
+
+    bus.connect(QNeard::service(), adapterPath, propertiesInterface,
+                QStringLiteral("PropertiesChanged"),
+                this, SLOT(handleAdapterPropertiesChanged(QDBusMessage)));
+
+    if (powered != adapterPowered) {
+        adapterPowered = powered;
+        if (adapterPowered)
+            Q_EMIT adapterStateChanged(QNearFieldManager::AdapterState::Online);
+    }
+}
+
+void QNearFieldManagerPrivateImpl::addTarget(const QString &tagPath, const QVariantMap &properties)
+{
+    if (!detecting || detectedTargets.contains(tagPath))
+        return;
+
+    auto target = new QNearFieldTargetPrivateImpl(tagPath, properties, this);
+    if (!(target->accessMethods() & requestedMethod)) {
+        delete target;
+        return;
+    }
+
+    // Report the target once neard published its records, so that
+    // hasNdefMessage() and readNdefMessages() work from targetDetected() on
+    detectedTargets.insert(tagPath, target);
+    connect(target, &QNearFieldTargetPrivateImpl::recordsCollected, this, [this, target]() {
+        Q_EMIT targetDetected(new NearFieldTarget(target, this));
+    });
+    target->collectRecords();
+}
+
+void QNearFieldManagerPrivateImpl::startPollLoop()
+{
+    if (adapterPath.isEmpty() || adapterPolling)
+        return;
+
+    QDBusMessage call = QDBusMessage::createMethodCall(QNeard::service(), adapterPath,
+                                                       adapterInterface,
+                                                       QStringLiteral("StartPollLoop"));
+    call << QStringLiteral("Initiator");
+    auto watcher = new QDBusPendingCallWatcher(bus.asyncCall(call), this);
+    connect(watcher, &QDBusPendingCallWatcher::finished,
+            this, [this](QDBusPendingCallWatcher *watcher) {
+        const QDBusPendingReply<> reply = *watcher;
+        if (reply.isError()) {
+            qWarning() << "Cannot start NFC poll loop:" << reply.error().message();
+        } else {
+            adapterPolling = true;
+        }
+        watcher->deleteLater();
+    });
+}
+
+void QNearFieldManagerPrivateImpl::stopPollLoop()
+{
+    if (adapterPath.isEmpty())
+        return;
+
+    QDBusMessage call = QDBusMessage::createMethodCall(QNeard::service(), adapterPath,
+                                                       adapterInterface,
+                                                       QStringLiteral("StopPollLoop"));
+    bus.asyncCall(call);
+    adapterPolling = false;
+}
+
+QT_END_NAMESPACE
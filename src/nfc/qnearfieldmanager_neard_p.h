@@ -0,0 +1,103 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtNfc module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#ifndef QNEARFIELDMANAGER_NEARD_P_H
+#define QNEARFIELDMANAGER_NEARD_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include "qnearfieldmanager_p.h"
+#include "qnearfieldtarget_neard_p.h"
+
+#include <QtCore/QMap>
+#include <QtCore/QPointer>
+#include <QtDBus/QDBusConnection>
+#include <QtDBus/QDBusObjectPath>
+
+QT_BEGIN_NAMESPACE
+
+class QDBusMessage;
+
+class QNearFieldManagerPrivateImpl : public QNearFieldManagerPrivate
+{
+    Q_OBJECT
+
+public:
+    QNearFieldManagerPrivateImpl();
+    ~QNearFieldManagerPrivateImpl() override;
+
+    bool isEnabled() const override;
+    bool isSupported(QNearFieldTarget::AccessMethod accessMethod) const override;
+    bool startTargetDetection(QNearFieldTarget::AccessMethod accessMethod) override;
+    void stopTargetDetection(const QString &errorMessage) override;
+
+private slots:
+    void handleInterfacesAdded(const QDBusMessage &message);
+    void handleInterfacesRemoved(const QDBusMessage &message);
+    void handleAdapterPropertiesChanged(const QDBusMessage &message);
+
+private:
+    void initAdapter();
+    void setAdapter(const QString &path, const QVariantMap &properties);
+    void addTarget(const QString &tagPath, const QVariantMap &properties);
+    void startPollLoop();
+    void stopPollLoop();
+
+    QDBusConnection bus;
+    QString adapterPath;
+    bool adapterPowered = false;
+    bool adapterPolling = false;
+    bool detecting = false;
+    QNearFieldTarget::AccessMethod requestedMethod = QNearFieldTarget::UnknownAccess;
+    QMap<QString, QPointer<QNearFieldTargetPrivateImpl>> detectedTargets;
+};
+
+QT_END_NAMESPACE
+
+#endif // QNEARFIELDMANAGER_NEARD_P_H
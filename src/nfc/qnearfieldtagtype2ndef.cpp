@@ -0,0 +1,184 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtNfc module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#include "qnearfieldtagtype2ndef_p.h"
+
+#include <QtCore/QMap>
+#include <QtCore/QPair>
+
+QT_BEGIN_NAMESPACE
+
+static constexpr quint8 ReadOpcode = 0x30;
+static constexpr quint8 FastReadOpcode = 0x3a;
+static constexpr int BlockSize = 4;
+
+// Only sector 0 is read, its blocks are addressed with a single byte
+static constexpr int MaxMemorySize = 256 * BlockSize;
+
+QByteArray QNearFieldTagType2Ndef::readCommand(quint8 block)
+{
+    QByteArray command;
+    command.append(char(ReadOpcode));
+    command.append(char(block));
+    return command;
+}
+
+int QNearFieldTagType2Ndef::memorySize(const QByteArray &header)
+{
+    // Block 3 holds the capability container, byte 0 is the NDEF magic number
+    // and byte 2 the size of the data area in units of 8 bytes
+    if (header.size() < HeaderSize || quint8(header.at(12)) != 0xe1)
+        return 0;
+
+    return qMin(HeaderSize + 8 * quint8(header.at(14)), MaxMemorySize);
+}
+
+QList<QByteArray> QNearFieldTagType2Ndef::fastReadCommands(int memorySize, int maxFrameLength)
+{
+    // Leave room for the CRC, but read at least as much as a READ command would
+    const int blocksPerRead = qMax(HeaderSize / BlockSize, (maxFrameLength - 2) / BlockSize);
+    const int lastBlock = qMin(memorySize, MaxMemorySize) / BlockSize - 1;
+
+    QList<QByteArray> commands;
+    for (int block = HeaderSize / BlockSize; block <= lastBlock; block += blocksPerRead) {
+        QByteArray command;
+        command.append(char(FastReadOpcode));
+        command.append(char(block));
+        command.append(char(qMin(block + blocksPerRead - 1, lastBlock)));
+        commands.append(command);
+    }
+    return commands;
+}
+
+int QNearFieldTagType2Ndef::responseOffset(const QByteArray &command)
+{
+    if (command.size() < 2)
+        return -1;
+    return quint8(command.at(1)) * BlockSize;
+}
+
+// The area which a Lock Control or Memory Control TLV reserves
+static QPair<int, int> reservedArea(quint8 tag, const QByteArray &value)
+{
+    if (value.size() < 3)
+        return qMakePair(0, 0);
+
+    const quint8 position = value.at(0);
+    const int bytesPerPage = quint8(value.at(2)) & 0x0f;
+    if (!bytesPerPage)
+        return qMakePair(0, 0);
+
+    int size = quint8(value.at(1));
+    if (size == 0)
+        size = 256;
+    // Lock Control TLVs count lock bits
+    if (tag == 0x01)
+        size = (size + 7) / 8;
+
+    return qMakePair((position >> 4) * (1 << bytesPerPage) + (position & 0x0f), size);
+}
+
+QList<QNdefMessage> QNearFieldTagType2Ndef::parseTlvs(const QByteArray &memory)
+{
+    QList<QNdefMessage> messages;
+
+    // offset -> size of the areas reserved by the TLVs read so far
+    QMap<int, int> reserved;
+    int position = HeaderSize;
+
+    const auto read = [&](int count, QByteArray *data) {
+        while (count-- > 0) {
+            for (auto it = reserved.cbegin(), end = reserved.cend(); it != end; ++it) {
+                if (position >= it.key() && position < it.key() + it.value())
+                    position = it.key() + it.value();
+            }
+            if (position >= memory.size())
+                return false;
+            data->append(memory.at(position++));
+        }
+        return true;
+    };
+
+    while (true) {
+        QByteArray tag;
+        if (!read(1, &tag))
+            break;
+
+        const quint8 type = tag.at(0);
+        if (type == 0x00)       // NULL TLV
+            continue;
+        if (type == 0xfe)       // Terminator TLV
+            break;
+
+        QByteArray length;
+        if (!read(1, &length))
+            break;
+        int valueLength = quint8(length.at(0));
+        if (valueLength == 0xff) {
+            length.clear();
+            if (!read(2, &length))
+                break;
+            valueLength = (quint8(length.at(0)) << 8) | quint8(length.at(1));
+        }
+
+        QByteArray value;
+        if (!read(valueLength, &value))
+            break;
+
+        switch (type) {
+        case 0x01:  // Lock Control TLV
+        case 0x02: { // Memory Control TLV
+            const QPair<int, int> area = reservedArea(type, value);
+            if (area.second > 0)
+                reserved.insert(area.first, area.second);
+            break;
+        }
+        case 0x03:  // NDEF Message TLV
+            messages.append(QNdefMessage::fromByteArray(value));
+            break;
+        default:
+            break;
+        }
+    }
+
+    return messages;
+}
+
+QT_END_NAMESPACE
@@ -0,0 +1,90 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtNfc module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#ifndef QNEARFIELDTAGTYPE2NDEF_P_H
+#define QNEARFIELDTAGTYPE2NDEF_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include "qtnfcglobal.h"
+#include "qndefmessage.h"
+
+#include <QtCore/QByteArray>
+#include <QtCore/QList>
+
+QT_BEGIN_NAMESPACE
+
+/*
+    Reading the NDEF data of NFC Forum Type 2 tags.
+
+    The first four blocks of a tag hold the UID, the static lock bytes and
+    the capability container. The data area follows directly. It is read
+    with FAST_READ commands, each covering as many blocks as fit into one
+    frame, and then parsed as TLVs in a single pass.
+ */
+namespace QNearFieldTagType2Ndef {
+    // UID, lock bytes and capability container, as returned by readCommand(0)
+    constexpr int HeaderSize = 16;
+
+    Q_AUTOTEST_EXPORT QByteArray readCommand(quint8 block);
+    // Size of the tag memory described by the capability container in
+    // header, 0 if the tag is not NDEF formatted
+    Q_AUTOTEST_EXPORT int memorySize(const QByteArray &header);
+    // FAST_READ commands covering the data area; their responses must not
+    // exceed maxFrameLength bytes including the CRC
+    Q_AUTOTEST_EXPORT QList<QByteArray> fastReadCommands(int memorySize, int maxFrameLength);
+    // Offset of the data returned by command in the tag memory
+    Q_AUTOTEST_EXPORT int responseOffset(const QByteArray &command);
+    // NDEF messages found in the TLVs of memory, starting at block 0
+    Q_AUTOTEST_EXPORT QList<QNdefMessage> parseTlvs(const QByteArray &memory);
+}
+
+QT_END_NAMESPACE
+
+#endif // QNEARFIELDTAGTYPE2NDEF_P_H
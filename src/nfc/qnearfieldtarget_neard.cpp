@@ -0,0 +1,598 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtNfc module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#include "qnearfieldtarget_neard_p.h"
+#include "qnearfieldtagtype2ndef_p.h"
+
+#include "qndefnfcsmartposterrecord.h"
+#include "qndefnfctextrecord.h"
+#include "qndefnfcurirecord.h"
+
+#include <QtCore/QDebug>
+#include <QtCore/QRegularExpression>
+#include <QtCore/QSocketNotifier>
+#include <QtCore/QTimer>
+#include <QtDBus/QDBusMessage>
+#include <QtDBus/QDBusMetaType>
+#include <QtDBus/QDBusPendingCallWatcher>
+#include <QtDBus/QDBusPendingReply>
+
+#include <errno.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <linux/nfc.h>
+
+QT_BEGIN_NAMESPACE
+
+QDBusConnection QNeard::bus()
+{
+    if (qEnvironmentVariableIsSet("QT_NFC_NEARD_SESSION_BUS"))
+        return QDBusConnection::sessionBus();
+    return QDBusConnection::systemBus();
+}
+
+QString QNeard::service()
+{
+    return QStringLiteral("org.neard");
+}
+
+void QNeard::registerMetaTypes()
+{
+    static bool initDone = false;
+    if (!initDone) {
+        qDBusRegisterMetaType<NeardInterfaceList>();
+        qDBusRegisterMetaType<NeardManagedObjectList>();
+        initDone = true;
+    }
+}
+
+static QNeard::RawSocketFactory rawSocketFactory = nullptr;
+
+void QNeard::setRawSocketFactory(RawSocketFactory factory)
+{
+    rawSocketFactory = factory;
+}
+
+// neard publishes the records of a tag right after the tag itself
+static constexpr int recordCollectionTime = 100; // ms
+
+// neard names tags <adapter>/nfc<dev idx>/tag<target idx>
+static bool parseTagPath(const QString &tagPath, quint32 *devIdx, quint32 *targetIdx)
+{
+    static const QRegularExpression pattern(QStringLiteral("/nfc(\\d+)/tag(\\d+)$"));
+    const QRegularExpressionMatch match = pattern.match(tagPath);
+    if (!match.hasMatch())
+        return false;
+    *devIdx = match.captured(1).toUInt();
+    *targetIdx = match.captured(2).toUInt();
+    return true;
+}
+
+// and records <tag>/record<record idx>
+static bool parseRecordPath(const QString &recordPath, quint32 *recordIdx)
+{
+    static const QRegularExpression pattern(QStringLiteral("/record(\\d+)$"));
+    const QRegularExpressionMatch match = pattern.match(recordPath);
+    if (!match.hasMatch())
+        return false;
+    *recordIdx = match.captured(1).toUInt();
+    return true;
+}
+
+static quint32 nfcProtocol(const QString &neardProtocol)
+{
+    if (neardProtocol == QLatin1String("Jewel"))
+        return NFC_PROTO_JEWEL;
+    if (neardProtocol == QLatin1String("MIFARE"))
+        return NFC_PROTO_MIFARE;
+    if (neardProtocol == QLatin1String("Felica"))
+        return NFC_PROTO_FELICA;
+    if (neardProtocol == QLatin1String("ISO-DEP"))
+        return NFC_PROTO_ISO14443;
+    if (neardProtocol == QLatin1String("ISO15693"))
+        return NFC_PROTO_ISO15693;
+    return 0;
+}
+
+static QNdefRecord recordFromProperties(const QVariantMap &properties)
+{
+    const QString type = properties.value(QStringLiteral("Type")).toString();
+    if (type == QLatin1String("Text")) {
+        QNdefNfcTextRecord textRecord;
+        textRecord.setText(properties.value(QStringLiteral("Representation")).toString());
+        textRecord.setLocale(properties.value(QStringLiteral("Language")).toString());
+        textRecord.setEncoding(properties.value(QStringLiteral("Encoding")).toString()
+                                       == QLatin1String("UTF-16")
+                               ? QNdefNfcTextRecord::Utf16 : QNdefNfcTextRecord::Utf8);
+        return textRecord;
+    } else if (type == QLatin1String("URI")) {
+        QNdefNfcUriRecord uriRecord;
+        uriRecord.setUri(QUrl(properties.value(QStringLiteral("URI")).toString()));
+        return uriRecord;
+    } else if (type == QLatin1String("SmartPoster")) {
+        QNdefNfcSmartPosterRecord posterRecord;
+        posterRecord.setUri(QUrl(properties.value(QStringLiteral("URI")).toString()));
+        const QString title = properties.value(QStringLiteral("Representation")).toString();
+        if (!title.isEmpty()) {
+            posterRecord.addTitle(title,
+                                  properties.value(QStringLiteral("Language")).toString(),
+                                  QNdefNfcTextRecord::Utf8);
+        }
+        return posterRecord;
+    }
+
+    return QNdefRecord();
+}
+
+QNearFieldTargetPrivateImpl::QNearFieldTargetPrivateImpl(const QString &tagPath,
+                                                         const QVariantMap &properties,
+                                                         QObject *parent)
+    : QNearFieldTargetPrivate(parent),
+      tagPath(tagPath),
+      tagProperties(properties)
+{
+}
+
+QNearFieldTargetPrivateImpl::~QNearFieldTargetPrivateImpl()
+{
+    closeRawSocket();
+}
+
+QByteArray QNearFieldTargetPrivateImpl::uid() const
+{
+    // neard does not expose the tag UID
+    return QByteArray();
+}
+
+QNearFieldTarget::Type QNearFieldTargetPrivateImpl::type() const
+{
+    const QString type = tagProperties.value(QStringLiteral("Type")).toString();
+    if (type == QLatin1String("Type 1"))
+        return QNearFieldTarget::NfcTagType1;
+    if (type == QLatin1String("Type 2"))
+        return QNearFieldTarget::NfcTagType2;
+    if (type == QLatin1String("Type 3"))
+        return QNearFieldTarget::NfcTagType3;
+    if (type == QLatin1String("Type 4"))
+        return QNearFieldTarget::NfcTagType4;
+    if (type == QLatin1String("MIFARE"))
+        return QNearFieldTarget::MifareTag;
+
+    return QNearFieldTarget::ProprietaryTag;
+}
+
+QNearFieldTarget::AccessMethods QNearFieldTargetPrivateImpl::accessMethods() const
+{
+    QNearFieldTarget::AccessMethods methods = QNearFieldTarget::NdefAccess;
+    if (nfcProtocol(tagProperties.value(QStringLiteral("Protocol")).toString()) != 0)
+        methods |= QNearFieldTarget::TagTypeSpecificAccess;
+    return methods;
+}
+
+bool QNearFieldTargetPrivateImpl::disconnect()
+{
+    if (rawSocket < 0)
+        return false;
+
+    closeRawSocket();
+    return true;
+}
+
+bool QNearFieldTargetPrivateImpl::hasNdefMessage()
+{
+    return !records.isEmpty();
+}
+
+QNearFieldTarget::RequestId QNearFieldTargetPrivateImpl::readNdefMessages()
+{
+    QNearFieldTarget::RequestId requestId(new QNearFieldTarget::RequestIdPrivate);
+    if (!isValid) {
+        reportError(QNearFieldTarget::TargetOutOfRangeError, requestId);
+        return requestId;
+    }
+
+    // Type 2 tags are read directly, which yields the complete NDEF message
+    if (readType2NdefMessages(requestId))
+        return requestId;
+
+    // neard reads and parses the NDEF area once the tag has been detected,
+    // the records are already known at this point. Only the record types
+    // neard understands are available.
+    QList<QNdefRecord> ndefRecords;
+    for (const QVariantMap &properties : qAsConst(records)) {
+        const QNdefRecord record = recordFromProperties(properties);
+        if (!record.isEmpty())
+            ndefRecords.append(record);
+    }
+
+    if (ndefRecords.isEmpty()) {
+        reportError(QNearFieldTarget::NdefReadError, requestId);
+        return requestId;
+    }
+
+    const QNdefMessage message(ndefRecords);
+    QMetaObject::invokeMethod(this, [this, message, requestId]() {
+        Q_EMIT this->ndefMessageRead(message);
+        setResponseForRequest(requestId, QVariant());
+    }, Qt::QueuedConnection);
+
+    return requestId;
+}
+
+QNearFieldTarget::RequestId
+QNearFieldTargetPrivateImpl::writeNdefMessages(const QList<QNdefMessage> &messages)
+{
+    QNearFieldTarget::RequestId requestId(new QNearFieldTarget::RequestIdPrivate);
+    if (!isValid) {
+        reportError(QNearFieldTarget::TargetOutOfRangeError, requestId);
+        return requestId;
+    }
+
+    // org.neard.Tag.Write() accepts exactly one record
+    if (messages.size() != 1 || messages.first().size() != 1) {
+        qWarning("QNearFieldTarget::writeNdefMessages: neard supports writing only "
+                 "a single NDEF record per tag.");
+        reportError(QNearFieldTarget::UnsupportedError, requestId);
+        return requestId;
+    }
+
+    const QNdefRecord &record = messages.first().first();
+    QVariantMap attributes;
+    if (record.isRecordType<QNdefNfcTextRecord>()) {
+        const QNdefNfcTextRecord textRecord(record);
+        attributes.insert(QStringLiteral("Type"), QStringLiteral("Text"));
+        attributes.insert(QStringLiteral("Encoding"),
+                          textRecord.encoding() == QNdefNfcTextRecord::Utf16
+                          ? QStringLiteral("UTF-16") : QStringLiteral("UTF-8"));
+        attributes.insert(QStringLiteral("Language"), textRecord.locale());
+        attributes.insert(QStringLiteral("Representation"), textRecord.text());
+    } else if (record.isRecordType<QNdefNfcUriRecord>()) {
+        const QNdefNfcUriRecord uriRecord(record);
+        attributes.insert(QStringLiteral("Type"), QStringLiteral("URI"));
+        attributes.insert(QStringLiteral("URI"), uriRecord.uri().toString());
+    } else {
+        reportError(QNearFieldTarget::UnsupportedError, requestId);
+        return requestId;
+    }
+
+    QDBusMessage call = QDBusMessage::createMethodCall(QNeard::service(), tagPath,
+                                                       QStringLiteral("org.neard.Tag"),
+                                                       QStringLiteral("Write"));
+    call << attributes;
+    auto watcher = new QDBusPendingCallWatcher(QNeard::bus().asyncCall(call), this);
+    connect(watcher, &QDBusPendingCallWatcher::finished,
+            this, [this, requestId](QDBusPendingCallWatcher *watcher) {
+        const QDBusPendingReply<> reply = *watcher;
+        if (reply.isError()) {
+            qWarning() << "neard failed to write NDEF message:" << reply.error().message();
+            reportError(QNearFieldTarget::NdefWriteError, requestId);
+        } else {
+            setResponseForRequest(requestId, QVariant());
+        }
+        watcher->deleteLater();
+    });
+
+    return requestId;
+}
+
+int QNearFieldTargetPrivateImpl::maxCommandLength() const
+{
+    if (!(accessMethods() & QNearFieldTarget::TagTypeSpecificAccess))
+        return 0;
+
+    // ISO-DEP allows extended frames, everything else is limited to a single short frame
+    return type() == QNearFieldTarget::NfcTagType4 ? 261 : 255;
+}
+
+/*
+    Commands are written to an AF_NFC raw socket as soon as they are issued.
+    The kernel queues them and answers in order, so several commands can be
+    in flight without waiting for the previous response.
+ */
+QNearFieldTarget::RequestId QNearFieldTargetPrivateImpl::sendCommand(const QByteArray &command)
+{
+    if (command.isEmpty() || command.size() > maxCommandLength()) {
+        Q_EMIT error(QNearFieldTarget::InvalidParametersError, QNearFieldTarget::RequestId());
+        return QNearFieldTarget::RequestId();
+    }
+
+    QNearFieldTarget::RequestId requestId(new QNearFieldTarget::RequestIdPrivate);
+    if (!isValid) {
+        reportError(QNearFieldTarget::TargetOutOfRangeError, requestId);
+        return requestId;
+    }
+
+    if (rawSocket < 0 && !openRawSocket()) {
+        reportError(QNearFieldTarget::ConnectionError, requestId);
+        return requestId;
+    }
+
+    if (!writeRawCommand(command, requestId))
+        reportError(QNearFieldTarget::CommandError, requestId);
+
+    return requestId;
+}
+
+bool QNearFieldTargetPrivateImpl::writeRawCommand(const QByteArray &command,
+                                                  const QNearFieldTarget::RequestId &requestId,
+                                                  int ndefOffset)
+{
+    if (::write(rawSocket, command.constData(), command.size()) != command.size()) {
+        qWarning() << "Cannot write NFC command:" << qt_error_string(errno);
+        return false;
+    }
+
+    pendingCommands.enqueue({ requestId, ndefOffset });
+    return true;
+}
+
+/*
+    Reads the NDEF messages of a Type 2 tag through the raw socket. The
+    header blocks are read first. All FAST_READ commands for the data area
+    are then written at once, and the TLVs are parsed after the last
+    response arrived.
+
+    Returns false if the tag cannot be read this way.
+ */
+bool QNearFieldTargetPrivateImpl::readType2NdefMessages(const QNearFieldTarget::RequestId &requestId)
+{
+    if (type() != QNearFieldTarget::NfcTagType2
+            || !(accessMethods() & QNearFieldTarget::TagTypeSpecificAccess)
+            || ndefReadRequest.isValid()) {
+        return false;
+    }
+
+    if (rawSocket < 0 && !openRawSocket())
+        return false;
+
+    if (!writeRawCommand(QNearFieldTagType2Ndef::readCommand(0), requestId, 0))
+        return false;
+
+    ndefReadRequest = requestId;
+    ndefMemory.clear();
+    pendingNdefReads = 1;
+    return true;
+}
+
+void QNearFieldTargetPrivateImpl::handleType2NdefResponse(int offset, const QByteArray &response)
+{
+    --pendingNdefReads;
+    if (response.isEmpty()) {
+        finishType2NdefRead(QNearFieldTarget::NdefReadError);
+        return;
+    }
+
+    if (offset == 0) {
+        const int memorySize = QNearFieldTagType2Ndef::memorySize(response);
+        if (memorySize == 0) {
+            finishType2NdefRead(QNearFieldTarget::NdefReadError);
+            return;
+        }
+
+        ndefMemory = response.left(QNearFieldTagType2Ndef::HeaderSize);
+        ndefMemory.append(QByteArray(memorySize - ndefMemory.size(), '\0'));
+
+        const QList<QByteArray> commands =
+                QNearFieldTagType2Ndef::fastReadCommands(memorySize, maxCommandLength());
+        for (const QByteArray &command : commands) {
+            if (!writeRawCommand(command, ndefReadRequest,
+                                 QNearFieldTagType2Ndef::responseOffset(command))) {
+                finishType2NdefRead(QNearFieldTarget::NdefReadError);
+                return;
+            }
+            ++pendingNdefReads;
+        }
+    } else if (offset < ndefMemory.size()) {
+        const qsizetype size = qMin(response.size(), ndefMemory.size() - offset);
+        ndefMemory.replace(offset, size, response.constData(), size);
+    }
+
+    if (pendingNdefReads == 0)
+        finishType2NdefRead(QNearFieldTarget::NoError);
+}
+
+void QNearFieldTargetPrivateImpl::finishType2NdefRead(QNearFieldTarget::Error error)
+{
+    const QNearFieldTarget::RequestId requestId = ndefReadRequest;
+    ndefReadRequest = QNearFieldTarget::RequestId();
+    pendingNdefReads = 0;
+
+    QList<QNdefMessage> messages;
+    if (error == QNearFieldTarget::NoError) {
+        messages = QNearFieldTagType2Ndef::parseTlvs(ndefMemory);
+        if (messages.isEmpty())
+            error = QNearFieldTarget::NdefReadError;
+    }
+    ndefMemory.clear();
+
+    if (error != QNearFieldTarget::NoError) {
+        reportError(error, requestId);
+        return;
+    }
+
+    for (const QNdefMessage &message : qAsConst(messages))
+        Q_EMIT ndefMessageRead(message);
+    setResponseForRequest(requestId, QVariant());
+}
+
+/*
+    Emits recordsCollected() once no record arrived for recordCollectionTime.
+    Records which arrive later are still added to the target.
+ */
+void QNearFieldTargetPrivateImpl::collectRecords()
+{
+    if (!recordTimer) {
+        recordTimer = new QTimer(this);
+        recordTimer->setSingleShot(true);
+        recordTimer->setInterval(recordCollectionTime);
+        connect(recordTimer, &QTimer::timeout,
+                this, &QNearFieldTargetPrivateImpl::recordsCollected);
+    }
+    recordTimer->start();
+}
+
+void QNearFieldTargetPrivateImpl::addRecord(const QString &recordPath,
+                                            const QVariantMap &properties)
+{
+    quint32 index = 0;
+    if (!parseRecordPath(recordPath, &index)) {
+        qWarning() << "Ignoring neard record with unexpected path" << recordPath;
+        return;
+    }
+    records.insert(index, properties);
+
+    if (recordTimer && recordTimer->isActive())
+        recordTimer->start();
+}
+
+void QNearFieldTargetPrivateImpl::removeRecord(const QString &recordPath)
+{
+    quint32 index = 0;
+    if (parseRecordPath(recordPath, &index))
+        records.remove(index);
+}
+
+void QNearFieldTargetPrivateImpl::invalidate()
+{
+    if (!isValid)
+        return;
+
+    isValid = false;
+    records.clear();
+    if (recordTimer)
+        recordTimer->stop();
+    closeRawSocket();
+    Q_EMIT disconnected();
+}
+
+void QNearFieldTargetPrivateImpl::readRawResponses()
+{
+    // Each datagram carries one response prefixed by a status byte.
+    char buffer[1024];
+    while (true) {
+        const ssize_t size = ::recv(rawSocket, buffer, sizeof(buffer), MSG_DONTWAIT);
+        if (size < 0) {
+            if (errno == EAGAIN || errno == EINTR)
+                return;
+            qWarning() << "Cannot read NFC response:" << qt_error_string(errno);
+            closeRawSocket();
+            return;
+        }
+        if (size == 0) {
+            // the peer or the kernel closed the socket
+            qWarning("NFC raw socket was closed");
+            closeRawSocket(QNearFieldTarget::ConnectionError);
+            return;
+        }
+        if (pendingCommands.isEmpty()) {
+            qWarning("Dropping unexpected NFC response");
+            continue;
+        }
+
+        const PendingCommand command = pendingCommands.dequeue();
+        const bool failed = size < 1 || buffer[0] != 0;
+        if (command.ndefOffset >= 0) {
+            // steps of an NDEF read which already failed are dropped
+            if (command.requestId == ndefReadRequest) {
+                handleType2NdefResponse(command.ndefOffset,
+                                        failed ? QByteArray()
+                                               : QByteArray(buffer + 1, int(size - 1)));
+            }
+        } else if (failed) {
+            reportError(QNearFieldTarget::CommandError, command.requestId);
+        } else {
+            setResponseForRequest(command.requestId, QByteArray(buffer + 1, int(size - 1)));
+        }
+    }
+}
+
+bool QNearFieldTargetPrivateImpl::openRawSocket()
+{
+    struct sockaddr_nfc address = {};
+    address.sa_family = AF_NFC;
+    address.nfc_protocol = nfcProtocol(tagProperties.value(QStringLiteral("Protocol")).toString());
+    if (!address.nfc_protocol || !parseTagPath(tagPath, &address.dev_idx, &address.target_idx))
+        return false;
+
+    if (rawSocketFactory) {
+        rawSocket = rawSocketFactory(tagPath);
+        if (rawSocket < 0)
+            return false;
+    } else {
+        rawSocket = ::socket(AF_NFC, SOCK_SEQPACKET | SOCK_CLOEXEC, NFC_SOCKPROTO_RAW);
+        if (rawSocket < 0) {
+            qWarning() << "Cannot open NFC raw socket:" << qt_error_string(errno);
+            return false;
+        }
+
+        if (::connect(rawSocket, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0) {
+            qWarning() << "Cannot connect NFC raw socket:" << qt_error_string(errno);
+            ::close(rawSocket);
+            rawSocket = -1;
+            return false;
+        }
+    }
+
+    rawNotifier = new QSocketNotifier(rawSocket, QSocketNotifier::Read, this);
+    connect(rawNotifier, &QSocketNotifier::activated,
+            this, &QNearFieldTargetPrivateImpl::readRawResponses);
+    return true;
+}
+
+void QNearFieldTargetPrivateImpl::closeRawSocket(QNearFieldTarget::Error error)
+{
+    delete rawNotifier;
+    rawNotifier = nullptr;
+
+    if (rawSocket >= 0) {
+        ::close(rawSocket);
+        rawSocket = -1;
+    }
+
+    while (!pendingCommands.isEmpty()) {
+        const PendingCommand command = pendingCommands.dequeue();
+        if (command.ndefOffset < 0)
+            reportError(error, command.requestId);
+    }
+    if (ndefReadRequest.isValid())
+        finishType2NdefRead(error);
+}
+
+QT_END_NAMESPACE
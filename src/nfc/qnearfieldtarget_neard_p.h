@@ -0,0 +1,161 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtNfc module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#ifndef QNEARFIELDTARGET_NEARD_P_H
+#define QNEARFIELDTARGET_NEARD_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include "qnearfieldtarget_p.h"
+#include "qndefmessage.h"
+
+#include <QtCore/QMap>
+#include <QtCore/QQueue>
+#include <QtCore/QVariantMap>
+#include <QtDBus/QDBusConnection>
+#include <QtDBus/QDBusObjectPath>
+
+typedef QMap<QString, QVariantMap> NeardInterfaceList;
+typedef QMap<QDBusObjectPath, NeardInterfaceList> NeardManagedObjectList;
+
+Q_DECLARE_METATYPE(NeardInterfaceList)
+Q_DECLARE_METATYPE(NeardManagedObjectList)
+
+QT_BEGIN_NAMESPACE
+
+class QSocketNotifier;
+class QTimer;
+
+namespace QNeard {
+    // neard runs on the system bus; autotests point the backend to a fake
+    // neard on the session bus via QT_NFC_NEARD_SESSION_BUS
+    QDBusConnection bus();
+    QString service();
+    void registerMetaTypes();
+
+    // Autotests replace the AF_NFC raw socket of a tag with a connected socket
+    // of their own. The factory returns a descriptor or -1.
+    using RawSocketFactory = int (*)(const QString &tagPath);
+    Q_AUTOTEST_EXPORT void setRawSocketFactory(RawSocketFactory factory);
+}
+
+class QNearFieldTargetPrivateImpl : public QNearFieldTargetPrivate
+{
+    Q_OBJECT
+
+public:
+    QNearFieldTargetPrivateImpl(const QString &tagPath, const QVariantMap &properties,
+                                QObject *parent = nullptr);
+    ~QNearFieldTargetPrivateImpl() override;
+
+    QByteArray uid() const override;
+    QNearFieldTarget::Type type() const override;
+    QNearFieldTarget::AccessMethods accessMethods() const override;
+
+    bool disconnect() override;
+
+    bool hasNdefMessage() override;
+    QNearFieldTarget::RequestId readNdefMessages() override;
+    QNearFieldTarget::RequestId writeNdefMessages(const QList<QNdefMessage> &messages) override;
+
+    int maxCommandLength() const override;
+    QNearFieldTarget::RequestId sendCommand(const QByteArray &command) override;
+
+    QString path() const { return tagPath; }
+    void collectRecords();
+    void addRecord(const QString &recordPath, const QVariantMap &properties);
+    void removeRecord(const QString &recordPath);
+    void invalidate();
+
+Q_SIGNALS:
+    // no further record arrived within recordCollectionTime after the last one
+    void recordsCollected();
+
+private slots:
+    void readRawResponses();
+
+private:
+    bool openRawSocket();
+    // fails the outstanding commands with error
+    void closeRawSocket(QNearFieldTarget::Error error = QNearFieldTarget::TargetOutOfRangeError);
+    bool writeRawCommand(const QByteArray &command, const QNearFieldTarget::RequestId &requestId,
+                         int ndefOffset = -1);
+
+    bool readType2NdefMessages(const QNearFieldTarget::RequestId &requestId);
+    void handleType2NdefResponse(int offset, const QByteArray &response);
+    void finishType2NdefRead(QNearFieldTarget::Error error);
+
+    QString tagPath;
+    QVariantMap tagProperties;
+    // record index -> org.neard.Record properties. neard names the records
+    // record<index> in NDEF message order.
+    QMap<quint32, QVariantMap> records;
+    QTimer *recordTimer = nullptr;
+    bool isValid = true;
+
+    int rawSocket = -1;
+    QSocketNotifier *rawNotifier = nullptr;
+    struct PendingCommand
+    {
+        QNearFieldTarget::RequestId requestId;
+        // offset of the response in ndefMemory for the steps of an NDEF read
+        int ndefOffset = -1;
+    };
+    // raw commands are written immediately; the kernel answers them in order
+    QQueue<PendingCommand> pendingCommands;
+
+    // NDEF read of a Type 2 tag through the raw socket
+    QNearFieldTarget::RequestId ndefReadRequest;
+    QByteArray ndefMemory;
+    int pendingNdefReads = 0;
+};
+
+QT_END_NAMESPACE
+
+#endif // QNEARFIELDTARGET_NEARD_P_H
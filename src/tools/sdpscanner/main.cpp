@@ -39,12 +39,22 @@
 
 #include <QtCore/QByteArray>
 #include <QtCore/QDebug>
+#include <QtCore/qendian.h>
 #include <stdio.h>
+#include <string.h>
+#include <iostream>
+#include <sstream>
 #include <string>
+#include <vector>
 #include <bluetooth/bluetooth.h>
 #include <bluetooth/sdp.h>
 #include <bluetooth/sdp_lib.h>
 
+#include "sdpscannerprotocol_p.h"
+
+QT_USE_NAMESPACE
+using namespace SdpScannerProtocol;
+
 #define RETURN_SUCCESS      0
 #define RETURN_USAGE        1
 #define RETURN_INVALPARAM   2
@@ -53,14 +63,18 @@
 void usage()
 {
     fprintf(stderr, "Usage:\n");
-    fprintf(stderr, "\tsdpscanner <remote bdaddr> <local bdaddr> [Options] ({uuids})\n\n");
+    fprintf(stderr, "\tsdpscanner <remote bdaddr> <local bdaddr> [Options] ({uuids})\n");
+    fprintf(stderr, "\tsdpscanner -w\n\n");
     fprintf(stderr, "Performs an SDP scan on remote device, using the SDP server\n"
                     "represented by the local Bluetooth device.\n\n"
                     "Options:\n"
                     "   -p                  Show scan results in human-readable form\n"
                     "   -u [list of uuids]  List of uuids which should be scanned for.\n"
                     "                       Each uuid must be enclosed in {}.\n"
-                    "                       If the list is empty PUBLIC_BROWSE_GROUP scan is used.\n");
+                    "                       If the list is empty PUBLIC_BROWSE_GROUP scan is used.\n"
+                    "   -w                  Worker mode, reads one request per line from stdin\n"
+                    "                       (<remote bdaddr> <local bdaddr> [-u ({uuids})]) and\n"
+                    "                       answers each with a binary result frame on stdout.\n");
 }
 
 #define BUFFER_SIZE 1024
@@ -255,93 +269,178 @@ QByteArray parseSdpRecord(sdp_record_t *record)
 }
 
 
-int main(int argc, char **argv)
+/*
+ * Worker mode, see src/bluetooth/bluez/sdpscannerprotocol_p.h for the format
+ */
+static void appendSdpString(QByteArray &output, ElementType type, const sdp_data_t *data)
 {
-    if (argc < 3) {
-        usage();
-        return RETURN_USAGE;
+    // the strings are zero terminated, anything beyond is not part of the value
+    const size_t length = data->val.str ? strnlen(data->val.str, data->unitSize) : 0;
+    appendString(output, type, data->val.str, quint32(length));
+}
+
+static void encodeElement(const sdp_data_t *data, QByteArray &output);
+
+static void encodeElementList(ElementType type, const sdp_data_t *first, QByteArray &output)
+{
+    quint16 count = 0;
+    for (const sdp_data_t *child = first; child; child = child->next)
+        ++count;
+    appendListHeader(output, type, count);
+    for (const sdp_data_t *child = first; child; child = child->next)
+        encodeElement(child, output);
+}
+
+static void encodeElement(const sdp_data_t *data, QByteArray &output)
+{
+    switch (data->dtd) {
+    case SDP_UINT8:
+        appendElement<quint8>(output, ElementUInt8, data->val.uint8);
+        break;
+    case SDP_UINT16:
+        appendElement<quint16>(output, ElementUInt16, data->val.uint16);
+        break;
+    case SDP_UINT32:
+        appendElement<quint32>(output, ElementUInt32, data->val.uint32);
+        break;
+    case SDP_UINT64:
+        appendElement<quint64>(output, ElementUInt64, data->val.uint64);
+        break;
+    case SDP_UINT128:
+        appendElement128(output, ElementUInt128, data->val.uint128.data);
+        break;
+    case SDP_INT8:
+        appendElement<qint8>(output, ElementInt8, data->val.int8);
+        break;
+    case SDP_INT16:
+        appendElement<qint16>(output, ElementInt16, data->val.int16);
+        break;
+    case SDP_INT32:
+        appendElement<qint32>(output, ElementInt32, data->val.int32);
+        break;
+    case SDP_INT64:
+        appendElement<qint64>(output, ElementInt64, data->val.int64);
+        break;
+    case SDP_INT128:
+        appendElement128(output, ElementInt128, data->val.int128.data);
+        break;
+    case SDP_BOOL:
+        appendElement<quint8>(output, ElementBool, data->val.uint8 ? 1 : 0);
+        break;
+    case SDP_UUID16:
+        appendElement<quint16>(output, ElementUuid16, data->val.uuid.value.uuid16);
+        break;
+    case SDP_UUID32:
+        appendElement<quint32>(output, ElementUuid32, data->val.uuid.value.uuid32);
+        break;
+    case SDP_UUID128:
+        // already in network byte order
+        appendElement128(output, ElementUuid128, data->val.uuid.value.uuid128.data);
+        break;
+    case SDP_TEXT_STR8:
+    case SDP_TEXT_STR16:
+    case SDP_TEXT_STR32:
+        appendSdpString(output, ElementText, data);
+        break;
+    case SDP_URL_STR8:
+    case SDP_URL_STR16:
+    case SDP_URL_STR32:
+        appendSdpString(output, ElementUrl, data);
+        break;
+    case SDP_SEQ8:
+    case SDP_SEQ16:
+    case SDP_SEQ32:
+        encodeElementList(ElementSequence, data->val.dataseq, output);
+        break;
+    case SDP_ALT8:
+    case SDP_ALT16:
+    case SDP_ALT32:
+        encodeElementList(ElementAlternative, data->val.dataseq, output);
+        break;
+    default:
+        // SDP_DATA_NIL and the unspecified types carry no value
+        output.append(char(ElementNil));
+        break;
+    }
+}
+
+static QByteArray encodeSdpRecord(sdp_record_t *record)
+{
+    QByteArray output;
+    quint16 count = 0;
+    for (sdp_list_t *it = record ? record->attrlist : nullptr; it; it = it->next)
+        ++count;
+    appendBigEndian<quint16>(output, count);
+    for (sdp_list_t *it = record ? record->attrlist : nullptr; it; it = it->next) {
+        const sdp_data_t *data = static_cast<const sdp_data_t *>(it->data);
+        appendBigEndian<quint16>(output, data->attrId);
+        encodeElement(data, output);
+    }
+    return output;
+}
+
+static bool parseUuid(const std::string &text, uuid_t *sdpUuid)
+{
+    uint128_t temp128;
+    uint16_t field1, field2, field3, field5;
+    uint32_t field0, field4;
+
+    fprintf(stderr, "Target scan for %s\n", text.c_str());
+    if (sscanf(text.c_str(), "{%08x-%04hx-%04hx-%04hx-%08x%04hx}", &field0,
+               &field1, &field2, &field3, &field4, &field5) != 6) {
+        fprintf(stderr, "Skipping invalid uuid: %s\n", text.c_str());
+        return false;
     }
 
-    fprintf(stderr, "SDP for %s %s\n", argv[1], argv[2]);
+    // we need uuid_t conversion based on
+    // http://www.spinics.net/lists/linux-bluetooth/msg20356.html
+    field0 = htonl(field0);
+    field4 = htonl(field4);
+    field1 = htons(field1);
+    field2 = htons(field2);
+    field3 = htons(field3);
+    field5 = htons(field5);
+
+    uint8_t* temp = (uint8_t*) &temp128;
+    memcpy(&temp[0], &field0, 4);
+    memcpy(&temp[4], &field1, 2);
+    memcpy(&temp[6], &field2, 2);
+    memcpy(&temp[8], &field3, 2);
+    memcpy(&temp[10], &field4, 4);
+    memcpy(&temp[14], &field5, 2);
+
+    sdp_uuid128_create(sdpUuid, &temp128);
+    return true;
+}
+
+// Returns the found records in *totalResults, the caller frees them
+static int searchServices(const char *remoteAddress, const char *localAddress,
+                          const std::vector<std::string> &targetServices,
+                          sdp_list_t **totalResults)
+{
+    *totalResults = nullptr;
+    fprintf(stderr, "SDP for %s %s\n", remoteAddress, localAddress);
 
     bdaddr_t remote;
     bdaddr_t local;
-    int result = str2ba(argv[1], &remote);
+    int result = str2ba(remoteAddress, &remote);
     if (result < 0) {
-        fprintf(stderr, "Invalid remote address: %s\n", argv[1]);
+        fprintf(stderr, "Invalid remote address: %s\n", remoteAddress);
         return RETURN_INVALPARAM;
     }
 
-    result = str2ba(argv[2], &local);
+    result = str2ba(localAddress, &local);
     if (result < 0) {
-        fprintf(stderr, "Invalid local address: %s\n", argv[2]);
+        fprintf(stderr, "Invalid local address: %s\n", localAddress);
         return RETURN_INVALPARAM;
     }
 
-    bool showHumanReadable = false;
-    std::vector<std::string> targetServices;
-
-    for (int i = 3; i < argc; i++) {
-        if (argv[i][0] != '-') {
-            usage();
-            return RETURN_USAGE;
-        }
-
-        switch (argv[i][1])
-        {
-        case 'p':
-            showHumanReadable = true;
-            break;
-        case 'u':
-            i++;
-
-            for ( ; i < argc && argv[i][0] == '{'; i++)
-                targetServices.push_back(argv[i]);
-
-            i--; // outer loop increments again
-            break;
-        default:
-            fprintf(stderr, "Wrong argument: %s\n", argv[i]);
-            usage();
-            return RETURN_USAGE;
-        }
-    }
-
     std::vector<uuid_t> uuids;
     for (std::vector<std::string>::const_iterator iter = targetServices.cbegin();
          iter != targetServices.cend(); ++iter) {
-
-        uint128_t temp128;
-        uint16_t field1, field2, field3, field5;
-        uint32_t field0, field4;
-
-        fprintf(stderr, "Target scan for %s\n", (*iter).c_str());
-        if (sscanf((*iter).c_str(), "{%08x-%04hx-%04hx-%04hx-%08x%04hx}", &field0,
-                   &field1, &field2, &field3, &field4, &field5) != 6) {
-            fprintf(stderr, "Skipping invalid uuid: %s\n", ((*iter).c_str()));
-            continue;
-        }
-
-        // we need uuid_t conversion based on
-        // http://www.spinics.net/lists/linux-bluetooth/msg20356.html
-        field0 = htonl(field0);
-        field4 = htonl(field4);
-        field1 = htons(field1);
-        field2 = htons(field2);
-        field3 = htons(field3);
-        field5 = htons(field5);
-
-        uint8_t* temp = (uint8_t*) &temp128;
-        memcpy(&temp[0], &field0, 4);
-        memcpy(&temp[4], &field1, 2);
-        memcpy(&temp[6], &field2, 2);
-        memcpy(&temp[8], &field3, 2);
-        memcpy(&temp[10], &field4, 4);
-        memcpy(&temp[14], &field5, 2);
-
         uuid_t sdpUuid;
-        sdp_uuid128_create(&sdpUuid, &temp128);
-        uuids.push_back(sdpUuid);
+        if (parseUuid(*iter, &sdpUuid))
+            uuids.push_back(sdpUuid);
     }
 
     sdp_session_t *session = sdp_connect( &local, &remote, SDP_RETRY_IF_BUSY);
@@ -367,8 +466,7 @@ int main(int argc, char **argv)
     sdp_list_t *attributes;
     attributes = sdp_list_append(nullptr, &attributeRange);
 
-    sdp_list_t *sdpResults, *sdpIter;
-    sdp_list_t *totalResults = nullptr;
+    sdp_list_t *sdpResults, *sdpIter = nullptr;
     sdp_list_t* serviceFilter;
 
     for (uint i = 0; i < uuids.size(); ++i) {
@@ -380,6 +478,8 @@ int main(int argc, char **argv)
         if (result != 0) {
             fprintf(stderr, "sdp_service_search_attr_req failed\n");
             sdp_list_free(attributes, nullptr);
+            sdp_list_free(*totalResults, reinterpret_cast<sdp_free_func_t>(sdp_record_free));
+            *totalResults = nullptr;
             sdp_close(session);
             return RETURN_SDP_ERROR;
         }
@@ -387,9 +487,9 @@ int main(int argc, char **argv)
         if (!sdpResults)
             continue;
 
-        if (!totalResults) {
-            totalResults = sdpResults;
-            sdpIter = totalResults;
+        if (!*totalResults) {
+            *totalResults = sdpResults;
+            sdpIter = *totalResults;
         } else {
             // attach each new result list to the end of totalResults
             sdpIter->next = sdpResults;
@@ -399,9 +499,109 @@ int main(int argc, char **argv)
             sdpIter = sdpIter->next;
     }
     sdp_list_free(attributes, nullptr);
+    sdp_close(session);
+
+    return RETURN_SUCCESS;
+}
+
+static void writeFrame(quint8 status, quint16 recordCount, const QByteArray &records)
+{
+    const QByteArray frame = SdpScannerProtocol::frame(status, recordCount, records);
+    fwrite(frame.constData(), 1, size_t(frame.size()), stdout);
+    fflush(stdout);
+}
+
+static int runWorker()
+{
+    std::string line;
+    while (std::getline(std::cin, line)) {
+        std::istringstream request(line);
+        std::vector<std::string> arguments;
+        for (std::string argument; request >> argument; )
+            arguments.push_back(argument);
+        if (arguments.empty())
+            continue;
+
+        std::vector<std::string> targetServices;
+        bool validRequest = arguments.size() >= 2;
+        for (size_t i = 2; validRequest && i < arguments.size(); ++i) {
+            if (arguments[i] == "-u")
+                continue;
+            if (arguments[i][0] != '{')
+                validRequest = false;
+            else
+                targetServices.push_back(arguments[i]);
+        }
+        if (!validRequest) {
+            fprintf(stderr, "Invalid request: %s\n", line.c_str());
+            writeFrame(RETURN_INVALPARAM, 0, QByteArray());
+            continue;
+        }
+
+        sdp_list_t *results = nullptr;
+        const int status = searchServices(arguments[0].c_str(), arguments[1].c_str(),
+                                          targetServices, &results);
+        QByteArray records;
+        quint16 recordCount = 0;
+        for (sdp_list_t *it = results; it; it = it->next) {
+            records += encodeSdpRecord(static_cast<sdp_record_t *>(it->data));
+            ++recordCount;
+        }
+        sdp_list_free(results, reinterpret_cast<sdp_free_func_t>(sdp_record_free));
+
+        writeFrame(quint8(status), recordCount, records);
+    }
+
+    return RETURN_SUCCESS;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc == 2 && qstrcmp(argv[1], "-w") == 0)
+        return runWorker();
+
+    if (argc < 3) {
+        usage();
+        return RETURN_USAGE;
+    }
+
+    bool showHumanReadable = false;
+    std::vector<std::string> targetServices;
+
+    for (int i = 3; i < argc; i++) {
+        if (argv[i][0] != '-') {
+            usage();
+            return RETURN_USAGE;
+        }
+
+        switch (argv[i][1])
+        {
+        case 'p':
+            showHumanReadable = true;
+            break;
+        case 'u':
+            i++;
+
+            for ( ; i < argc && argv[i][0] == '{'; i++)
+                targetServices.push_back(argv[i]);
+
+            i--; // outer loop increments again
+            break;
+        default:
+            fprintf(stderr, "Wrong argument: %s\n", argv[i]);
+            usage();
+            return RETURN_USAGE;
+        }
+    }
+
+    sdp_list_t *totalResults = nullptr;
+    const int result = searchServices(argv[1], argv[2], targetServices, &totalResults);
+    if (result != RETURN_SUCCESS)
+        return result;
 
     // start XML generation from the front
-    sdpResults = totalResults;
+    sdp_list_t *sdpResults = totalResults;
+    sdp_list_t *sdpIter;
 
     QByteArray total;
     while (sdpResults) {
@@ -423,7 +623,5 @@ int main(int argc, char **argv)
             printf("%s", total.toBase64().constData());
     }
 
-    sdp_close(session);
-
     return RETURN_SUCCESS;
 }
@@ -348,6 +348,24 @@ QByteArray NfcTagType2::processCommand(const QByteArray &command)
 
         break;
     }
+    case 0x3a: {    // FAST_READ
+        quint8 startBlock = command.at(1);
+        quint8 endBlock = command.at(2);
+        if (endBlock < startBlock)
+            return NACK;
+
+        int absoluteBlock = currentSector * 256 + startBlock;
+        int length = (endBlock - startBlock + 1) * 4;
+
+        if (absoluteBlock * 4 >= memory.length())
+            return NACK;
+
+        response.append(memory.mid(absoluteBlock * 4, length));
+        if (response.length() != length)
+            response.append(QByteArray(length - response.length(), '\0'));
+
+        break;
+    }
     case 0xa2: {    // WRITE BLOCK
         quint8 block = command.at(1);
         int absoluteBlock = currentSector * 256 + block;
@@ -34,8 +34,12 @@
 #include <QLoggingCategory>
 
 #include <private/qtbluetoothglobal_p.h>
+#if QT_CONFIG(bluez) && defined(QT_BUILD_INTERNAL)
+#include <private/qbluetoothdevicediscoveryagent_p.h>
+#endif
 #include <qbluetoothaddress.h>
 #include <qbluetoothdevicediscoveryagent.h>
+#include <qbluetoothdevicediscoveryfilter.h>
 #include <qbluetoothlocaldevice.h>
 
 QT_USE_NAMESPACE
@@ -78,6 +82,9 @@ private slots:
 
     void tst_discoveryTimeout();
 
+    void tst_discoveryFilter();
+    void tst_pathlossFilter();
+
     void tst_discoveryMethods();
 private:
     int noOfLocalDevices;
@@ -412,6 +419,107 @@ void tst_QBluetoothDeviceDiscoveryAgent::tst_discoveryTimeout()
 #endif
 }
 
+void tst_QBluetoothDeviceDiscoveryAgent::tst_discoveryFilter()
+{
+    QBluetoothDeviceDiscoveryFilter filter;
+    QVERIFY(filter.isEmpty());
+    QVERIFY(filter.serviceUuids().isEmpty());
+    QVERIFY(filter.manufacturerIds().isEmpty());
+    QVERIFY(filter.namePrefix().isEmpty());
+    QCOMPARE(filter.rssiThreshold(), qint16(0));
+    QCOMPARE(filter.pathlossThreshold(), -1);
+    QVERIFY(filter.reportDuplicates());
+
+    const QList<QBluetoothUuid> uuids = {
+        QBluetoothUuid(QBluetoothUuid::ServiceClassUuid::HeartRate),
+        QBluetoothUuid(QBluetoothUuid::ServiceClassUuid::BatteryService) };
+    filter.setServiceUuids(uuids);
+    filter.setManufacturerIds({ 0x004c });
+    filter.setNamePrefix(QStringLiteral("Polar"));
+    filter.setReportDuplicates(false);
+    filter.setRssiThreshold(-70);
+    QVERIFY(!filter.isEmpty());
+    QCOMPARE(filter.serviceUuids(), uuids);
+    QCOMPARE(filter.manufacturerIds(), QList<quint16>{ 0x004c });
+    QCOMPARE(filter.namePrefix(), QStringLiteral("Polar"));
+    QVERIFY(!filter.reportDuplicates());
+    QCOMPARE(filter.rssiThreshold(), qint16(-70));
+
+    // RSSI and pathloss thresholds are mutually exclusive
+    filter.setPathlossThreshold(40);
+    QCOMPARE(filter.pathlossThreshold(), 40);
+    QCOMPARE(filter.rssiThreshold(), qint16(0));
+    filter.setRssiThreshold(-60);
+    QCOMPARE(filter.pathlossThreshold(), -1);
+
+    QBluetoothDeviceDiscoveryFilter copy = filter;
+    QCOMPARE(copy, filter);
+    copy.setNamePrefix(QString());
+    QVERIFY(copy != filter);
+
+    QBluetoothDeviceDiscoveryAgent agent;
+    QCOMPARE(agent.discoveryFilter(), QBluetoothDeviceDiscoveryFilter());
+    agent.setDiscoveryFilter(filter);
+    QCOMPARE(agent.discoveryFilter(), filter);
+}
+
+void tst_QBluetoothDeviceDiscoveryAgent::tst_pathlossFilter()
+{
+#if QT_CONFIG(bluez) && defined(QT_BUILD_INTERNAL)
+    using AgentPrivate = QBluetoothDeviceDiscoveryAgentPrivate;
+
+    QBluetoothDeviceDiscoveryFilter filter;
+    filter.setPathlossThreshold(40);
+    QBluetoothDeviceDiscoveryAgent agent;
+    agent.setDiscoveryFilter(filter);
+    AgentPrivate *d = AgentPrivate::get(&agent);
+    d->compileDiscoveryFilter();
+
+    const QVariantMap pushdown = d->discoveryFilterPushdown(QVariantMap());
+    QCOMPARE(pushdown.value(QStringLiteral("Pathloss")).value<quint16>(), quint16(40));
+    QVERIFY(!pushdown.contains(QStringLiteral("RSSI")));
+
+    // The pathloss is the advertised TX power minus the RSSI
+    const auto properties = [](qint16 rssi, qint16 txPower) {
+        return QVariantMap{ { QStringLiteral("RSSI"), QVariant::fromValue(rssi) },
+                            { QStringLiteral("TxPower"), QVariant::fromValue(txPower) } };
+    };
+    QCOMPARE(d->failedFilterCriteria(properties(-45, -10), AgentPrivate::AllCriteria), 0);
+    QCOMPARE(d->failedFilterCriteria(properties(-50, -10), AgentPrivate::AllCriteria), 0);
+    QCOMPARE(d->failedFilterCriteria(properties(-51, -10), AgentPrivate::AllCriteria),
+             int(AgentPrivate::PathlossCriterion));
+    QCOMPARE(d->failedFilterCriteria(properties(-45, -10), AgentPrivate::RssiCriterion), 0);
+
+    // Devices without TX power cannot be checked
+    const QVariantMap rssiOnly{ { QStringLiteral("RSSI"), QVariant::fromValue(qint16(-20)) } };
+    QCOMPARE(d->failedFilterCriteria(rssiOnly, AgentPrivate::AllCriteria),
+             int(AgentPrivate::PathlossCriterion));
+
+    // A rejected device is reconsidered with the last known value of the other property
+    const QString path = QStringLiteral("/org/bluez/hci0/dev_00_11_22_33_44_55");
+    const QString deviceInterface = QStringLiteral("org.bluez.Device1");
+    d->filteredDevicePaths.insert(path, { AgentPrivate::PathlossCriterion,
+                                          QVariant::fromValue(qint16(-60)),
+                                          QVariant::fromValue(qint16(-10)) });
+
+    d->_q_PropertiesChanged(deviceInterface, path,
+                            { { QStringLiteral("Alias"), QStringLiteral("Sensor") } }, {});
+    QCOMPARE(d->filteredDevicePaths.value(path).failedCriteria,
+             int(AgentPrivate::PathlossCriterion));
+
+    d->_q_PropertiesChanged(deviceInterface, path,
+                            { { QStringLiteral("RSSI"), QVariant::fromValue(qint16(-55)) } }, {});
+    QCOMPARE(d->filteredDevicePaths.value(path).failedCriteria,
+             int(AgentPrivate::PathlossCriterion));
+
+    d->_q_PropertiesChanged(deviceInterface, path,
+                            { { QStringLiteral("TxPower"), QVariant::fromValue(qint16(-20)) } }, {});
+    QCOMPARE(d->filteredDevicePaths.value(path).failedCriteria, 0);
+#else
+    QSKIP("Pathloss filtering test only applicable for developer builds with BlueZ");
+#endif
+}
+
 void tst_QBluetoothDeviceDiscoveryAgent::tst_discoveryMethods()
 {
     const QBluetoothLocalDevice localDevice;
@@ -0,0 +1,107 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtBluetooth module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#include <QtCore/QByteArray>
+#include <QtCore/QCoreApplication>
+#include <QtCore/QFile>
+#include <QtCore/QThread>
+#include <QtBluetooth/private/sdpscannerprotocol_p.h>
+#include <stdio.h>
+#include <iostream>
+#include <string>
+
+QT_USE_NAMESPACE
+
+/*
+ * Stands in for sdpscanner's worker mode (-w) in tests. The last byte of the
+ * remote address selects the answer:
+ *     FF  the request is never answered
+ *     FE  the scan fails with RETURN_SDP_ERROR
+ *     any other address gets one serial port record after 100 ms
+ * Every start and request is logged to the file named by QT_FAKE_SDPSCANNER_LOG.
+ */
+
+static void log(const QByteArray &line)
+{
+    QFile file(qEnvironmentVariable("QT_FAKE_SDPSCANNER_LOG"));
+    if (file.fileName().isEmpty() || !file.open(QIODevice::WriteOnly | QIODevice::Append))
+        return;
+    file.write(line + '\n');
+}
+
+static void writeFrame(quint8 status, quint16 recordCount, const QByteArray &records)
+{
+    const QByteArray frame = SdpScannerProtocol::frame(status, recordCount, records);
+    fwrite(frame.constData(), 1, size_t(frame.size()), stdout);
+    fflush(stdout);
+}
+
+static QByteArray serialPortRecord(const QByteArray &name)
+{
+    using namespace SdpScannerProtocol;
+
+    QByteArray record;
+    appendBigEndian<quint16>(record, 3);
+
+    appendBigEndian<quint16>(record, 0x0000); // ServiceRecordHandle
+    appendElement<quint32>(record, ElementUInt32, 0x00010001);
+
+    appendBigEndian<quint16>(record, 0x0001); // ServiceClassIds
+    appendListHeader(record, ElementSequence, 1);
+    appendElement<quint16>(record, ElementUuid16, 0x1101);
+
+    appendBigEndian<quint16>(record, 0x0100); // ServiceName
+    appendString(record, ElementText, name.constData(), quint32(name.size()));
+
+    return record;
+}
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+    log("start " + QByteArray::number(QCoreApplication::applicationPid()));
+
+    std::string line;
+    while (std::getline(std::cin, line)) {
+        const QByteArray request = QByteArray::fromStdString(line);
+        log(request);
+        const QByteArray remote = request.left(request.indexOf(' '));
+        if (remote.endsWith("FF"))
+            continue;
+        if (remote.endsWith("FE")) {
+            writeFrame(3, 0, QByteArray());
+            continue;
+        }
+
+        QThread::msleep(100);
+        writeFrame(0, 1, serialPortRecord("Serial Port " + remote));
+    }
+
+    return 0;
+}
@@ -39,6 +39,14 @@
 #include <qbluetoothlocaldevice.h>
 #include <qbluetoothserver.h>
 #include <qbluetoothserviceinfo.h>
+#include <private/qtbluetoothglobal_p.h>
+#include <private/qbluetoothservicecache_p.h>
+#if QT_CONFIG(bluez) && defined(QT_BUILD_INTERNAL)
+#include <private/qbluetoothservicediscoveryagent_p.h>
+#include <private/propertiesrouter_p.h>
+#include <private/sdpscannerprotocol_p.h>
+#include <QtDBus/QDBusMessage>
+#endif
 
 QT_USE_NAMESPACE
 
@@ -62,6 +70,11 @@ private slots:
     void initTestCase();
 
     void tst_invalidBtAddress();
+    void tst_concurrentScanLimit();
+    void tst_sdpScanScheduling();
+    void tst_sdpRecordEncoding();
+    void tst_cachedDiscovery();
+    void tst_serviceCacheDeviceChanges();
     void tst_serviceDiscovery_data();
     void tst_serviceDiscovery();
     void tst_serviceDiscoveryAdapters();
@@ -167,6 +180,317 @@ void tst_QBluetoothServiceDiscoveryAgent::tst_invalidBtAddress()
     delete discoveryAgent;
 }
 
+void tst_QBluetoothServiceDiscoveryAgent::tst_concurrentScanLimit()
+{
+    QBluetoothServiceDiscoveryAgent discoveryAgent;
+    QCOMPARE(discoveryAgent.concurrentScanLimit(), 3);
+
+    discoveryAgent.setConcurrentScanLimit(8);
+    QCOMPARE(discoveryAgent.concurrentScanLimit(), 8);
+
+    // at least one device is always queried
+    discoveryAgent.setConcurrentScanLimit(0);
+    QCOMPARE(discoveryAgent.concurrentScanLimit(), 1);
+    discoveryAgent.setConcurrentScanLimit(-5);
+    QCOMPARE(discoveryAgent.concurrentScanLimit(), 1);
+}
+
+void tst_QBluetoothServiceDiscoveryAgent::tst_sdpScanScheduling()
+{
+#if QT_CONFIG(bluez) && defined(QT_BUILD_INTERNAL)
+    const QString scanner = QCoreApplication::applicationDirPath()
+            + QStringLiteral("/fakesdpscanner");
+    if (!QFileInfo(scanner).isExecutable())
+        QSKIP("fakesdpscanner is not available");
+
+    QTemporaryDir logDir;
+    QVERIFY(logDir.isValid());
+    const QString logPath = logDir.filePath(QStringLiteral("requests.log"));
+    qputenv("QT_FAKE_SDPSCANNER_LOG", QFile::encodeName(logPath));
+
+    QBluetoothServiceDiscoveryAgent discoveryAgent;
+    discoveryAgent.setConcurrentScanLimit(2);
+    QSignalSpy finishedSpy(&discoveryAgent, SIGNAL(finished()));
+    QSignalSpy discoveredSpy(&discoveryAgent, SIGNAL(serviceDiscovered(QBluetoothServiceInfo)));
+    QSignalSpy errorSpy(&discoveryAgent, SIGNAL(errorOccurred(QBluetoothServiceDiscoveryAgent::Error)));
+
+    // the fake scanner never answers for FF and fails for FE
+    const QStringList addresses = { QStringLiteral("00:11:22:33:44:01"),
+                                    QStringLiteral("00:11:22:33:44:FF"),
+                                    QStringLiteral("00:11:22:33:44:02"),
+                                    QStringLiteral("00:11:22:33:44:FE"),
+                                    QStringLiteral("00:11:22:33:44:03"),
+                                    QStringLiteral("00:11:22:33:44:04") };
+
+    auto d = QBluetoothServiceDiscoveryAgentPrivate::get(&discoveryAgent);
+    d->sdpScannerPath = scanner;
+    d->sdpScanTimeout = 2000;
+    d->sdpWorkerIdleTimeout = 500;
+    d->localAdapterAddress = QBluetoothAddress(QStringLiteral("00:AA:BB:CC:DD:EE"));
+    d->setDiscoveryMode(QBluetoothServiceDiscoveryAgent::FullDiscovery);
+    for (const QString &address : addresses)
+        d->discoveredDevices.append(QBluetoothDeviceInfo(QBluetoothAddress(address), address, 0));
+    d->setDiscoveryState(QBluetoothServiceDiscoveryAgentPrivate::ServiceDiscovery);
+
+    QElapsedTimer elapsed;
+    elapsed.start();
+    d->scheduleSdpScans();
+    QCOMPARE(d->runningSdpScans.size(), 2);
+    QCOMPARE(d->discoveredDevices.size(), addresses.size() - 2);
+
+    int maxRunning = 0;
+    QTimer sampler;
+    sampler.setInterval(10);
+    connect(&sampler, &QTimer::timeout, this, [&]() {
+        maxRunning = qMax(maxRunning, int(d->runningSdpScans.size()));
+    });
+    sampler.start();
+
+    // the silent device holds its worker until the scan times out
+    QTRY_COMPARE_WITH_TIMEOUT(discoveredSpy.count(), 4, 1500);
+    QCOMPARE(d->runningSdpScans.size(), 1);
+    QVERIFY(d->discoveredDevices.isEmpty());
+    QCOMPARE(finishedSpy.count(), 0);
+
+    QTRY_COMPARE_WITH_TIMEOUT(finishedSpy.count(), 1, 10000);
+    QVERIFY(elapsed.elapsed() >= d->sdpScanTimeout);
+    QVERIFY(maxRunning <= 2);
+    QCOMPARE(errorSpy.count(), 0);
+    QVERIFY(!discoveryAgent.isActive());
+
+    QStringList discovered;
+    const QList<QBluetoothServiceInfo> services = discoveryAgent.discoveredServices();
+    for (const QBluetoothServiceInfo &info : services) {
+        discovered.append(info.device().address().toString());
+        QVERIFY(info.serviceClassUuids().contains(
+                    QBluetoothUuid(QBluetoothUuid::ServiceClassUuid::SerialPort)));
+    }
+    discovered.sort();
+    QCOMPARE(discovered, QStringList({ addresses.at(0), addresses.at(2),
+                                       addresses.at(4), addresses.at(5) }));
+
+    // every device was requested once, the two workers took all of them
+    QFile log(logPath);
+    QVERIFY(log.open(QIODevice::ReadOnly));
+    int starts = 0;
+    QStringList requested;
+    const QList<QByteArray> lines = log.readAll().split('\n');
+    for (const QByteArray &line : lines) {
+        if (line.startsWith("start "))
+            ++starts;
+        else if (!line.isEmpty())
+            requested.append(QString::fromLatin1(line.left(line.indexOf(' '))));
+    }
+    QCOMPARE(starts, 2);
+    requested.sort();
+    QStringList expected = addresses;
+    expected.sort();
+    QCOMPARE(requested, expected);
+
+    // the idle worker retires on its own
+    QTRY_VERIFY(d->idleSdpWorkers.isEmpty());
+    QTRY_VERIFY(d->sdpWorkerTimers.isEmpty());
+#else
+    QSKIP("This test requires a developer build with BlueZ");
+#endif
+}
+
+void tst_QBluetoothServiceDiscoveryAgent::tst_sdpRecordEncoding()
+{
+#if QT_CONFIG(bluez) && defined(QT_BUILD_INTERNAL)
+    using namespace SdpScannerProtocol;
+
+    const QBluetoothUuid uuid128(QStringLiteral("{e8e10f95-1a70-4b27-9ccf-02010264e9c8}"));
+    const QByteArray uuidBytes = uuid128.toRfc4122();
+    const QByteArray int128(16, '\x7f');
+    const QByteArray text("Serial Port \xc3\xa4");
+    const QByteArray url("http://www.qt.io/");
+
+    // every element type, in the form sdpscanner writes them
+    QByteArray record;
+    appendBigEndian<quint16>(record, 17);
+    appendBigEndian<quint16>(record, 0x0200);
+    appendElement<quint8>(record, ElementUInt8, 0xab);
+    appendBigEndian<quint16>(record, 0x0201);
+    appendElement<quint16>(record, ElementUInt16, 0xabcd);
+    appendBigEndian<quint16>(record, 0x0202);
+    appendElement<quint32>(record, ElementUInt32, 0xabcdef01);
+    appendBigEndian<quint16>(record, 0x0203);
+    appendElement<quint64>(record, ElementUInt64, Q_UINT64_C(0xabcdef0123456789));
+    appendBigEndian<quint16>(record, 0x0204);
+    appendElement128(record, ElementUInt128, int128.constData());
+    appendBigEndian<quint16>(record, 0x0205);
+    appendElement<qint8>(record, ElementInt8, -100);
+    appendBigEndian<quint16>(record, 0x0206);
+    appendElement<qint16>(record, ElementInt16, -30000);
+    appendBigEndian<quint16>(record, 0x0207);
+    appendElement<qint32>(record, ElementInt32, -2000000000);
+    appendBigEndian<quint16>(record, 0x0208);
+    appendElement<qint64>(record, ElementInt64, Q_INT64_C(-9000000000000000000));
+    appendBigEndian<quint16>(record, 0x0209);
+    appendElement128(record, ElementInt128, int128.constData());
+    appendBigEndian<quint16>(record, 0x020a);
+    appendElement<quint8>(record, ElementBool, 1);
+    appendBigEndian<quint16>(record, 0x020b);
+    appendElement<quint16>(record, ElementUuid16, 0x1101);
+    appendBigEndian<quint16>(record, 0x020c);
+    appendElement<quint32>(record, ElementUuid32, 0x12345678);
+    appendBigEndian<quint16>(record, 0x020d);
+    appendElement128(record, ElementUuid128, uuidBytes.constData());
+    appendBigEndian<quint16>(record, 0x020e);
+    appendString(record, ElementText, text.constData(), quint32(text.size()));
+    appendBigEndian<quint16>(record, 0x020f);
+    appendString(record, ElementUrl, url.constData(), quint32(url.size()));
+    appendBigEndian<quint16>(record, 0x0210);
+    appendListHeader(record, ElementSequence, 3);
+    appendElement<quint16>(record, ElementUuid16, 0x0100);
+    appendListHeader(record, ElementAlternative, 2);
+    appendElement<quint8>(record, ElementUInt8, 1);
+    appendElement<quint8>(record, ElementUInt8, 2);
+    record.append(char(ElementNil));
+
+    const QByteArray frame = SdpScannerProtocol::frame(0, 1, record);
+    QCOMPARE(qFromBigEndian<quint32>(frame.constData()), quint32(frame.size() - 4));
+
+    QBluetoothServiceDiscoveryAgent discoveryAgent;
+    auto d = QBluetoothServiceDiscoveryAgentPrivate::get(&discoveryAgent);
+    const QBluetoothDeviceInfo device(QBluetoothAddress(QStringLiteral("00:11:22:33:44:01")),
+                                      QStringLiteral("device"), 0);
+
+    QDataStream stream(frame.mid(4));
+    quint8 status = 0xff;
+    quint16 recordCount = 0;
+    stream >> status >> recordCount;
+    QCOMPARE(status, quint8(0));
+    QCOMPARE(recordCount, quint16(1));
+    const QBluetoothServiceInfo info = d->parseServiceRecord(device, stream);
+    QCOMPARE(stream.status(), QDataStream::Ok);
+    QVERIFY(stream.atEnd());
+    QCOMPARE(info.device().address(), device.address());
+
+    QCOMPARE(info.attribute(0x0200), QVariant::fromValue(quint8(0xab)));
+    QCOMPARE(info.attribute(0x0201), QVariant::fromValue(quint16(0xabcd)));
+    QCOMPARE(info.attribute(0x0202), QVariant::fromValue(quint32(0xabcdef01)));
+    QCOMPARE(info.attribute(0x0203), QVariant::fromValue(Q_UINT64_C(0xabcdef0123456789)));
+    // 128 bit integers are skipped without losing track of the following elements
+    QVERIFY(!info.attribute(0x0204).isValid());
+    QCOMPARE(info.attribute(0x0205), QVariant::fromValue(qint8(-100)));
+    QCOMPARE(info.attribute(0x0206), QVariant::fromValue(qint16(-30000)));
+    QCOMPARE(info.attribute(0x0207), QVariant::fromValue(qint32(-2000000000)));
+    QCOMPARE(info.attribute(0x0208), QVariant::fromValue(Q_INT64_C(-9000000000000000000)));
+    QVERIFY(!info.attribute(0x0209).isValid());
+    QCOMPARE(info.attribute(0x020a), QVariant(true));
+    QCOMPARE(info.attribute(0x020b).value<QBluetoothUuid>(),
+             QBluetoothUuid(QBluetoothUuid::ServiceClassUuid::SerialPort));
+    QCOMPARE(info.attribute(0x020c).value<QBluetoothUuid>(), QBluetoothUuid(quint32(0x12345678)));
+    QCOMPARE(info.attribute(0x020d).value<QBluetoothUuid>(), uuid128);
+    QCOMPARE(info.attribute(0x020e).toString(), QString::fromUtf8(text));
+    QCOMPARE(info.attribute(0x020f).toString(), QString::fromLatin1(url));
+
+    const auto sequence = info.attribute(0x0210).value<QBluetoothServiceInfo::Sequence>();
+    QCOMPARE(sequence.size(), 3);
+    QCOMPARE(sequence.at(0).value<QBluetoothUuid>(), QBluetoothUuid(quint16(0x0100)));
+    const auto alternative = sequence.at(1).value<QBluetoothServiceInfo::Alternative>();
+    QCOMPARE(alternative.size(), 2);
+    QCOMPARE(alternative.at(0), QVariant::fromValue(quint8(1)));
+    QCOMPARE(alternative.at(1), QVariant::fromValue(quint8(2)));
+    QVERIFY(!sequence.at(2).isValid());
+
+    // a truncated record is detected, wherever it is cut
+    for (int length = 0; length < record.size(); ++length) {
+        QDataStream truncated(record.left(length));
+        d->parseServiceRecord(device, truncated);
+        QVERIFY2(truncated.status() != QDataStream::Ok, QByteArray::number(length));
+    }
+
+    // so is a string longer than the frame
+    QByteArray bogus;
+    appendBigEndian<quint16>(bogus, 1);
+    appendBigEndian<quint16>(bogus, 0x0100);
+    appendString(bogus, ElementText, text.constData(), quint32(text.size()));
+    qToBigEndian<quint32>(0x7fffffff, bogus.data() + 5);
+    QDataStream bogusStream(bogus);
+    const QBluetoothServiceInfo bogusInfo = d->parseServiceRecord(device, bogusStream);
+    QCOMPARE(bogusStream.status(), QDataStream::ReadCorruptData);
+    QVERIFY(!bogusInfo.attribute(0x0100).isValid());
+#else
+    QSKIP("This test requires a developer build with BlueZ");
+#endif
+}
+
+void tst_QBluetoothServiceDiscoveryAgent::tst_cachedDiscovery()
+{
+#ifdef QT_BUILD_INTERNAL
+    const QBluetoothAddress address(QStringLiteral("11:22:33:44:55:66"));
+    const QBluetoothDeviceInfo device(address, QStringLiteral("cached"), 0);
+
+    const auto serviceOfClass = [&device](QBluetoothUuid::ServiceClassUuid serviceClass) {
+        QBluetoothServiceInfo info;
+        info.setDevice(device);
+        QBluetoothServiceInfo::Sequence classIds;
+        classIds << QVariant::fromValue(QBluetoothUuid(serviceClass));
+        info.setAttribute(QBluetoothServiceInfo::ServiceClassIds, classIds);
+        return info;
+    };
+    const QBluetoothServiceInfo serialPort
+            = serviceOfClass(QBluetoothUuid::ServiceClassUuid::SerialPort);
+    const QBluetoothServiceInfo objectPush
+            = serviceOfClass(QBluetoothUuid::ServiceClassUuid::ObexObjectPush);
+
+    QBluetoothServiceCache *cache = QBluetoothServiceCache::instance();
+    cache->clear();
+    cache->insert(address, {}, { serialPort, objectPush });
+
+    // unfiltered results answer filtered lookups
+    QList<QBluetoothServiceInfo> services;
+    QVERIFY(cache->lookup(address, { QBluetoothUuid(QBluetoothUuid::ServiceClassUuid::SerialPort) },
+                          1000, &services));
+    QCOMPARE(services.count(), 1);
+    QCOMPARE(services.first().serviceClassUuids(), serialPort.serviceClassUuids());
+    QVERIFY(!cache->lookup(QBluetoothAddress(QStringLiteral("11:22:33:44:55:77")), {}, 1000,
+                           &services));
+
+    QBluetoothServiceDiscoveryAgent discoveryAgent;
+    QCOMPARE(discoveryAgent.maximumCacheAge(), 300000);
+    QVERIFY(discoveryAgent.setRemoteAddress(address));
+    QSignalSpy serviceSpy(&discoveryAgent, &QBluetoothServiceDiscoveryAgent::serviceDiscovered);
+    QSignalSpy finishedSpy(&discoveryAgent, &QBluetoothServiceDiscoveryAgent::finished);
+
+    // the results arrive from the event loop without contacting the device
+    discoveryAgent.start(QBluetoothServiceDiscoveryAgent::CachedOnlyDiscovery);
+    QVERIFY(discoveryAgent.isActive());
+    QCOMPARE(serviceSpy.count(), 0);
+    QTRY_COMPARE(finishedSpy.count(), 1);
+    QVERIFY(!discoveryAgent.isActive());
+    QCOMPARE(serviceSpy.count(), 2);
+    QCOMPARE(discoveryAgent.discoveredServices().count(), 2);
+
+    // expired results are ignored
+    discoveryAgent.clear();
+    discoveryAgent.setMaximumCacheAge(0);
+    serviceSpy.clear();
+    discoveryAgent.start(QBluetoothServiceDiscoveryAgent::CachedOnlyDiscovery);
+    QTRY_COMPARE(finishedSpy.count(), 2);
+    QCOMPARE(serviceSpy.count(), 0);
+
+    // stopping cancels the lookup
+    QSignalSpy canceledSpy(&discoveryAgent, &QBluetoothServiceDiscoveryAgent::canceled);
+    discoveryAgent.setMaximumCacheAge(1000);
+    discoveryAgent.start(QBluetoothServiceDiscoveryAgent::CachedOnlyDiscovery);
+    discoveryAgent.stop();
+    QCOMPARE(canceledSpy.count(), 1);
+    QVERIFY(!discoveryAgent.isActive());
+    QTest::qWait(50);
+    QCOMPARE(serviceSpy.count(), 0);
+    QCOMPARE(finishedSpy.count(), 2);
+
+    cache->invalidate(address);
+    QVERIFY(!cache->lookup(address, {}, 1000, &services));
+#else
+    QSKIP("Service cache test only applicable to developer builds");
+#endif
+}
+
 void tst_QBluetoothServiceDiscoveryAgent::serviceDiscoveryDebug(const QBluetoothServiceInfo &info)
 {
     qDebug() << "Discovered service on"
@@ -461,6 +785,54 @@ void tst_QBluetoothServiceDiscoveryAgent::tst_serviceDiscovery()
     QVERIFY(!discoveryAgent.isActive());
 }
 
+void tst_QBluetoothServiceDiscoveryAgent::tst_serviceCacheDeviceChanges()
+{
+#if QT_CONFIG(bluez) && defined(QT_BUILD_INTERNAL)
+    const QBluetoothAddress address(QStringLiteral("11:22:33:44:55:66"));
+    QBluetoothServiceInfo service;
+    service.setDevice(QBluetoothDeviceInfo(address, QStringLiteral("cached"), 0));
+    service.setServiceUuid(QBluetoothUuid(QBluetoothUuid::ServiceClassUuid::SerialPort));
+
+    QBluetoothServiceCache *cache = QBluetoothServiceCache::instance();
+    QCOMPARE(cache->thread(), thread());
+    cache->clear();
+
+    // an agent on another thread fills the cache and starts the monitoring
+    QScopedPointer<QThread> agentThread(QThread::create([cache, address, service]() {
+        cache->insert(address, {}, { service });
+    }));
+    agentThread->start();
+    QVERIFY(agentThread->wait());
+
+    // Device1 property changes as the router receives them from BlueZ
+    const auto sendPropertiesChanged = [](const QString &path, const QVariantMap &changed) {
+        QDBusMessage message = QDBusMessage::createSignal(
+                path, QStringLiteral("org.freedesktop.DBus.Properties"),
+                QStringLiteral("PropertiesChanged"));
+        message << QStringLiteral("org.bluez.Device1") << changed << QStringList();
+        return QMetaObject::invokeMethod(QtBluezPropertiesRouter::instance(),
+                                         "pathNamespaceSignal", Qt::DirectConnection,
+                                         Q_ARG(QDBusMessage, message));
+    };
+
+    QList<QBluetoothServiceInfo> services;
+    QVERIFY(sendPropertiesChanged(QStringLiteral("/org/bluez/hci0/dev_11_22_33_44_55_66"),
+                                  { { QStringLiteral("RSSI"), -60 } }));
+    QVERIFY(sendPropertiesChanged(QStringLiteral("/org/bluez/hci0/dev_11_22_33_44_55_77"),
+                                  { { QStringLiteral("UUIDs"), QStringList() } }));
+    QVERIFY(cache->lookup(address, {}, 1000, &services));
+    QCOMPARE(services.count(), 1);
+
+    // changed UUIDs drop the entries of that device
+    QVERIFY(sendPropertiesChanged(QStringLiteral("/org/bluez/hci0/dev_11_22_33_44_55_66"),
+                                  { { QStringLiteral("UUIDs"), QStringList() } }));
+    QTRY_VERIFY(!cache->lookup(address, {}, 1000, &services));
+    QVERIFY(!cache->devices().contains(address));
+#else
+    QSKIP("Service cache monitoring test only applicable to developer builds with BlueZ");
+#endif
+}
+
 QTEST_MAIN(tst_QBluetoothServiceDiscoveryAgent)
 
 #include "tst_qbluetoothservicediscoveryagent.moc"
@@ -33,12 +33,15 @@
 #include <QtBluetooth/qlowenergyadvertisingdata.h>
 #include <QtBluetooth/qlowenergyadvertisingparameters.h>
 #include <QtBluetooth/qlowenergyconnectionparameters.h>
+#include <QtBluetooth/qlowenergyconnectionstatistics.h>
 #include <QtBluetooth/qlowenergycontroller.h>
 #include <QtBluetooth/qlowenergycharacteristicdata.h>
 #include <QtBluetooth/qlowenergydescriptordata.h>
 #include <QtBluetooth/qlowenergyservicedata.h>
 #include <QtCore/qendian.h>
 #include <QtCore/qscopedpointer.h>
+#include <QtCore/qscopeguard.h>
+#include <QtCore/qthread.h>
 //#include <QtCore/qloggingcategory.h>
 #include <QtTest/qsignalspy.h>
 #include <QtTest/QtTest>
@@ -46,8 +49,20 @@
 #ifdef Q_OS_LINUX
 #include <QtBluetooth/private/lecmaccalculator_p.h>
 #endif
+#if defined(CONFIG_BLUEZ_LE) && defined(QT_BUILD_INTERNAL)
+#include <QtBluetooth/private/attcapture_p.h>
+#include <QtBluetooth/private/attloopback_p.h>
+#include <QtBluetooth/private/atttransmitqueue_p.h>
+#include <QtBluetooth/private/hcimanager_p.h>
+#include <QtBluetooth/private/qleadvertiser_p.h>
+#include <QtBluetooth/private/qlowenergycontroller_bluez_p.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
 
 #include <algorithm>
+#include <numeric>
 #include <cstring>
 
 using namespace QBluetooth;
@@ -66,7 +81,24 @@ private slots:
     void cmacVerifier_data();
     void connectionParameters();
     void controllerType();
+    void linkParameterPreferences();
+    void hciLinkParameterEvents();
+    void extendedAdvertisingCommands();
+    void extendedAdvertisingFallback();
+    void advertisingDataUpdate();
+    void notificationBackpressure();
     void serviceData();
+    void batchedCharacteristicUpdate();
+    void attCaptureReplay();
+    void connectionStatistics();
+    void gattRequestTimeout();
+    void gattRequestTimeoutConnectionUpdate();
+    void asyncRequests();
+    void engineThreads();
+    void notificationBatching();
+    void longWrites();
+    void controllerLinkParameterEvents();
+    void valueProvider();
 
     // Interaction with actual GATT server goes here. Order is relevant.
     void advertisedData();
@@ -129,6 +161,26 @@ void TestQLowEnergyControllerGattServer::advertisingParameters()
 
 void TestQLowEnergyControllerGattServer::advertisingData()
 {
+    QLowEnergyAdvertisingParameters extendedParams;
+    QVERIFY(!extendedParams.isExtendedAdvertising());
+    QCOMPARE(extendedParams.advertisingSetId(), quint8(0));
+    QCOMPARE(extendedParams.periodicMinimumInterval(), 0);
+    QCOMPARE(extendedParams.periodicMaximumInterval(), 0);
+    extendedParams.setExtendedAdvertising(true);
+    extendedParams.setAdvertisingSetId(42); // clamped
+    QCOMPARE(extendedParams.advertisingSetId(), quint8(15));
+    extendedParams.setPeriodicInterval(200, 100);
+    QCOMPARE(extendedParams.periodicMinimumInterval(), 200);
+    QCOMPARE(extendedParams.periodicMaximumInterval(), 200);
+    QVERIFY(extendedParams != QLowEnergyAdvertisingParameters());
+    QLowEnergyAdvertisingParameters periodicParams;
+    periodicParams.setPeriodicInterval(-1, 100);
+    QCOMPARE(periodicParams.periodicMinimumInterval(), 0);
+    QCOMPARE(periodicParams.periodicMaximumInterval(), 0);
+    periodicParams.setPeriodicInterval(70000, 90000); // beyond 16 bits
+    QCOMPARE(periodicParams.periodicMinimumInterval(), 70000);
+    QCOMPARE(periodicParams.periodicMaximumInterval(), 90000);
+
     QLowEnergyAdvertisingData data;
     QCOMPARE(data, QLowEnergyAdvertisingData());
     QCOMPARE(data.discoverability(), QLowEnergyAdvertisingData::DiscoverabilityNone);
@@ -558,6 +610,389 @@ void TestQLowEnergyControllerGattServer::controllerType()
     QCOMPARE(controller->role(), QLowEnergyController::PeripheralRole);
 }
 
+void TestQLowEnergyControllerGattServer::linkParameterPreferences()
+{
+    const QScopedPointer<QLowEnergyController> controller(QLowEnergyController::createPeripheral());
+    QVERIFY(!controller.isNull());
+    QCOMPARE(controller->preferredMtu(), 0);
+    QCOMPARE(controller->preferredDataLength(), 0);
+    QCOMPARE(controller->preferredPhys(), QLowEnergyController::Phys());
+
+    controller->setPreferredMtu(247);
+    QCOMPARE(controller->preferredMtu(), 247);
+    controller->setPreferredMtu(-1);
+    QCOMPARE(controller->preferredMtu(), 0);
+
+    controller->setPreferredDataLength(251);
+    QCOMPARE(controller->preferredDataLength(), 251);
+
+    controller->setPreferredPhys(QLowEnergyController::Phy1M | QLowEnergyController::Phy2M);
+    QCOMPARE(controller->preferredPhys(),
+             QLowEnergyController::Phy1M | QLowEnergyController::Phy2M);
+}
+
+void TestQLowEnergyControllerGattServer::hciLinkParameterEvents()
+{
+#if defined(CONFIG_BLUEZ_LE) && defined(QT_BUILD_INTERNAL)
+    // A socket pair stands in for the HCI socket: one end is handed to HciManager,
+    // the other one feeds events and receives the issued commands.
+    int fds[2];
+    QCOMPARE(::socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fds), 0);
+    HciManager manager(fds[0], 0);
+    QVERIFY(manager.isValid());
+
+    QSignalSpy dataLengthSpy(&manager, &HciManager::dataLengthChanged);
+    QSignalSpy phySpy(&manager, &HciManager::phyUpdateComplete);
+
+    // HCI event packet, LE Meta event, LE Data Length Change
+    const QByteArray dataLengthEvent = QByteArray::fromHex("043e0b074000fb004808fb004808");
+    QCOMPARE(::write(fds[1], dataLengthEvent.constData(), dataLengthEvent.size()),
+             ssize_t(dataLengthEvent.size()));
+    QTRY_COMPARE(dataLengthSpy.count(), 1);
+    QCOMPARE(dataLengthSpy.at(0).at(0).value<quint16>(), quint16(0x40));
+    QCOMPARE(dataLengthSpy.at(0).at(1).value<quint16>(), quint16(251));
+    QCOMPARE(dataLengthSpy.at(0).at(2).value<quint16>(), quint16(251));
+
+    // LE PHY Update Complete, failed and successful
+    const QByteArray failedPhyEvent = QByteArray::fromHex("043e060c1a40000101");
+    QCOMPARE(::write(fds[1], failedPhyEvent.constData(), failedPhyEvent.size()),
+             ssize_t(failedPhyEvent.size()));
+    const QByteArray phyEvent = QByteArray::fromHex("043e060c0040000202");
+    QCOMPARE(::write(fds[1], phyEvent.constData(), phyEvent.size()),
+             ssize_t(phyEvent.size()));
+    QTRY_COMPARE(phySpy.count(), 1);
+    QCOMPARE(phySpy.at(0).at(0).value<quint16>(), quint16(0x40));
+    QCOMPARE(phySpy.at(0).at(1).value<quint8>(), quint8(2));
+    QCOMPARE(phySpy.at(0).at(2).value<quint8>(), quint8(2));
+
+    // Commands are written as HCI command packets with LE opcodes
+    char buffer[64];
+    QVERIFY(manager.sendLeSetDataLength(0x40, 251, 2120));
+    ssize_t size = ::read(fds[1], buffer, sizeof buffer);
+    QCOMPARE(QByteArray(buffer, int(size)), QByteArray::fromHex("01222006" "4000fb004808"));
+
+    QVERIFY(manager.sendLeSetPhy(0x40, 0x2, 0x2));
+    size = ::read(fds[1], buffer, sizeof buffer);
+    QCOMPARE(QByteArray(buffer, int(size)), QByteArray::fromHex("01322007" "400000020200" "00"));
+
+    ::close(fds[1]);
+#else
+    QSKIP("HCI event test only applicable for developer builds on Linux with BlueZ");
+#endif
+}
+
+#if defined(CONFIG_BLUEZ_LE) && defined(QT_BUILD_INTERNAL)
+// Returns the next HCI command written to the fake HCI socket \a fd
+static QByteArray nextHciCommand(int fd)
+{
+    char buffer[300];
+    QDeadlineTimer deadline(5000);
+    while (!deadline.hasExpired()) {
+        const ssize_t size = ::read(fd, buffer, sizeof buffer);
+        if (size > 0)
+            return QByteArray(buffer, int(size));
+        QCoreApplication::processEvents(QEventLoop::AllEvents, 10);
+    }
+    return QByteArray();
+}
+
+static quint16 hciOpCode(const QByteArray &command)
+{
+    return command.size() < 3 ? 0 : qFromLittleEndian<quint16>(command.constData() + 1);
+}
+
+// Answers a command with a Command Complete event
+static void completeHciCommand(int fd, const QByteArray &command, quint8 status,
+                               const QByteArray &returnParameters = QByteArray())
+{
+    QByteArray event = QByteArray::fromHex("040e");
+    event.append(char(4 + returnParameters.size()));
+    event.append(char(1)); // number of allowed command packets
+    event.append(command.mid(1, 2));
+    event.append(char(status));
+    event.append(returnParameters);
+    QCOMPARE(::write(fd, event.constData(), event.size()), ssize_t(event.size()));
+}
+#endif
+
+void TestQLowEnergyControllerGattServer::extendedAdvertisingCommands()
+{
+#if defined(CONFIG_BLUEZ_LE) && defined(QT_BUILD_INTERNAL)
+    int fds[2];
+    QCOMPARE(::socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fds), 0);
+    QCOMPARE(::fcntl(fds[1], F_SETFL, O_NONBLOCK), 0);
+    // the advertiser disables the set on destruction, keep the other end open until then
+    const auto closeFakeSocket = qScopeGuard([&fds] { ::close(fds[1]); });
+    HciManager manager(fds[0], 0);
+
+    QLowEnergyAdvertisingParameters params;
+    params.setExtendedAdvertising(true);
+    params.setAdvertisingSetId(2);
+    params.setMode(QLowEnergyAdvertisingParameters::AdvNonConnInd);
+    params.setPeriodicInterval(100, 200);
+    QLowEnergyAdvertisingData data;
+    data.setRawData(QByteArray(300, 'x')); // does not fit into a single HCI command
+
+    QLeAdvertiserBluez advertiser(params, data, QLowEnergyAdvertisingData(), manager);
+    QSignalSpy errorSpy(&advertiser, &QLeAdvertiser::errorOccurred);
+    advertiser.startAdvertising();
+
+    // LE Read Maximum Advertising Data Length
+    QByteArray command = nextHciCommand(fds[1]);
+    QCOMPARE(hciOpCode(command), quint16(0x203a));
+    completeHciCommand(fds[1], command, 0, QByteArray::fromHex("7206"));
+
+    // Disabling an unknown set fails and is ignored
+    command = nextHciCommand(fds[1]);
+    QCOMPARE(command, QByteArray::fromHex("01392006" "000102000000"));
+    completeHciCommand(fds[1], command, 0x42);
+    command = nextHciCommand(fds[1]);
+    QCOMPARE(command, QByteArray::fromHex("0140200200" "02"));
+    completeHciCommand(fds[1], command, 0x0c);
+
+    // LE Set Extended Advertising Parameters, the TX power is returned
+    command = nextHciCommand(fds[1]);
+    QCOMPARE(command, QByteArray::fromHex("01362019" "02" "0000" "000800" "000800" "07" "00"
+                                          "00" "000000000000" "00" "7f" "01" "00" "01" "02"
+                                          "00"));
+    completeHciCommand(fds[1], command, 0, QByteArray::fromHex("f4"));
+
+    // LE Set Extended Advertising Data, split into two fragments
+    command = nextHciCommand(fds[1]);
+    QCOMPARE(command.left(8), QByteArray::fromHex("013720ff" "020101fb"));
+    QCOMPARE(command.size(), 4 + 4 + 251);
+    completeHciCommand(fds[1], command, 0);
+    command = nextHciCommand(fds[1]);
+    QCOMPARE(command.left(8), QByteArray::fromHex("01372035" "02020131"));
+    QCOMPARE(command.size(), 4 + 4 + 49);
+    completeHciCommand(fds[1], command, 0);
+
+    // Periodic advertising parameters, data and enable
+    command = nextHciCommand(fds[1]);
+    QCOMPARE(command, QByteArray::fromHex("013e2007" "02" "5000" "a000" "0000"));
+    completeHciCommand(fds[1], command, 0);
+    command = nextHciCommand(fds[1]);
+    QCOMPARE(command.left(7), QByteArray::fromHex("013f20ff" "0201fc"));
+    completeHciCommand(fds[1], command, 0);
+    command = nextHciCommand(fds[1]);
+    QCOMPARE(command.left(7), QByteArray::fromHex("013f2033" "020230"));
+    completeHciCommand(fds[1], command, 0);
+    command = nextHciCommand(fds[1]);
+    QCOMPARE(command, QByteArray::fromHex("0140200201" "02"));
+    completeHciCommand(fds[1], command, 0);
+
+    // LE Set Extended Advertising Enable
+    command = nextHciCommand(fds[1]);
+    QCOMPARE(command, QByteArray::fromHex("01392006" "010102000000"));
+    completeHciCommand(fds[1], command, 0);
+
+    QTest::qWait(50);
+    QCOMPARE(errorSpy.count(), 0);
+#else
+    QSKIP("HCI command test only applicable for developer builds on Linux with BlueZ");
+#endif
+}
+
+void TestQLowEnergyControllerGattServer::extendedAdvertisingFallback()
+{
+#if defined(CONFIG_BLUEZ_LE) && defined(QT_BUILD_INTERNAL)
+    int fds[2];
+    QCOMPARE(::socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fds), 0);
+    QCOMPARE(::fcntl(fds[1], F_SETFL, O_NONBLOCK), 0);
+    // the advertiser disables the set on destruction, keep the other end open until then
+    const auto closeFakeSocket = qScopeGuard([&fds] { ::close(fds[1]); });
+    HciManager manager(fds[0], 0);
+
+    QLowEnergyAdvertisingParameters params;
+    params.setExtendedAdvertising(true);
+    QLowEnergyAdvertisingData data;
+    data.setRawData(QByteArray(40, 'x'));
+
+    QLeAdvertiserBluez advertiser(params, data, QLowEnergyAdvertisingData(), manager);
+    advertiser.startAdvertising();
+
+    // Controllers without extended advertising reject the command as unknown
+    QByteArray command = nextHciCommand(fds[1]);
+    QCOMPARE(hciOpCode(command), quint16(0x203a));
+    completeHciCommand(fds[1], command, 0x01);
+
+    // Legacy sequence follows, the data is truncated to 31 bytes
+    command = nextHciCommand(fds[1]);
+    QCOMPARE(command, QByteArray::fromHex("010a200100"));
+    completeHciCommand(fds[1], command, 0);
+    command = nextHciCommand(fds[1]);
+    QCOMPARE(hciOpCode(command), quint16(0x2006));
+    completeHciCommand(fds[1], command, 0);
+    command = nextHciCommand(fds[1]);
+    QCOMPARE(command, QByteArray::fromHex("01082020" "1f") + QByteArray(31, 'x'));
+    completeHciCommand(fds[1], command, 0);
+    command = nextHciCommand(fds[1]);
+    QCOMPARE(command, QByteArray::fromHex("010a200101"));
+    completeHciCommand(fds[1], command, 0);
+#else
+    QSKIP("HCI command test only applicable for developer builds on Linux with BlueZ");
+#endif
+}
+
+void TestQLowEnergyControllerGattServer::advertisingDataUpdate()
+{
+#if defined(CONFIG_BLUEZ_LE) && defined(QT_BUILD_INTERNAL)
+    int fds[2];
+    QCOMPARE(::socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fds), 0);
+    QCOMPARE(::fcntl(fds[1], F_SETFL, O_NONBLOCK), 0);
+    // the advertiser disables advertising on destruction, keep the other end open until then
+    const auto closeFakeSocket = qScopeGuard([&fds] { ::close(fds[1]); });
+    HciManager manager(fds[0], 0);
+
+    QLowEnergyAdvertisingParameters params;
+    QLowEnergyAdvertisingData data;
+    data.setRawData(QByteArray("abc"));
+
+    QLeAdvertiserBluez advertiser(params, data, QLowEnergyAdvertisingData(), manager);
+    QSignalSpy errorSpy(&advertiser, &QLeAdvertiser::errorOccurred);
+    QSignalSpy updateSpy(&advertiser, &QLeAdvertiser::advertisingDataUpdated);
+    advertiser.startAdvertising();
+
+    // An update during the start sequence is applied once advertising is set up
+    QLowEnergyAdvertisingData responseData;
+    responseData.setRawData(QByteArray("xyz"));
+    advertiser.updateAdvertisingData(data, responseData);
+
+    QByteArray command = nextHciCommand(fds[1]);
+    QCOMPARE(command, QByteArray::fromHex("010a200100"));
+    completeHciCommand(fds[1], command, 0);
+    command = nextHciCommand(fds[1]);
+    QCOMPARE(hciOpCode(command), quint16(0x2006));
+    completeHciCommand(fds[1], command, 0);
+    command = nextHciCommand(fds[1]);
+    QCOMPARE(command, QByteArray::fromHex("01082020" "03") + "abc" + QByteArray(28, '\0'));
+    completeHciCommand(fds[1], command, 0);
+    command = nextHciCommand(fds[1]);
+    QCOMPARE(command, QByteArray::fromHex("010a200101"));
+    completeHciCommand(fds[1], command, 0);
+
+    // Only the scan response changed, advertising is not interrupted
+    command = nextHciCommand(fds[1]);
+    QCOMPARE(command, QByteArray::fromHex("01092020" "03") + "xyz" + QByteArray(28, '\0'));
+    QCOMPARE(updateSpy.count(), 0);
+    completeHciCommand(fds[1], command, 0);
+    QTRY_COMPARE(updateSpy.count(), 1);
+
+    // Unchanged data sends nothing but still reports completion
+    advertiser.updateAdvertisingData(data, responseData);
+    QTRY_COMPARE(updateSpy.count(), 2);
+    char buffer[64];
+    QCOMPARE(::read(fds[1], buffer, sizeof buffer), ssize_t(-1));
+
+    // Only the advertising data changed
+    QLowEnergyAdvertisingData newData;
+    newData.setRawData(QByteArray("abcd"));
+    advertiser.updateAdvertisingData(newData, responseData);
+    command = nextHciCommand(fds[1]);
+    QCOMPARE(command, QByteArray::fromHex("01082020" "04") + "abcd" + QByteArray(27, '\0'));
+    completeHciCommand(fds[1], command, 0);
+    QTRY_COMPARE(updateSpy.count(), 3);
+
+    // Failing updates are reported as errors
+    advertiser.updateAdvertisingData(newData, QLowEnergyAdvertisingData());
+    command = nextHciCommand(fds[1]);
+    QCOMPARE(command, QByteArray::fromHex("01092020" "00") + QByteArray(31, '\0'));
+    completeHciCommand(fds[1], command, 0x12);
+    QTRY_COMPARE(errorSpy.count(), 1);
+    QCOMPARE(updateSpy.count(), 3);
+#else
+    QSKIP("HCI command test only applicable for developer builds on Linux with BlueZ");
+#endif
+}
+
+void TestQLowEnergyControllerGattServer::notificationBackpressure()
+{
+    const QScopedPointer<QLowEnergyController> controller(QLowEnergyController::createPeripheral());
+    QCOMPARE(controller->notificationQueueLimit(), 64);
+    QCOMPARE(controller->notificationDropPolicy(), QLowEnergyController::DropOldestNotification);
+    controller->setNotificationQueueLimit(0);
+    QCOMPARE(controller->notificationQueueLimit(), 1);
+    controller->setNotificationDropPolicy(QLowEnergyController::DropNewestNotification);
+    QCOMPARE(controller->notificationDropPolicy(), QLowEnergyController::DropNewestNotification);
+    QCOMPARE(controller->queuedNotificationCount(), 0);
+    QCOMPARE(controller->droppedNotificationCount(), quint64(0));
+
+#if defined(CONFIG_BLUEZ_LE) && defined(QT_BUILD_INTERNAL)
+    // A socket pair stands in for the ATT bearer, the peer end is not read until
+    // the local end reports EAGAIN.
+    int fds[2];
+    QCOMPARE(::socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fds), 0);
+    QCOMPARE(::fcntl(fds[0], F_SETFL, O_NONBLOCK), 0);
+    QCOMPARE(::fcntl(fds[1], F_SETFL, O_NONBLOCK), 0);
+    const auto closeSockets = qScopeGuard([&fds] { ::close(fds[0]); ::close(fds[1]); });
+
+    AttTransmitQueue queue;
+    queue.setSocketDescriptor(fds[0]);
+    queue.setMaximumNotifications(4);
+
+    const auto notification = [](quint16 handle, quint32 value) {
+        QByteArray packet(7, Qt::Uninitialized);
+        packet[0] = char(0x1b); // ATT_OP_HANDLE_VAL_NOTIFICATION
+        qToLittleEndian(handle, packet.data() + 1);
+        qToLittleEndian(value, packet.data() + 3);
+        return packet;
+    };
+
+    // Saturate the link, the first packet which does not fit is queued
+    quint32 written = 0;
+    while (queue.queueDepth() == 0 && written < 1000000)
+        QVERIFY(queue.sendNotification(0x10, notification(0x10, written++)));
+    QCOMPARE(queue.queueDepth(), 1);
+
+    // A newer value replaces the queued one
+    QVERIFY(queue.sendNotification(0x10, notification(0x10, 0xffffffff)));
+    QCOMPARE(queue.queueDepth(), 1);
+    QCOMPARE(queue.coalescedNotifications(), quint64(1));
+
+    for (quint16 handle : { 0x20, 0x21, 0x22 })
+        QVERIFY(queue.sendNotification(handle, notification(handle, handle)));
+    QCOMPARE(queue.queuedNotificationCount(), 4);
+
+    // The limit is reached, the oldest notification makes room
+    QVERIFY(queue.sendNotification(0x30, notification(0x30, 0x30)));
+    QCOMPARE(queue.queuedNotificationCount(), 4);
+    QCOMPARE(queue.droppedNotifications(), quint64(1));
+
+    // Responses bypass the limit and are never dropped
+    const QByteArray response = QByteArray::fromHex("0b0102");
+    QVERIFY(queue.sendPacket(response));
+    QCOMPARE(queue.queueDepth(), 5);
+
+    queue.setDropPolicy(AttTransmitQueue::DropPolicy::DropNewest);
+    QVERIFY(queue.sendNotification(0x40, notification(0x40, 0x40)));
+    QCOMPARE(queue.queueDepth(), 5);
+    QCOMPARE(queue.droppedNotifications(), quint64(2));
+
+    // Draining the peer lets the queue flush in order
+    QList<QByteArray> received;
+    char buffer[64];
+    QDeadlineTimer deadline(5000);
+    while (received.size() < int(written) + 4 && !deadline.hasExpired()) {
+        const ssize_t size = ::read(fds[1], buffer, sizeof buffer);
+        if (size > 0)
+            received.append(QByteArray(buffer, int(size)));
+        else
+            QCoreApplication::processEvents(QEventLoop::AllEvents, 10);
+    }
+    QCOMPARE(received.size(), int(written) + 4);
+    QTRY_COMPARE(queue.queueDepth(), 0);
+
+    // all but the last value of handle 0x10 went out directly
+    QCOMPARE(received.at(int(written) - 2), notification(0x10, written - 2));
+    QCOMPARE(received.mid(int(written) - 1),
+             QList<QByteArray>({ notification(0x20, 0x20), notification(0x21, 0x21),
+                                 notification(0x22, 0x22), notification(0x30, 0x30),
+                                 response }));
+#else
+    QSKIP("ATT transmit queue test only applicable for developer builds on Linux with BlueZ");
+#endif
+}
+
 void TestQLowEnergyControllerGattServer::serviceData()
 {
     QLowEnergyDescriptorData descData;
@@ -602,6 +1037,18 @@ void TestQLowEnergyControllerGattServer::serviceData()
     QCOMPARE(charData.minimumValueLength(), 5);
     QCOMPARE(charData.maximumValueLength(), 5);
 
+    QVERIFY(!charData.valueProvider());
+    QCOMPARE(charData.valueProviderCacheTime(), 0);
+    QLowEnergyCharacteristicData providedCharData = charData;
+    providedCharData.setValueProvider([]() { return QByteArray("12345"); }, 60000);
+    QVERIFY(providedCharData.valueProvider());
+    QCOMPARE(providedCharData.valueProvider()(), QByteArray("12345"));
+    QCOMPARE(providedCharData.valueProviderCacheTime(), 60000);
+    QVERIFY(providedCharData != charData);
+    providedCharData.setValueProvider({}, -1);
+    QCOMPARE(providedCharData.valueProviderCacheTime(), 0);
+    QVERIFY(providedCharData == charData);
+
     const QLowEnergyCharacteristic::PropertyTypes props
             = QLowEnergyCharacteristic::Read | QLowEnergyCharacteristic::WriteSigned;
     charData.setProperties(props);
@@ -690,6 +1137,1180 @@ void TestQLowEnergyControllerGattServer::serviceData()
     QCOMPARE(includedServices.first(), secondaryService->serviceUuid());
 }
 
+void TestQLowEnergyControllerGattServer::batchedCharacteristicUpdate()
+{
+#ifdef Q_OS_DARWIN
+    QSKIP("GATT server functionality not implemented for Apple platforms");
+#endif
+    QLowEnergyServiceData serviceData;
+    serviceData.setUuid(QBluetoothUuid::ServiceClassUuid::EnvironmentalSensing);
+    const QLowEnergyDescriptorData clientConfig(
+                QBluetoothUuid::DescriptorType::ClientCharacteristicConfiguration,
+                QByteArray(2, 0));
+    for (const auto type : { QBluetoothUuid::CharacteristicType::Temperature,
+                             QBluetoothUuid::CharacteristicType::Humidity }) {
+        QLowEnergyCharacteristicData charData;
+        charData.setUuid(type);
+        charData.setProperties(QLowEnergyCharacteristic::Read | QLowEnergyCharacteristic::Notify);
+        charData.setValue("0");
+        charData.addDescriptor(clientConfig);
+        serviceData.addCharacteristic(charData);
+    }
+
+    const QScopedPointer<QLowEnergyController> controller(QLowEnergyController::createPeripheral());
+    const QScopedPointer<QLowEnergyService> service(controller->addService(serviceData));
+    QVERIFY(!service.isNull());
+    const QLowEnergyCharacteristic temperature =
+            service->characteristic(QBluetoothUuid::CharacteristicType::Temperature);
+    const QLowEnergyCharacteristic humidity =
+            service->characteristic(QBluetoothUuid::CharacteristicType::Humidity);
+
+    QVERIFY(!service->isUpdating());
+    service->beginUpdate();
+    QVERIFY(service->isUpdating());
+    service->writeCharacteristic(temperature, "1");
+    service->writeCharacteristic(humidity, "2");
+    service->beginUpdate();
+    service->writeCharacteristic(temperature, "3");
+    service->commitUpdate();
+
+    // only the outermost commit applies the values
+    QVERIFY(service->isUpdating());
+    QCOMPARE(temperature.value(), QByteArray("0"));
+    QCOMPARE(humidity.value(), QByteArray("0"));
+
+    service->commitUpdate();
+    QVERIFY(!service->isUpdating());
+    QCOMPARE(temperature.value(), QByteArray("3"));
+    QCOMPARE(humidity.value(), QByteArray("2"));
+
+    // outside of an update writes are applied right away
+    service->writeCharacteristic(humidity, "4");
+    QCOMPARE(humidity.value(), QByteArray("4"));
+
+    QTest::ignoreMessage(QtWarningMsg,
+                         "QLowEnergyService::commitUpdate() called without beginUpdate()");
+    service->commitUpdate();
+}
+
+void TestQLowEnergyControllerGattServer::attCaptureReplay()
+{
+#if defined(CONFIG_BLUEZ_LE) && defined(QT_BUILD_INTERNAL)
+    QTemporaryDir captureDir;
+    QVERIFY(captureDir.isValid());
+    const QString fileName = captureDir.filePath(QStringLiteral("att.btsnoop"));
+
+    QLowEnergyServiceData serviceData;
+    serviceData.setUuid(QBluetoothUuid::ServiceClassUuid::BatteryService);
+    QLowEnergyCharacteristicData charData;
+    charData.setUuid(QBluetoothUuid::CharacteristicType::BatteryLevel);
+    charData.setProperties(QLowEnergyCharacteristic::Read);
+    charData.setValue(QByteArray(1, 0x64));
+    serviceData.addCharacteristic(charData);
+
+    const QScopedPointer<QLowEnergyController> controller(QLowEnergyController::createPeripheral());
+    const QScopedPointer<QLowEnergyService> service(controller->addService(serviceData));
+    QVERIFY(!service.isNull());
+    const QLowEnergyHandle valueHandle =
+            service->characteristic(QBluetoothUuid::CharacteristicType::BatteryLevel).handle();
+    QVERIFY(valueHandle != 0);
+
+    QByteArray readRequest(3, Qt::Uninitialized);
+    readRequest[0] = char(0x0a); // ATT_OP_READ_REQUEST
+    qToLittleEndian(valueHandle, readRequest.data() + 1);
+
+    // Write a capture of one connection, interleaved with a second one
+    {
+        AttCapture capture(fileName);
+        QVERIFY(capture.isOpen());
+        const quint16 channel = capture.openChannel();
+        const quint16 otherChannel = capture.openChannel();
+        QVERIFY(channel != otherChannel);
+        capture.record(channel, AttCaptureRecord::Received, readRequest);
+        capture.record(otherChannel, AttCaptureRecord::Received, readRequest);
+        capture.record(channel, AttCaptureRecord::Sent, QByteArray::fromHex("0b64"));
+        capture.record(channel, AttCaptureRecord::Received, QByteArray::fromHex("0af0ff"));
+        capture.record(channel, AttCaptureRecord::Sent, QByteArray::fromHex("010af0ff01"));
+    }
+
+    bool ok = false;
+    QList<AttCaptureRecord> records = AttCapture::readFile(fileName, &ok);
+    QVERIFY(ok);
+    QCOMPARE(records.size(), 5);
+    QCOMPARE(records.at(0).direction, AttCaptureRecord::Received);
+    QCOMPARE(records.at(0).pdu, readRequest);
+    QCOMPARE(records.at(2).direction, AttCaptureRecord::Sent);
+    QCOMPARE(records.at(2).pdu, QByteArray::fromHex("0b64"));
+    QVERIFY(records.at(0).timestamp > 0);
+    QVERIFY(records.at(4).timestamp >= records.at(0).timestamp);
+    const quint16 channel = records.at(0).channel;
+    records.removeIf([channel](const AttCaptureRecord &record) {
+        return record.channel != channel;
+    });
+    QCOMPARE(records.size(), 4);
+
+    QVERIFY(!AttCapture::readFile(captureDir.filePath(QStringLiteral("missing")), &ok).size());
+    QVERIFY(!ok);
+
+    // Replaying the capture reproduces the responses of the GATT server
+    AttReplayDriver driver(records);
+    QSignalSpy finishedSpy(&driver, &AttReplayDriver::finished);
+    QSignalSpy mismatchSpy(&driver, &AttReplayDriver::mismatch);
+    QVERIFY(driver.attach(controller.data()));
+    QCOMPARE(controller->state(), QLowEnergyController::ConnectedState);
+    driver.start();
+    QTRY_COMPARE(finishedSpy.count(), 1);
+    QVERIFY(driver.isFinished());
+    QCOMPARE(driver.replayedRecords(), 4);
+    QCOMPARE(driver.mismatches(), 0);
+    QCOMPARE(mismatchSpy.count(), 0);
+
+    // A diverging server is reported
+    records.last().pdu = QByteArray::fromHex("010af0ff0a");
+    AttReplayDriver divergingDriver(records);
+    QVERIFY(divergingDriver.attach(controller.data()));
+    divergingDriver.start();
+    QTRY_VERIFY(divergingDriver.isFinished());
+    QCOMPARE(divergingDriver.mismatches(), 1);
+
+    // The replay ends without a mismatch when the controller closes its end,
+    // attaching another driver replaces the socket of this one
+    QList<AttCaptureRecord> notification(1);
+    notification[0].direction = AttCaptureRecord::Sent;
+    notification[0].pdu = QByteArray::fromHex("1b0300ff");
+    AttReplayDriver closedDriver(notification);
+    QSignalSpy closedFinishedSpy(&closedDriver, &AttReplayDriver::finished);
+    QVERIFY(closedDriver.attach(controller.data()));
+    closedDriver.start();
+    AttReplayDriver nextDriver(records);
+    QVERIFY(nextDriver.attach(controller.data()));
+    QTest::qWait(100);
+    QCOMPARE(closedDriver.mismatches(), 0);
+    QCOMPARE(closedDriver.replayedRecords(), 0);
+    QVERIFY(!closedDriver.isFinished());
+    QCOMPARE(closedFinishedSpy.count(), 0);
+#else
+    QSKIP("ATT capture test only applicable for developer builds on Linux with BlueZ");
+#endif
+}
+
+void TestQLowEnergyControllerGattServer::connectionStatistics()
+{
+    const QLowEnergyConnectionStatistics empty;
+    QCOMPARE(empty.mtu(), -1);
+    QCOMPARE(empty.packetsSent(), quint64(0));
+    QCOMPARE(empty.requestCount(), quint64(0));
+    QVERIFY(empty.requestOpcodes().isEmpty());
+    QVERIFY(empty.latencyHistogram(0x0a).isEmpty());
+    const QList<qint64> limits = QLowEnergyConnectionStatistics::latencyBucketLimits();
+    QVERIFY(!limits.isEmpty());
+    QVERIFY(std::is_sorted(limits.cbegin(), limits.cend()));
+
+#if defined(CONFIG_BLUEZ_LE) && defined(QT_BUILD_INTERNAL)
+    QLowEnergyServiceData serviceData;
+    serviceData.setUuid(QBluetoothUuid::ServiceClassUuid::BatteryService);
+    QLowEnergyCharacteristicData charData;
+    charData.setUuid(QBluetoothUuid::CharacteristicType::BatteryLevel);
+    charData.setProperties(QLowEnergyCharacteristic::Read);
+    charData.setValue(QByteArray(1, 0x64));
+    serviceData.addCharacteristic(charData);
+
+    const QScopedPointer<QLowEnergyController> peripheral(
+                QLowEnergyController::createPeripheral());
+    const QScopedPointer<QLowEnergyService> peripheralService(peripheral->addService(serviceData));
+    QVERIFY(!peripheralService.isNull());
+    const QScopedPointer<QLowEnergyController> central(QLowEnergyController::createCentral(
+            QBluetoothDeviceInfo(QBluetoothAddress(QStringLiteral("00:11:22:33:44:55")),
+                                 QStringLiteral("loopback"), 0)));
+
+    AttLoopback loopback;
+    if (!loopback.connectControllers(central.data(), peripheral.data()))
+        QSKIP("Central role does not use the BlueZ kernel backend");
+
+    QSignalSpy discoveryFinished(central.data(), &QLowEnergyController::discoveryFinished);
+    central->discoverServices();
+    QVERIFY(discoveryFinished.wait());
+    const QScopedPointer<QLowEnergyService> centralService(
+                central->createServiceObject(QBluetoothUuid::ServiceClassUuid::BatteryService));
+    QVERIFY(!centralService.isNull());
+    centralService->discoverDetails();
+    QTRY_COMPARE(centralService->state(), QLowEnergyService::RemoteServiceDiscovered);
+
+    QSignalSpy readSpy(centralService.data(), &QLowEnergyService::characteristicRead);
+    centralService->readCharacteristic(
+                centralService->characteristic(QBluetoothUuid::CharacteristicType::BatteryLevel));
+    QVERIFY(readSpy.wait());
+
+    const QLowEnergyConnectionStatistics centralStats = central->connectionStatistics();
+    const QLowEnergyConnectionStatistics peripheralStats = peripheral->connectionStatistics();
+    QCOMPARE(centralStats.mtu(), central->mtu());
+    QCOMPARE(centralStats.pendingRequestCount(), 0);
+    QCOMPARE(centralStats.queuedPacketCount(), 0);
+    QVERIFY(centralStats.requestOpcodes().contains(0x02)); // Exchange MTU
+    QVERIFY(centralStats.requestOpcodes().contains(0x0a)); // Read
+    quint64 responses = 0;
+    for (quint8 opcode : centralStats.requestOpcodes()) {
+        const QList<quint64> histogram = centralStats.latencyHistogram(opcode);
+        QCOMPARE(histogram.size(), limits.size() + 1);
+        responses += std::accumulate(histogram.cbegin(), histogram.cend(), quint64(0));
+        QVERIFY(centralStats.totalLatency(opcode) >= 0);
+    }
+    QCOMPARE(responses, centralStats.requestCount());
+    QVERIFY(centralStats.errorResponseCount() > 0); // discovery ends with Attribute Not Found
+    QCOMPARE(centralStats.timeoutCount(), quint64(0));
+
+    // Everything one side sends is received by the other
+    QCOMPARE(centralStats.packetsSent(), peripheralStats.packetsReceived());
+    QCOMPARE(centralStats.bytesSent(), peripheralStats.bytesReceived());
+    QCOMPARE(peripheralStats.packetsSent(), centralStats.packetsReceived());
+    QCOMPARE(peripheralStats.bytesSent(), centralStats.bytesReceived());
+    QCOMPARE(centralStats.packetsSent(), centralStats.requestCount());
+    QVERIFY(peripheralStats.requestOpcodes().isEmpty());
+
+    central->resetConnectionStatistics();
+    const QLowEnergyConnectionStatistics resetStats = central->connectionStatistics();
+    QCOMPARE(resetStats.packetsSent(), quint64(0));
+    QCOMPARE(resetStats.bytesReceived(), quint64(0));
+    QCOMPARE(resetStats.requestCount(), quint64(0));
+    QVERIFY(resetStats.requestOpcodes().isEmpty());
+    QCOMPARE(resetStats.mtu(), central->mtu());
+    // the snapshot taken before the reset is unaffected
+    QVERIFY(centralStats.requestCount() > 0);
+#endif
+}
+
+void TestQLowEnergyControllerGattServer::gattRequestTimeout()
+{
+    const QScopedPointer<QLowEnergyController> central(QLowEnergyController::createCentral(
+            QBluetoothDeviceInfo(QBluetoothAddress(QStringLiteral("00:11:22:33:44:55")),
+                                 QStringLiteral("loopback"), 0)));
+    central->setGattRequestTimeout(-1);
+    QCOMPARE(central->gattRequestTimeout(), 0);
+    central->setGattRequestTimeout(20000);
+    QCOMPARE(central->gattRequestTimeout(), 20000);
+    QVERIFY(central->isAdaptiveGattRequestTimeout());
+    QCOMPARE(central->gattRequestTimeoutOverride(0x12), -1);
+    central->setGattRequestTimeoutOverride(0x12, 60000);
+    QCOMPARE(central->gattRequestTimeoutOverride(0x12), 60000);
+    QCOMPARE(central->effectiveGattRequestTimeout(0x12), 60000);
+    central->setGattRequestTimeoutOverride(0x12, -1);
+    QCOMPARE(central->gattRequestTimeoutOverride(0x12), -1);
+    // nothing has been measured yet
+    QCOMPARE(central->effectiveGattRequestTimeout(0x0a), 20000);
+
+#if defined(CONFIG_BLUEZ_LE) && defined(QT_BUILD_INTERNAL)
+    QLowEnergyServiceData serviceData;
+    serviceData.setUuid(QBluetoothUuid::ServiceClassUuid::BatteryService);
+    QLowEnergyCharacteristicData charData;
+    charData.setUuid(QBluetoothUuid::CharacteristicType::BatteryLevel);
+    charData.setProperties(QLowEnergyCharacteristic::Read);
+    charData.setValue(QByteArray(1, 0x64));
+    serviceData.addCharacteristic(charData);
+
+    const QScopedPointer<QLowEnergyController> peripheral(
+                QLowEnergyController::createPeripheral());
+    const QScopedPointer<QLowEnergyService> peripheralService(peripheral->addService(serviceData));
+    QVERIFY(!peripheralService.isNull());
+
+    // round trips of 200 ms
+    AttLoopback loopback;
+    loopback.setLatency(100);
+    if (!loopback.connectControllers(central.data(), peripheral.data()))
+        QSKIP("Central role does not use the BlueZ kernel backend");
+
+    QSignalSpy discoveryFinished(central.data(), &QLowEnergyController::discoveryFinished);
+    central->discoverServices();
+    QVERIFY(discoveryFinished.wait());
+    const QScopedPointer<QLowEnergyService> centralService(
+                central->createServiceObject(QBluetoothUuid::ServiceClassUuid::BatteryService));
+    QVERIFY(!centralService.isNull());
+    centralService->discoverDetails();
+    QTRY_COMPARE(centralService->state(), QLowEnergyService::RemoteServiceDiscovered);
+
+    // enough round trips were measured to shorten the timeout
+    const int adaptiveTimeout = central->effectiveGattRequestTimeout(0x0a);
+    QVERIFY(adaptiveTimeout >= 1000);
+    QVERIFY(adaptiveTimeout < 20000);
+    central->setAdaptiveGattRequestTimeout(false);
+    QCOMPARE(central->effectiveGattRequestTimeout(0x0a), 20000);
+    central->setAdaptiveGattRequestTimeout(true);
+    QCOMPARE(central->effectiveGattRequestTimeout(0x0a), adaptiveTimeout);
+
+    // A read which times out fails, its response arrives later and is discarded
+    const QLowEnergyCharacteristic batteryLevel =
+            centralService->characteristic(QBluetoothUuid::CharacteristicType::BatteryLevel);
+    QSignalSpy readSpy(centralService.data(), &QLowEnergyService::characteristicRead);
+    QSignalSpy errorSpy(centralService.data(), &QLowEnergyService::errorOccurred);
+    central->setGattRequestTimeoutOverride(0x0a, 50);
+    centralService->readCharacteristic(batteryLevel);
+    QVERIFY(errorSpy.wait());
+    QCOMPARE(errorSpy.first().first().value<QLowEnergyService::ServiceError>(),
+             QLowEnergyService::CharacteristicReadError);
+    QTRY_COMPARE(central->connectionStatistics().lateResponseCount(), quint64(1));
+    QCOMPARE(central->connectionStatistics().timeoutCount(), quint64(1));
+    QCOMPARE(central->state(), QLowEnergyController::DiscoveredState);
+    QVERIFY(readSpy.isEmpty());
+
+    // and the next request is not confused by it
+    central->setGattRequestTimeoutOverride(0x0a, -1);
+    centralService->readCharacteristic(batteryLevel);
+    QVERIFY(readSpy.wait());
+    QCOMPARE(readSpy.first().at(1).toByteArray(), QByteArray(1, 0x64));
+    QCOMPARE(central->connectionStatistics().timeoutCount(), quint64(1));
+#endif
+}
+
+void TestQLowEnergyControllerGattServer::asyncRequests()
+{
+#if defined(CONFIG_BLUEZ_LE) && defined(QT_BUILD_INTERNAL)
+    QLowEnergyServiceData serviceData;
+    serviceData.setUuid(QBluetoothUuid::ServiceClassUuid::BatteryService);
+    QLowEnergyCharacteristicData levelData;
+    levelData.setUuid(QBluetoothUuid::CharacteristicType::BatteryLevel);
+    levelData.setProperties(QLowEnergyCharacteristic::Read | QLowEnergyCharacteristic::Write);
+    levelData.setValue(QByteArray(1, 0x64));
+    QLowEnergyDescriptorData userDescription(
+                QBluetoothUuid::DescriptorType::CharacteristicUserDescription, "level");
+    userDescription.setWritePermissions(false);
+    levelData.addDescriptor(userDescription);
+    serviceData.addCharacteristic(levelData);
+    QLowEnergyCharacteristicData writeOnlyData;
+    writeOnlyData.setUuid(QBluetoothUuid::CharacteristicType::AlertLevel);
+    writeOnlyData.setProperties(QLowEnergyCharacteristic::Write);
+    writeOnlyData.setValue(QByteArray(1, 0));
+    serviceData.addCharacteristic(writeOnlyData);
+
+    const QScopedPointer<QLowEnergyController> peripheral(
+                QLowEnergyController::createPeripheral());
+    const QScopedPointer<QLowEnergyService> peripheralService(peripheral->addService(serviceData));
+    QVERIFY(!peripheralService.isNull());
+    const QScopedPointer<QLowEnergyController> central(QLowEnergyController::createCentral(
+            QBluetoothDeviceInfo(QBluetoothAddress(QStringLiteral("00:11:22:33:44:55")),
+                                 QStringLiteral("loopback"), 0)));
+
+    AttLoopback loopback;
+    if (!loopback.connectControllers(central.data(), peripheral.data()))
+        QSKIP("Central role does not use the BlueZ kernel backend");
+
+    QSignalSpy discoveryFinished(central.data(), &QLowEnergyController::discoveryFinished);
+    central->discoverServices();
+    QVERIFY(discoveryFinished.wait());
+    const QScopedPointer<QLowEnergyService> service(
+                central->createServiceObject(QBluetoothUuid::ServiceClassUuid::BatteryService));
+    QVERIFY(!service.isNull());
+    service->discoverDetails();
+    QTRY_COMPARE(service->state(), QLowEnergyService::RemoteServiceDiscovered);
+
+    const QLowEnergyCharacteristic level =
+            service->characteristic(QBluetoothUuid::CharacteristicType::BatteryLevel);
+    const QLowEnergyCharacteristic writeOnly =
+            service->characteristic(QBluetoothUuid::CharacteristicType::AlertLevel);
+    const QLowEnergyDescriptor description = level.descriptor(
+                QBluetoothUuid::DescriptorType::CharacteristicUserDescription);
+    QVERIFY(level.isValid());
+    QVERIFY(writeOnly.isValid());
+    QVERIFY(description.isValid());
+
+    // All requests are outstanding at once, every future gets its own result
+    QSignalSpy readSpy(service.data(), &QLowEnergyService::characteristicRead);
+    QFuture<QByteArray> firstRead = service->readCharacteristicAsync(level);
+    QFuture<void> write = service->writeCharacteristicAsync(level, QByteArray(1, 0x32));
+    QFuture<QByteArray> secondRead = service->readCharacteristicAsync(level);
+    QFuture<QByteArray> descriptorRead = service->readDescriptorAsync(description);
+    QFuture<QByteArray> failedRead = service->readCharacteristicAsync(writeOnly);
+    QFuture<void> descriptorWrite = service->writeDescriptorAsync(description, "other");
+    QFuture<QByteArray> lastRead = service->readCharacteristicAsync(level);
+    QTRY_VERIFY(lastRead.isFinished());
+
+    QVERIFY(firstRead.isFinished() && !firstRead.isCanceled());
+    QCOMPARE(firstRead.result(), QByteArray(1, 0x64));
+    QVERIFY(write.isFinished() && !write.isCanceled());
+    QCOMPARE(secondRead.result(), QByteArray(1, 0x32));
+    QCOMPARE(descriptorRead.result(), QByteArray("level"));
+    QVERIFY(failedRead.isFinished());
+    QVERIFY(failedRead.isCanceled());
+    QCOMPARE(service->error(), QLowEnergyService::CharacteristicReadError);
+    QVERIFY(descriptorWrite.isFinished());
+    QVERIFY(descriptorWrite.isCanceled());
+    QVERIFY(!lastRead.isCanceled());
+    QCOMPARE(lastRead.result(), QByteArray(1, 0x32));
+    // the signals are still emitted
+    QCOMPARE(readSpy.count(), 3);
+
+    // Requests which cannot be made fail right away
+    QFuture<QByteArray> invalidRead = service->readCharacteristicAsync(QLowEnergyCharacteristic());
+    QVERIFY(invalidRead.isFinished());
+    QVERIFY(invalidRead.isCanceled());
+    QCOMPARE(service->error(), QLowEnergyService::OperationError);
+
+    // Pending requests are canceled when the connection goes away
+    QFuture<QByteArray> abandonedRead = service->readCharacteristicAsync(level);
+    central->disconnectFromDevice();
+    QTRY_VERIFY(abandonedRead.isFinished());
+    QVERIFY(abandonedRead.isCanceled());
+#else
+    QSKIP("Asynchronous GATT API test only applicable for developer builds on Linux "
+          "with BlueZ");
+#endif
+}
+
+void TestQLowEnergyControllerGattServer::engineThreads()
+{
+    QVERIFY(QLowEnergyController::engineThreadCount() >= 0);
+
+#if defined(CONFIG_BLUEZ_LE) && defined(QT_BUILD_INTERNAL)
+    const int peerCount = 32;
+    const int valueCount = 100;
+
+    QLowEnergyServiceData serviceData;
+    serviceData.setUuid(QBluetoothUuid::ServiceClassUuid::BatteryService);
+    QLowEnergyCharacteristicData charData;
+    charData.setUuid(QBluetoothUuid::CharacteristicType::BatteryLevel);
+    charData.setProperties(QLowEnergyCharacteristic::Read | QLowEnergyCharacteristic::Notify);
+    charData.setValue(QByteArray(1, 0));
+    charData.addDescriptor(QLowEnergyDescriptorData(
+            QBluetoothUuid::DescriptorType::ClientCharacteristicConfiguration, QByteArray(2, 0)));
+    serviceData.addCharacteristic(charData);
+
+    struct Peer
+    {
+        QLowEnergyController *central = nullptr;
+        QLowEnergyService *centralService = nullptr;
+        QScopedPointer<QLowEnergyController> peripheral;
+        QScopedPointer<QLowEnergyService> peripheralService;
+        AttLoopback loopback;
+        QByteArray lastValue;
+        int notifications = 0;
+    };
+    std::vector<Peer> peers(peerCount);
+
+    // The fake peers run on this thread, the centrals on the engine threads
+    int centralsDestroyed = 0;
+    const auto cleanup = qScopeGuard([&]() {
+        int pending = 0;
+        for (Peer &peer : peers) {
+            if (!peer.central)
+                continue;
+            ++pending;
+            connect(peer.central, &QObject::destroyed, this, [&]() { ++centralsDestroyed; });
+            peer.central->deleteLater();
+        }
+        QTRY_COMPARE(centralsDestroyed, pending);
+    });
+
+    QObject receiver;
+    int discovered = 0;
+    int detailsDiscovered = 0;
+    int notificationsEnabled = 0;
+    bool wrongThread = false;
+    QSet<QThread *> engineThreads;
+    const auto checkThread = [&]() {
+        if (QThread::currentThread() != receiver.thread())
+            wrongThread = true;
+    };
+
+    for (int i = 0; i < peerCount; ++i) {
+        Peer &peer = peers[i];
+        peer.central = QLowEnergyController::createCentral(
+                QBluetoothDeviceInfo(QBluetoothAddress(Q_UINT64_C(0x001122330000) + i),
+                                     QStringLiteral("peer %1").arg(i), 0));
+        if (!peer.central->moveToEngineThread())
+            QSKIP("Central role does not use the BlueZ kernel backend");
+        QVERIFY(peer.central->thread() != thread());
+        engineThreads.insert(peer.central->thread());
+
+        peer.peripheral.reset(QLowEnergyController::createPeripheral());
+        peer.peripheralService.reset(peer.peripheral->addService(serviceData));
+        QVERIFY(!peer.peripheralService.isNull());
+
+        connect(peer.central, &QLowEnergyController::discoveryFinished, &receiver, [&]() {
+            checkThread();
+            ++discovered;
+        });
+        QVERIFY(peer.loopback.connectControllers(peer.central, peer.peripheral.data()));
+        QMetaObject::invokeMethod(peer.central, &QLowEnergyController::discoverServices);
+    }
+    QCOMPARE(engineThreads.size(), qMin(peerCount, QLowEnergyController::engineThreadCount()));
+    QTRY_COMPARE(discovered, peerCount);
+
+    for (Peer &peer : peers) {
+        QMetaObject::invokeMethod(peer.central, [&]() {
+            peer.centralService = peer.central->createServiceObject(
+                    QBluetoothUuid::ServiceClassUuid::BatteryService, peer.central);
+            QLowEnergyService *service = peer.centralService;
+            connect(service, &QLowEnergyService::stateChanged, &receiver,
+                    [&](QLowEnergyService::ServiceState state) {
+                checkThread();
+                if (state == QLowEnergyService::RemoteServiceDiscovered)
+                    ++detailsDiscovered;
+            });
+            connect(service, &QLowEnergyService::descriptorWritten, &receiver, [&]() {
+                checkThread();
+                ++notificationsEnabled;
+            });
+            connect(service, &QLowEnergyService::characteristicChanged, &receiver,
+                    [&](const QLowEnergyCharacteristic &, const QByteArray &value) {
+                checkThread();
+                ++peer.notifications;
+                peer.lastValue = value;
+            });
+            service->discoverDetails();
+        }, Qt::BlockingQueuedConnection);
+        QVERIFY(peer.centralService);
+    }
+    QTRY_COMPARE(detailsDiscovered, peerCount);
+
+    for (Peer &peer : peers) {
+        QMetaObject::invokeMethod(peer.central, [&]() {
+            const QLowEnergyCharacteristic level = peer.centralService->characteristic(
+                    QBluetoothUuid::CharacteristicType::BatteryLevel);
+            peer.centralService->writeDescriptor(level.clientCharacteristicConfiguration(),
+                                                 QLowEnergyCharacteristic::CCCDEnableNotification);
+        });
+    }
+    QTRY_COMPARE(notificationsEnabled, peerCount);
+
+    // All peers notify at the same time
+    for (int value = 1; value <= valueCount; ++value) {
+        for (Peer &peer : peers) {
+            peer.peripheralService->writeCharacteristic(
+                    peer.peripheralService->characteristic(
+                            QBluetoothUuid::CharacteristicType::BatteryLevel),
+                    QByteArray(1, char(value)));
+        }
+    }
+    for (const Peer &peer : peers) {
+        // congested notifications are coalesced, the latest value always arrives
+        QTRY_COMPARE(peer.lastValue, QByteArray(1, char(valueCount)));
+        QVERIFY(peer.notifications > 0);
+        QVERIFY(peer.notifications <= valueCount);
+    }
+    QVERIFY(!wrongThread);
+
+    // A peripheral on an engine thread looks up its bonding state there when
+    // the client connects and disconnects
+    QLowEnergyController *enginePeripheral = QLowEnergyController::createPeripheral();
+    bool enginePeripheralDestroyed = false;
+    int peripheralDisconnected = 0;
+    connect(enginePeripheral, &QObject::destroyed, this, [&]() {
+        enginePeripheralDestroyed = true;
+    });
+    const auto deletePeripheral = qScopeGuard([&]() {
+        enginePeripheral->deleteLater();
+        QTRY_VERIFY(enginePeripheralDestroyed);
+    });
+    QVERIFY(enginePeripheral->moveToEngineThread());
+    QVERIFY(enginePeripheral->thread() != thread());
+    QLowEnergyService *enginePeripheralService = nullptr;
+    QMetaObject::invokeMethod(enginePeripheral, [&]() {
+        enginePeripheralService = enginePeripheral->addService(serviceData, enginePeripheral);
+    }, Qt::BlockingQueuedConnection);
+    QVERIFY(enginePeripheralService);
+    connect(enginePeripheral, &QLowEnergyController::disconnected, &receiver, [&]() {
+        checkThread();
+        ++peripheralDisconnected;
+    });
+
+    const QScopedPointer<QLowEnergyController> localCentral(QLowEnergyController::createCentral(
+            QBluetoothDeviceInfo(QBluetoothAddress(QStringLiteral("00:11:22:33:44:ff")),
+                                 QStringLiteral("engine peripheral"), 0)));
+    AttLoopback peripheralLoopback;
+    QVERIFY(peripheralLoopback.connectControllers(localCentral.data(), enginePeripheral));
+    QSignalSpy localDiscovery(localCentral.data(), &QLowEnergyController::discoveryFinished);
+    localCentral->discoverServices();
+    QVERIFY(localDiscovery.wait());
+    const QScopedPointer<QLowEnergyService> localService(localCentral->createServiceObject(
+            QBluetoothUuid::ServiceClassUuid::BatteryService));
+    QVERIFY(!localService.isNull());
+    localService->discoverDetails();
+    QTRY_COMPARE(localService->state(), QLowEnergyService::RemoteServiceDiscovered);
+    const QLowEnergyCharacteristic localLevel =
+            localService->characteristic(QBluetoothUuid::CharacteristicType::BatteryLevel);
+    QSignalSpy cccdSpy(localService.data(), &QLowEnergyService::descriptorWritten);
+    localService->writeDescriptor(localLevel.clientCharacteristicConfiguration(),
+                                  QLowEnergyCharacteristic::CCCDEnableNotification);
+    QTRY_COMPARE(cccdSpy.count(), 1);
+
+    QSignalSpy changedSpy(localService.data(), &QLowEnergyService::characteristicChanged);
+    QMetaObject::invokeMethod(enginePeripheral, [&]() {
+        enginePeripheralService->writeCharacteristic(
+                enginePeripheralService->characteristic(
+                        QBluetoothUuid::CharacteristicType::BatteryLevel),
+                QByteArray(1, 42));
+    });
+    QTRY_COMPARE(changedSpy.count(), 1);
+    QCOMPARE(changedSpy.first().at(1).toByteArray(), QByteArray(1, 42));
+
+    localCentral->disconnectFromDevice();
+    QTRY_COMPARE(peripheralDisconnected, 1);
+    QVERIFY(!wrongThread);
+#else
+    QSKIP("Engine thread test only applicable for developer builds on Linux with BlueZ");
+#endif
+}
+
+void TestQLowEnergyControllerGattServer::notificationBatching()
+{
+#if defined(CONFIG_BLUEZ_LE) && defined(QT_BUILD_INTERNAL)
+    QLowEnergyServiceData serviceData;
+    serviceData.setUuid(QBluetoothUuid::ServiceClassUuid::BatteryService);
+    QLowEnergyCharacteristicData levelData;
+    levelData.setUuid(QBluetoothUuid::CharacteristicType::BatteryLevel);
+    levelData.setProperties(QLowEnergyCharacteristic::Read | QLowEnergyCharacteristic::Notify);
+    levelData.setValue(QByteArray(1, 0));
+    levelData.addDescriptor(QLowEnergyDescriptorData(
+            QBluetoothUuid::DescriptorType::ClientCharacteristicConfiguration, QByteArray(2, 0)));
+    serviceData.addCharacteristic(levelData);
+
+    const QScopedPointer<QLowEnergyController> peripheral(
+                QLowEnergyController::createPeripheral());
+    const QScopedPointer<QLowEnergyService> peripheralService(peripheral->addService(serviceData));
+    QVERIFY(!peripheralService.isNull());
+    const QScopedPointer<QLowEnergyController> central(QLowEnergyController::createCentral(
+            QBluetoothDeviceInfo(QBluetoothAddress(QStringLiteral("00:11:22:33:44:55")),
+                                 QStringLiteral("loopback"), 0)));
+
+    AttLoopback loopback;
+    if (!loopback.connectControllers(central.data(), peripheral.data()))
+        QSKIP("Central role does not use the BlueZ kernel backend");
+
+    QSignalSpy discoveryFinished(central.data(), &QLowEnergyController::discoveryFinished);
+    central->discoverServices();
+    QVERIFY(discoveryFinished.wait());
+    const QScopedPointer<QLowEnergyService> service(
+                central->createServiceObject(QBluetoothUuid::ServiceClassUuid::BatteryService));
+    QVERIFY(!service.isNull());
+    service->discoverDetails();
+    QTRY_COMPARE(service->state(), QLowEnergyService::RemoteServiceDiscovered);
+
+    const QLowEnergyCharacteristic level =
+            service->characteristic(QBluetoothUuid::CharacteristicType::BatteryLevel);
+    QSignalSpy descriptorWritten(service.data(), &QLowEnergyService::descriptorWritten);
+    service->writeDescriptor(level.clientCharacteristicConfiguration(),
+                             QLowEnergyCharacteristic::CCCDEnableNotification);
+    QTRY_COMPARE(descriptorWritten.count(), 1);
+
+    const QLowEnergyCharacteristic peripheralLevel =
+            peripheralService->characteristic(QBluetoothUuid::CharacteristicType::BatteryLevel);
+    const auto notify = [&](char value) {
+        peripheralService->writeCharacteristic(peripheralLevel, QByteArray(1, value));
+    };
+    const auto cachedValue = [&]() {
+        return service->characteristic(QBluetoothUuid::CharacteristicType::BatteryLevel).value();
+    };
+
+    QSignalSpy changedSpy(service.data(), &QLowEnergyService::characteristicChanged);
+    QSignalSpy batchSpy(service.data(), &QLowEnergyService::characteristicChangedBatch);
+
+    // The flush interval delivers buffered values without further calls
+    service->setNotificationBatching(50, 256);
+    QVERIFY(service->isNotificationBatchingEnabled());
+    notify(1);
+    notify(2);
+    QList<QByteArray> delivered;
+    const auto collectBatches = [&]() {
+        for (const QList<QVariant> &batch : std::as_const(batchSpy))
+            delivered += batch.at(1).value<QList<QByteArray>>();
+        batchSpy.clear();
+        return delivered.size();
+    };
+    QTRY_COMPARE(collectBatches(), 2);
+    QCOMPARE(delivered, (QList<QByteArray>{ QByteArray(1, 1), QByteArray(1, 2) }));
+    QCOMPARE(changedSpy.count(), 0);
+    // the value cache still follows the notifications
+    QCOMPARE(cachedValue(), QByteArray(1, 2));
+
+    // A full ring is flushed right away, nothing is dropped
+    service->setNotificationBatching(60000, 4);
+    for (char value = 3; value <= 7; ++value)
+        notify(value);
+    QTRY_COMPARE(cachedValue(), QByteArray(1, 7));
+    QCOMPARE(batchSpy.count(), 1);
+    QList<QVariant> batch = batchSpy.takeFirst();
+    QCOMPARE(batch.at(0).value<QLowEnergyCharacteristic>().uuid(), level.uuid());
+    QCOMPARE(batch.at(1).value<QList<QByteArray>>(),
+             (QList<QByteArray>{ QByteArray(1, 3), QByteArray(1, 4),
+                                 QByteArray(1, 5), QByteArray(1, 6) }));
+    const QList<qint64> timestamps = batch.at(2).value<QList<qint64>>();
+    QCOMPARE(timestamps.size(), 4);
+    QVERIFY(std::is_sorted(timestamps.cbegin(), timestamps.cend()));
+
+    // Disabling batching delivers the remainder before returning
+    service->disableNotificationBatching();
+    QVERIFY(!service->isNotificationBatchingEnabled());
+    QCOMPARE(batchSpy.count(), 1);
+    QCOMPARE(batchSpy.takeFirst().at(1).value<QList<QByteArray>>(),
+             QList<QByteArray>{ QByteArray(1, 7) });
+    notify(8);
+    QTRY_COMPARE(changedSpy.count(), 1);
+    QCOMPARE(batchSpy.count(), 0);
+    changedSpy.clear();
+
+    // SkipValueCacheUpdate leaves the cached value alone
+    service->setNotificationBatching(50, 256, QLowEnergyService::SkipValueCacheUpdate);
+    notify(9);
+    QTRY_COMPARE(batchSpy.count(), 1);
+    QCOMPARE(batchSpy.takeFirst().at(1).value<QList<QByteArray>>(),
+             QList<QByteArray>{ QByteArray(1, 9) });
+    QCOMPARE(cachedValue(), QByteArray(1, 8));
+
+    // Buffered values are delivered before the service becomes invalid
+    service->setNotificationBatching(60000, 256);
+    notify(10);
+    // with DefaultBatching the cache is updated when the value is buffered
+    QTRY_COMPARE(cachedValue(), QByteArray(1, 10));
+    QCOMPARE(batchSpy.count(), 0);
+    QList<QLowEnergyService::ServiceState> statesAtFlush;
+    connect(service.data(), &QLowEnergyService::characteristicChangedBatch, this, [&]() {
+        statesAtFlush.append(service->state());
+    });
+    central->disconnectFromDevice();
+    QTRY_COMPARE(service->state(), QLowEnergyService::InvalidService);
+    QCOMPARE(batchSpy.count(), 1);
+    QCOMPARE(batchSpy.takeFirst().at(1).value<QList<QByteArray>>(),
+             QList<QByteArray>{ QByteArray(1, 10) });
+    QCOMPARE(statesAtFlush, QList<QLowEnergyService::ServiceState>{
+                 QLowEnergyService::RemoteServiceDiscovered });
+    QCOMPARE(changedSpy.count(), 0);
+#else
+    QSKIP("Notification batching test only applicable for developer builds on Linux with BlueZ");
+#endif
+}
+
+void TestQLowEnergyControllerGattServer::longWrites()
+{
+#if defined(CONFIG_BLUEZ_LE) && defined(QT_BUILD_INTERNAL)
+    QLowEnergyServiceData serviceData;
+    serviceData.setUuid(QBluetoothUuid::ServiceClassUuid::DeviceInformation);
+    QLowEnergyCharacteristicData nameData;
+    nameData.setUuid(QBluetoothUuid::CharacteristicType::ManufacturerNameString);
+    nameData.setProperties(QLowEnergyCharacteristic::Read | QLowEnergyCharacteristic::Write);
+    nameData.setValue("initial");
+    nameData.setValueLength(0, 512);
+    serviceData.addCharacteristic(nameData);
+
+    const QScopedPointer<QLowEnergyController> peripheral(
+                QLowEnergyController::createPeripheral());
+    const QScopedPointer<QLowEnergyService> peripheralService(peripheral->addService(serviceData));
+    QVERIFY(!peripheralService.isNull());
+    const QScopedPointer<QLowEnergyController> central(QLowEnergyController::createCentral(
+            QBluetoothDeviceInfo(QBluetoothAddress(QStringLiteral("00:11:22:33:44:55")),
+                                 QStringLiteral("loopback"), 0)));
+    // the default MTU splits every value into parts of 18 bytes
+    central->setPreferredMtu(23);
+
+    // Replaces the prepare write responses selected by failResponses with an error
+    int prepareResponses = 0;
+    QList<int> failResponses;
+    AttLoopback loopback;
+    loopback.setCentralPacketFilter([&](const QByteArray &packet) {
+        if (packet.isEmpty() || quint8(packet.at(0)) != 0x17) // ATT_OP_PREPARE_WRITE_RESPONSE
+            return packet;
+        if (!failResponses.contains(prepareResponses++))
+            return packet;
+        QByteArray error(5, Qt::Uninitialized);
+        error[0] = char(0x01); // ATT_OP_ERROR_RESPONSE
+        error[1] = char(0x16); // ATT_OP_PREPARE_WRITE_REQUEST
+        error[2] = packet.at(1);
+        error[3] = packet.at(2);
+        error[4] = char(0x0e); // ATT_ERROR_UNLIKELY
+        return error;
+    });
+    if (!loopback.connectControllers(central.data(), peripheral.data()))
+        QSKIP("Central role does not use the BlueZ kernel backend");
+
+    QSignalSpy discoveryFinished(central.data(), &QLowEnergyController::discoveryFinished);
+    central->discoverServices();
+    QVERIFY(discoveryFinished.wait());
+    const QScopedPointer<QLowEnergyService> service(central->createServiceObject(
+            QBluetoothUuid::ServiceClassUuid::DeviceInformation));
+    QVERIFY(!service.isNull());
+    service->discoverDetails();
+    QTRY_COMPARE(service->state(), QLowEnergyService::RemoteServiceDiscovered);
+
+    const QLowEnergyCharacteristic name =
+            service->characteristic(QBluetoothUuid::CharacteristicType::ManufacturerNameString);
+    const QLowEnergyCharacteristic peripheralName = peripheralService->characteristic(
+            QBluetoothUuid::CharacteristicType::ManufacturerNameString);
+    QVERIFY(name.isValid());
+
+    QSignalSpy progressSpy(service.data(), &QLowEnergyService::characteristicWriteProgress);
+    QSignalSpy writtenSpy(service.data(), &QLowEnergyService::characteristicWritten);
+    QSignalSpy errorSpy(service.data(), &QLowEnergyService::errorOccurred);
+
+    // The largest valid value takes several prepare write requests
+    QByteArray longValue(512, Qt::Uninitialized);
+    for (int i = 0; i < longValue.size(); ++i)
+        longValue[i] = char(i % 251);
+    service->writeCharacteristicLong(name, longValue);
+    QTRY_COMPARE(writtenSpy.count(), 1);
+    QCOMPARE(writtenSpy.takeFirst().at(1).toByteArray(), longValue);
+    QCOMPARE(peripheralName.value(), longValue);
+    QVERIFY(progressSpy.count() > 1);
+    QCOMPARE(prepareResponses, progressSpy.count());
+    int lastWritten = 0;
+    for (const QList<QVariant> &progress : std::as_const(progressSpy)) {
+        QVERIFY(progress.at(1).toInt() > lastWritten);
+        QCOMPARE(progress.at(2).toInt(), longValue.size());
+        lastWritten = progress.at(1).toInt();
+    }
+    QCOMPARE(lastWritten, longValue.size());
+    QCOMPARE(errorSpy.count(), 0);
+    progressSpy.clear();
+
+    // Values beyond the attribute limit are refused before anything is sent
+    prepareResponses = 0;
+    service->writeCharacteristicLong(name, QByteArray(513, 'x'));
+    QCOMPARE(errorSpy.count(), 1);
+    QCOMPARE(service->error(), QLowEnergyService::CharacteristicWriteError);
+    service->writeCharacteristic(name, QByteArray(70000, 'x'));
+    QCOMPARE(errorSpy.count(), 2);
+    QCOMPARE(service->error(), QLowEnergyService::CharacteristicWriteError);
+    // a later request shows that nothing of the refused writes reached the link
+    QSignalSpy readSpy(service.data(), &QLowEnergyService::characteristicRead);
+    service->readCharacteristic(name);
+    QTRY_COMPARE(readSpy.count(), 1);
+    QCOMPARE(prepareResponses, 0);
+    QCOMPARE(peripheralName.value(), longValue);
+    errorSpy.clear();
+
+    // An error in the middle cancels that write only, the next one to the
+    // same handle stays queued
+    const QByteArray cancelledValue(100, 'c');
+    const QByteArray nextValue(100, 'n');
+    failResponses = { 2 };
+    service->writeCharacteristicLong(name, cancelledValue);
+    service->writeCharacteristicLong(name, nextValue);
+    QTRY_COMPARE(writtenSpy.count(), 1);
+    QCOMPARE(writtenSpy.takeFirst().at(1).toByteArray(), nextValue);
+    QCOMPARE(errorSpy.count(), 1);
+    QCOMPARE(errorSpy.takeFirst().at(0).value<QLowEnergyService::ServiceError>(),
+             QLowEnergyService::CharacteristicWriteError);
+    QCOMPARE(peripheralName.value(), nextValue);
+    // the cancelled write got two parts acknowledged, the next one all of its parts
+    QCOMPARE(progressSpy.constFirst().at(2).toInt(), cancelledValue.size());
+    QCOMPARE(progressSpy.constLast().at(1).toInt(), nextValue.size());
+#else
+    QSKIP("Long write test only applicable for developer builds on Linux with BlueZ");
+#endif
+}
+
+void TestQLowEnergyControllerGattServer::controllerLinkParameterEvents()
+{
+#if defined(CONFIG_BLUEZ_LE) && defined(QT_BUILD_INTERNAL)
+    const QScopedPointer<QLowEnergyController> central(QLowEnergyController::createCentral(
+            QBluetoothDeviceInfo(QBluetoothAddress(QStringLiteral("00:11:22:33:44:55")),
+                                 QStringLiteral("fake"), 0)));
+    auto *d = qobject_cast<QLowEnergyControllerPrivateBluez *>(
+                QLowEnergyControllerPrivate::get(central.data()));
+    if (!d)
+        QSKIP("Central role does not use the BlueZ kernel backend");
+    central->setPreferredDataLength(251);
+    central->setPreferredPhys(QLowEnergyController::Phy2M);
+
+    // The controller's HCI manager reads the events from a socket pair
+    int fds[2];
+    QCOMPARE(::socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fds), 0);
+    QCOMPARE(::fcntl(fds[1], F_SETFL, O_NONBLOCK), 0);
+    const auto closeSocket = qScopeGuard([&fds] { ::close(fds[1]); });
+    d->setHciManager(new HciManager(fds[0], 0));
+
+    QSignalSpy linkSpy(central.data(), &QLowEnergyController::linkParametersChanged);
+    const auto sendEvent = [&fds](const QByteArray &event) {
+        return ::write(fds[1], event.constData(), event.size()) == event.size();
+    };
+
+    // LE Connection Complete for handle 0x40 applies the link preferences
+    QVERIFY(sendEvent(QByteArray::fromHex("043e1301" "00" "4000" "00" "00" "554433221100"
+                                          "2800" "0000" "c800" "00")));
+    QCOMPARE(nextHciCommand(fds[1]), QByteArray::fromHex("01222006" "4000fb004808"));
+    QCOMPARE(nextHciCommand(fds[1]), QByteArray::fromHex("01322007" "400000020200" "00"));
+
+    // LE Data Length Change
+    QVERIFY(sendEvent(QByteArray::fromHex("043e0b074000fb004808fb004808")));
+    QTRY_COMPARE(linkSpy.count(), 1);
+    QCOMPARE(linkSpy.at(0).at(0).toInt(), 251);
+    QCOMPARE(linkSpy.at(0).at(1).toInt(), 251);
+
+    // Events for other connections and unknown PHYs are ignored
+    QVERIFY(sendEvent(QByteArray::fromHex("043e0b074100fb004808fb004808")));
+    QTest::ignoreMessage(QtWarningMsg, "Ignoring PHY update with unknown PHYs 0 2");
+    QVERIFY(sendEvent(QByteArray::fromHex("043e060c0040000002")));
+    QTest::ignoreMessage(QtWarningMsg, "Ignoring PHY update with unknown PHYs 2 4");
+    QVERIFY(sendEvent(QByteArray::fromHex("043e060c0040000204")));
+
+    // LE PHY Update Complete, 2 is the LE 2M PHY
+    QVERIFY(sendEvent(QByteArray::fromHex("043e060c0040000203")));
+    QTRY_COMPARE(linkSpy.count(), 2);
+    QCOMPARE(linkSpy.at(1).at(0).toInt(), 251);
+    QCOMPARE(linkSpy.at(1).at(1).toInt(), 251);
+    QCOMPARE(linkSpy.at(1).at(2).value<QLowEnergyController::Phy>(),
+             QLowEnergyController::Phy2M);
+    QCOMPARE(linkSpy.at(1).at(3).value<QLowEnergyController::Phy>(),
+             QLowEnergyController::PhyCoded);
+#else
+    QSKIP("HCI event test only applicable for developer builds on Linux with BlueZ");
+#endif
+}
+
+void TestQLowEnergyControllerGattServer::valueProvider()
+{
+#if defined(CONFIG_BLUEZ_LE) && defined(QT_BUILD_INTERNAL)
+    int counterCalls = 0;
+    int cachedCalls = 0;
+    int limitedCalls = 0;
+
+    QLowEnergyServiceData serviceData;
+    serviceData.setUuid(QBluetoothUuid::ServiceClassUuid::DeviceInformation);
+    QLowEnergyCharacteristicData counterData;
+    counterData.setUuid(QBluetoothUuid::CharacteristicType::ManufacturerNameString);
+    counterData.setProperties(QLowEnergyCharacteristic::Read);
+    counterData.setValue("initial");
+    counterData.setValueLength(0, 512);
+    // longer than a single read response, every call produces different content
+    counterData.setValueProvider([&counterCalls]() {
+        ++counterCalls;
+        return QByteArray(40, char('a' + counterCalls % 26));
+    });
+    serviceData.addCharacteristic(counterData);
+    QLowEnergyCharacteristicData cachedData;
+    cachedData.setUuid(QBluetoothUuid::CharacteristicType::SerialNumberString);
+    cachedData.setProperties(QLowEnergyCharacteristic::Read);
+    cachedData.setValueProvider([&cachedCalls]() {
+        return QByteArray::number(++cachedCalls);
+    }, 60000);
+    serviceData.addCharacteristic(cachedData);
+    QLowEnergyCharacteristicData limitedData;
+    limitedData.setUuid(QBluetoothUuid::CharacteristicType::ModelNumberString);
+    limitedData.setProperties(QLowEnergyCharacteristic::Read);
+    limitedData.setValue("ok");
+    limitedData.setValueLength(1, 4);
+    limitedData.setValueProvider([&limitedCalls]() {
+        ++limitedCalls;
+        return QByteArray(10, 'x');
+    });
+    serviceData.addCharacteristic(limitedData);
+
+    const QScopedPointer<QLowEnergyController> peripheral(
+                QLowEnergyController::createPeripheral());
+    const QScopedPointer<QLowEnergyService> peripheralService(peripheral->addService(serviceData));
+    QVERIFY(!peripheralService.isNull());
+    const QScopedPointer<QLowEnergyController> central(QLowEnergyController::createCentral(
+            QBluetoothDeviceInfo(QBluetoothAddress(QStringLiteral("00:11:22:33:44:55")),
+                                 QStringLiteral("loopback"), 0)));
+    // the counter value takes a Read and a Read Blob request
+    central->setPreferredMtu(23);
+
+    AttLoopback loopback;
+    if (!loopback.connectControllers(central.data(), peripheral.data()))
+        QSKIP("Central role does not use the BlueZ kernel backend");
+
+    QSignalSpy discoveryFinished(central.data(), &QLowEnergyController::discoveryFinished);
+    central->discoverServices();
+    QVERIFY(discoveryFinished.wait());
+    const QScopedPointer<QLowEnergyService> service(central->createServiceObject(
+            QBluetoothUuid::ServiceClassUuid::DeviceInformation));
+    QVERIFY(!service.isNull());
+    service->discoverDetails(QLowEnergyService::SkipValueDiscovery);
+    QTRY_COMPARE(service->state(), QLowEnergyService::RemoteServiceDiscovered);
+    // discovery alone does not produce any value
+    QCOMPARE(counterCalls, 0);
+    QCOMPARE(cachedCalls, 0);
+    QCOMPARE(limitedCalls, 0);
+
+    QSignalSpy readSpy(service.data(), &QLowEnergyService::characteristicRead);
+    QSignalSpy errorSpy(service.data(), &QLowEnergyService::errorOccurred);
+
+    // A read calls the provider once, the parts of the long read share its value
+    const QLowEnergyCharacteristic counter =
+            service->characteristic(QBluetoothUuid::CharacteristicType::ManufacturerNameString);
+    service->readCharacteristic(counter);
+    QTRY_COMPARE(readSpy.count(), 1);
+    QCOMPARE(counterCalls, 1);
+    const QByteArray firstValue = readSpy.takeFirst().at(1).toByteArray();
+    QCOMPARE(firstValue, QByteArray(40, 'b'));
+    QCOMPARE(peripheralService->characteristic(
+                     QBluetoothUuid::CharacteristicType::ManufacturerNameString).value(),
+             firstValue);
+    service->readCharacteristic(counter);
+    QTRY_COMPARE(readSpy.count(), 1);
+    QCOMPARE(counterCalls, 2);
+    QCOMPARE(readSpy.takeFirst().at(1).toByteArray(), QByteArray(40, 'c'));
+
+    // Reads within the cache time reuse the produced value
+    const QLowEnergyCharacteristic cached =
+            service->characteristic(QBluetoothUuid::CharacteristicType::SerialNumberString);
+    service->readCharacteristic(cached);
+    QTRY_COMPARE(readSpy.count(), 1);
+    QCOMPARE(readSpy.takeFirst().at(1).toByteArray(), QByteArray("1"));
+    service->readCharacteristic(cached);
+    QTRY_COMPARE(readSpy.count(), 1);
+    QCOMPARE(readSpy.takeFirst().at(1).toByteArray(), QByteArray("1"));
+    QCOMPARE(cachedCalls, 1);
+
+    // A value violating the length constraints is dropped, the stored one is sent
+    QTest::ignoreMessage(QtWarningMsg,
+                         QRegularExpression(QStringLiteral(
+                                 "ignoring provided value of invalid length 10")));
+    service->readCharacteristic(
+            service->characteristic(QBluetoothUuid::CharacteristicType::ModelNumberString));
+    QTRY_COMPARE(readSpy.count(), 1);
+    QCOMPARE(limitedCalls, 1);
+    QCOMPARE(readSpy.takeFirst().at(1).toByteArray(), QByteArray("ok"));
+    QCOMPARE(errorSpy.count(), 0);
+
+    // Read By Type only asks the providers whose values fit into the response
+    QLowEnergyServiceData batteryData;
+    batteryData.setUuid(QBluetoothUuid::ServiceClassUuid::BatteryService);
+    QList<int> levelCalls(8, 0);
+    for (int i = 0; i < levelCalls.size(); ++i) {
+        QLowEnergyCharacteristicData levelData;
+        levelData.setUuid(QBluetoothUuid::CharacteristicType::BatteryLevel);
+        levelData.setProperties(QLowEnergyCharacteristic::Read);
+        levelData.setValue(QByteArray(2, 0));
+        levelData.setValueProvider([&levelCalls, i]() {
+            ++levelCalls[i];
+            return QByteArray(2, char(i));
+        });
+        batteryData.addCharacteristic(levelData);
+    }
+    const QScopedPointer<QLowEnergyController> batteryPeripheral(
+                QLowEnergyController::createPeripheral());
+    const QScopedPointer<QLowEnergyService> batteryService(
+                batteryPeripheral->addService(batteryData));
+    QVERIFY(!batteryService.isNull());
+    QList<QLowEnergyHandle> levelHandles;
+    const QList<QLowEnergyCharacteristic> levels = batteryService->characteristics();
+    for (const QLowEnergyCharacteristic &level : levels)
+        levelHandles.append(level.handle());
+    QCOMPARE(levelHandles.size(), levelCalls.size());
+
+    // With the default MTU of 23, a response holds five handle/value pairs
+    const auto readByType = [](QLowEnergyHandle start) {
+        // start handle, end handle 0xffff and the Battery Level type
+        QByteArray request = QByteArray::fromHex("080000ffff192a");
+        qToLittleEndian(start, request.data() + 1);
+        return request;
+    };
+    const auto response = [&levelHandles](int first, int count) {
+        QByteArray response = QByteArray::fromHex("0904");
+        for (int i = first; i < first + count; ++i) {
+            char handle[2];
+            qToLittleEndian(levelHandles.at(i), handle);
+            response.append(handle, 2);
+            response.append(QByteArray(2, char(i)));
+        }
+        return response;
+    };
+    QList<AttCaptureRecord> records(4);
+    records[0].direction = AttCaptureRecord::Received;
+    records[0].pdu = readByType(1);
+    records[1].direction = AttCaptureRecord::Sent;
+    records[1].pdu = response(0, 5);
+    records[2].direction = AttCaptureRecord::Received;
+    records[2].pdu = readByType(levelHandles.at(4) + 1);
+    records[3].direction = AttCaptureRecord::Sent;
+    records[3].pdu = response(5, 3);
+
+    AttReplayDriver driver(records);
+    QVERIFY(driver.attach(batteryPeripheral.data()));
+    driver.start();
+    QTRY_VERIFY(driver.isFinished());
+    QCOMPARE(driver.mismatches(), 0);
+    QCOMPARE(levelCalls, QList<int>(8, 1));
+
+    // the first response stops before the sixth provider
+    AttReplayDriver firstDriver(records.mid(0, 2));
+    QVERIFY(firstDriver.attach(batteryPeripheral.data()));
+    firstDriver.start();
+    QTRY_VERIFY(firstDriver.isFinished());
+    QCOMPARE(firstDriver.mismatches(), 0);
+    QCOMPARE(levelCalls, QList<int>({ 2, 2, 2, 2, 2, 1, 1, 1 }));
+#else
+    QSKIP("Value provider test only applicable for developer builds on Linux with BlueZ");
+#endif
+}
+
+void TestQLowEnergyControllerGattServer::gattRequestTimeoutConnectionUpdate()
+{
+#if defined(CONFIG_BLUEZ_LE) && defined(QT_BUILD_INTERNAL)
+    QLowEnergyServiceData serviceData;
+    serviceData.setUuid(QBluetoothUuid::ServiceClassUuid::BatteryService);
+    QLowEnergyCharacteristicData charData;
+    charData.setUuid(QBluetoothUuid::CharacteristicType::BatteryLevel);
+    charData.setProperties(QLowEnergyCharacteristic::Read);
+    charData.setValue(QByteArray(1, 0x64));
+    serviceData.addCharacteristic(charData);
+
+    const QScopedPointer<QLowEnergyController> central(QLowEnergyController::createCentral(
+            QBluetoothDeviceInfo(QBluetoothAddress(QStringLiteral("00:11:22:33:44:55")),
+                                 QStringLiteral("loopback"), 0)));
+    auto *d = qobject_cast<QLowEnergyControllerPrivateBluez *>(
+                QLowEnergyControllerPrivate::get(central.data()));
+    if (!d)
+        QSKIP("Central role does not use the BlueZ kernel backend");
+    central->setGattRequestTimeout(20000);
+
+    // The central's HCI manager reads the events from a socket pair
+    int fds[2];
+    QCOMPARE(::socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fds), 0);
+    QCOMPARE(::fcntl(fds[1], F_SETFL, O_NONBLOCK), 0);
+    const auto closeSocket = qScopeGuard([&fds] { ::close(fds[1]); });
+    d->setHciManager(new HciManager(fds[0], 0));
+    const auto sendEvent = [&fds](const QByteArray &event) {
+        return ::write(fds[1], event.constData(), event.size()) == event.size();
+    };
+
+    const QScopedPointer<QLowEnergyController> peripheral(
+                QLowEnergyController::createPeripheral());
+    const QScopedPointer<QLowEnergyService> peripheralService(peripheral->addService(serviceData));
+    QVERIFY(!peripheralService.isNull());
+
+    AttLoopback loopback;
+    loopback.setLatency(20);
+    if (!loopback.connectControllers(central.data(), peripheral.data()))
+        QSKIP("Central role does not use the BlueZ kernel backend");
+
+    // LE Connection Complete for handle 0x40
+    QVERIFY(sendEvent(QByteArray::fromHex("043e1301" "00" "4000" "00" "00" "554433221100"
+                                          "2800" "0000" "c800" "00")));
+
+    // measure enough round trips for the adaptive timeout
+    QSignalSpy discoveryFinished(central.data(), &QLowEnergyController::discoveryFinished);
+    central->discoverServices();
+    QVERIFY(discoveryFinished.wait());
+    const QScopedPointer<QLowEnergyService> centralService(
+                central->createServiceObject(QBluetoothUuid::ServiceClassUuid::BatteryService));
+    QVERIFY(!centralService.isNull());
+    centralService->discoverDetails();
+    QTRY_COMPARE(centralService->state(), QLowEnergyService::RemoteServiceDiscovered);
+
+    // the measured round trips are short, the minimum applies
+    QCOMPARE(central->effectiveGattRequestTimeout(0x0a), 1000);
+
+    // LE Connection Update Complete: 500 ms interval and a slave latency of 3
+    // raise the floor to six connection events of 2 s each
+    QSignalSpy updateSpy(central.data(), &QLowEnergyController::connectionUpdated);
+    QVERIFY(sendEvent(QByteArray::fromHex("043e0a03" "00" "4000" "9001" "0300" "800c")));
+    QTRY_COMPARE(updateSpy.count(), 1);
+    QCOMPARE(central->effectiveGattRequestTimeout(0x0a), 12000);
+
+    // updates of other connections are ignored
+    QVERIFY(sendEvent(QByteArray::fromHex("043e0a03" "00" "4100" "2800" "0000" "c800")));
+    QVERIFY(sendEvent(QByteArray::fromHex("043e0a03" "00" "4000" "800c" "0100" "800c")));
+    QTRY_COMPARE(updateSpy.count(), 2);
+    // the configured maximum still bounds the floor
+    QCOMPARE(central->effectiveGattRequestTimeout(0x0a), 20000);
+
+    // a shorter interval lowers it again
+    QVERIFY(sendEvent(QByteArray::fromHex("043e0a03" "00" "4000" "5000" "0000" "c800")));
+    QTRY_COMPARE(updateSpy.count(), 3);
+    QCOMPARE(central->effectiveGattRequestTimeout(0x0a), 1000);
+#else
+    QSKIP("Connection update test only applicable for developer builds on Linux with BlueZ");
+#endif
+}
+
 QTEST_MAIN(TestQLowEnergyControllerGattServer)
 
 #include "tst_qlowenergycontroller-gattserver.moc"
@@ -37,6 +37,10 @@
 #include <QBluetoothDeviceDiscoveryAgent>
 #include <QBluetoothUuid>
 #include <QLowEnergyController>
+#include <QLowEnergyConnectionPool>
+#ifdef QT_BUILD_INTERNAL
+#include <QtBluetooth/private/qlowenergyconnectionpool_p.h>
+#endif
 #include <QLowEnergyCharacteristic>
 
 #include <QDebug>
@@ -66,6 +70,8 @@ private slots:
     void init();
     void cleanupTestCase();
     void tst_emptyCtor();
+    void tst_connectionPool();
+    void tst_connectionPoolExternalLinks();
     void tst_connect();
     void tst_concurrentDiscovery();
     void tst_defaultBehavior();
@@ -245,6 +251,90 @@ void tst_QLowEnergyController::tst_emptyCtor()
 
 }
 
+void tst_QLowEnergyController::tst_connectionPool()
+{
+    {
+        QLowEnergyConnectionPool pool(QList<QBluetoothAddress>{});
+        QCOMPARE(pool.maximumConnectionsPerAdapter(), 7);
+        pool.setMaximumConnectionsPerAdapter(0);
+        QCOMPARE(pool.maximumConnectionsPerAdapter(), 1);
+
+        // without any adapter requests fail instead of being queued forever
+        QSignalSpy connectedSpy(&pool, &QLowEnergyConnectionPool::connected);
+        QSignalSpy failedSpy(&pool, &QLowEnergyConnectionPool::connectionFailed);
+        pool.connectToDevice(QBluetoothDeviceInfo(QBluetoothAddress(QStringLiteral("11:22:33:44:55:66")),
+                                                  QStringLiteral("Test"), 0));
+        QCOMPARE(failedSpy.count(), 1);
+        QCOMPARE(failedSpy[0].at(1).value<QLowEnergyController::Error>(),
+                 QLowEnergyController::InvalidBluetoothAdapterError);
+        QVERIFY(connectedSpy.isEmpty());
+        QCOMPARE(pool.queuedConnectionCount(), 0);
+    }
+
+    {
+        const QBluetoothAddress adapter(QStringLiteral("AA:BB:CC:DD:EE:FF"));
+        QLowEnergyConnectionPool pool({ adapter });
+        QCOMPARE(pool.adapters(), QList<QBluetoothAddress>{ adapter });
+        QCOMPARE(pool.adapterLoad(adapter), 0);
+
+        QSignalSpy failedSpy(&pool, &QLowEnergyConnectionPool::connectionFailed);
+        pool.connectToDevice(QBluetoothDeviceInfo());
+        QTRY_VERIFY_WITH_TIMEOUT(!failedSpy.isEmpty(), 10000);
+
+        const auto lastError = failedSpy[0].at(1).value<QLowEnergyController::Error>();
+        QVERIFY(lastError == QLowEnergyController::UnknownRemoteDeviceError
+                || lastError == QLowEnergyController::InvalidBluetoothAdapterError);
+        // the failed attempt frees the adapter again
+        QCOMPARE(pool.pendingConnectionCount(adapter), 0);
+        QCOMPARE(pool.connectionCount(adapter), 0);
+        QCOMPARE(pool.queuedConnectionCount(), 0);
+    }
+}
+
+void tst_QLowEnergyController::tst_connectionPoolExternalLinks()
+{
+#ifdef QT_BUILD_INTERNAL
+    const QBluetoothAddress adapter(QStringLiteral("AA:BB:CC:DD:EE:FF"));
+    QLowEnergyConnectionPool pool({ adapter });
+    pool.setMaximumConnectionsPerAdapter(1);
+
+    // another application holds the only link the adapter may carry
+    int externalLinks = 1;
+    auto d = QLowEnergyConnectionPoolPrivate::get(&pool);
+    d->externalConnectionCounter = [&externalLinks](const QBluetoothAddress &) {
+        return externalLinks;
+    };
+    d->recheckTimer.setInterval(50);
+    QCOMPARE(pool.adapterLoad(adapter), 1);
+
+    QSignalSpy failedSpy(&pool, &QLowEnergyConnectionPool::connectionFailed);
+    pool.connectToDevice(QBluetoothDeviceInfo());
+    QCOMPARE(pool.queuedConnectionCount(), 1);
+    QCOMPARE(pool.pendingConnectionCount(adapter), 0);
+    QVERIFY(d->recheckTimer.isActive());
+
+    // the request stays queued as long as the external link is up
+    QTest::qWait(200);
+    QCOMPARE(pool.queuedConnectionCount(), 1);
+    QVERIFY(failedSpy.isEmpty());
+
+    // no connection of the pool is closed, the request is served nevertheless
+    externalLinks = 0;
+    QTRY_COMPARE(pool.queuedConnectionCount(), 0);
+    QVERIFY(!d->recheckTimer.isActive());
+    QTRY_VERIFY_WITH_TIMEOUT(!failedSpy.isEmpty(), 10000);
+
+    // cancelling the queue also ends the polling
+    externalLinks = 1;
+    pool.connectToDevice(QBluetoothDeviceInfo());
+    QVERIFY(d->recheckTimer.isActive());
+    pool.cancelQueuedConnections();
+    QVERIFY(!d->recheckTimer.isActive());
+#else
+    QSKIP("This test requires a developer build");
+#endif
+}
+
 void tst_QLowEnergyController::tst_connect()
 {
     QList<QBluetoothHostInfo> localAdapters = QBluetoothLocalDevice::allDevices();
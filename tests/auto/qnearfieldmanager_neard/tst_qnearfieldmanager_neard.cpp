@@ -0,0 +1,654 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtNfc module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#include <QtTest/QtTest>
+
+#include <QtCore/QSettings>
+#include <QtCore/QSocketNotifier>
+#include <QtCore/QTemporaryDir>
+#include <QtDBus/QDBusConnection>
+#include <QtDBus/QDBusConnectionInterface>
+#include <QtDBus/QDBusMessage>
+#include <QtDBus/QDBusMetaType>
+#include <QtDBus/QDBusObjectPath>
+#include <QtDBus/QDBusVirtualObject>
+
+#include <QtNfc/qnearfieldmanager.h>
+#include <QtNfc/qndefmessage.h>
+#include <QtNfc/qndefnfctextrecord.h>
+#include <QtNfc/qndefnfcurirecord.h>
+#include <QtNfc/private/qnearfieldtagtype2ndef_p.h>
+#include <QtNfc/private/qnearfieldtarget_neard_p.h>
+
+#include "qtlv_p.h"
+#include "targetemulator_p.h"
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+QT_USE_NAMESPACE
+
+typedef QMap<QString, QVariantMap> InterfaceList;
+typedef QMap<QDBusObjectPath, InterfaceList> ManagedObjectList;
+
+Q_DECLARE_METATYPE(InterfaceList)
+Q_DECLARE_METATYPE(ManagedObjectList)
+Q_DECLARE_METATYPE(QNearFieldTarget *)
+
+static const QLatin1String neardService("org.neard");
+static const QLatin1String adapterPath("/org/neard/nfc0");
+static const QLatin1String tagPath("/org/neard/nfc0/tag0");
+
+// Memory of an NTAG215 sized Type 2 tag holding \a message
+static QByteArray type2TagMemory(const QNdefMessage &message)
+{
+    constexpr int dataAreaSize = 0x3e * 8;
+    QByteArray memory = QByteArray::fromHex("04a1b2c3" "d4e5f607" "08000000" "e1103e00");
+    const QByteArray ndef = message.toByteArray();
+    Q_ASSERT(ndef.size() < 0xff);
+    memory += char(0x03); // NDEF Message TLV
+    memory += char(ndef.size());
+    memory += ndef;
+    memory += char(0xfe); // Terminator TLV
+    memory += QByteArray(16 + dataAreaSize - memory.size(), '\0');
+    return memory;
+}
+
+// The org.neard.Record properties neard publishes for \a record
+static QVariantMap neardRecordProperties(const QNdefRecord &record)
+{
+    if (record.isRecordType<QNdefNfcTextRecord>()) {
+        const QNdefNfcTextRecord text(record);
+        return { { QStringLiteral("Type"), QStringLiteral("Text") },
+                 { QStringLiteral("Encoding"), text.encoding() == QNdefNfcTextRecord::Utf16
+                                                       ? QStringLiteral("UTF-16")
+                                                       : QStringLiteral("UTF-8") },
+                 { QStringLiteral("Language"), text.locale() },
+                 { QStringLiteral("Representation"), text.text() } };
+    }
+    if (record.isRecordType<QNdefNfcUriRecord>()) {
+        return { { QStringLiteral("Type"), QStringLiteral("URI") },
+                 { QStringLiteral("URI"), QNdefNfcUriRecord(record).uri().toString() } };
+    }
+    return QVariantMap();
+}
+
+/*
+    Minimal stand-in for neard. It publishes one adapter and answers the
+    object manager and poll loop calls the backend issues.
+
+    Tags are Type 2 tag emulators from nfccommons. Like neard, the fake reads
+    the NDEF message from the tag memory and publishes one record object per
+    NDEF record. Raw commands reach the emulator through a socket pair which
+    replaces the AF_NFC socket.
+ */
+class FakeNeard : public QDBusVirtualObject
+{
+public:
+    explicit FakeNeard(const QDBusConnection &connection)
+        : connection(connection)
+    {
+        InterfaceList adapter;
+        adapter.insert(QStringLiteral("org.neard.Adapter"),
+                       { { QStringLiteral("Powered"), true },
+                         { QStringLiteral("Polling"), false },
+                         { QStringLiteral("Mode"), QStringLiteral("Idle") } });
+        objects.insert(QDBusObjectPath(adapterPath), adapter);
+
+        instance = this;
+        QNeard::setRawSocketFactory(&FakeNeard::openRawSocket);
+    }
+
+    ~FakeNeard()
+    {
+        QNeard::setRawSocketFactory(nullptr);
+        instance = nullptr;
+        closeRawSocket();
+    }
+
+    QString introspect(const QString &) const override { return QString(); }
+
+    bool handleMessage(const QDBusMessage &message, const QDBusConnection &) override
+    {
+        if (message.type() != QDBusMessage::MethodCallMessage)
+            return false;
+
+        methodCalls.append(message.member());
+        if (message.member() == QLatin1String("GetManagedObjects")) {
+            connection.send(message.createReply(QVariant::fromValue(objects)));
+        } else if (message.member() == QLatin1String("StartPollLoop")) {
+            setPolling(true);
+            connection.send(message.createReply());
+        } else if (message.member() == QLatin1String("StopPollLoop")) {
+            setPolling(false);
+            connection.send(message.createReply());
+        } else if (message.member() == QLatin1String("Write")) {
+            writtenRecord = qdbus_cast<QVariantMap>(message.arguments().value(0));
+            connection.send(message.createReply());
+        } else {
+            connection.send(message.createErrorReply(QStringLiteral("org.neard.Error.NotSupported"),
+                                                     message.member()));
+        }
+        return true;
+    }
+
+    bool addTag(const QNdefMessage &message)
+    {
+        QTemporaryDir dir;
+        if (!dir.isValid())
+            return false;
+        {
+            QSettings settings(dir.filePath(QStringLiteral("tag.nfc")), QSettings::IniFormat);
+            settings.setValue(QStringLiteral("TagType2/Data"), type2TagMemory(message));
+        }
+        QSettings settings(dir.filePath(QStringLiteral("tag.nfc")), QSettings::IniFormat);
+        tag.load(&settings);
+
+        setPolling(false);
+
+        InterfaceList tagInterfaces;
+        tagInterfaces.insert(QStringLiteral("org.neard.Tag"),
+                   { { QStringLiteral("Type"), QStringLiteral("Type 2") },
+                     { QStringLiteral("Protocol"), QStringLiteral("MIFARE") },
+                     { QStringLiteral("ReadOnly"), false },
+                     { QStringLiteral("Adapter"), QVariant::fromValue(QDBusObjectPath(adapterPath)) } });
+        interfacesAdded(tagPath, tagInterfaces);
+
+        // neard publishes every record as a separate object after the tag
+        const QList<QNdefRecord> records = readNdefMessage();
+        for (qsizetype i = 0; i < records.size(); ++i) {
+            InterfaceList recordInterfaces;
+            recordInterfaces.insert(QStringLiteral("org.neard.Record"),
+                                    neardRecordProperties(records.at(i)));
+            interfacesAdded(tagPath + QStringLiteral("/record%1").arg(i), recordInterfaces);
+        }
+        return !records.isEmpty();
+    }
+
+    void removeTag()
+    {
+        QDBusMessage signal = QDBusMessage::createSignal(
+                    QStringLiteral("/"), QStringLiteral("org.freedesktop.DBus.ObjectManager"),
+                    QStringLiteral("InterfacesRemoved"));
+        signal << QVariant::fromValue(QDBusObjectPath(tagPath))
+               << QStringList{ QStringLiteral("org.neard.Tag") };
+        connection.send(signal);
+        closeRawSocket();
+    }
+
+    // Answers all commands written to the raw socket so far, returns their number
+    int answerCommands()
+    {
+        int answered = 0;
+        char buffer[256];
+        ssize_t size;
+        while ((size = ::recv(rawSocket, buffer, sizeof buffer, MSG_DONTWAIT)) > 0) {
+            commands.append(QByteArray(buffer, int(size)));
+            const QByteArray response = transceive(commands.last());
+            // the kernel prefixes every response with a status byte
+            const QByteArray datagram = response.isEmpty() ? QByteArray(1, 1)
+                                                           : char(0) + response;
+            if (::send(rawSocket, datagram.constData(), datagram.size(), 0) != datagram.size())
+                break;
+            ++answered;
+        }
+        return answered;
+    }
+
+    // closes the tag's end of the raw socket, the tag stays in range
+    void dropRawSocket() { closeRawSocket(); }
+
+    bool hasRawSocket() const { return rawSocket >= 0; }
+
+    QStringList methodCalls;
+    QVariantMap writtenRecord;
+    // raw commands the tag received
+    QList<QByteArray> commands;
+    // refuse raw sockets, readNdefMessages() then relies on the records
+    bool rawAccess = true;
+    // answer raw commands as soon as they arrive
+    bool answerAutomatically = true;
+
+private:
+    static int openRawSocket(const QString &path)
+    {
+        if (!instance || !instance->rawAccess || path != tagPath)
+            return -1;
+        instance->closeRawSocket();
+        int sockets[2];
+        if (::socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sockets) != 0)
+            return -1;
+        instance->rawSocket = sockets[1];
+        instance->rawNotifier = new QSocketNotifier(sockets[1], QSocketNotifier::Read);
+        QObject::connect(instance->rawNotifier, &QSocketNotifier::activated, [] {
+            if (instance->answerAutomatically)
+                instance->answerCommands();
+        });
+        return sockets[0];
+    }
+
+    void closeRawSocket()
+    {
+        delete rawNotifier;
+        rawNotifier = nullptr;
+        if (rawSocket >= 0)
+            ::close(rawSocket);
+        rawSocket = -1;
+    }
+
+    // Passes a command to the emulator the way the NFC controller does,
+    // which adds and checks the CRC of the frames
+    QByteArray transceive(const QByteArray &command)
+    {
+        const quint16 crc = qChecksum(QByteArrayView(command), Qt::ChecksumItuV41);
+        QByteArray response = tag.processCommand(command + char(crc & 0xff) + char(crc >> 8));
+        if (response.size() <= 2
+                || qChecksum(QByteArrayView(response), Qt::ChecksumItuV41) != 0) {
+            return QByteArray();
+        }
+        response.chop(2);
+        return response;
+    }
+
+    QList<QNdefRecord> readNdefMessage()
+    {
+        QByteArray memory;
+        for (int block = 0; block < 128; block += 4)
+            memory += transceive(QByteArray::fromHex("30") + char(block));
+
+        // skip UID, lock bytes and capability container
+        QTlvReader reader(memory.mid(16));
+        while (!reader.atEnd()) {
+            if (!reader.readNext())
+                break;
+            if (reader.tag() == 0x03)
+                return QNdefMessage::fromByteArray(reader.data());
+        }
+        return QList<QNdefRecord>();
+    }
+
+    void interfacesAdded(const QString &path, const InterfaceList &interfaces)
+    {
+        QDBusMessage signal = QDBusMessage::createSignal(
+                    QStringLiteral("/"), QStringLiteral("org.freedesktop.DBus.ObjectManager"),
+                    QStringLiteral("InterfacesAdded"));
+        signal << QVariant::fromValue(QDBusObjectPath(path)) << QVariant::fromValue(interfaces);
+        connection.send(signal);
+    }
+
+    void setPolling(bool polling)
+    {
+        QDBusMessage signal = QDBusMessage::createSignal(
+                    adapterPath, QStringLiteral("org.freedesktop.DBus.Properties"),
+                    QStringLiteral("PropertiesChanged"));
+        signal << QStringLiteral("org.neard.Adapter")
+               << QVariantMap{ { QStringLiteral("Polling"), polling } }
+               << QStringList();
+        connection.send(signal);
+    }
+
+    static FakeNeard *instance;
+
+    QDBusConnection connection;
+    ManagedObjectList objects;
+    NfcTagType2 tag;
+    int rawSocket = -1;
+    QSocketNotifier *rawNotifier = nullptr;
+};
+
+FakeNeard *FakeNeard::instance = nullptr;
+
+class tst_QNearFieldManagerNeard : public QObject
+{
+    Q_OBJECT
+
+public:
+    tst_QNearFieldManagerNeard();
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void init();
+
+    void adapterState();
+    void detectAndReadTarget();
+    void recordOrder();
+    void writeTextRecord();
+    void pipelinedCommands();
+    void rawSocketClosed();
+    void type2Tlvs();
+
+private:
+    FakeNeard *neard = nullptr;
+};
+
+tst_QNearFieldManagerNeard::tst_QNearFieldManagerNeard()
+{
+    qputenv("QT_NFC_NEARD_SESSION_BUS", "1");
+
+    qDBusRegisterMetaType<InterfaceList>();
+    qDBusRegisterMetaType<ManagedObjectList>();
+    qRegisterMetaType<QNdefMessage>();
+    qRegisterMetaType<QNearFieldTarget *>();
+}
+
+void tst_QNearFieldManagerNeard::initTestCase()
+{
+    QDBusConnection bus = QDBusConnection::sessionBus();
+    if (!bus.isConnected())
+        QSKIP("No D-Bus session bus available");
+    if (!bus.registerService(neardService))
+        QSKIP("Cannot register the fake neard service");
+
+    neard = new FakeNeard(bus);
+    QVERIFY(bus.registerVirtualObject(QStringLiteral("/"), neard,
+                                      QDBusConnection::SubPath));
+}
+
+void tst_QNearFieldManagerNeard::cleanupTestCase()
+{
+    QDBusConnection bus = QDBusConnection::sessionBus();
+    if (neard) {
+        bus.unregisterObject(QStringLiteral("/"), QDBusConnection::UnregisterTree);
+        bus.unregisterService(neardService);
+        delete neard;
+    }
+}
+
+void tst_QNearFieldManagerNeard::init()
+{
+    neard->rawAccess = true;
+    neard->answerAutomatically = true;
+    neard->commands.clear();
+}
+
+void tst_QNearFieldManagerNeard::adapterState()
+{
+    QNearFieldManager manager;
+
+    QVERIFY(manager.isEnabled());
+    QVERIFY(manager.isSupported(QNearFieldTarget::NdefAccess));
+    QVERIFY(manager.isSupported(QNearFieldTarget::TagTypeSpecificAccess));
+    QVERIFY(!manager.isSupported(QNearFieldTarget::UnknownAccess));
+}
+
+void tst_QNearFieldManagerNeard::detectAndReadTarget()
+{
+    QNearFieldManager manager;
+    QSignalSpy detectedSpy(&manager, &QNearFieldManager::targetDetected);
+    QSignalSpy lostSpy(&manager, &QNearFieldManager::targetLost);
+
+    neard->methodCalls.clear();
+    QVERIFY(manager.startTargetDetection(QNearFieldTarget::NdefAccess));
+    QTRY_VERIFY(neard->methodCalls.contains(QLatin1String("StartPollLoop")));
+
+    // neard does not publish the MIME record, only the raw read finds it
+    QNdefNfcUriRecord uriRecord;
+    uriRecord.setUri(QUrl(QStringLiteral("http://qt.io")));
+    QNdefRecord mimeRecord;
+    mimeRecord.setTypeNameFormat(QNdefRecord::Mime);
+    mimeRecord.setType("application/json");
+    mimeRecord.setPayload("{}");
+    QNdefMessage written;
+    written << uriRecord << mimeRecord;
+    QVERIFY(neard->addTag(written));
+    QTRY_COMPARE(detectedSpy.count(), 1);
+
+    QNearFieldTarget *target = detectedSpy.first().at(0).value<QNearFieldTarget *>();
+    QVERIFY(target);
+    QCOMPARE(target->type(), QNearFieldTarget::NfcTagType2);
+    QVERIFY(target->accessMethods() & QNearFieldTarget::NdefAccess);
+
+    // The target is reported once neard published the records
+    QVERIFY(target->hasNdefMessage());
+    QSignalSpy readSpy(target, &QNearFieldTarget::ndefMessageRead);
+    const QNearFieldTarget::RequestId id = target->readNdefMessages();
+    QVERIFY(target->waitForRequestCompleted(id));
+    QCOMPARE(readSpy.count(), 1);
+    QCOMPARE(readSpy.first().at(0).value<QNdefMessage>(), written);
+
+    // The header blocks, then the data area with as few FAST_READs as fit into a frame
+    const QList<QByteArray> expectedCommands = { QByteArray::fromHex("3000"),
+                                                 QByteArray::fromHex("3a0442"),
+                                                 QByteArray::fromHex("3a437f") };
+    QCOMPARE(neard->commands, expectedCommands);
+
+    // Detection continues after the target is lost
+    neard->methodCalls.clear();
+    neard->removeTag();
+    QTRY_COMPARE(lostSpy.count(), 1);
+    QTRY_VERIFY(neard->methodCalls.contains(QLatin1String("StartPollLoop")));
+
+    manager.stopTargetDetection();
+    QTRY_VERIFY(neard->methodCalls.contains(QLatin1String("StopPollLoop")));
+}
+
+void tst_QNearFieldManagerNeard::recordOrder()
+{
+    neard->rawAccess = false;
+
+    QNearFieldManager manager;
+    QSignalSpy detectedSpy(&manager, &QNearFieldManager::targetDetected);
+    QVERIFY(manager.startTargetDetection(QNearFieldTarget::NdefAccess));
+
+    // record10 and record11 must not end up between record1 and record2
+    QNdefMessage written;
+    for (int i = 0; i < 12; ++i) {
+        QNdefNfcTextRecord record;
+        record.setLocale(QStringLiteral("en"));
+        record.setText(QString::number(i));
+        written.append(record);
+    }
+    QVERIFY(neard->addTag(written));
+    QTRY_COMPARE(detectedSpy.count(), 1);
+    QNearFieldTarget *target = detectedSpy.first().at(0).value<QNearFieldTarget *>();
+
+    QSignalSpy readSpy(target, &QNearFieldTarget::ndefMessageRead);
+    QVERIFY(target->waitForRequestCompleted(target->readNdefMessages()));
+    QCOMPARE(readSpy.count(), 1);
+    const QNdefMessage message = readSpy.first().at(0).value<QNdefMessage>();
+    QCOMPARE(message.size(), written.size());
+    for (qsizetype i = 0; i < message.size(); ++i)
+        QCOMPARE(QNdefNfcTextRecord(message.at(i)).text(), QString::number(i));
+    QVERIFY(neard->commands.isEmpty());
+
+    neard->removeTag();
+    manager.stopTargetDetection();
+}
+
+void tst_QNearFieldManagerNeard::writeTextRecord()
+{
+    QNearFieldManager manager;
+    QSignalSpy detectedSpy(&manager, &QNearFieldManager::targetDetected);
+
+    QVERIFY(manager.startTargetDetection(QNearFieldTarget::NdefAccess));
+    QNdefNfcTextRecord initial;
+    initial.setLocale(QStringLiteral("en"));
+    initial.setText(QStringLiteral("Qt"));
+    QVERIFY(neard->addTag(QNdefMessage(initial)));
+    QTRY_COMPARE(detectedSpy.count(), 1);
+    QNearFieldTarget *target = detectedSpy.first().at(0).value<QNearFieldTarget *>();
+
+    QNdefNfcTextRecord record;
+    record.setText(QStringLiteral("Hello"));
+    record.setLocale(QStringLiteral("de"));
+    const QNearFieldTarget::RequestId id = target->writeNdefMessages({ QNdefMessage(record) });
+    QVERIFY(target->waitForRequestCompleted(id));
+
+    QCOMPARE(neard->writtenRecord.value(QStringLiteral("Type")).toString(),
+             QStringLiteral("Text"));
+    QCOMPARE(neard->writtenRecord.value(QStringLiteral("Representation")).toString(),
+             QStringLiteral("Hello"));
+    QCOMPARE(neard->writtenRecord.value(QStringLiteral("Language")).toString(),
+             QStringLiteral("de"));
+
+    // neard can store a single record only
+    QNdefMessage twoRecords;
+    twoRecords << record << record;
+    QSignalSpy errorSpy(target, &QNearFieldTarget::error);
+    const QNearFieldTarget::RequestId failedId = target->writeNdefMessages({ twoRecords });
+    QTRY_COMPARE(errorSpy.count(), 1);
+    QCOMPARE(errorSpy.first().at(0).value<QNearFieldTarget::Error>(),
+             QNearFieldTarget::UnsupportedError);
+    QCOMPARE(errorSpy.first().at(1).value<QNearFieldTarget::RequestId>(), failedId);
+
+    neard->removeTag();
+    manager.stopTargetDetection();
+}
+
+void tst_QNearFieldManagerNeard::pipelinedCommands()
+{
+    QNearFieldManager manager;
+    QSignalSpy detectedSpy(&manager, &QNearFieldManager::targetDetected);
+    QVERIFY(manager.startTargetDetection(QNearFieldTarget::TagTypeSpecificAccess));
+
+    QNdefNfcTextRecord text;
+    text.setLocale(QStringLiteral("en"));
+    text.setText(QStringLiteral("pipelined"));
+    QVERIFY(neard->addTag(QNdefMessage(text)));
+    QTRY_COMPARE(detectedSpy.count(), 1);
+    QNearFieldTarget *target = detectedSpy.first().at(0).value<QNearFieldTarget *>();
+    QVERIFY(target->accessMethods() & QNearFieldTarget::TagTypeSpecificAccess);
+    QCOMPARE(target->maxCommandLength(), 255);
+
+    // All commands are written before the first response arrives
+    neard->answerAutomatically = false;
+    QSignalSpy completedSpy(target, &QNearFieldTarget::requestCompleted);
+    QSignalSpy errorSpy(target, &QNearFieldTarget::error);
+    const QNearFieldTarget::RequestId readCc = target->sendCommand(QByteArray::fromHex("3003"));
+    const QNearFieldTarget::RequestId fastRead =
+            target->sendCommand(QByteArray::fromHex("3a0407"));
+    const QNearFieldTarget::RequestId invalid =
+            target->sendCommand(QByteArray::fromHex("3aff00"));
+    const QNearFieldTarget::RequestId readUid = target->sendCommand(QByteArray::fromHex("3000"));
+    QVERIFY(neard->hasRawSocket());
+    QCOMPARE(completedSpy.count(), 0);
+    QCOMPARE(neard->answerCommands(), 4);
+
+    // Responses are matched to the requests in order
+    QVERIFY(target->waitForRequestCompleted(readUid));
+    QCOMPARE(completedSpy.count(), 3);
+    QCOMPARE(completedSpy.at(0).at(0).value<QNearFieldTarget::RequestId>(), readCc);
+    QCOMPARE(completedSpy.at(1).at(0).value<QNearFieldTarget::RequestId>(), fastRead);
+    QCOMPARE(completedSpy.at(2).at(0).value<QNearFieldTarget::RequestId>(), readUid);
+    QTRY_COMPARE(errorSpy.count(), 1);
+    QCOMPARE(errorSpy.first().at(0).value<QNearFieldTarget::Error>(),
+             QNearFieldTarget::CommandError);
+    QCOMPARE(errorSpy.first().at(1).value<QNearFieldTarget::RequestId>(), invalid);
+
+    const QByteArray memory = type2TagMemory(QNdefMessage(text));
+    QCOMPARE(target->requestResponse(readCc).toByteArray(), memory.mid(12, 16));
+    QCOMPARE(target->requestResponse(fastRead).toByteArray(), memory.mid(16, 16));
+    QCOMPARE(target->requestResponse(readUid).toByteArray(), memory.left(16));
+
+    // Commands still in flight fail when the target goes away
+    const QNearFieldTarget::RequestId abandoned =
+            target->sendCommand(QByteArray::fromHex("3004"));
+    neard->removeTag();
+    QTRY_COMPARE(errorSpy.count(), 2);
+    QCOMPARE(errorSpy.last().at(0).value<QNearFieldTarget::Error>(),
+             QNearFieldTarget::TargetOutOfRangeError);
+    QCOMPARE(errorSpy.last().at(1).value<QNearFieldTarget::RequestId>(), abandoned);
+
+    manager.stopTargetDetection();
+}
+
+void tst_QNearFieldManagerNeard::type2Tlvs()
+{
+    QNdefNfcTextRecord text;
+    text.setLocale(QStringLiteral("en"));
+    text.setText(QString(300, QLatin1Char('x')));
+    const QByteArray ndef = QNdefMessage(text).toByteArray();
+    QVERIFY(ndef.size() > 0xff);
+
+    // Lock Control TLV reserving 2 bytes at offset 160, NULL TLV, NDEF TLV with a 3 byte length
+    QByteArray dense = QByteArray::fromHex("04a1b2c3" "d4e5f607" "08000000" "e1106d00"
+                                           "0103a01044" "00" "03ff");
+    dense += char(ndef.size() >> 8);
+    dense += char(ndef.size() & 0xff);
+    dense += ndef;
+    dense += char(0xfe);
+    QByteArray memory = dense.left(160) + QByteArray::fromHex("aabb") + dense.mid(160);
+    memory += QByteArray(16 + 0x6d * 8 - memory.size(), '\0');
+
+    QCOMPARE(QNearFieldTagType2Ndef::memorySize(memory.left(16)), 888);
+    QCOMPARE(QNearFieldTagType2Ndef::memorySize(QByteArray(16, '\0')), 0);
+
+    const QList<QNdefMessage> messages = QNearFieldTagType2Ndef::parseTlvs(memory);
+    QCOMPARE(messages.size(), 1);
+    QCOMPARE(messages.first(), QNdefMessage(text));
+
+    // A frame too short for FAST_READ still reads 4 blocks per command
+    const QList<QByteArray> commands = QNearFieldTagType2Ndef::fastReadCommands(888, 16);
+    QCOMPARE(commands.size(), 55);
+    QCOMPARE(commands.first(), QByteArray::fromHex("3a0407"));
+    QCOMPARE(commands.last(), QByteArray::fromHex("3adcdd"));
+    QCOMPARE(QNearFieldTagType2Ndef::responseOffset(commands.last()), 880);
+}
+
+void tst_QNearFieldManagerNeard::rawSocketClosed()
+{
+    QNearFieldManager manager;
+    QSignalSpy detectedSpy(&manager, &QNearFieldManager::targetDetected);
+    QVERIFY(manager.startTargetDetection(QNearFieldTarget::TagTypeSpecificAccess));
+
+    QNdefNfcTextRecord text;
+    text.setLocale(QStringLiteral("en"));
+    text.setText(QStringLiteral("closed"));
+    QVERIFY(neard->addTag(QNdefMessage(text)));
+    QTRY_COMPARE(detectedSpy.count(), 1);
+    QNearFieldTarget *target = detectedSpy.first().at(0).value<QNearFieldTarget *>();
+
+    // The socket closes while a command is in flight, the target stays in range
+    neard->answerAutomatically = false;
+    QSignalSpy errorSpy(target, &QNearFieldTarget::error);
+    const QNearFieldTarget::RequestId pending = target->sendCommand(QByteArray::fromHex("3000"));
+    QVERIFY(neard->hasRawSocket());
+    QTest::ignoreMessage(QtWarningMsg, "NFC raw socket was closed");
+    neard->dropRawSocket();
+    QTRY_COMPARE(errorSpy.count(), 1);
+    QCOMPARE(errorSpy.first().at(0).value<QNearFieldTarget::Error>(),
+             QNearFieldTarget::ConnectionError);
+    QCOMPARE(errorSpy.first().at(1).value<QNearFieldTarget::RequestId>(), pending);
+
+    // the next command opens a new socket
+    neard->answerAutomatically = true;
+    const QNearFieldTarget::RequestId readUid = target->sendCommand(QByteArray::fromHex("3000"));
+    QVERIFY(target->waitForRequestCompleted(readUid));
+    QCOMPARE(target->requestResponse(readUid).toByteArray(),
+             type2TagMemory(QNdefMessage(text)).left(16));
+    QCOMPARE(errorSpy.count(), 1);
+
+    neard->removeTag();
+    manager.stopTargetDetection();
+}
+
+QTEST_MAIN(tst_QNearFieldManagerNeard)
+
+#include "tst_qnearfieldmanager_neard.moc"
@@ -0,0 +1,106 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtBluetooth module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#include <QtTest/QtTest>
+
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+#include <malloc.h>
+#define HAVE_MALLINFO2
+#endif
+
+#include <QtBluetooth/qbluetoothaddress.h>
+#include <QtBluetooth/qbluetoothdeviceinfo.h>
+#include <QtBluetooth/qbluetoothuuid.h>
+#include <QtBluetooth/private/qbluetoothdeviceinfo_p.h>
+
+QT_USE_NAMESPACE
+
+/*
+ * Measures the heap used per QBluetoothDeviceInfo of a typical beacon, as
+ * seen by a device discovery which keeps many devices. The numbers come from
+ * the glibc allocator statistics and depend on its bookkeeping.
+ */
+class tst_bench_QBluetoothDeviceInfo : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void memoryFootprint();
+};
+
+void tst_bench_QBluetoothDeviceInfo::memoryFootprint()
+{
+#ifdef HAVE_MALLINFO2
+    // shared name, one service UUID and one manufacturer data entry
+    const int deviceCount = 50000;
+    const QString name = QStringLiteral("Beacon");
+    const QList<QBluetoothUuid> uuids = { QBluetoothUuid(quint16(0xfeaa)) };
+    const QByteArray payload(20, 'x');
+
+    // large blocks such as the list storage are served by mmap
+    const auto heapInUse = []() {
+        const struct mallinfo2 info = mallinfo2();
+        return info.uordblks + info.hblkhd;
+    };
+
+    const size_t before = heapInUse();
+    QList<QBluetoothDeviceInfo> devices;
+    devices.reserve(deviceCount);
+    for (int i = 0; i < deviceCount; ++i) {
+        QBluetoothDeviceInfo info(QBluetoothAddress(quint64(0x001122000000) + i),
+                                  QString(name.constData(), name.size()), 0);
+        info.setServiceUuids(uuids);
+        info.setManufacturerData(0x004c, QByteArray(payload.constData(), payload.size()));
+        devices.append(info);
+    }
+    const size_t after = heapInUse();
+
+    const qsizetype bytesPerDevice = qsizetype(after - before) / deviceCount;
+    QTest::setBenchmarkResult(qreal(bytesPerDevice), QTest::BytesAllocated);
+
+    // The list slot, one allocation for the private data and one for the payload. The name is
+    // interned, the UUID and the data entry are stored inline. Each allocation may add up to
+    // 32 bytes of allocator and byte array overhead.
+    const qsizetype bound = qsizetype(sizeof(QBluetoothDeviceInfo))
+            + qsizetype(sizeof(QBluetoothDeviceInfoPrivate)) + payload.size() + 2 * 32;
+    QVERIFY2(bytesPerDevice <= bound,
+             qPrintable(QStringLiteral("%1 bytes per device, expected at most %2")
+                        .arg(bytesPerDevice).arg(bound)));
+
+    QCOMPARE(devices.last().name(), name);
+    QCOMPARE(devices.last().serviceUuids(), uuids);
+    QCOMPARE(devices.last().manufacturerData(0x004c), payload);
+#else
+    QSKIP("Heap statistics are only available with glibc 2.33 or later");
+#endif
+}
+
+QTEST_MAIN(tst_bench_QBluetoothDeviceInfo)
+
+#include "tst_bench_qbluetoothdeviceinfo.moc"
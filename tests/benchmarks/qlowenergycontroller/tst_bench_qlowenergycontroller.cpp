@@ -0,0 +1,314 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtBluetooth module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#include <QtBluetooth/qbluetoothaddress.h>
+#include <QtBluetooth/qbluetoothdeviceinfo.h>
+#include <QtBluetooth/qlowenergycharacteristicdata.h>
+#include <QtBluetooth/qlowenergycontroller.h>
+#include <QtBluetooth/qlowenergydescriptordata.h>
+#include <QtBluetooth/qlowenergyservice.h>
+#include <QtBluetooth/qlowenergyservicedata.h>
+#include <QtCore/qendian.h>
+#include <QtCore/qscopedpointer.h>
+#include <QtTest/qsignalspy.h>
+#include <QtTest/QtTest>
+
+#if defined(CONFIG_BLUEZ_LE) && defined(QT_BUILD_INTERNAL)
+#include <QtBluetooth/private/attloopback_p.h>
+#endif
+
+QT_USE_NAMESPACE
+
+/*
+ * Benchmarks the GATT client and server engines of the BlueZ kernel backend.
+ * The central and the peripheral run in this process and are connected through
+ * an AttLoopback, no Bluetooth hardware is needed.
+ */
+class tst_bench_QLowEnergyController : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void discovery_data();
+    void discovery();
+    void readRoundTrip_data();
+    void readRoundTrip();
+    void writeRoundTrip_data();
+    void writeRoundTrip();
+    void notificationThroughput_data();
+    void notificationThroughput();
+
+#if defined(CONFIG_BLUEZ_LE) && defined(QT_BUILD_INTERNAL)
+private:
+    struct GattLink
+    {
+        AttLoopback loopback;
+        QScopedPointer<QLowEnergyController> peripheral;
+        QScopedPointer<QLowEnergyService> peripheralService;
+        QScopedPointer<QLowEnergyController> central;
+        QScopedPointer<QLowEnergyService> centralService;
+    };
+
+    static QLowEnergyServiceData gattDatabase(int characteristicCount, int valueSize);
+    static bool connectLink(GattLink &link, int characteristicCount, int valueSize, int latency);
+    static bool discoverLink(GattLink &link);
+    static int timeout(int latency) { return 5000 + 1000 * latency; }
+#endif
+};
+
+static void addLatencyColumn()
+{
+    QTest::addColumn<int>("latency");
+}
+
+void tst_bench_QLowEnergyController::initTestCase()
+{
+#if defined(CONFIG_BLUEZ_LE) && defined(QT_BUILD_INTERNAL)
+    // The loopback requires the kernel ATT backend for the central as well
+    qputenv("BLUETOOTH_FORCE_DBUS_LE_VERSION", "5.41");
+#else
+    QSKIP("GATT benchmarks only applicable for developer builds on Linux with BlueZ");
+#endif
+}
+
+#if defined(CONFIG_BLUEZ_LE) && defined(QT_BUILD_INTERNAL)
+static const QBluetoothUuid serviceUuid(quint16(0xfff0));
+
+static QBluetoothUuid characteristicUuid(int index)
+{
+    return QBluetoothUuid(quint16(0xf000 + index));
+}
+
+QLowEnergyServiceData tst_bench_QLowEnergyController::gattDatabase(int characteristicCount,
+                                                                   int valueSize)
+{
+    QLowEnergyServiceData serviceData;
+    serviceData.setUuid(serviceUuid);
+    const QLowEnergyDescriptorData clientConfig(
+                QBluetoothUuid::DescriptorType::ClientCharacteristicConfiguration,
+                QByteArray(2, 0));
+    for (int i = 0; i < characteristicCount; ++i) {
+        QLowEnergyCharacteristicData charData;
+        charData.setUuid(characteristicUuid(i));
+        charData.setProperties(QLowEnergyCharacteristic::Read | QLowEnergyCharacteristic::Write
+                               | QLowEnergyCharacteristic::Notify);
+        charData.setValue(QByteArray(valueSize, char('a' + i % 26)));
+        charData.addDescriptor(clientConfig);
+        serviceData.addCharacteristic(charData);
+    }
+    return serviceData;
+}
+
+bool tst_bench_QLowEnergyController::connectLink(GattLink &link, int characteristicCount,
+                                                 int valueSize, int latency)
+{
+    link.peripheral.reset(QLowEnergyController::createPeripheral());
+    link.peripheralService.reset(
+                link.peripheral->addService(gattDatabase(characteristicCount, valueSize)));
+    if (link.peripheralService.isNull())
+        return false;
+
+    const QBluetoothDeviceInfo remote(QBluetoothAddress(QStringLiteral("00:11:22:33:44:55")),
+                                      QStringLiteral("loopback"), 0);
+    link.central.reset(QLowEnergyController::createCentral(remote));
+
+    link.loopback.setLatency(latency);
+    return link.loopback.connectControllers(link.central.data(), link.peripheral.data())
+            && link.central->state() == QLowEnergyController::ConnectedState;
+}
+
+bool tst_bench_QLowEnergyController::discoverLink(GattLink &link)
+{
+    QSignalSpy discoveryFinished(link.central.data(), &QLowEnergyController::discoveryFinished);
+    link.central->discoverServices();
+    if (!discoveryFinished.wait(timeout(link.loopback.latency())))
+        return false;
+
+    link.centralService.reset(link.central->createServiceObject(serviceUuid));
+    if (link.centralService.isNull())
+        return false;
+    link.centralService->discoverDetails();
+    QDeadlineTimer deadline(timeout(link.loopback.latency()));
+    while (link.centralService->state() != QLowEnergyService::RemoteServiceDiscovered) {
+        if (deadline.hasExpired())
+            return false;
+        QTest::qWait(0);
+    }
+    return true;
+}
+#endif
+
+void tst_bench_QLowEnergyController::discovery_data()
+{
+    QTest::addColumn<int>("characteristics");
+    addLatencyColumn();
+
+    for (int latency : { 0, 5 }) {
+        for (int characteristics : { 1, 10, 100 }) {
+            QTest::addRow("%d characteristics, %d ms", characteristics, latency)
+                    << characteristics << latency;
+        }
+    }
+}
+
+void tst_bench_QLowEnergyController::discovery()
+{
+#if defined(CONFIG_BLUEZ_LE) && defined(QT_BUILD_INTERNAL)
+    QFETCH(int, characteristics);
+    QFETCH(int, latency);
+
+    QBENCHMARK {
+        GattLink link;
+        QVERIFY(connectLink(link, characteristics, 20, latency));
+        QVERIFY(discoverLink(link));
+        QCOMPARE(link.centralService->characteristics().size(), characteristics);
+    }
+#endif
+}
+
+void tst_bench_QLowEnergyController::readRoundTrip_data()
+{
+    QTest::addColumn<int>("valueSize");
+    addLatencyColumn();
+
+    for (int latency : { 0, 5 }) {
+        // 512 bytes do not fit into one PDU and take Read Blob requests
+        for (int valueSize : { 20, 512 })
+            QTest::addRow("%d bytes, %d ms", valueSize, latency) << valueSize << latency;
+    }
+}
+
+void tst_bench_QLowEnergyController::readRoundTrip()
+{
+#if defined(CONFIG_BLUEZ_LE) && defined(QT_BUILD_INTERNAL)
+    QFETCH(int, valueSize);
+    QFETCH(int, latency);
+
+    GattLink link;
+    QVERIFY(connectLink(link, 1, valueSize, latency));
+    QVERIFY(discoverLink(link));
+    const QLowEnergyCharacteristic characteristic =
+            link.centralService->characteristic(characteristicUuid(0));
+    QVERIFY(characteristic.isValid());
+
+    QSignalSpy readSpy(link.centralService.data(), &QLowEnergyService::characteristicRead);
+    QBENCHMARK {
+        readSpy.clear();
+        link.centralService->readCharacteristic(characteristic);
+        QVERIFY(readSpy.wait(timeout(latency)));
+    }
+    QCOMPARE(readSpy.first().at(1).toByteArray().size(), valueSize);
+#endif
+}
+
+void tst_bench_QLowEnergyController::writeRoundTrip_data()
+{
+    addLatencyColumn();
+
+    for (int latency : { 0, 5 })
+        QTest::addRow("%d ms", latency) << latency;
+}
+
+void tst_bench_QLowEnergyController::writeRoundTrip()
+{
+#if defined(CONFIG_BLUEZ_LE) && defined(QT_BUILD_INTERNAL)
+    QFETCH(int, latency);
+
+    GattLink link;
+    QVERIFY(connectLink(link, 1, 20, latency));
+    QVERIFY(discoverLink(link));
+    const QLowEnergyCharacteristic characteristic =
+            link.centralService->characteristic(characteristicUuid(0));
+    QVERIFY(characteristic.isValid());
+
+    QSignalSpy writeSpy(link.centralService.data(), &QLowEnergyService::characteristicWritten);
+    quint32 counter = 0;
+    QBENCHMARK {
+        writeSpy.clear();
+        QByteArray value(20, 0);
+        qToLittleEndian(counter++, value.data());
+        link.centralService->writeCharacteristic(characteristic, value);
+        QVERIFY(writeSpy.wait(timeout(latency)));
+    }
+#endif
+}
+
+void tst_bench_QLowEnergyController::notificationThroughput_data()
+{
+    addLatencyColumn();
+
+    for (int latency : { 0, 5 })
+        QTest::addRow("%d ms", latency) << latency;
+}
+
+void tst_bench_QLowEnergyController::notificationThroughput()
+{
+#if defined(CONFIG_BLUEZ_LE) && defined(QT_BUILD_INTERNAL)
+    QFETCH(int, latency);
+    constexpr int notificationsPerIteration = 1000;
+
+    GattLink link;
+    QVERIFY(connectLink(link, 1, 20, latency));
+    QVERIFY(discoverLink(link));
+    const QLowEnergyCharacteristic characteristic =
+            link.centralService->characteristic(characteristicUuid(0));
+    const QLowEnergyDescriptor clientConfig = characteristic.clientCharacteristicConfiguration();
+    QVERIFY(clientConfig.isValid());
+    QSignalSpy descriptorSpy(link.centralService.data(), &QLowEnergyService::descriptorWritten);
+    link.centralService->writeDescriptor(clientConfig,
+                                         QLowEnergyCharacteristic::CCCDEnableNotification);
+    QVERIFY(descriptorSpy.wait(timeout(latency)));
+
+    const QLowEnergyCharacteristic source =
+            link.peripheralService->characteristic(characteristicUuid(0));
+    QByteArray lastReceived;
+    connect(link.centralService.data(), &QLowEnergyService::characteristicChanged, this,
+            [&lastReceived](const QLowEnergyCharacteristic &, const QByteArray &value) {
+        lastReceived = value;
+    });
+
+    // Notifications queued behind a full socket may be coalesced, only the
+    // arrival of the last value is guaranteed.
+    quint32 counter = 0;
+    QBENCHMARK {
+        QByteArray value(20, 0);
+        for (int i = 0; i < notificationsPerIteration; ++i) {
+            qToLittleEndian(++counter, value.data());
+            link.peripheralService->writeCharacteristic(source, value);
+        }
+        QTRY_COMPARE_WITH_TIMEOUT(lastReceived, value, timeout(latency));
+    }
+#endif
+}
+
+QTEST_MAIN(tst_bench_QLowEnergyController)
+
+#include "tst_bench_qlowenergycontroller.moc"
@@ -0,0 +1,145 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtNfc module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#include <QtCore/QSettings>
+#include <QtNfc/qndefmessage.h>
+#include <QtNfc/qndefnfctextrecord.h>
+#include <QtNfc/private/qnearfieldtagtype2ndef_p.h>
+#include <QtTest/QtTest>
+
+#include "targetemulator_p.h"
+
+QT_USE_NAMESPACE
+
+/*
+ * Compares reading the NDEF message of a Type 2 tag with one READ command
+ * per 16 bytes against the FAST_READ commands QtNfc sends. Both read the
+ * complete memory of the same NTAG216 emulator and parse it with the same
+ * TLV parser, only the number of command frames differs.
+ */
+class tst_bench_QNearFieldTagType2 : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void readNdefMessage_data();
+    void readNdefMessage();
+
+private:
+    QByteArray transceive(const QByteArray &command);
+    QByteArray readMemory(bool fastRead, int *frames);
+
+    NfcTagType2 tag;
+};
+
+void tst_bench_QNearFieldTagType2::initTestCase()
+{
+    QSettings settings(QFINDTESTDATA("nfcdata/NTAG216 Tag.nfc"), QSettings::IniFormat);
+    tag.load(&settings);
+    QVERIFY(!tag.uid().isEmpty());
+}
+
+// Adds and checks the CRC the way an NFC controller does
+QByteArray tst_bench_QNearFieldTagType2::transceive(const QByteArray &command)
+{
+    const quint16 crc = qChecksum(QByteArrayView(command), Qt::ChecksumItuV41);
+    QByteArray response = tag.processCommand(command + char(crc & 0xff) + char(crc >> 8));
+    if (response.size() <= 2 || qChecksum(QByteArrayView(response), Qt::ChecksumItuV41) != 0)
+        return QByteArray();
+    response.chop(2);
+    return response;
+}
+
+QByteArray tst_bench_QNearFieldTagType2::readMemory(bool fastRead, int *frames)
+{
+    QByteArray memory = transceive(QNearFieldTagType2Ndef::readCommand(0));
+    *frames = 1;
+
+    const int memorySize = QNearFieldTagType2Ndef::memorySize(memory);
+    if (memorySize == 0)
+        return QByteArray();
+    memory.resize(memorySize);
+
+    QList<QByteArray> commands;
+    if (fastRead) {
+        // the frame size QtNfc uses for Type 2 tags
+        commands = QNearFieldTagType2Ndef::fastReadCommands(memorySize, 255);
+    } else {
+        for (int block = QNearFieldTagType2Ndef::HeaderSize / 4; block < memorySize / 4; block += 4)
+            commands.append(QNearFieldTagType2Ndef::readCommand(quint8(block)));
+    }
+
+    for (const QByteArray &command : qAsConst(commands)) {
+        const QByteArray response = transceive(command);
+        const int offset = QNearFieldTagType2Ndef::responseOffset(command);
+        const qsizetype size = qMin(response.size(), memory.size() - offset);
+        memory.replace(offset, size, response.constData(), size);
+    }
+    *frames += commands.size();
+
+    return memory;
+}
+
+void tst_bench_QNearFieldTagType2::readNdefMessage_data()
+{
+    QTest::addColumn<bool>("fastRead");
+    QTest::addColumn<int>("expectedFrames");
+
+    // 888 bytes of memory: the header plus 872 bytes of data area
+    QTest::newRow("READ") << false << 1 + 55;
+    QTest::newRow("FAST_READ") << true << 1 + 4;
+}
+
+void tst_bench_QNearFieldTagType2::readNdefMessage()
+{
+    QFETCH(bool, fastRead);
+    QFETCH(int, expectedFrames);
+
+    int frames = 0;
+    const QByteArray memory = readMemory(fastRead, &frames);
+    QCOMPARE(memory.size(), 888);
+    QCOMPARE(frames, expectedFrames);
+
+    const QList<QNdefMessage> messages = QNearFieldTagType2Ndef::parseTlvs(memory);
+    QCOMPARE(messages.size(), 1);
+    QCOMPARE(messages.first().size(), 1);
+    QVERIFY(messages.first().first().isRecordType<QNdefNfcTextRecord>());
+
+    QBENCHMARK {
+        const QList<QNdefMessage> read =
+                QNearFieldTagType2Ndef::parseTlvs(readMemory(fastRead, &frames));
+        QCOMPARE(read, messages);
+    }
+}
+
+QTEST_MAIN(tst_bench_QNearFieldTagType2)
+
+#include "tst_bench_qnearfieldtagtype2.moc"